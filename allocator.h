@@ -0,0 +1,314 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Tagged tracking allocator.
+//
+// mem_alloc() and friends sit on top of malloc and charge every block to the subsystem tag it
+// was allocated with: live bytes and blocks, the peak of live bytes, totals since startup, and
+// the allocations made since the last mem_end_frame() (the frame's churn). Counters are atomics,
+// any thread can allocate and free. Blocks carry a small header in front of them, so memory from
+// mem_alloc() goes back through mem_free() and nothing else; mem_free() finds the tag there.
+//
+// With MEM_TRACK_SITES (the default outside NDEBUG builds) live blocks are also linked in a list
+// with the file and line that allocated them, and mem_report_leaks() lists what is still alive.
+
+#ifndef MEMAPI
+#   define MEMAPI extern
+#endif
+
+#ifndef MEM_TRACK_SITES
+#   if defined(NDEBUG)
+#       define MEM_TRACK_SITES 0
+#   else
+#       define MEM_TRACK_SITES 1
+#   endif
+#endif
+
+typedef enum mem_tag_enum {
+    MEM_TAG_GENERAL,
+    MEM_TAG_AUDIO,
+    MEM_TAG_RENDER,
+    MEM_TAG_IO,
+    MEM_TAG_ASSETS,
+    MEM_TAG_PLATFORM,
+    MEM_TAG_COUNT
+} mem_tag_t;
+
+typedef struct MemTagStats_st MemTagStats_t;
+
+struct MemTagStats_st {
+    uint64_t live_bytes;
+    uint64_t live_blocks;
+    uint64_t peak_bytes;
+    uint64_t total_allocs;
+    uint64_t total_bytes;
+    // the last finished frame, see mem_end_frame().
+    uint64_t frame_allocs;
+    uint64_t frame_bytes;
+};
+
+#define mem_alloc(tag, size)          mem__alloc((tag), (size), __FILE__, __LINE__)
+#define mem_calloc(tag, count, size)  mem__calloc((tag), (count), (size), __FILE__, __LINE__)
+#define mem_realloc(tag, ptr, size)   mem__realloc((tag), (ptr), (size), __FILE__, __LINE__)
+
+MEMAPI void*         mem__alloc(mem_tag_t tag, size_t size, const char* file, int line);
+MEMAPI void*         mem__calloc(mem_tag_t tag, size_t count, size_t size, const char* file, int line);
+// a block keeps the tag it was first allocated with.
+MEMAPI void*         mem__realloc(mem_tag_t tag, void* ptr, size_t size, const char* file, int line);
+MEMAPI void          mem_free(void* ptr);
+
+// closes the frame's churn counters, once per frame from the main loop.
+MEMAPI void          mem_end_frame(void);
+MEMAPI MemTagStats_t mem_tag_stats(mem_tag_t tag);
+// allocations since the last mem_end_frame(), every tag.
+MEMAPI uint64_t      mem_frame_allocs(void);
+MEMAPI const char*   mem_tag_name(mem_tag_t tag);
+MEMAPI void          mem_print_stats(void);
+// prints every live block (or only the per tag totals without MEM_TRACK_SITES), returns how many.
+MEMAPI uint64_t      mem_report_leaks(void);
+
+#ifdef ALLOCATOR_IMPLEMENTATION
+
+typedef struct MemHeader_st MemHeader_t;
+
+struct MemHeader_st {
+    size_t       size;
+    uint32_t     tag;
+    int32_t      line;
+    const char*  file;
+    MemHeader_t* prev;
+    MemHeader_t* next;
+};
+
+// keeps the block at malloc's alignment.
+#define MEM_HEADER_SIZE ((sizeof(MemHeader_t) + 15) & ~(size_t) 15)
+
+typedef struct MemTagCounters_st MemTagCounters_t;
+
+struct MemTagCounters_st {
+    atomic_uint_fast64_t live_bytes;
+    atomic_uint_fast64_t live_blocks;
+    atomic_uint_fast64_t peak_bytes;
+    atomic_uint_fast64_t total_allocs;
+    atomic_uint_fast64_t total_bytes;
+    atomic_uint_fast64_t frame_allocs;
+    atomic_uint_fast64_t frame_bytes;
+    // copied out by mem_end_frame().
+    atomic_uint_fast64_t last_frame_allocs;
+    atomic_uint_fast64_t last_frame_bytes;
+};
+
+static const char* const MEM_TAG_NAMES[MEM_TAG_COUNT] = {
+    "general",
+    "audio",
+    "render",
+    "io",
+    "assets",
+    "platform",
+};
+
+static struct {
+    MemTagCounters_t tags[MEM_TAG_COUNT];
+
+#if MEM_TRACK_SITES
+    atomic_flag      lock;
+    MemHeader_t*     live;
+#endif
+} s_mem;
+
+static MemHeader_t* mem__header(void* ptr) {
+    return (MemHeader_t*)((char*) ptr - MEM_HEADER_SIZE);
+}
+
+#if MEM_TRACK_SITES
+static void mem__lock(void) {
+    while (atomic_flag_test_and_set_explicit(&s_mem.lock, memory_order_acquire)) {}
+}
+
+static void mem__unlock(void) {
+    atomic_flag_clear_explicit(&s_mem.lock, memory_order_release);
+}
+
+static void mem__link(MemHeader_t* header) {
+    mem__lock();
+    header->prev = NULL;
+    header->next = s_mem.live;
+    if (s_mem.live) s_mem.live->prev = header;
+    s_mem.live = header;
+    mem__unlock();
+}
+
+static void mem__unlink(MemHeader_t* header) {
+    mem__lock();
+    if (header->prev) header->prev->next = header->next;
+    else              s_mem.live         = header->next;
+    if (header->next) header->next->prev = header->prev;
+    mem__unlock();
+}
+#else
+static void mem__link(MemHeader_t* header)   { (void) header; }
+static void mem__unlink(MemHeader_t* header) { (void) header; }
+#endif // MEM_TRACK_SITES
+
+static void mem__charge(mem_tag_t tag, size_t size) {
+    MemTagCounters_t* c = &s_mem.tags[tag];
+
+    uint64_t live = atomic_fetch_add_explicit(&c->live_bytes, size, memory_order_relaxed) + size;
+    atomic_fetch_add_explicit(&c->live_blocks,  1,    memory_order_relaxed);
+    atomic_fetch_add_explicit(&c->total_allocs, 1,    memory_order_relaxed);
+    atomic_fetch_add_explicit(&c->total_bytes,  size, memory_order_relaxed);
+    atomic_fetch_add_explicit(&c->frame_allocs, 1,    memory_order_relaxed);
+    atomic_fetch_add_explicit(&c->frame_bytes,  size, memory_order_relaxed);
+
+    uint64_t peak = atomic_load_explicit(&c->peak_bytes, memory_order_relaxed);
+    while (live > peak && !atomic_compare_exchange_weak_explicit(&c->peak_bytes, &peak, live,
+                                                                  memory_order_relaxed, memory_order_relaxed)) {}
+}
+
+static void mem__release(mem_tag_t tag, size_t size) {
+    MemTagCounters_t* c = &s_mem.tags[tag];
+
+    atomic_fetch_sub_explicit(&c->live_bytes,  size, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&c->live_blocks, 1,    memory_order_relaxed);
+}
+
+MEMAPI void* mem__alloc(mem_tag_t tag, size_t size, const char* file, int line) {
+    if (tag >= MEM_TAG_COUNT) tag = MEM_TAG_GENERAL;
+
+    MemHeader_t* header = malloc(MEM_HEADER_SIZE + size);
+    if (!header) return NULL;
+
+    header->size = size;
+    header->tag  = (uint32_t) tag;
+    header->file = file;
+    header->line = line;
+
+    mem__link(header);
+    mem__charge(tag, size);
+
+    return (char*) header + MEM_HEADER_SIZE;
+}
+
+MEMAPI void* mem__calloc(mem_tag_t tag, size_t count, size_t size, const char* file, int line) {
+    if (size && count > SIZE_MAX / size) return NULL;
+
+    void* ptr = mem__alloc(tag, count * size, file, line);
+    if (ptr) memset(ptr, 0, count * size);
+    return ptr;
+}
+
+MEMAPI void* mem__realloc(mem_tag_t tag, void* ptr, size_t size, const char* file, int line) {
+    if (!ptr) return mem__alloc(tag, size, file, line);
+
+    MemHeader_t* header = mem__header(ptr);
+    size_t       old    = header->size;
+
+    // unlinked while it may move, the list never sees a freed header.
+    mem__unlink(header);
+
+    MemHeader_t* moved = realloc(header, MEM_HEADER_SIZE + size);
+    if (!moved) {
+        mem__link(header);
+        return NULL;
+    }
+
+    moved->size = size;
+    moved->file = file;
+    moved->line = line;
+    mem__link(moved);
+
+    mem__release((mem_tag_t) moved->tag, old);
+    mem__charge((mem_tag_t) moved->tag, size);
+
+    return (char*) moved + MEM_HEADER_SIZE;
+}
+
+MEMAPI void mem_free(void* ptr) {
+    if (!ptr) return;
+
+    MemHeader_t* header = mem__header(ptr);
+
+    mem__unlink(header);
+    mem__release((mem_tag_t) header->tag, header->size);
+    free(header);
+}
+
+MEMAPI void mem_end_frame(void) {
+    for (int i = 0; i < MEM_TAG_COUNT; ++i) {
+        MemTagCounters_t* c = &s_mem.tags[i];
+
+        atomic_store_explicit(&c->last_frame_allocs, atomic_exchange_explicit(&c->frame_allocs, 0, memory_order_relaxed), memory_order_relaxed);
+        atomic_store_explicit(&c->last_frame_bytes,  atomic_exchange_explicit(&c->frame_bytes,  0, memory_order_relaxed), memory_order_relaxed);
+    }
+}
+
+MEMAPI MemTagStats_t mem_tag_stats(mem_tag_t tag) {
+    if (tag >= MEM_TAG_COUNT) return (MemTagStats_t) {0};
+
+    MemTagCounters_t* c = &s_mem.tags[tag];
+    return (MemTagStats_t) {
+        .live_bytes   = atomic_load_explicit(&c->live_bytes,        memory_order_relaxed),
+        .live_blocks  = atomic_load_explicit(&c->live_blocks,       memory_order_relaxed),
+        .peak_bytes   = atomic_load_explicit(&c->peak_bytes,        memory_order_relaxed),
+        .total_allocs = atomic_load_explicit(&c->total_allocs,      memory_order_relaxed),
+        .total_bytes  = atomic_load_explicit(&c->total_bytes,       memory_order_relaxed),
+        .frame_allocs = atomic_load_explicit(&c->last_frame_allocs, memory_order_relaxed),
+        .frame_bytes  = atomic_load_explicit(&c->last_frame_bytes,  memory_order_relaxed),
+    };
+}
+
+MEMAPI uint64_t mem_frame_allocs(void) {
+    uint64_t count = 0;
+    for (int i = 0; i < MEM_TAG_COUNT; ++i) {
+        count += atomic_load_explicit(&s_mem.tags[i].frame_allocs, memory_order_relaxed);
+    }
+    return count;
+}
+
+MEMAPI const char* mem_tag_name(mem_tag_t tag) {
+    return tag < MEM_TAG_COUNT ? MEM_TAG_NAMES[tag] : "?";
+}
+
+MEMAPI void mem_print_stats(void) {
+    printf("memory:  %-9s %10s %8s %10s %10s %12s\n", "tag", "live MB", "blocks", "peak MB", "allocs", "last frame");
+
+    for (int i = 0; i < MEM_TAG_COUNT; ++i) {
+        MemTagStats_t s = mem_tag_stats((mem_tag_t) i);
+        if (!s.total_allocs) continue;
+
+        printf("         %-9s %10.2f %8llu %10.2f %10llu %6llu / %3.0f KB\n", MEM_TAG_NAMES[i],
+            s.live_bytes / (1024.0 * 1024.0), (unsigned long long) s.live_blocks, s.peak_bytes / (1024.0 * 1024.0),
+            (unsigned long long) s.total_allocs, (unsigned long long) s.frame_allocs, s.frame_bytes / 1024.0);
+    }
+}
+
+MEMAPI uint64_t mem_report_leaks(void) {
+    uint64_t blocks = 0;
+    for (int i = 0; i < MEM_TAG_COUNT; ++i) {
+        MemTagStats_t s = mem_tag_stats((mem_tag_t) i);
+        if (!s.live_blocks) continue;
+
+        printf("memory: %llu %s blocks (%llu bytes) still alive\n", (unsigned long long) s.live_blocks,
+            MEM_TAG_NAMES[i], (unsigned long long) s.live_bytes);
+        blocks += s.live_blocks;
+    }
+
+#if MEM_TRACK_SITES
+    mem__lock();
+    for (MemHeader_t* h = s_mem.live; h; h = h->next) {
+        printf("  %-9s %10zu bytes  %s:%d\n", MEM_TAG_NAMES[h->tag], h->size, h->file, h->line);
+    }
+    mem__unlock();
+#endif // MEM_TRACK_SITES
+
+    return blocks;
+}
+
+#endif // ALLOCATOR_IMPLEMENTATION
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "allocator.h"
+
+// Linear arenas.
+//
+// An arena hands out memory by bumping an offset through a chain of blocks taken from
+// mem_alloc(). Nothing is freed one allocation at a time: arena_reset() rewinds the whole arena,
+// arena_restore() rewinds to a marker from arena_save(). Blocks are kept across rewinds, so once
+// an arena has grown to what a frame needs it never touches the heap again.
+//
+// Two kinds are kept ready:
+//   - the frame arena, double buffered: frame_alloc() memory stays valid until the end of the
+//     next frame, frame_arena_swap() at the top of every frame rewinds the older half. Main
+//     thread only.
+//   - scratch arenas, one per thread (created on its first scratch_arena() call), for temporary
+//     work bracketed by arena_save() / arena_restore().
+
+#ifndef ARENAAPI
+#   define ARENAAPI extern
+#endif
+
+#define ARENA_DEFAULT_BLOCK      (256 * 1024)
+#define ARENA_FRAME_BLOCK        (1024 * 1024)
+#define ARENA_SCRATCH_BLOCK      (1024 * 1024)
+#define ARENA_MAX_SCRATCH        64
+#define ARENA_DEFAULT_ALIGNMENT  16
+
+typedef struct ArenaBlock_st  ArenaBlock_t;
+typedef struct Arena_st       Arena_t;
+typedef struct ArenaMarker_st ArenaMarker_t;
+
+struct ArenaBlock_st {
+    ArenaBlock_t* next;
+    size_t        capacity;
+};
+
+struct Arena_st {
+    ArenaBlock_t* first;
+    ArenaBlock_t* current;
+    size_t        offset;       // into `current`
+    size_t        block_size;
+    mem_tag_t     tag;
+};
+
+struct ArenaMarker_st {
+    ArenaBlock_t* block;
+    size_t        offset;
+};
+
+// takes the first block right away when `block_size` is not 0 (0 picks ARENA_DEFAULT_BLOCK lazily).
+ARENAAPI bool          arena_init(Arena_t* arena, mem_tag_t tag, size_t block_size);
+ARENAAPI void          arena_release(Arena_t* arena);
+// `align` a power of two. NULL only when a new block couldn't be allocated.
+ARENAAPI void*         arena_alloc(Arena_t* arena, size_t size, size_t align);
+ARENAAPI void          arena_reset(Arena_t* arena);
+ARENAAPI ArenaMarker_t arena_save(const Arena_t* arena);
+ARENAAPI void          arena_restore(Arena_t* arena, ArenaMarker_t marker);
+// bytes in blocks, whether in use or not.
+ARENAAPI size_t        arena_capacity(const Arena_t* arena);
+
+ARENAAPI bool          frame_arena_init(size_t block_size);
+ARENAAPI void          frame_arena_shutdown(void);
+ARENAAPI void          frame_arena_swap(void);
+ARENAAPI void*         frame_alloc(size_t size);
+
+// the calling thread's scratch arena, NULL if out of slots.
+ARENAAPI Arena_t*      scratch_arena(void);
+// every thread's, once none of them uses its scratch arena anymore.
+ARENAAPI void          scratch_shutdown(void);
+
+#ifdef ARENA_IMPLEMENTATION
+
+#define ARENA_BLOCK_HEADER ((sizeof(ArenaBlock_t) + ARENA_DEFAULT_ALIGNMENT - 1) & ~(size_t)(ARENA_DEFAULT_ALIGNMENT - 1))
+
+static struct {
+    Arena_t              frame[2];
+    int                  frame_index;
+
+    Arena_t*             scratch[ARENA_MAX_SCRATCH];
+    atomic_int           scratch_count;
+} s_arena;
+
+static _Thread_local Arena_t* t_scratch_arena;
+
+static ArenaBlock_t* arena__new_block(Arena_t* arena, size_t min_size) {
+    size_t capacity = arena->block_size > min_size ? arena->block_size : min_size;
+
+    ArenaBlock_t* block = mem_alloc(arena->tag, ARENA_BLOCK_HEADER + capacity);
+    if (!block) return NULL;
+
+    block->next     = NULL;
+    block->capacity = capacity;
+    return block;
+}
+
+static char* arena__block_data(ArenaBlock_t* block) {
+    return (char*) block + ARENA_BLOCK_HEADER;
+}
+
+ARENAAPI bool arena_init(Arena_t* arena, mem_tag_t tag, size_t block_size) {
+    *arena = (Arena_t) {
+        .block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK,
+        .tag        = tag
+    };
+
+    if (!block_size) return true;
+
+    arena->first = arena->current = arena__new_block(arena, 0);
+    return arena->first != NULL;
+}
+
+ARENAAPI void arena_release(Arena_t* arena) {
+    for (ArenaBlock_t* block = arena->first; block;) {
+        ArenaBlock_t* next = block->next;
+        mem_free(block);
+        block = next;
+    }
+
+    arena->first = arena->current = NULL;
+    arena->offset = 0;
+}
+
+ARENAAPI void* arena_alloc(Arena_t* arena, size_t size, size_t align) {
+    if (align < 1) align = 1;
+
+    ArenaBlock_t* block  = arena->current;
+    size_t        offset = arena->offset;
+
+    // blocks past the current one are left over from before a rewind, reused before growing.
+    while (block) {
+        size_t aligned = (offset + align - 1) & ~(align - 1);
+        if (aligned + size <= block->capacity) {
+            arena->current = block;
+            arena->offset  = aligned + size;
+            return arena__block_data(block) + aligned;
+        }
+
+        if (!block->next) break;
+        block  = block->next;
+        offset = 0;
+    }
+
+    ArenaBlock_t* fresh = arena__new_block(arena, size + align);
+    if (!fresh) return NULL;
+
+    if (block) block->next   = fresh;
+    else       arena->first  = fresh;
+
+    size_t aligned = ((uintptr_t) arena__block_data(fresh) + align - 1) & ~(uintptr_t)(align - 1);
+    aligned       -= (uintptr_t) arena__block_data(fresh);
+
+    arena->current = fresh;
+    arena->offset  = aligned + size;
+    return arena__block_data(fresh) + aligned;
+}
+
+ARENAAPI void arena_reset(Arena_t* arena) {
+    arena->current = arena->first;
+    arena->offset  = 0;
+}
+
+ARENAAPI ArenaMarker_t arena_save(const Arena_t* arena) {
+    return (ArenaMarker_t) { arena->current, arena->offset };
+}
+
+ARENAAPI void arena_restore(Arena_t* arena, ArenaMarker_t marker) {
+    // a marker taken before the first block existed rewinds to the start.
+    if (!marker.block) {
+        arena_reset(arena);
+        return;
+    }
+
+    arena->current = marker.block;
+    arena->offset  = marker.offset;
+}
+
+ARENAAPI size_t arena_capacity(const Arena_t* arena) {
+    size_t capacity = 0;
+    for (const ArenaBlock_t* block = arena->first; block; block = block->next) capacity += block->capacity;
+    return capacity;
+}
+
+ARENAAPI bool frame_arena_init(size_t block_size) {
+    if (!block_size) block_size = ARENA_FRAME_BLOCK;
+
+    bool ok = arena_init(&s_arena.frame[0], MEM_TAG_GENERAL, block_size)
+           && arena_init(&s_arena.frame[1], MEM_TAG_GENERAL, block_size);
+
+    s_arena.frame_index = 0;
+    return ok;
+}
+
+ARENAAPI void frame_arena_shutdown(void) {
+    arena_release(&s_arena.frame[0]);
+    arena_release(&s_arena.frame[1]);
+}
+
+ARENAAPI void frame_arena_swap(void) {
+    s_arena.frame_index ^= 1;
+    arena_reset(&s_arena.frame[s_arena.frame_index]);
+}
+
+ARENAAPI void* frame_alloc(size_t size) {
+    return arena_alloc(&s_arena.frame[s_arena.frame_index], size, ARENA_DEFAULT_ALIGNMENT);
+}
+
+ARENAAPI Arena_t* scratch_arena(void) {
+    if (t_scratch_arena) return t_scratch_arena;
+
+    int index = atomic_fetch_add(&s_arena.scratch_count, 1);
+    if (index >= ARENA_MAX_SCRATCH) {
+        fprintf(stderr, "arena: out of scratch arenas (%d threads)\n", ARENA_MAX_SCRATCH);
+        return NULL;
+    }
+
+    Arena_t* arena = mem_alloc(MEM_TAG_GENERAL, sizeof(Arena_t));
+    if (!arena || !arena_init(arena, MEM_TAG_GENERAL, ARENA_SCRATCH_BLOCK)) {
+        mem_free(arena);
+        return NULL;
+    }
+
+    s_arena.scratch[index] = arena;
+    t_scratch_arena        = arena;
+    return arena;
+}
+
+ARENAAPI void scratch_shutdown(void) {
+    int count = atomic_load(&s_arena.scratch_count);
+    if (count > ARENA_MAX_SCRATCH) count = ARENA_MAX_SCRATCH;
+
+    for (int i = 0; i < count; ++i) {
+        if (!s_arena.scratch[i]) continue;
+
+        arena_release(s_arena.scratch[i]);
+        mem_free(s_arena.scratch[i]);
+        s_arena.scratch[i] = NULL;
+    }
+
+    atomic_store(&s_arena.scratch_count, 0);
+    t_scratch_arena = NULL;
+}
+
+#endif // ARENA_IMPLEMENTATION
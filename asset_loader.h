@@ -0,0 +1,374 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "file.h"
+#include "gl_gfx.h"
+#include "jobs.h"
+#include "async_io.h"
+#include "cooked_texture.h"
+#include "material.h"
+#include "asset_registry.h"
+#include "profiler.h"
+
+// Startup asset pipeline.
+//
+// Every asset added to the loader is read right away through async_io.h, all reads in flight
+// together, and images are decoded on the job pool as their bytes arrive. No worker sits
+// blocked on the disk. startup_loader_finish() runs on the GL thread: it compiles programs and uploads
+// textures as soon as their data arrives, so GL work overlaps with the remaining decodes.
+// Each stage is timestamped and startup_loader_print_timeline() shows where time went.
+// Textures with a cooked sibling (name.ctex, see cooked_texture.h) are mapped instead of decoded.
+// Textures go through the asset registry: a path it already holds isn't read again, and a file
+// whose bytes match a loaded one shares that texture instead of being uploaded.
+
+#define ASSETLOADERAPI static
+
+#ifndef STARTUP_LOADER_MAX_ITEMS
+#   define STARTUP_LOADER_MAX_ITEMS 128
+#endif
+
+typedef struct StartupLoader_st  StartupLoader_t;
+typedef struct AssetLoadItem_st  AssetLoadItem_t;
+
+typedef enum asset_load_kind_enum {
+    ASSET_LOAD_PROGRAM,
+    ASSET_LOAD_TEXTURE
+} asset_load_kind_t;
+
+struct AssetLoadItem_st {
+    asset_load_kind_t  kind;
+    StartupLoader_t*   loader;
+    const char*        paths[2];
+    int                path_count;
+
+    GLProgram_t*       program_out;
+    AssetHandle_t*     texture_out;
+
+    // filled by the I/O thread and the worker
+    AsyncRead_t        reads[2];
+    atomic_int         reads_pending;
+    File_t             files[2];
+    unsigned char*     pixels;
+    int                width, height, channels;
+    CookedTexture_t    cooked;
+    bool               is_cooked;
+    uint64_t           content_hash;
+    bool               failed;
+
+    // timeline, in ns from get_time_ns()
+    int                worker;
+    uint64_t           io_begin, io_end;
+    uint64_t           decode_end;
+    uint64_t           gl_begin, gl_end;
+
+    AssetLoadItem_t*   next_done;
+};
+
+struct StartupLoader_st {
+    AssetLoadItem_t   items[STARTUP_LOADER_MAX_ITEMS];
+    int               count;
+
+    JobGroup_t        group;
+    Mutex_t           lock;
+    CondVar_t         cv;
+    AssetLoadItem_t*  done;     // completed by workers, not yet consumed by the GL thread
+
+    uint64_t          begin_ns;
+    uint64_t          end_ns;
+    uint64_t          gl_wait_ns;
+};
+
+uint64_t get_time_ns();
+
+ASSETLOADERAPI void startup_loader_begin(StartupLoader_t* loader);
+ASSETLOADERAPI bool startup_loader_add_program(StartupLoader_t* loader, GLProgram_t* out, const char* vs_path, const char* fs_path);
+ASSETLOADERAPI bool startup_loader_add_texture(StartupLoader_t* loader, AssetHandle_t* out, const char* path);
+// GL thread only. Returns false if any program failed to load; missing textures are reported but not fatal.
+ASSETLOADERAPI bool startup_loader_finish(StartupLoader_t* loader);
+ASSETLOADERAPI void startup_loader_print_timeline(StartupLoader_t* loader);
+
+#ifdef ASSETLOADER_IMPLEMENTATION
+
+static void startup_loader__done(AssetLoadItem_t* item) {
+    StartupLoader_t* loader = item->loader;
+
+    mutex_lock(&loader->lock);
+    item->next_done = loader->done;
+    loader->done    = item;
+    condvar_signal(&loader->cv);
+    mutex_unlock(&loader->lock);
+}
+
+static void startup_loader__decode_job(void* user) {
+    PROFILE_FUNCTION();
+    AssetLoadItem_t* item = (AssetLoadItem_t*) user;
+
+    item->worker = jobs_worker_index();
+
+    if (!item->failed) {
+        // read_file() layout, the terminator isn't part of the image.
+        size_t size = item->files[0].size - 1;
+
+        item->content_hash = asset_registry_hash(item->files[0].data, size);
+        item->pixels = stbi_load_from_memory((const stbi_uc*) item->files[0].data, (int) size,
+                                             &item->width, &item->height, &item->channels, 0);
+        if (!item->pixels) item->failed = true;
+
+        free_file(&item->files[0]);
+    }
+
+    item->decode_end = get_time_ns();
+    startup_loader__done(item);
+}
+
+// I/O thread: once every file of the item is in, images go to a worker, shader sources
+// (compiled as the C strings read_file() layout gives) straight to the GL thread.
+static void startup_loader__read_done(AsyncRead_t* read, void* user) {
+    AssetLoadItem_t* item = (AssetLoadItem_t*) user;
+    (void) read;
+
+    if (atomic_fetch_sub(&item->reads_pending, 1) != 1) return;
+
+    for (int i = 0; i < item->path_count; ++i) {
+        item->files[i] = item->reads[i].file;
+        if (!item->files[i].data) item->failed = true;
+    }
+
+    item->io_end = get_time_ns();
+
+    if (item->kind == ASSET_LOAD_TEXTURE) {
+        jobs_submit(&item->loader->group, startup_loader__decode_job, item);
+        return;
+    }
+
+    item->decode_end = item->io_end;
+    startup_loader__done(item);
+}
+
+static void startup_loader__read(AssetLoadItem_t* item) {
+    atomic_store(&item->reads_pending, item->path_count);
+
+    for (int i = 0; i < item->path_count; ++i) {
+        async_io_read(&item->reads[i], item->paths[i], startup_loader__read_done, item);
+    }
+}
+
+// a cooked sibling is only mapped, anything else is read and then decoded.
+static void startup_loader__texture_job(void* user) {
+    PROFILE_FUNCTION();
+    AssetLoadItem_t* item = (AssetLoadItem_t*) user;
+
+    item->worker   = jobs_worker_index();
+    item->io_begin = get_time_ns();
+
+    char cooked_path[512];
+    if (!cookedTexturePath(item->paths[0], cooked_path, sizeof(cooked_path)) || !cookedTextureOpen(cooked_path, &item->cooked)) {
+        startup_loader__read(item);
+        return;
+    }
+
+    item->is_cooked    = true;
+    item->content_hash = asset_registry_hash(item->cooked.data, item->cooked.size);
+    item->io_end       = get_time_ns();
+    item->decode_end   = item->io_end;
+
+    startup_loader__done(item);
+}
+
+static AssetLoadItem_t* startup_loader__push(StartupLoader_t* loader, asset_load_kind_t kind) {
+    if (!loader || loader->count >= STARTUP_LOADER_MAX_ITEMS) return NULL;
+
+    AssetLoadItem_t* item = &loader->items[loader->count++];
+    *item                 = (AssetLoadItem_t) { .kind = kind, .loader = loader, .worker = -1 };
+
+    return item;
+}
+
+ASSETLOADERAPI void startup_loader_begin(StartupLoader_t* loader) {
+    loader->count      = 0;
+    loader->done       = NULL;
+    loader->group      = (JobGroup_t) {0};
+    loader->begin_ns   = get_time_ns();
+    loader->end_ns     = 0;
+    loader->gl_wait_ns = 0;
+
+    mutex_init(&loader->lock);
+    condvar_init(&loader->cv);
+}
+
+ASSETLOADERAPI bool startup_loader_add_program(StartupLoader_t* loader, GLProgram_t* out, const char* vs_path, const char* fs_path) {
+    AssetLoadItem_t* item = startup_loader__push(loader, ASSET_LOAD_PROGRAM);
+    if (!item) return false;
+
+    item->program_out = out;
+    item->paths[0]    = vs_path;
+    item->paths[1]    = fs_path;
+    item->path_count  = 2;
+    item->io_begin    = get_time_ns();
+
+    startup_loader__read(item);
+    return true;
+}
+
+ASSETLOADERAPI bool startup_loader_add_texture(StartupLoader_t* loader, AssetHandle_t* out, const char* path) {
+    *out = asset_registry_find_texture(path, 0);
+    if (out->id) return true;
+
+    AssetLoadItem_t* item = startup_loader__push(loader, ASSET_LOAD_TEXTURE);
+    if (!item) return false;
+
+    item->texture_out = out;
+    item->paths[0]    = path;
+    item->path_count  = 1;
+
+    jobs_submit(&loader->group, startup_loader__texture_job, item);
+    return true;
+}
+
+ASSETLOADERAPI bool startup_loader_finish(StartupLoader_t* loader) {
+    PROFILE_FUNCTION();
+    bool ok        = true;
+    int  processed = 0;
+
+    while (processed < loader->count) {
+        uint64_t wait_begin = get_time_ns();
+
+        mutex_lock(&loader->lock);
+        while (!loader->done) {
+            condvar_wait(&loader->cv, &loader->lock);
+        }
+        AssetLoadItem_t* batch = loader->done;
+        loader->done           = NULL;
+        mutex_unlock(&loader->lock);
+
+        loader->gl_wait_ns += get_time_ns() - wait_begin;
+
+        // the done list is LIFO, flip it so assets are handled in arrival order.
+        AssetLoadItem_t* ordered = NULL;
+        while (batch) {
+            AssetLoadItem_t* next = batch->next_done;
+            batch->next_done      = ordered;
+            ordered               = batch;
+            batch                 = next;
+        }
+        batch = ordered;
+
+        for (AssetLoadItem_t* item = batch; item; item = item->next_done, ++processed) {
+            item->gl_begin = get_time_ns();
+
+            if (item->kind == ASSET_LOAD_PROGRAM) {
+                if (item->failed) {
+                    for (int i = 0; i < item->path_count; ++i) {
+                        if (!item->files[i].data) printf("%s was not found.\n", item->paths[i]);
+                    }
+                    *item->program_out = (GLProgram_t) {0};
+                    ok = false;
+                } else {
+                    *item->program_out = createShaderProgramGL(item->files[0], item->files[1]);
+                }
+
+                for (int i = 0; i < item->path_count; ++i) free_file(&item->files[i]);
+            } else if (item->kind == ASSET_LOAD_TEXTURE) {
+                // an earlier item may have loaded the same bytes under another path.
+                AssetHandle_t existing = item->failed ? (AssetHandle_t) {0} : asset_registry_find_texture(item->paths[0], item->content_hash);
+
+                if (existing.id) {
+                    *item->texture_out = existing;
+                } else if (item->is_cooked) {
+                    MaterialTexture_t texture = materialTextureFromCooked(&item->cooked);
+                    size_t            bytes   = item->cooked.size - sizeof(CookedTextureHeader_t);
+
+                    *item->texture_out = asset_registry_add_texture(item->paths[0], item->content_hash, texture, bytes);
+                } else if (item->failed) {
+                    fprintf(stderr, "Failed to load texture: %s\n", item->paths[0]);
+                    *item->texture_out = (AssetHandle_t) {0};
+                } else {
+                    MaterialTexture_t texture = materialTextureFromPixels(item->pixels, item->width, item->height, item->channels);
+                    size_t            bytes   = (size_t) item->width * item->height * 4 * 4 / 3;
+
+                    *item->texture_out = asset_registry_add_texture(item->paths[0], item->content_hash, texture, bytes);
+                }
+
+                if (item->is_cooked) cookedTextureClose(&item->cooked);
+                if (item->pixels)    stbi_image_free(item->pixels);
+                item->pixels = NULL;
+            }
+
+            item->gl_end = get_time_ns();
+        }
+    }
+
+    // the I/O thread may still be finishing the last read callbacks.
+    for (int i = 0; i < loader->count; ++i) {
+        for (int p = 0; p < loader->items[i].path_count; ++p) async_io_wait(&loader->items[i].reads[p]);
+    }
+
+    jobs_wait(&loader->group);
+    loader->end_ns = get_time_ns();
+
+    condvar_destroy(&loader->cv);
+    mutex_destroy(&loader->lock);
+
+    return ok;
+}
+
+ASSETLOADERAPI void startup_loader_print_timeline(StartupLoader_t* loader) {
+    int order[STARTUP_LOADER_MAX_ITEMS];
+    for (int i = 0; i < loader->count; ++i) order[i] = i;
+
+    // insertion sort on io start, the item count is tiny.
+    for (int i = 1; i < loader->count; ++i) {
+        int j = i;
+        while (j > 0 && loader->items[order[j - 1]].io_begin > loader->items[order[j]].io_begin) {
+            int tmp = order[j]; order[j] = order[j - 1]; order[j - 1] = tmp;
+            --j;
+        }
+    }
+
+    double   base        = (double) loader->begin_ns;
+    double   wall_ms     = (loader->end_ns - loader->begin_ns) / 1e6;
+    uint64_t worker_busy = 0;
+    uint64_t gl_busy     = 0;
+
+#   define MS(t) (((double)(t) - base) / 1e6)
+
+    printf("startup timeline: %d assets, %d workers\n", loader->count, jobs_worker_count());
+    printf("  %-8s %-7s %17s %17s %17s  %s\n", "thread", "kind", "read (ms)", "decode (ms)", "gl (ms)", "asset");
+
+    for (int i = 0; i < loader->count; ++i) {
+        AssetLoadItem_t* item = &loader->items[order[i]];
+        char thread[16];
+
+        // programs never touch a worker, their sources come straight from the I/O thread.
+        if (item->worker >= 0)                     snprintf(thread, sizeof(thread), "worker%d", item->worker);
+        else if (item->kind == ASSET_LOAD_PROGRAM) snprintf(thread, sizeof(thread), "io");
+        else                                       snprintf(thread, sizeof(thread), "main");
+
+        printf("  %-8s %-7s %7.2f..%7.2f %7.2f..%7.2f %7.2f..%7.2f  %s%s%s%s\n",
+            thread,
+            item->kind == ASSET_LOAD_PROGRAM ? "program" : item->is_cooked ? "cooked" : "texture",
+            MS(item->io_begin), MS(item->io_end),
+            MS(item->io_end),   MS(item->decode_end),
+            MS(item->gl_begin), MS(item->gl_end),
+            item->paths[0],
+            item->path_count > 1 ? " + " : "",
+            item->path_count > 1 ? item->paths[1] : "",
+            item->failed ? " (FAILED)" : "");
+
+        worker_busy += item->decode_end - item->io_end;
+        gl_busy     += item->gl_end - item->gl_begin;
+    }
+
+#   undef MS
+
+    printf("  wall %.2f ms | worker busy %.2f ms (%.2fx) | gl busy %.2f ms | gl waiting %.2f ms\n",
+        wall_ms,
+        worker_busy / 1e6,
+        wall_ms > 0.0 ? (worker_busy / 1e6) / wall_ms : 0.0,
+        gl_busy / 1e6,
+        loader->gl_wait_ns / 1e6);
+}
+
+#endif // ASSETLOADER_IMPLEMENTATION
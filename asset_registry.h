@@ -0,0 +1,556 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "allocator.h"
+#include "file.h"
+#include "cooked_texture.h"
+#include "material.h"
+
+// Asset registry.
+//
+// Every loaded asset is keyed twice: by its interned path (so a second load of the same path is
+// a table lookup) and by a hash of its bytes (so two paths holding the same data share one
+// asset). Handles are reference counted; an asset whose last reference goes away stays loaded
+// on an LRU list and is only freed when the loaded total goes over the budget, or on an
+// explicit unload. GL thread only.
+
+#define ASSETREGISTRYAPI static
+
+#ifndef ASSET_REGISTRY_MAX_ASSETS
+#   define ASSET_REGISTRY_MAX_ASSETS 1024
+#endif
+
+#define ASSET_REGISTRY_DEFAULT_BUDGET (256u * 1024 * 1024)
+#define ASSET_REGISTRY_CONTENT_SLOTS  (ASSET_REGISTRY_MAX_ASSETS * 2)
+
+typedef struct AssetHandle_st AssetHandle_t;
+typedef struct Asset_st       Asset_t;
+
+typedef enum asset_kind_enum {
+    ASSET_KIND_NONE,
+    ASSET_KIND_FILE,
+    ASSET_KIND_TEXTURE
+} asset_kind_t;
+
+// 0 is the invalid handle. The generation moves on when the slot's asset is freed, so a handle
+// kept past that (or a path still aliasing it) stops resolving instead of finding the next one.
+struct AssetHandle_st {
+    uint32_t id;
+    uint32_t generation;
+};
+
+struct Asset_st {
+    asset_kind_t      kind;
+    uint32_t          generation;
+    uint32_t          path_id;       // interned path it was first loaded from
+    uint64_t          content_hash;
+    int               refcount;
+    size_t            bytes;         // CPU + GPU memory held
+
+    File_t            file;
+    MaterialTexture_t texture;
+
+    // unreferenced assets, least recently released first
+    int               lru_prev, lru_next;
+};
+
+ASSETREGISTRYAPI bool              asset_registry_init(size_t budget_bytes);
+// frees every asset, referenced or not.
+ASSETREGISTRYAPI void              asset_registry_shutdown(void);
+
+// the handle holds a reference; a failed load returns the invalid handle. Files are mapped read
+// only (see map_file()), their data is not NUL terminated.
+ASSETREGISTRYAPI AssetHandle_t     asset_registry_load_file(const char* path);
+ASSETREGISTRYAPI AssetHandle_t     asset_registry_load_texture(const char* path);
+
+// for loaders that read off thread: the loaded texture with this path or content, acquired, or the invalid handle.
+ASSETREGISTRYAPI AssetHandle_t     asset_registry_find_texture(const char* path, uint64_t content_hash);
+// takes ownership of `texture`.
+ASSETREGISTRYAPI AssetHandle_t     asset_registry_add_texture(const char* path, uint64_t content_hash, MaterialTexture_t texture, size_t bytes);
+
+ASSETREGISTRYAPI AssetHandle_t     asset_registry_acquire(AssetHandle_t handle);
+ASSETREGISTRYAPI void              asset_registry_release(AssetHandle_t handle);
+// frees the asset now if nothing references it.
+ASSETREGISTRYAPI bool              asset_registry_unload(AssetHandle_t handle);
+
+ASSETREGISTRYAPI const File_t*     asset_registry_file(AssetHandle_t handle);
+ASSETREGISTRYAPI MaterialTexture_t asset_registry_texture(AssetHandle_t handle);
+
+ASSETREGISTRYAPI void              asset_registry_set_budget(size_t budget_bytes);
+ASSETREGISTRYAPI uint64_t          asset_registry_hash(const void* data, size_t size);
+ASSETREGISTRYAPI void              asset_registry_print_stats(void);
+
+#ifdef ASSETREGISTRY_IMPLEMENTATION
+
+static struct {
+    Asset_t   assets[ASSET_REGISTRY_MAX_ASSETS];   // assets[0] is the invalid handle
+
+    // interned paths: `names` holds them back to back, `path_slots` maps a path hash to its id.
+    char*     names;
+    uint32_t  names_size, names_capacity;
+    uint32_t* path_offsets;      // by path id
+    AssetHandle_t* path_assets;  // by path id, invalid or stale when not loaded
+    uint32_t  path_count, path_capacity;
+    uint32_t* path_slots;        // open addressing, path id + 1
+    uint32_t  path_slot_count;   // power of two
+
+    // content hash -> asset, open addressing
+    uint64_t  content_keys[ASSET_REGISTRY_CONTENT_SLOTS];
+    int       content_assets[ASSET_REGISTRY_CONTENT_SLOTS];
+
+    int       lru_head, lru_tail;
+    size_t    budget;
+    size_t    loaded_bytes;
+
+    uint32_t  path_hits, content_hits, loads, evictions;
+    bool      initialized;
+} s_registry;
+
+// FNV-1a, 64 bit.
+ASSETREGISTRYAPI uint64_t asset_registry_hash(const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*) data;
+    uint64_t             hash  = 0xcbf29ce484222325ull;
+
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+// "./a\b//c.png" and "a/b/c.png" intern to the same id.
+static size_t asset_registry__normalize(const char* path, char* out, size_t out_size) {
+    size_t len = 0;
+
+    while (path[0] == '.' && (path[1] == '/' || path[1] == '\\')) path += 2;
+
+    for (; *path && len + 1 < out_size; ++path) {
+        char c = *path == '\\' ? '/' : *path;
+        if (c == '/' && len > 0 && out[len - 1] == '/') continue;
+        out[len++] = c;
+    }
+
+    out[len] = '\0';
+    return len;
+}
+
+static bool asset_registry__grow_paths(void) {
+    uint32_t capacity = s_registry.path_capacity ? s_registry.path_capacity * 2 : 64;
+
+    uint32_t* offsets = mem_realloc(MEM_TAG_ASSETS, s_registry.path_offsets, capacity * sizeof(uint32_t));
+    if (!offsets) return false;
+    s_registry.path_offsets = offsets;
+
+    AssetHandle_t* assets = mem_realloc(MEM_TAG_ASSETS, s_registry.path_assets, capacity * sizeof(AssetHandle_t));
+    if (!assets) return false;
+    s_registry.path_assets = assets;
+
+    // slots stay at most half full
+    uint32_t  slot_count = capacity * 2;
+    uint32_t* slots      = mem_calloc(MEM_TAG_ASSETS, slot_count, sizeof(uint32_t));
+    if (!slots) return false;
+
+    for (uint32_t id = 0; id < s_registry.path_count; ++id) {
+        const char* name = s_registry.names + s_registry.path_offsets[id];
+        uint32_t    slot = (uint32_t) asset_registry_hash(name, strlen(name)) & (slot_count - 1);
+
+        while (slots[slot]) slot = (slot + 1) & (slot_count - 1);
+        slots[slot] = id + 1;
+    }
+
+    mem_free(s_registry.path_slots);
+    s_registry.path_slots      = slots;
+    s_registry.path_slot_count = slot_count;
+    s_registry.path_capacity   = capacity;
+
+    return true;
+}
+
+// returns the path id, interning it if `insert`; -1 if unknown (or out of memory).
+static int asset_registry__intern(const char* path, bool insert) {
+    char   name[512];
+    size_t len = asset_registry__normalize(path, name, sizeof(name));
+
+    if (s_registry.path_slot_count) {
+        uint32_t mask = s_registry.path_slot_count - 1;
+
+        for (uint32_t slot = (uint32_t) asset_registry_hash(name, len) & mask; s_registry.path_slots[slot]; slot = (slot + 1) & mask) {
+            uint32_t id = s_registry.path_slots[slot] - 1;
+            if (strcmp(s_registry.names + s_registry.path_offsets[id], name) == 0) return (int) id;
+        }
+    }
+
+    if (!insert) return -1;
+
+    if (s_registry.path_count == s_registry.path_capacity && !asset_registry__grow_paths()) return -1;
+
+    if (s_registry.names_size + len + 1 > s_registry.names_capacity) {
+        uint32_t capacity = s_registry.names_capacity ? s_registry.names_capacity : 4096;
+        while (s_registry.names_size + len + 1 > capacity) capacity *= 2;
+
+        char* names = mem_realloc(MEM_TAG_ASSETS, s_registry.names, capacity);
+        if (!names) return -1;
+
+        s_registry.names          = names;
+        s_registry.names_capacity = capacity;
+    }
+
+    uint32_t id = s_registry.path_count++;
+    s_registry.path_offsets[id] = s_registry.names_size;
+    s_registry.path_assets[id]  = (AssetHandle_t) {0};
+    memcpy(s_registry.names + s_registry.names_size, name, len + 1);
+    s_registry.names_size += (uint32_t) len + 1;
+
+    uint32_t mask = s_registry.path_slot_count - 1;
+    uint32_t slot = (uint32_t) asset_registry_hash(name, len) & mask;
+    while (s_registry.path_slots[slot]) slot = (slot + 1) & mask;
+    s_registry.path_slots[slot] = id + 1;
+
+    return (int) id;
+}
+
+static int asset_registry__find_content(uint64_t content_hash) {
+    uint32_t mask = ASSET_REGISTRY_CONTENT_SLOTS - 1;
+
+    for (uint32_t slot = (uint32_t) content_hash & mask; s_registry.content_assets[slot]; slot = (slot + 1) & mask) {
+        if (s_registry.content_keys[slot] == content_hash) return s_registry.content_assets[slot];
+    }
+
+    return 0;
+}
+
+static void asset_registry__insert_content(uint64_t content_hash, int index) {
+    uint32_t mask = ASSET_REGISTRY_CONTENT_SLOTS - 1;
+    uint32_t slot = (uint32_t) content_hash & mask;
+
+    while (s_registry.content_assets[slot]) slot = (slot + 1) & mask;
+
+    s_registry.content_keys[slot]   = content_hash;
+    s_registry.content_assets[slot] = index;
+}
+
+// backward shift: the rest of the probe run moves up so lookups never stop at the hole.
+static void asset_registry__remove_content(uint64_t content_hash, int index) {
+    uint32_t mask = ASSET_REGISTRY_CONTENT_SLOTS - 1;
+    uint32_t slot = (uint32_t) content_hash & mask;
+
+    while (s_registry.content_assets[slot] && s_registry.content_assets[slot] != index) slot = (slot + 1) & mask;
+    if (!s_registry.content_assets[slot]) return;
+
+    for (uint32_t next = (slot + 1) & mask; s_registry.content_assets[next]; next = (next + 1) & mask) {
+        uint32_t home = (uint32_t) s_registry.content_keys[next] & mask;
+
+        // entries whose probe starts past the hole stay where they are.
+        if (((next - home) & mask) < ((next - slot) & mask)) continue;
+
+        s_registry.content_keys[slot]   = s_registry.content_keys[next];
+        s_registry.content_assets[slot] = s_registry.content_assets[next];
+        slot = next;
+    }
+
+    s_registry.content_assets[slot] = 0;
+}
+
+static void asset_registry__lru_unlink(int index) {
+    Asset_t* asset = &s_registry.assets[index];
+
+    if (asset->lru_prev) s_registry.assets[asset->lru_prev].lru_next = asset->lru_next;
+    else if (s_registry.lru_head == index) s_registry.lru_head = asset->lru_next;
+
+    if (asset->lru_next) s_registry.assets[asset->lru_next].lru_prev = asset->lru_prev;
+    else if (s_registry.lru_tail == index) s_registry.lru_tail = asset->lru_prev;
+
+    asset->lru_prev = asset->lru_next = 0;
+}
+
+static void asset_registry__lru_push(int index) {
+    Asset_t* asset = &s_registry.assets[index];
+
+    asset->lru_prev = s_registry.lru_tail;
+    asset->lru_next = 0;
+
+    if (s_registry.lru_tail) s_registry.assets[s_registry.lru_tail].lru_next = index;
+    else                     s_registry.lru_head = index;
+
+    s_registry.lru_tail = index;
+}
+
+static void asset_registry__free(int index) {
+    Asset_t* asset = &s_registry.assets[index];
+
+    asset_registry__lru_unlink(index);
+
+    if (asset->kind == ASSET_KIND_FILE)    free_file(&asset->file);
+    if (asset->kind == ASSET_KIND_TEXTURE) materialTextureRelease(asset->texture);
+
+    s_registry.loaded_bytes -= asset->bytes;
+
+    // paths aliasing it go stale with the generation.
+    asset_registry__remove_content(asset->content_hash, index);
+    *asset = (Asset_t) { .generation = asset->generation + 1 };
+}
+
+// unreferenced assets go, oldest first, until the total fits.
+static void asset_registry__trim(void) {
+    while (s_registry.loaded_bytes > s_registry.budget && s_registry.lru_head) {
+        asset_registry__free(s_registry.lru_head);
+        s_registry.evictions++;
+    }
+}
+
+static Asset_t* asset_registry__get(AssetHandle_t handle) {
+    if (handle.id == 0 || handle.id >= ASSET_REGISTRY_MAX_ASSETS) return NULL;
+
+    Asset_t* asset = &s_registry.assets[handle.id];
+    return asset->kind != ASSET_KIND_NONE && asset->generation == handle.generation ? asset : NULL;
+}
+
+static AssetHandle_t asset_registry__handle(int index) {
+    return (AssetHandle_t) { (uint32_t) index, s_registry.assets[index].generation };
+}
+
+ASSETREGISTRYAPI bool asset_registry_init(size_t budget_bytes) {
+    if (s_registry.initialized) return true;
+
+    memset(&s_registry, 0, sizeof(s_registry));
+    s_registry.budget      = budget_bytes ? budget_bytes : ASSET_REGISTRY_DEFAULT_BUDGET;
+    s_registry.initialized = true;
+
+    return true;
+}
+
+ASSETREGISTRYAPI void asset_registry_shutdown(void) {
+    if (!s_registry.initialized) return;
+
+    for (int i = 1; i < ASSET_REGISTRY_MAX_ASSETS; ++i) {
+        Asset_t* asset = &s_registry.assets[i];
+
+        if (asset->kind == ASSET_KIND_FILE)    free_file(&asset->file);
+        if (asset->kind == ASSET_KIND_TEXTURE) materialTextureRelease(asset->texture);
+    }
+
+    mem_free(s_registry.names);
+    mem_free(s_registry.path_offsets);
+    mem_free(s_registry.path_assets);
+    mem_free(s_registry.path_slots);
+
+    memset(&s_registry, 0, sizeof(s_registry));
+}
+
+ASSETREGISTRYAPI AssetHandle_t asset_registry_acquire(AssetHandle_t handle) {
+    Asset_t* asset = asset_registry__get(handle);
+    if (!asset) return (AssetHandle_t) {0};
+
+    if (asset->refcount++ == 0) asset_registry__lru_unlink((int) handle.id);
+    return handle;
+}
+
+ASSETREGISTRYAPI void asset_registry_release(AssetHandle_t handle) {
+    Asset_t* asset = asset_registry__get(handle);
+    if (!asset || asset->refcount <= 0) return;
+
+    if (--asset->refcount == 0) {
+        asset_registry__lru_push((int) handle.id);
+        asset_registry__trim();
+    }
+}
+
+ASSETREGISTRYAPI bool asset_registry_unload(AssetHandle_t handle) {
+    Asset_t* asset = asset_registry__get(handle);
+    if (!asset) return false;
+
+    if (asset->refcount > 0) {
+        fprintf(stderr, "asset_registry: %s is still referenced %d times, not unloading.\n",
+                s_registry.names + s_registry.path_offsets[asset->path_id], asset->refcount);
+        return false;
+    }
+
+    asset_registry__free((int) handle.id);
+    return true;
+}
+
+static AssetHandle_t asset_registry__find(const char* path, uint64_t content_hash, asset_kind_t kind) {
+    int      path_id = asset_registry__intern(path, false);
+    Asset_t* asset   = path_id >= 0 ? asset_registry__get(s_registry.path_assets[path_id]) : NULL;
+
+    if (asset && asset->kind == kind) {
+        s_registry.path_hits++;
+        return asset_registry_acquire(s_registry.path_assets[path_id]);
+    }
+
+    int index = content_hash ? asset_registry__find_content(content_hash) : 0;
+    if (!index || s_registry.assets[index].kind != kind) return (AssetHandle_t) {0};
+
+    // same bytes under another name, the path becomes an alias.
+    path_id = asset_registry__intern(path, true);
+    if (path_id >= 0) s_registry.path_assets[path_id] = asset_registry__handle(index);
+
+    s_registry.content_hits++;
+    return asset_registry_acquire(asset_registry__handle(index));
+}
+
+ASSETREGISTRYAPI AssetHandle_t asset_registry_find_texture(const char* path, uint64_t content_hash) {
+    return asset_registry__find(path, content_hash, ASSET_KIND_TEXTURE);
+}
+
+static AssetHandle_t asset_registry__add(const char* path, uint64_t content_hash, asset_kind_t kind, size_t bytes) {
+    int path_id = asset_registry__intern(path, true);
+    if (path_id < 0) return (AssetHandle_t) {0};
+
+    for (int i = 1; i < ASSET_REGISTRY_MAX_ASSETS; ++i) {
+        Asset_t* asset = &s_registry.assets[i];
+        if (asset->kind != ASSET_KIND_NONE) continue;
+
+        *asset = (Asset_t) {
+            .kind         = kind,
+            .generation   = asset->generation,
+            .path_id      = (uint32_t) path_id,
+            .content_hash = content_hash,
+            .refcount     = 1,
+            .bytes        = bytes
+        };
+
+        AssetHandle_t handle = asset_registry__handle(i);
+
+        s_registry.path_assets[path_id] = handle;
+        asset_registry__insert_content(content_hash, i);
+
+        s_registry.loaded_bytes += bytes;
+        s_registry.loads++;
+        asset_registry__trim();
+
+        return handle;
+    }
+
+    fprintf(stderr, "asset_registry: out of asset slots (%d)\n", ASSET_REGISTRY_MAX_ASSETS);
+    return (AssetHandle_t) {0};
+}
+
+ASSETREGISTRYAPI AssetHandle_t asset_registry_add_texture(const char* path, uint64_t content_hash, MaterialTexture_t texture, size_t bytes) {
+    if (!texture.id) return (AssetHandle_t) {0};
+
+    AssetHandle_t handle = asset_registry_find_texture(path, content_hash);
+
+    if (handle.id) {
+        materialTextureRelease(texture);
+        return handle;
+    }
+
+    handle = asset_registry__add(path, content_hash, ASSET_KIND_TEXTURE, bytes);
+
+    if (handle.id) s_registry.assets[handle.id].texture = texture;
+    else           materialTextureRelease(texture);
+
+    return handle;
+}
+
+ASSETREGISTRYAPI AssetHandle_t asset_registry_load_file(const char* path) {
+    AssetHandle_t handle = asset_registry__find(path, 0, ASSET_KIND_FILE);
+    if (handle.id) return handle;
+
+    File_t file = map_file(path, FILE_ACCESS_WILLNEED);
+    if (!file.data) return handle;
+
+    uint64_t hash = asset_registry_hash(file.data, file.size);
+
+    handle = asset_registry__find(path, hash, ASSET_KIND_FILE);
+    if (handle.id) {
+        free_file(&file);
+        return handle;
+    }
+
+    handle = asset_registry__add(path, hash, ASSET_KIND_FILE, file.size);
+
+    if (handle.id) s_registry.assets[handle.id].file = file;
+    else           free_file(&file);
+
+    return handle;
+}
+
+ASSETREGISTRYAPI AssetHandle_t asset_registry_load_texture(const char* path) {
+    AssetHandle_t handle = asset_registry_find_texture(path, 0);
+    if (handle.id) return handle;
+
+    MaterialTexture_t texture = {0};
+    uint64_t          hash    = 0;
+    size_t            bytes   = 0;
+    char              cooked_path[512];
+    CookedTexture_t   cooked;
+
+    if (cookedTexturePath(path, cooked_path, sizeof(cooked_path)) && cookedTextureOpen(cooked_path, &cooked)) {
+        hash = asset_registry_hash(cooked.data, cooked.size);
+
+        handle = asset_registry_find_texture(path, hash);
+        if (handle.id) {
+            cookedTextureClose(&cooked);
+            return handle;
+        }
+
+        texture = materialTextureFromCooked(&cooked);
+        bytes   = cooked.size - sizeof(CookedTextureHeader_t);
+        cookedTextureClose(&cooked);
+    } else {
+        File_t file = map_file(path, FILE_ACCESS_SEQUENTIAL);
+        if (!file.data) return handle;
+
+        hash = asset_registry_hash(file.data, file.size);
+
+        handle = asset_registry_find_texture(path, hash);
+        if (handle.id) {
+            free_file(&file);
+            return handle;
+        }
+
+        int w, h, c;
+        unsigned char* pixels = stbi_load_from_memory((const stbi_uc*) file.data, (int) file.size, &w, &h, &c, 0);
+        free_file(&file);
+
+        if (!pixels) {
+            fprintf(stderr, "Failed to load texture: %s\n", path);
+            return handle;
+        }
+
+        texture = materialTextureFromPixels(pixels, w, h, c);
+        bytes   = (size_t) w * h * 4 * 4 / 3;   // RGBA8 with its mip chain
+        stbi_image_free(pixels);
+    }
+
+    return asset_registry_add_texture(path, hash, texture, bytes);
+}
+
+ASSETREGISTRYAPI const File_t* asset_registry_file(AssetHandle_t handle) {
+    Asset_t* asset = asset_registry__get(handle);
+    return asset && asset->kind == ASSET_KIND_FILE ? &asset->file : NULL;
+}
+
+ASSETREGISTRYAPI MaterialTexture_t asset_registry_texture(AssetHandle_t handle) {
+    Asset_t* asset = asset_registry__get(handle);
+    return asset && asset->kind == ASSET_KIND_TEXTURE ? asset->texture : (MaterialTexture_t) {0};
+}
+
+ASSETREGISTRYAPI void asset_registry_set_budget(size_t budget_bytes) {
+    s_registry.budget = budget_bytes;
+    asset_registry__trim();
+}
+
+ASSETREGISTRYAPI void asset_registry_print_stats(void) {
+    int loaded = 0, cached = 0;
+
+    for (int i = 1; i < ASSET_REGISTRY_MAX_ASSETS; ++i) {
+        if (s_registry.assets[i].kind == ASSET_KIND_NONE) continue;
+        loaded++;
+        if (s_registry.assets[i].refcount == 0) cached++;
+    }
+
+    printf("asset registry: %d assets (%d unreferenced), %.2f / %.2f MB, %u paths\n",
+        loaded, cached, s_registry.loaded_bytes / (1024.0 * 1024.0), s_registry.budget / (1024.0 * 1024.0), s_registry.path_count);
+    printf("  loads %u | path hits %u | content hits %u | evictions %u\n",
+        s_registry.loads, s_registry.path_hits, s_registry.content_hits, s_registry.evictions);
+}
+
+#endif // ASSETREGISTRY_IMPLEMENTATION
@@ -0,0 +1,556 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "file.h"
+#include "thread.h"
+#include "jobs.h"
+#include "profiler.h"
+
+#if defined(__linux__)
+#   include <errno.h>
+#   include <fcntl.h>
+#   include <poll.h>
+#   include <sys/eventfd.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <sys/syscall.h>
+#   include <sys/uio.h>
+#   include <unistd.h>
+#   include <linux/io_uring.h>
+#endif // defined(__linux__)
+
+// Asynchronous whole-file reads.
+//
+// async_io_read() queues a read and returns right away; the AsyncRead_t is the future; poll it
+// with async_io_done(), block on it with async_io_wait(), or pass a callback. On Linux reads
+// go through io_uring: one I/O thread owns the ring, takes every queued request in a single
+// batch, opens the files and submits all their reads with one io_uring_enter(), so hundreds
+// can be in flight while no other thread ever blocks on the disk. The ring is set up with raw
+// syscalls, there is no liburing dependency. Where io_uring isn't available (other platforms,
+// old kernels, sandboxes that filter it) and while a file resolver is installed (a mounted
+// pack serves files from memory), each read runs read_file() as a job instead. Before
+// async_io_init() reads run inline, like jobs do without a pool.
+
+#define ASYNCIOAPI static
+
+#define ASYNC_IO_DEFAULT_DEPTH 256
+
+typedef struct AsyncRead_st AsyncRead_t;
+
+// runs on the I/O thread (or the job worker that did the read): keep it short, hand decoding
+// to the job pool.
+typedef void (*async_read_fn)(AsyncRead_t* read, void* user);
+
+typedef enum async_read_state_enum {
+    ASYNC_READ_IDLE,
+    ASYNC_READ_PENDING,
+    ASYNC_READ_DONE
+} async_read_state_t;
+
+struct AsyncRead_st {
+    const char*     path;
+    // read_file() layout: heap copy, NUL terminated and counted in `size`. `data` is NULL if
+    // the read failed. Owned by the caller once done, release it with free_file().
+    File_t          file;
+    atomic_int      state;
+
+    async_read_fn   on_done;
+    void*           user;
+
+    // internal
+    AsyncRead_t*    next;
+    uint64_t        submit_ns;
+#if defined(__linux__)
+    int             fd;
+    size_t          read_bytes;
+    struct iovec    iov;
+#endif // defined(__linux__)
+};
+
+uint64_t get_time_ns();
+
+// `queue_depth` (0 for ASYNC_IO_DEFAULT_DEPTH) sizes the ring, about that many reads can be in
+// flight at once; the rest wait in a queue.
+ASYNCIOAPI bool async_io_init(unsigned queue_depth);
+// waits for every queued read.
+ASYNCIOAPI void async_io_shutdown(void);
+// true when reads go through io_uring.
+ASYNCIOAPI bool async_io_uses_ring(void);
+
+// `read` must stay alive until it is done. `on_done` may be NULL.
+ASYNCIOAPI bool async_io_read(AsyncRead_t* read, const char* path, async_read_fn on_done, void* user);
+ASYNCIOAPI bool async_io_done(AsyncRead_t* read);
+// true if the file was read.
+ASYNCIOAPI bool async_io_wait(AsyncRead_t* read);
+ASYNCIOAPI void async_io_print_stats(void);
+
+#ifdef ASYNCIO_IMPLEMENTATION
+
+static struct {
+    bool                 initialized;
+    bool                 ring;
+
+    Mutex_t              lock;
+    CondVar_t            done_cv;
+    AsyncRead_t*         pending;        // FIFO, waiting for the I/O thread
+    AsyncRead_t*         pending_tail;
+    int                  outstanding;    // queued and not done, either path
+
+    atomic_uint_fast64_t reads;
+    atomic_uint_fast64_t failures;
+    atomic_uint_fast64_t bytes;
+    atomic_uint_fast64_t latency_ns;     // submit to completion, summed
+    uint64_t             ring_reads;     // I/O thread only
+    uint32_t             max_in_flight;
+
+#if defined(__linux__)
+    int                  ring_fd;
+    int                  event_fd;
+    Thread_t             thread;
+    bool                 quit;           // under `lock`
+    unsigned             depth;
+    unsigned             in_flight;
+
+    void*                sq_map;
+    size_t               sq_map_size;
+    void*                cq_map;
+    size_t               cq_map_size;
+    struct io_uring_sqe* sqes;
+    size_t               sqes_size;
+
+    uint32_t*            sq_tail;
+    uint32_t             sq_mask;
+    uint32_t*            sq_array;
+    uint32_t*            cq_head;
+    uint32_t*            cq_tail;
+    uint32_t             cq_mask;
+    struct io_uring_cqe* cqes;
+#endif // defined(__linux__)
+} s_asyncio;
+
+static void asyncio__complete(AsyncRead_t* read, bool ok) {
+    if (!ok) free_file(&read->file);
+    read->file.file_path = read->path;
+
+    atomic_fetch_add(&s_asyncio.reads, 1);
+    atomic_fetch_add(&s_asyncio.latency_ns, get_time_ns() - read->submit_ns);
+    if (ok) atomic_fetch_add(&s_asyncio.bytes, read->file.size - 1);
+    else    atomic_fetch_add(&s_asyncio.failures, 1);
+
+    if (read->on_done) read->on_done(read, read->user);
+
+    if (!s_asyncio.initialized) {
+        atomic_store(&read->state, ASYNC_READ_DONE);
+        return;
+    }
+
+    // after the callback, so a waiter also sees what it did.
+    mutex_lock(&s_asyncio.lock);
+    atomic_store(&read->state, ASYNC_READ_DONE);
+    s_asyncio.outstanding--;
+    condvar_broadcast(&s_asyncio.done_cv);
+    mutex_unlock(&s_asyncio.lock);
+}
+
+static void asyncio__read_job(void* user) {
+    PROFILE_FUNCTION();
+    AsyncRead_t* read = (AsyncRead_t*) user;
+
+    read->file = read_file(read->path);
+    asyncio__complete(read, read->file.data != NULL);
+}
+
+#if defined(__linux__)
+
+#ifndef __NR_io_uring_setup
+#   define __NR_io_uring_setup 425
+#   define __NR_io_uring_enter 426
+#endif
+
+// user_data of the poll on the wake up eventfd, reads use their AsyncRead_t address.
+#define ASYNCIO__WAKE 0
+
+static int asyncio__setup(unsigned entries, struct io_uring_params* params) {
+    return (int) syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int asyncio__enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int) syscall(__NR_io_uring_enter, s_asyncio.ring_fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static bool asyncio__ring_init(unsigned depth) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    s_asyncio.ring_fd = asyncio__setup(depth, &params);
+    if (s_asyncio.ring_fd < 0) return false;
+
+    s_asyncio.sq_map_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    s_asyncio.cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    s_asyncio.sqes_size   = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    // newer kernels put both rings in one mapping.
+    bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single && s_asyncio.cq_map_size > s_asyncio.sq_map_size) s_asyncio.sq_map_size = s_asyncio.cq_map_size;
+
+    s_asyncio.sq_map = mmap(NULL, s_asyncio.sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, s_asyncio.ring_fd, IORING_OFF_SQ_RING);
+    if (s_asyncio.sq_map == MAP_FAILED) goto fail_ring;
+
+    if (single) {
+        s_asyncio.cq_map = s_asyncio.sq_map;
+    } else {
+        s_asyncio.cq_map = mmap(NULL, s_asyncio.cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, s_asyncio.ring_fd, IORING_OFF_CQ_RING);
+        if (s_asyncio.cq_map == MAP_FAILED) goto fail_sq;
+    }
+
+    s_asyncio.sqes = mmap(NULL, s_asyncio.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, s_asyncio.ring_fd, IORING_OFF_SQES);
+    if (s_asyncio.sqes == MAP_FAILED) goto fail_cq;
+
+    char* sq = (char*) s_asyncio.sq_map;
+    char* cq = (char*) s_asyncio.cq_map;
+
+    s_asyncio.sq_tail  = (uint32_t*)(sq + params.sq_off.tail);
+    s_asyncio.sq_mask  = *(uint32_t*)(sq + params.sq_off.ring_mask);
+    s_asyncio.sq_array = (uint32_t*)(sq + params.sq_off.array);
+    s_asyncio.cq_head  = (uint32_t*)(cq + params.cq_off.head);
+    s_asyncio.cq_tail  = (uint32_t*)(cq + params.cq_off.tail);
+    s_asyncio.cq_mask  = *(uint32_t*)(cq + params.cq_off.ring_mask);
+    s_asyncio.cqes     = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    // one slot stays with the wake up poll. The completion ring is at least as large, so it
+    // can't overflow either.
+    s_asyncio.depth = params.sq_entries - 1;
+    return true;
+
+fail_cq:
+    if (s_asyncio.cq_map != s_asyncio.sq_map) munmap(s_asyncio.cq_map, s_asyncio.cq_map_size);
+fail_sq:
+    munmap(s_asyncio.sq_map, s_asyncio.sq_map_size);
+fail_ring:
+    close(s_asyncio.ring_fd);
+    return false;
+}
+
+static void asyncio__ring_shutdown(void) {
+    munmap(s_asyncio.sqes, s_asyncio.sqes_size);
+    if (s_asyncio.cq_map != s_asyncio.sq_map) munmap(s_asyncio.cq_map, s_asyncio.cq_map_size);
+    munmap(s_asyncio.sq_map, s_asyncio.sq_map_size);
+    close(s_asyncio.ring_fd);
+}
+
+// I/O thread only. Never full: at most `depth` reads plus the poll are in flight.
+static struct io_uring_sqe* asyncio__get_sqe(void) {
+    uint32_t             tail = *s_asyncio.sq_tail;
+    uint32_t             slot = tail & s_asyncio.sq_mask;
+    struct io_uring_sqe* sqe  = &s_asyncio.sqes[slot];
+
+    memset(sqe, 0, sizeof(*sqe));
+    s_asyncio.sq_array[slot] = slot;
+
+    // the kernel reads the entry once it sees the new tail.
+    atomic_store_explicit((_Atomic uint32_t*) s_asyncio.sq_tail, tail + 1, memory_order_release);
+    return sqe;
+}
+
+static void asyncio__queue_poll(void) {
+    struct io_uring_sqe* sqe = asyncio__get_sqe();
+    sqe->opcode      = IORING_OP_POLL_ADD;
+    sqe->fd          = s_asyncio.event_fd;
+    sqe->poll_events = POLLIN;
+    sqe->user_data   = ASYNCIO__WAKE;
+}
+
+static void asyncio__queue_read(AsyncRead_t* read) {
+    read->iov.iov_base = read->file.data + read->read_bytes;
+    read->iov.iov_len  = read->file.size - 1 - read->read_bytes;
+
+    struct io_uring_sqe* sqe = asyncio__get_sqe();
+    sqe->opcode    = IORING_OP_READV;
+    sqe->fd        = read->fd;
+    sqe->addr      = (uint64_t)(uintptr_t) &read->iov;
+    sqe->len       = 1;
+    sqe->off       = read->read_bytes;
+    sqe->user_data = (uint64_t)(uintptr_t) read;
+}
+
+static void asyncio__finish(AsyncRead_t* read, bool ok) {
+    if (read->fd >= 0) close(read->fd);
+    read->fd = -1;
+
+    if (ok) read->file.data[read->read_bytes] = '\0';
+    read->file.size = read->read_bytes + 1;
+
+    asyncio__complete(read, ok);
+}
+
+// opens the file and queues its read, returns false if it completed right away.
+static bool asyncio__start(AsyncRead_t* read) {
+    PROFILE_FUNCTION();
+    s_asyncio.ring_reads++;
+    read->fd         = open(read->path, O_RDONLY | O_CLOEXEC);
+    read->read_bytes = 0;
+
+    struct stat st;
+    if (read->fd < 0 || fstat(read->fd, &st) != 0) {
+        asyncio__finish(read, false);
+        return false;
+    }
+
+    read->file = (File_t) { .data = mem_alloc(MEM_TAG_IO, (size_t) st.st_size + 1), .size = (size_t) st.st_size + 1, .file_path = read->path };
+    if (!read->file.data || st.st_size == 0) {
+        asyncio__finish(read, read->file.data != NULL);
+        return false;
+    }
+
+    asyncio__queue_read(read);
+    return true;
+}
+
+// returns true if the read is still in flight.
+static bool asyncio__on_cqe(AsyncRead_t* read, int result) {
+    if (result == -EINTR || result == -EAGAIN) {
+        asyncio__queue_read(read);
+        return true;
+    }
+
+    if (result < 0) {
+        fprintf(stderr, "async_io: reading %s failed: %s\n", read->path, strerror(-result));
+        asyncio__finish(read, false);
+        return false;
+    }
+
+    read->read_bytes += (size_t) result;
+
+    // a short read continues where it stopped, 0 means the file shrank since it was opened.
+    if (result > 0 && read->read_bytes < read->file.size - 1) {
+        asyncio__queue_read(read);
+        return true;
+    }
+
+    asyncio__finish(read, true);
+    return false;
+}
+
+static int asyncio__thread(void* user) {
+    (void) user;
+    profiler_set_thread_name("io");
+
+    unsigned to_submit = 0;
+    asyncio__queue_poll();
+    to_submit++;
+
+    for (;;) {
+        // takes as many queued reads as there is room for in the ring.
+        mutex_lock(&s_asyncio.lock);
+        AsyncRead_t* batch = s_asyncio.pending;
+        AsyncRead_t* last  = NULL;
+        unsigned     room  = s_asyncio.depth - s_asyncio.in_flight;
+        unsigned     taken = 0;
+
+        for (AsyncRead_t* read = batch; read && taken < room; read = read->next, ++taken) last = read;
+
+        if (last) {
+            s_asyncio.pending = last->next;
+            last->next        = NULL;
+        } else {
+            batch = NULL;
+        }
+        if (!s_asyncio.pending) s_asyncio.pending_tail = NULL;
+
+        bool quit = s_asyncio.quit && !s_asyncio.pending && !batch && s_asyncio.in_flight == 0;
+        mutex_unlock(&s_asyncio.lock);
+
+        if (quit) break;
+
+        // callbacks may queue more reads, the list is detached first.
+        while (batch) {
+            AsyncRead_t* read = batch;
+            batch = read->next;
+            read->next = NULL;
+
+            if (asyncio__start(read)) {
+                s_asyncio.in_flight++;
+                to_submit++;
+            }
+        }
+
+        if (s_asyncio.in_flight > s_asyncio.max_in_flight) s_asyncio.max_in_flight = s_asyncio.in_flight;
+
+        // submits the whole batch and sleeps until something completes (a read, or a wake up).
+        int submitted = asyncio__enter(to_submit, 1, IORING_ENTER_GETEVENTS);
+        if (submitted < 0) {
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                fprintf(stderr, "async_io: io_uring_enter failed: %s\n", strerror(errno));
+                break;
+            }
+        } else {
+            to_submit -= (unsigned) submitted;
+        }
+
+        uint32_t head = *s_asyncio.cq_head;
+        uint32_t tail = atomic_load_explicit((_Atomic uint32_t*) s_asyncio.cq_tail, memory_order_acquire);
+
+        for (; head != tail; ++head) {
+            struct io_uring_cqe* cqe = &s_asyncio.cqes[head & s_asyncio.cq_mask];
+
+            if (cqe->user_data == ASYNCIO__WAKE) {
+                eventfd_t value;
+                eventfd_read(s_asyncio.event_fd, &value);
+                asyncio__queue_poll();
+                to_submit++;
+                continue;
+            }
+
+            AsyncRead_t* read = (AsyncRead_t*)(uintptr_t) cqe->user_data;
+            if (asyncio__on_cqe(read, cqe->res)) {
+                to_submit++;
+            } else {
+                s_asyncio.in_flight--;
+            }
+        }
+
+        atomic_store_explicit((_Atomic uint32_t*) s_asyncio.cq_head, head, memory_order_release);
+    }
+
+    return 0;
+}
+
+#endif // defined(__linux__)
+
+ASYNCIOAPI bool async_io_init(unsigned queue_depth) {
+    if (s_asyncio.initialized) return true;
+
+    mutex_init(&s_asyncio.lock);
+    condvar_init(&s_asyncio.done_cv);
+    s_asyncio.initialized = true;
+
+#if defined(__linux__)
+    if (!queue_depth) queue_depth = ASYNC_IO_DEFAULT_DEPTH;
+
+    s_asyncio.event_fd = eventfd(0, EFD_CLOEXEC);
+    if (s_asyncio.event_fd < 0) return true;
+
+    if (!asyncio__ring_init(queue_depth)) {
+        printf("async_io: io_uring unavailable (%s), reads run on the job pool.\n", strerror(errno));
+        close(s_asyncio.event_fd);
+        return true;
+    }
+
+    if (!thread_create(&s_asyncio.thread, asyncio__thread, NULL)) {
+        asyncio__ring_shutdown();
+        close(s_asyncio.event_fd);
+        return true;
+    }
+
+    s_asyncio.ring = true;
+#else
+    (void) queue_depth;
+#endif // defined(__linux__)
+
+    return true;
+}
+
+ASYNCIOAPI void async_io_shutdown(void) {
+    if (!s_asyncio.initialized) return;
+
+    mutex_lock(&s_asyncio.lock);
+    while (s_asyncio.outstanding > 0) condvar_wait(&s_asyncio.done_cv, &s_asyncio.lock);
+    mutex_unlock(&s_asyncio.lock);
+
+#if defined(__linux__)
+    if (s_asyncio.ring) {
+        mutex_lock(&s_asyncio.lock);
+        s_asyncio.quit = true;
+        mutex_unlock(&s_asyncio.lock);
+
+        eventfd_write(s_asyncio.event_fd, 1);
+        thread_join(&s_asyncio.thread);
+
+        asyncio__ring_shutdown();
+        close(s_asyncio.event_fd);
+    }
+#endif // defined(__linux__)
+
+    condvar_destroy(&s_asyncio.done_cv);
+    mutex_destroy(&s_asyncio.lock);
+    memset(&s_asyncio, 0, sizeof(s_asyncio));
+}
+
+ASYNCIOAPI bool async_io_uses_ring(void) {
+    return s_asyncio.ring;
+}
+
+ASYNCIOAPI bool async_io_read(AsyncRead_t* read, const char* path, async_read_fn on_done, void* user) {
+    if (!read || !path) return false;
+
+    read->path      = path;
+    read->file      = (File_t) { .file_path = path };
+    read->on_done   = on_done;
+    read->user      = user;
+    read->next      = NULL;
+    read->submit_ns = get_time_ns();
+    atomic_store(&read->state, ASYNC_READ_PENDING);
+
+    if (!s_asyncio.initialized) {
+        asyncio__read_job(read);
+        return true;
+    }
+
+    mutex_lock(&s_asyncio.lock);
+    s_asyncio.outstanding++;
+
+#if defined(__linux__)
+    if (s_asyncio.ring && !has_file_resolver()) {
+        if (s_asyncio.pending_tail) s_asyncio.pending_tail->next = read;
+        else                        s_asyncio.pending            = read;
+        s_asyncio.pending_tail = read;
+        mutex_unlock(&s_asyncio.lock);
+
+        eventfd_write(s_asyncio.event_fd, 1);
+        return true;
+    }
+#endif // defined(__linux__)
+
+    mutex_unlock(&s_asyncio.lock);
+
+    jobs_submit(NULL, asyncio__read_job, read);
+    return true;
+}
+
+ASYNCIOAPI bool async_io_done(AsyncRead_t* read) {
+    return atomic_load(&read->state) == ASYNC_READ_DONE;
+}
+
+ASYNCIOAPI bool async_io_wait(AsyncRead_t* read) {
+    if (atomic_load(&read->state) == ASYNC_READ_IDLE) return false;
+    if (!s_asyncio.initialized)                       return read->file.data != NULL;
+
+    mutex_lock(&s_asyncio.lock);
+    while (atomic_load(&read->state) != ASYNC_READ_DONE) condvar_wait(&s_asyncio.done_cv, &s_asyncio.lock);
+    mutex_unlock(&s_asyncio.lock);
+
+    return read->file.data != NULL;
+}
+
+ASYNCIOAPI void async_io_print_stats(void) {
+    uint64_t reads    = atomic_load(&s_asyncio.reads);
+    uint64_t failures = atomic_load(&s_asyncio.failures);
+    uint64_t bytes    = atomic_load(&s_asyncio.bytes);
+
+    if (!reads) return;
+
+    printf("async_io: %llu reads (%llu failed), %.2f MB, %.2f ms average latency\n",
+        (unsigned long long) reads, (unsigned long long) failures, bytes / (1024.0 * 1024.0),
+        atomic_load(&s_asyncio.latency_ns) / 1e6 / (double) reads);
+
+    if (s_asyncio.ring) {
+        printf("  %llu through io_uring, %u in flight at most (queue depth %u), the rest on the job pool\n",
+            (unsigned long long) s_asyncio.ring_reads, s_asyncio.max_in_flight, s_asyncio.depth);
+    }
+}
+
+#endif // ASYNCIO_IMPLEMENTATION
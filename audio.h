@@ -2,6 +2,7 @@
 
 #include <inttypes.h>
 #include <stdbool.h>
+#include "allocator.h"
 
 
 #define SAMPLE_RATE       44100
@@ -28,6 +29,7 @@ struct AudioMixer_st {
 };
 
 extern AudioDevice* audio_init_device();
+extern void         audio_close_device(AudioDevice* device);
 
 // audio buffer
 extern AudioBuffer  audio_buffer_create(size_t sample_count, AudioDevice* device);
@@ -50,6 +52,7 @@ extern void         audio_buffer_sin_fill_stereo_low(AudioBuffer buff);
 // audio mixer
 extern bool        audio_mixer_create(AudioMixer* mixer_out, size_t capacity, AudioDevice* device);
 extern void        audio_mixer_update(AudioMixer* mixer);
+extern void        audio_mixer_free(AudioMixer* mixer);
 
 // audio utilities
 extern int16_t      float_to_int16(float f);
@@ -58,6 +61,8 @@ extern float        int16_to_float(int16_t v);
 
 #ifdef AUDIO_IMPLEMENTATION
 
+#include "profiler.h"
+
 #ifndef M_PI
 #   define M_PI 3.14159265
 #endif
@@ -89,7 +94,7 @@ AudioBuffer audio_buffer_create(size_t sample_count, AudioDevice* device) {
         .playing = false
     };
 
-    ab.buffer = malloc(sample_count * sizeof(*ab.buffer));
+    ab.buffer = mem_alloc(MEM_TAG_AUDIO, sample_count * sizeof(*ab.buffer));
     if (!ab.buffer) return (AudioBuffer) {0};
     
     return ab;
@@ -127,7 +132,7 @@ float audio_buffer_sample_flt(AudioBuffer* ab, size_t ch, size_t time) {
 }
 
 void audio_buffer_free(AudioBuffer ab) {
-    if (ab.buffer) free(ab.buffer);
+    if (ab.buffer) mem_free(ab.buffer);
 }
 
 void audio_buffer_seek_start(AudioBuffer* audio) {
@@ -145,14 +150,31 @@ bool audio_mixer_create(AudioMixer* mixer_out, size_t capacity, AudioDevice* dev
     if (!mixer_out) return false;
     
     mixer_out->count      = capacity;
-    mixer_out->audio_list = malloc(sizeof(mixer_out->audio_list[0]) * capacity);
+    mixer_out->audio_list = mem_alloc(MEM_TAG_AUDIO, sizeof(mixer_out->audio_list[0]) * capacity);
     mixer_out->device     = device != NULL ? device : s_audioDevice;
-    mixer_out->mx_buff    = malloc(sizeof(mixer_out->mx_buff[0]) * AUDIO_BUFFERS_SIZE * AUDIO_CHANNELS);
+    mixer_out->mx_buff    = mem_alloc(MEM_TAG_AUDIO, sizeof(mixer_out->mx_buff[0]) * AUDIO_BUFFERS_SIZE * AUDIO_CHANNELS);
 
     return mixer_out->audio_list != NULL && mixer_out->mx_buff != NULL;
 }
 
+void audio_mixer_free(AudioMixer* mixer) {
+    if (!mixer) return;
+
+    mem_free(mixer->audio_list);
+    mem_free(mixer->mx_buff);
+    *mixer = (AudioMixer) {0};
+}
+
 void audio_mixer_update(AudioMixer* mixer) {
+    PROFILE_FUNCTION();
+#if !defined(_WIN32)
+    // no output device, keep the clocks moving so playback state stays the same.
+    for (size_t i = 0; i < mixer->count; ++i) {
+        if (mixer->audio_list[i]->playing)
+            mixer->audio_list[i]->time += AUDIO_BUFFERS_SIZE;
+    }
+    return;
+#else
     WAVEHDR* whdr         = &(s_Audio_WinHDRS[s_Audio_CurrentWHDR]);
     HWAVEOUT device       = (HWAVEOUT)mixer->device;
 
@@ -205,6 +227,7 @@ void audio_mixer_update(AudioMixer* mixer) {
     whdr->dwBufferLength = AUDIO_BUFFERS_SIZE * AUDIO_CHANNELS *  sizeof(int16_t);
     waveOutWrite(device, whdr, sizeof(WAVEHDR));
     s_Audio_CurrentWHDR = (s_Audio_CurrentWHDR + 1) % AUDIO_BUFFERS;
+#endif // !defined(_WIN32)
 }
 
 void audio_buffer_update(AudioBuffer* audio) {
@@ -217,6 +240,9 @@ void audio_buffer_update(AudioBuffer* audio) {
     if (2*(audio->time + audio_samples) >= audio->size)
         audio_samples = (audio->size/AUDIO_CHANNELS) - audio->time;
 
+#if !defined(_WIN32)
+    audio->time += audio_samples;
+#else
     // Prepare buffer
     WAVEHDR* whdr   = &(s_Audio_WinHDRS[s_Audio_CurrentWHDR]);
     HWAVEOUT device = (HWAVEOUT)audio->device;
@@ -231,6 +257,7 @@ void audio_buffer_update(AudioBuffer* audio) {
     audio->time += audio_samples;
 
     s_Audio_CurrentWHDR = (s_Audio_CurrentWHDR + 1) % AUDIO_BUFFERS;
+#endif // !defined(_WIN32)
 }
 
 void audio_buffer_play(AudioBuffer* audio) {
@@ -264,7 +291,7 @@ AudioDevice* audio_init_device() {
     s_audioDevice = (AudioDevice*) hWaveOut;
 
     for (int i = 0; i < AUDIO_BUFFERS; ++i) {
-        s_audioBuffers[i]                 = calloc(AUDIO_BUFFERS_SIZE * AUDIO_CHANNELS, sizeof(int16_t));
+        s_audioBuffers[i]                 = mem_calloc(MEM_TAG_AUDIO, AUDIO_BUFFERS_SIZE * AUDIO_CHANNELS, sizeof(int16_t));
 
         s_Audio_WinHDRS[i].lpData         = (LPSTR) s_audioBuffers[i];
         s_Audio_WinHDRS[i].dwBufferLength = AUDIO_BUFFERS_SIZE * AUDIO_CHANNELS * sizeof(int16_t);
@@ -275,8 +302,33 @@ AudioDevice* audio_init_device() {
 
     return (AudioDevice*) hWaveOut;
 }
+
+void audio_close_device(AudioDevice* device) {
+    if (!device) return;
+
+    // hands every queued buffer back, they can be unprepared and freed after this.
+    waveOutReset((HWAVEOUT) device);
+
+    for (int i = 0; i < AUDIO_BUFFERS; ++i) {
+        waveOutUnprepareHeader((HWAVEOUT) device, &s_Audio_WinHDRS[i], sizeof(WAVEHDR));
+        mem_free(s_audioBuffers[i]);
+        s_audioBuffers[i] = NULL;
+    }
+
+    waveOutClose((HWAVEOUT) device);
+    if (s_audioDevice == device) s_audioDevice = NULL;
+}
 #else
-#   error "audio_init_device() not implemented for current OS."
+
+// no audio backend here (headless builds), every buffer plays silently.
+AudioDevice* audio_init_device() {
+    return NULL;
+}
+
+void audio_close_device(AudioDevice* device) {
+    (void) device;
+}
+
 #endif // if defined(_WIN32)
 
 void audio_buffer_sin_fill_stereo_low(AudioBuffer buff) {
@@ -0,0 +1,536 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <emmintrin.h>
+#include "jobs.h"
+
+// Block compression encoder (BC1, BC3, BC4, BC5) for the offline texture cooker.
+//
+// Every 4x4 block is encoded on its own, block rows are spread over the job pool.
+// Color endpoints start on the principal axis of the block (covariance + power iteration),
+// then get a couple of least squares refinement passes; palette distances and index
+// selection run four texels at a time on SSE2. Single channel blocks (BC4, the BC3 alpha
+// and both BC5 halves) take min / max as endpoints and pick the nearest of the 8 values.
+// Edge blocks of images that are not a multiple of 4 repeat their last row / column.
+
+#define BCENCODEAPI static
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#   define GL_COMPRESSED_RGB_S3TC_DXT1_EXT  0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#   define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RED_RGTC1
+#   define GL_COMPRESSED_RED_RGTC1          0x8DBB
+#endif
+#ifndef GL_COMPRESSED_RG_RGTC2
+#   define GL_COMPRESSED_RG_RGTC2           0x8DBD
+#endif
+
+typedef enum bc_format_enum {
+    BC_FORMAT_BC1,  // rgb, 8 bytes per block
+    BC_FORMAT_BC3,  // rgba, 16 bytes per block
+    BC_FORMAT_BC4,  // r, 8 bytes per block
+    BC_FORMAT_BC5   // rg, 16 bytes per block
+} bc_format_t;
+
+BCENCODEAPI int         bc_block_bytes(bc_format_t format);
+BCENCODEAPI size_t      bc_encoded_size(bc_format_t format, int width, int height);
+BCENCODEAPI uint32_t    bc_gl_internal_format(bc_format_t format);
+BCENCODEAPI const char* bc_format_name(bc_format_t format);
+
+// pixels are tightly packed with `channels` bytes each; `out` holds bc_encoded_size() bytes.
+BCENCODEAPI void        bc_encode_image(bc_format_t format, const unsigned char* pixels, int width, int height, int channels, unsigned char* out);
+// decodes `encoded` and compares it with the channels the format keeps.
+BCENCODEAPI double      bc_psnr(bc_format_t format, const unsigned char* pixels, int width, int height, int channels, const unsigned char* encoded);
+
+#ifdef BCENCODE_IMPLEMENTATION
+
+BCENCODEAPI int bc_block_bytes(bc_format_t format) {
+    return format == BC_FORMAT_BC1 || format == BC_FORMAT_BC4 ? 8 : 16;
+}
+
+BCENCODEAPI size_t bc_encoded_size(bc_format_t format, int width, int height) {
+    size_t blocks_x = (size_t)(width  + 3) / 4;
+    size_t blocks_y = (size_t)(height + 3) / 4;
+    return blocks_x * blocks_y * bc_block_bytes(format);
+}
+
+BCENCODEAPI uint32_t bc_gl_internal_format(bc_format_t format) {
+    switch (format) {
+        case BC_FORMAT_BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case BC_FORMAT_BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case BC_FORMAT_BC4: return GL_COMPRESSED_RED_RGTC1;
+        case BC_FORMAT_BC5: return GL_COMPRESSED_RG_RGTC2;
+    }
+    return 0;
+}
+
+BCENCODEAPI const char* bc_format_name(bc_format_t format) {
+    switch (format) {
+        case BC_FORMAT_BC1: return "BC1";
+        case BC_FORMAT_BC3: return "BC3";
+        case BC_FORMAT_BC4: return "BC4";
+        case BC_FORMAT_BC5: return "BC5";
+    }
+    return "?";
+}
+
+// 4x4 texels as rgba, missing channels are filled so every format can read the one it needs.
+static void bc__gather_block(const unsigned char* pixels, int width, int height, int channels, int bx, int by, unsigned char block[64]) {
+    for (int y = 0; y < 4; ++y) {
+        int py = by * 4 + y < height ? by * 4 + y : height - 1;
+
+        for (int x = 0; x < 4; ++x) {
+            int                  px  = bx * 4 + x < width ? bx * 4 + x : width - 1;
+            const unsigned char* src = pixels + ((size_t) py * width + px) * channels;
+            unsigned char*       dst = block + (y * 4 + x) * 4;
+
+            dst[0] = src[0];
+            dst[1] = channels > 1 ? src[1] : src[0];
+            dst[2] = channels > 2 ? src[2] : src[0];
+            dst[3] = channels == 4 ? src[3] : channels == 2 ? src[1] : 255;
+        }
+    }
+}
+
+static float bc__hsum(__m128 v) {
+    __m128 t = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    t        = _mm_add_ss(t, _mm_shuffle_ps(t, t, 1));
+    return _mm_cvtss_f32(t);
+}
+
+static float bc__hmin(__m128 v) {
+    __m128 t = _mm_min_ps(v, _mm_movehl_ps(v, v));
+    t        = _mm_min_ss(t, _mm_shuffle_ps(t, t, 1));
+    return _mm_cvtss_f32(t);
+}
+
+static float bc__hmax(__m128 v) {
+    __m128 t = _mm_max_ps(v, _mm_movehl_ps(v, v));
+    t        = _mm_max_ss(t, _mm_shuffle_ps(t, t, 1));
+    return _mm_cvtss_f32(t);
+}
+
+static uint16_t bc__pack_565(float r, float g, float b) {
+    int ri = (int)(r * (31.0f / 255.0f) + 0.5f);
+    int gi = (int)(g * (63.0f / 255.0f) + 0.5f);
+    int bi = (int)(b * (31.0f / 255.0f) + 0.5f);
+
+    ri = ri < 0 ? 0 : ri > 31 ? 31 : ri;
+    gi = gi < 0 ? 0 : gi > 63 ? 63 : gi;
+    bi = bi < 0 ? 0 : bi > 31 ? 31 : bi;
+
+    return (uint16_t)((ri << 11) | (gi << 5) | bi);
+}
+
+static void bc__unpack_565(uint16_t c, int rgb[3]) {
+    int r = (c >> 11) & 31;
+    int g = (c >> 5)  & 63;
+    int b =  c        & 31;
+
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// 4 color palette in the order the decoder uses.
+static void bc__color_palette(uint16_t c0, uint16_t c1, int palette[4][3]) {
+    bc__unpack_565(c0, palette[0]);
+    bc__unpack_565(c1, palette[1]);
+
+    for (int k = 0; k < 3; ++k) {
+        palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+        palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+    }
+}
+
+typedef struct BcColorBlock_st {
+    _Alignas(16) float r[16];
+    _Alignas(16) float g[16];
+    _Alignas(16) float b[16];
+} BcColorBlock_t;
+
+// nearest palette entry for all 16 texels, returns the squared error.
+static float bc__fit_color_indices(const BcColorBlock_t* block, uint16_t c0, uint16_t c1, uint8_t indices[16]) {
+    int palette[4][3];
+    bc__color_palette(c0, c1, palette);
+
+    __m128 pr[4], pg[4], pb[4];
+    for (int p = 0; p < 4; ++p) {
+        pr[p] = _mm_set1_ps((float) palette[p][0]);
+        pg[p] = _mm_set1_ps((float) palette[p][1]);
+        pb[p] = _mm_set1_ps((float) palette[p][2]);
+    }
+
+    __m128 total = _mm_setzero_ps();
+
+    for (int i = 0; i < 16; i += 4) {
+        __m128 r = _mm_load_ps(block->r + i);
+        __m128 g = _mm_load_ps(block->g + i);
+        __m128 b = _mm_load_ps(block->b + i);
+
+        __m128  best     = _mm_set1_ps(1e30f);
+        __m128i best_idx = _mm_setzero_si128();
+
+        for (int p = 0; p < 4; ++p) {
+            __m128 dr = _mm_sub_ps(r, pr[p]);
+            __m128 dg = _mm_sub_ps(g, pg[p]);
+            __m128 db = _mm_sub_ps(b, pb[p]);
+            __m128 d  = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+
+            __m128i closer = _mm_castps_si128(_mm_cmplt_ps(d, best));
+            best_idx       = _mm_or_si128(_mm_andnot_si128(closer, best_idx), _mm_and_si128(closer, _mm_set1_epi32(p)));
+            best           = _mm_min_ps(d, best);
+        }
+
+        int32_t idx[4];
+        _mm_storeu_si128((__m128i*) idx, best_idx);
+        for (int k = 0; k < 4; ++k) indices[i + k] = (uint8_t) idx[k];
+
+        total = _mm_add_ps(total, best);
+    }
+
+    return bc__hsum(total);
+}
+
+// least squares endpoints for fixed indices, false when the indices don't constrain them.
+static bool bc__refine_color_endpoints(const BcColorBlock_t* block, const uint8_t indices[16], float e0[3], float e1[3]) {
+    static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+    float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+    float ax[3] = {0}, bx[3] = {0};
+
+    for (int i = 0; i < 16; ++i) {
+        float a = weights[indices[i]];
+        float b = 1.0f - a;
+        float texel[3] = { block->r[i], block->g[i], block->b[i] };
+
+        aa += a * a;
+        bb += b * b;
+        ab += a * b;
+
+        for (int k = 0; k < 3; ++k) {
+            ax[k] += a * texel[k];
+            bx[k] += b * texel[k];
+        }
+    }
+
+    float det = aa * bb - ab * ab;
+    if (fabsf(det) < 1e-6f) return false;
+
+    float inv = 1.0f / det;
+    for (int k = 0; k < 3; ++k) {
+        e0[k] = (ax[k] * bb - bx[k] * ab) * inv;
+        e1[k] = (bx[k] * aa - ax[k] * ab) * inv;
+    }
+
+    return true;
+}
+
+// BC1 color block, always in 4 color mode so it is valid inside BC3 too.
+static void bc__encode_color_block(const unsigned char rgba[64], unsigned char out[8]) {
+    BcColorBlock_t block;
+    for (int i = 0; i < 16; ++i) {
+        block.r[i] = rgba[i * 4 + 0];
+        block.g[i] = rgba[i * 4 + 1];
+        block.b[i] = rgba[i * 4 + 2];
+    }
+
+    __m128 sr = _mm_setzero_ps(), sg = _mm_setzero_ps(), sb = _mm_setzero_ps();
+    for (int i = 0; i < 16; i += 4) {
+        sr = _mm_add_ps(sr, _mm_load_ps(block.r + i));
+        sg = _mm_add_ps(sg, _mm_load_ps(block.g + i));
+        sb = _mm_add_ps(sb, _mm_load_ps(block.b + i));
+    }
+
+    float  mean[3] = { bc__hsum(sr) / 16.0f, bc__hsum(sg) / 16.0f, bc__hsum(sb) / 16.0f };
+    __m128 mr = _mm_set1_ps(mean[0]), mg = _mm_set1_ps(mean[1]), mb = _mm_set1_ps(mean[2]);
+
+    // covariance of the block around its mean.
+    __m128 crr = _mm_setzero_ps(), cgg = _mm_setzero_ps(), cbb = _mm_setzero_ps();
+    __m128 crg = _mm_setzero_ps(), crb = _mm_setzero_ps(), cgb = _mm_setzero_ps();
+
+    for (int i = 0; i < 16; i += 4) {
+        __m128 dr = _mm_sub_ps(_mm_load_ps(block.r + i), mr);
+        __m128 dg = _mm_sub_ps(_mm_load_ps(block.g + i), mg);
+        __m128 db = _mm_sub_ps(_mm_load_ps(block.b + i), mb);
+
+        crr = _mm_add_ps(crr, _mm_mul_ps(dr, dr));
+        cgg = _mm_add_ps(cgg, _mm_mul_ps(dg, dg));
+        cbb = _mm_add_ps(cbb, _mm_mul_ps(db, db));
+        crg = _mm_add_ps(crg, _mm_mul_ps(dr, dg));
+        crb = _mm_add_ps(crb, _mm_mul_ps(dr, db));
+        cgb = _mm_add_ps(cgb, _mm_mul_ps(dg, db));
+    }
+
+    float cov[6] = { bc__hsum(crr), bc__hsum(cgg), bc__hsum(cbb), bc__hsum(crg), bc__hsum(crb), bc__hsum(cgb) };
+
+    // principal axis by power iteration.
+    float axis[3] = { 0.577f, 0.577f, 0.577f };
+    for (int it = 0; it < 8; ++it) {
+        float x = cov[0] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        float y = cov[3] * axis[0] + cov[1] * axis[1] + cov[5] * axis[2];
+        float z = cov[4] * axis[0] + cov[5] * axis[1] + cov[2] * axis[2];
+        float len = sqrtf(x * x + y * y + z * z);
+
+        if (len < 1e-6f) break;
+        axis[0] = x / len; axis[1] = y / len; axis[2] = z / len;
+    }
+
+    __m128 ar = _mm_set1_ps(axis[0]), ag = _mm_set1_ps(axis[1]), ab = _mm_set1_ps(axis[2]);
+    __m128 tmin = _mm_set1_ps(1e30f), tmax = _mm_set1_ps(-1e30f);
+
+    for (int i = 0; i < 16; i += 4) {
+        __m128 t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.r + i), mr), ar),
+                                         _mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.g + i), mg), ag)),
+                                         _mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.b + i), mb), ab));
+        tmin = _mm_min_ps(tmin, t);
+        tmax = _mm_max_ps(tmax, t);
+    }
+
+    // pull the extremes in a bit, the interpolated colors sit closer to most texels.
+    float lo    = bc__hmin(tmin);
+    float hi    = bc__hmax(tmax);
+    float inset = (hi - lo) / 16.0f;
+    lo += inset;
+    hi -= inset;
+
+    uint16_t c0 = bc__pack_565(mean[0] + axis[0] * hi, mean[1] + axis[1] * hi, mean[2] + axis[2] * hi);
+    uint16_t c1 = bc__pack_565(mean[0] + axis[0] * lo, mean[1] + axis[1] * lo, mean[2] + axis[2] * lo);
+
+    uint8_t indices[16];
+    float   error = bc__fit_color_indices(&block, c0, c1, indices);
+
+    for (int it = 0; it < 2 && error > 0.0f; ++it) {
+        float e0[3], e1[3];
+        if (!bc__refine_color_endpoints(&block, indices, e0, e1)) break;
+
+        uint16_t n0 = bc__pack_565(e0[0], e0[1], e0[2]);
+        uint16_t n1 = bc__pack_565(e1[0], e1[1], e1[2]);
+        if (n0 == c0 && n1 == c1) break;
+
+        uint8_t candidate[16];
+        float   candidate_error = bc__fit_color_indices(&block, n0, n1, candidate);
+        if (candidate_error >= error) break;
+
+        c0 = n0; c1 = n1; error = candidate_error;
+        memcpy(indices, candidate, sizeof(indices));
+    }
+
+    // c0 > c1 selects 4 color mode in BC1, swapping the endpoints swaps 0<->1 and 2<->3.
+    if (c0 < c1) {
+        uint16_t tmp = c0; c0 = c1; c1 = tmp;
+        for (int i = 0; i < 16; ++i) indices[i] ^= 1;
+    } else if (c0 == c1) {
+        memset(indices, 0, sizeof(indices));
+    }
+
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; ++i) bits |= (uint32_t) indices[i] << (i * 2);
+
+    out[0] = (unsigned char)(c0 & 0xFF); out[1] = (unsigned char)(c0 >> 8);
+    out[2] = (unsigned char)(c1 & 0xFF); out[3] = (unsigned char)(c1 >> 8);
+    out[4] = (unsigned char)(bits);      out[5] = (unsigned char)(bits >> 8);
+    out[6] = (unsigned char)(bits >> 16); out[7] = (unsigned char)(bits >> 24);
+}
+
+static void bc__single_palette(int r0, int r1, int palette[8]) {
+    palette[0] = r0;
+    palette[1] = r1;
+
+    if (r0 > r1) {
+        for (int i = 1; i < 7; ++i) palette[i + 1] = ((7 - i) * r0 + i * r1) / 7;
+    } else {
+        for (int i = 1; i < 5; ++i) palette[i + 1] = ((5 - i) * r0 + i * r1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+// BC4 block, also the BC3 alpha block and each half of BC5.
+static void bc__encode_single_block(const unsigned char values[16], unsigned char out[8]) {
+    __m128i v  = _mm_loadu_si128((const __m128i*) values);
+    __m128i lo = _mm_min_epu8(v, _mm_srli_si128(v, 8));
+    __m128i hi = _mm_max_epu8(v, _mm_srli_si128(v, 8));
+    lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 4));
+    hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 4));
+    lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 2));
+    hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 2));
+    lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 1));
+    hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 1));
+
+    int r0 = _mm_cvtsi128_si32(hi) & 0xFF;
+    int r1 = _mm_cvtsi128_si32(lo) & 0xFF;
+
+    int palette[8];
+    bc__single_palette(r0, r1, palette);
+
+    uint64_t bits = 0;
+
+    if (r0 != r1) {
+        for (int i = 0; i < 16; i += 4) {
+            __m128  x        = _mm_set_ps(values[i + 3], values[i + 2], values[i + 1], values[i]);
+            __m128  best     = _mm_set1_ps(1e30f);
+            __m128i best_idx = _mm_setzero_si128();
+
+            for (int p = 0; p < 8; ++p) {
+                __m128  d      = _mm_sub_ps(x, _mm_set1_ps((float) palette[p]));
+                __m128  d2     = _mm_mul_ps(d, d);
+                __m128i closer = _mm_castps_si128(_mm_cmplt_ps(d2, best));
+
+                best_idx = _mm_or_si128(_mm_andnot_si128(closer, best_idx), _mm_and_si128(closer, _mm_set1_epi32(p)));
+                best     = _mm_min_ps(d2, best);
+            }
+
+            int32_t idx[4];
+            _mm_storeu_si128((__m128i*) idx, best_idx);
+            for (int k = 0; k < 4; ++k) bits |= (uint64_t) idx[k] << ((i + k) * 3);
+        }
+    }
+
+    out[0] = (unsigned char) r0;
+    out[1] = (unsigned char) r1;
+    for (int k = 0; k < 6; ++k) out[2 + k] = (unsigned char)(bits >> (k * 8));
+}
+
+static void bc__encode_block(bc_format_t format, const unsigned char rgba[64], unsigned char* out) {
+    unsigned char channel[16];
+
+    switch (format) {
+        case BC_FORMAT_BC1:
+            bc__encode_color_block(rgba, out);
+            break;
+        case BC_FORMAT_BC3:
+            for (int i = 0; i < 16; ++i) channel[i] = rgba[i * 4 + 3];
+            bc__encode_single_block(channel, out);
+            bc__encode_color_block(rgba, out + 8);
+            break;
+        case BC_FORMAT_BC4:
+            for (int i = 0; i < 16; ++i) channel[i] = rgba[i * 4];
+            bc__encode_single_block(channel, out);
+            break;
+        case BC_FORMAT_BC5:
+            for (int i = 0; i < 16; ++i) channel[i] = rgba[i * 4];
+            bc__encode_single_block(channel, out);
+            for (int i = 0; i < 16; ++i) channel[i] = rgba[i * 4 + 1];
+            bc__encode_single_block(channel, out + 8);
+            break;
+    }
+}
+
+static void bc__decode_color_block(const unsigned char in[8], unsigned char rgba[64]) {
+    uint16_t c0   = (uint16_t)(in[0] | in[1] << 8);
+    uint16_t c1   = (uint16_t)(in[2] | in[3] << 8);
+    uint32_t bits = (uint32_t) in[4] | (uint32_t) in[5] << 8 | (uint32_t) in[6] << 16 | (uint32_t) in[7] << 24;
+
+    int palette[4][3];
+    bc__color_palette(c0, c1, palette);
+
+    for (int i = 0; i < 16; ++i) {
+        int idx = (bits >> (i * 2)) & 3;
+        for (int k = 0; k < 3; ++k) rgba[i * 4 + k] = (unsigned char) palette[idx][k];
+    }
+}
+
+static void bc__decode_single_block(const unsigned char in[8], unsigned char values[16], int stride) {
+    int palette[8];
+    bc__single_palette(in[0], in[1], palette);
+
+    uint64_t bits = 0;
+    for (int k = 0; k < 6; ++k) bits |= (uint64_t) in[2 + k] << (k * 8);
+
+    for (int i = 0; i < 16; ++i) values[i * stride] = (unsigned char) palette[(bits >> (i * 3)) & 7];
+}
+
+typedef struct BcEncodeJob_st {
+    bc_format_t          format;
+    const unsigned char* pixels;
+    int                  width, height, channels;
+    unsigned char*       out;
+} BcEncodeJob_t;
+
+static void bc__encode_rows(int begin, int end, void* user) {
+    BcEncodeJob_t* job        = (BcEncodeJob_t*) user;
+    int            blocks_x   = (job->width + 3) / 4;
+    int            block_size = bc_block_bytes(job->format);
+
+    for (int by = begin; by < end; ++by) {
+        for (int bx = 0; bx < blocks_x; ++bx) {
+            unsigned char rgba[64];
+            bc__gather_block(job->pixels, job->width, job->height, job->channels, bx, by, rgba);
+            bc__encode_block(job->format, rgba, job->out + ((size_t) by * blocks_x + bx) * block_size);
+        }
+    }
+}
+
+BCENCODEAPI void bc_encode_image(bc_format_t format, const unsigned char* pixels, int width, int height, int channels, unsigned char* out) {
+    BcEncodeJob_t job = {
+        .format   = format,
+        .pixels   = pixels,
+        .width    = width,
+        .height   = height,
+        .channels = channels,
+        .out      = out
+    };
+
+    jobs_parallel_for((height + 3) / 4, 4, bc__encode_rows, &job);
+}
+
+BCENCODEAPI double bc_psnr(bc_format_t format, const unsigned char* pixels, int width, int height, int channels, const unsigned char* encoded) {
+    int blocks_x   = (width  + 3) / 4;
+    int blocks_y   = (height + 3) / 4;
+    int block_size = bc_block_bytes(format);
+    int kept       = format == BC_FORMAT_BC1 ? 3 : format == BC_FORMAT_BC3 ? 4 : format == BC_FORMAT_BC4 ? 1 : 2;
+
+    double   sum   = 0.0;
+    uint64_t count = 0;
+
+    for (int by = 0; by < blocks_y; ++by) {
+        for (int bx = 0; bx < blocks_x; ++bx) {
+            const unsigned char* in = encoded + ((size_t) by * blocks_x + bx) * block_size;
+            unsigned char source[64], decoded[64];
+
+            bc__gather_block(pixels, width, height, channels, bx, by, source);
+
+            switch (format) {
+                case BC_FORMAT_BC1:
+                    bc__decode_color_block(in, decoded);
+                    break;
+                case BC_FORMAT_BC3:
+                    bc__decode_single_block(in, decoded + 3, 4);
+                    bc__decode_color_block(in + 8, decoded);
+                    break;
+                case BC_FORMAT_BC4:
+                    bc__decode_single_block(in, decoded, 4);
+                    break;
+                case BC_FORMAT_BC5:
+                    bc__decode_single_block(in,     decoded,     4);
+                    bc__decode_single_block(in + 8, decoded + 1, 4);
+                    break;
+            }
+
+            // padding texels of edge blocks are not part of the image.
+            for (int y = 0; y < 4 && by * 4 + y < height; ++y) {
+                for (int x = 0; x < 4 && bx * 4 + x < width; ++x) {
+                    for (int k = 0; k < kept; ++k) {
+                        double d = (double) source[(y * 4 + x) * 4 + k] - decoded[(y * 4 + x) * 4 + k];
+                        sum += d * d;
+                        count++;
+                    }
+                }
+            }
+        }
+    }
+
+    if (count == 0 || sum == 0.0) return INFINITY;
+
+    double mse = sum / (double) count;
+    return 10.0 * log10(255.0 * 255.0 / mse);
+}
+
+#endif // BCENCODE_IMPLEMENTATION
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "allocator.h"
+#include "engine_math.h"
+#include "game.h"
+
+// Scripted flythrough benchmark.
+//
+// Every scenario is a generated scene, a grid of cubes and spheres lit by a number of point
+// lights, rendered for a fixed number of frames while the camera follows a closed Catmull-Rom
+// spline through BENCH_CAMERA_PATH. Nothing depends on input or wall clock time, so two runs
+// of the same build draw exactly the same frames and their numbers can be compared.
+// The results (frame time mean and percentiles, draws and triangles per second) are written
+// as JSON for whatever tracks regressions.
+
+#define BENCHAPI static
+
+#define BENCH_WARMUP_FRAMES  30
+#define BENCH_GRID_SPACING   2.5f
+
+typedef struct BenchScenario_st   BenchScenario_t;
+typedef struct BenchCameraKey_st  BenchCameraKey_t;
+typedef struct BenchFrameStats_st BenchFrameStats_t;
+typedef struct BenchResult_st     BenchResult_t;
+
+struct BenchScenario_st {
+    const char* name;
+    int         cubes;
+    int         spheres;
+    int         lights;
+    int         frames;
+};
+
+// in units of the scene's half extent, so one path fits every grid size.
+struct BenchCameraKey_st {
+    vec3 position;
+    vec3 target;
+};
+
+// nanoseconds.
+struct BenchFrameStats_st {
+    int      count;
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    uint64_t p50;
+    uint64_t p95;
+    uint64_t p99;
+};
+
+struct BenchResult_st {
+    BenchScenario_t   scenario;
+    BenchFrameStats_t frames;
+    uint64_t          draws;
+    uint64_t          triangles;
+};
+
+static const BenchScenario_t BENCH_SCENARIOS[] = {
+    { "small",     32,   32,   4, 300 },
+    { "medium",   256,  256,  16, 300 },
+    { "large",   1024, 1024,  64, 300 },
+    { "lights",   256,  256, 256, 300 },
+};
+
+#define BENCH_SCENARIO_COUNT (sizeof(BENCH_SCENARIOS) / sizeof(BENCH_SCENARIOS[0]))
+
+static const BenchCameraKey_t BENCH_CAMERA_PATH[] = {
+    { {  1.6f, 0.6f,  1.6f }, {  0.0f, 0.0f,  0.0f } },
+    { {  0.0f, 0.3f,  1.2f }, { -0.5f, 0.0f, -0.5f } },
+    { { -1.4f, 0.2f,  0.4f }, {  0.5f, 0.0f,  0.0f } },
+    { { -0.8f, 1.2f, -1.3f }, {  0.0f, 0.0f,  0.0f } },
+    { {  0.3f, 0.1f, -0.6f }, {  1.0f, 0.0f,  0.6f } },
+    { {  1.3f, 0.4f, -0.2f }, { -1.0f, 0.0f,  0.0f } },
+};
+
+#define BENCH_CAMERA_KEY_COUNT (sizeof(BENCH_CAMERA_PATH) / sizeof(BENCH_CAMERA_PATH[0]))
+
+// `t` in [0, 1) covers the whole loop, the last key joins back to the first.
+BENCHAPI void              bench_camera_path(const BenchCameraKey_t* keys, int count, float t, vec3* position, vec3* target);
+// sorts a copy, `frame_ns` is left alone.
+BENCHAPI BenchFrameStats_t bench_frame_stats(const uint64_t* frame_ns, int count);
+BENCHAPI bool              bench_write_json(const char* path, const char* renderer, const BenchResult_t* results, int count);
+
+#ifdef BENCH_IMPLEMENTATION
+
+static vec3 bench__catmull_rom(vec3 p0, vec3 p1, vec3 p2, vec3 p3, float t) {
+    float t2 = t * t;
+    float t3 = t2 * t;
+
+    vec3 a = vec3_scale(p1, 2.0f);
+    vec3 b = vec3_sub(p2, p0);
+    vec3 c = vec3_add(vec3_sub(vec3_scale(p0, 2.0f), vec3_scale(p1, 5.0f)), vec3_sub(vec3_scale(p2, 4.0f), p3));
+    vec3 d = vec3_add(vec3_sub(vec3_scale(p1, 3.0f), p0), vec3_sub(p3, vec3_scale(p2, 3.0f)));
+
+    return vec3_scale(vec3_add(vec3_add(a, vec3_scale(b, t)), vec3_add(vec3_scale(c, t2), vec3_scale(d, t3))), 0.5f);
+}
+
+BENCHAPI void bench_camera_path(const BenchCameraKey_t* keys, int count, float t, vec3* position, vec3* target) {
+    t -= floorf(t);
+
+    float segment = t * count;
+    int   i       = (int) segment;
+    float local   = segment - i;
+
+    const BenchCameraKey_t* k0 = &keys[(i + count - 1) % count];
+    const BenchCameraKey_t* k1 = &keys[i % count];
+    const BenchCameraKey_t* k2 = &keys[(i + 1) % count];
+    const BenchCameraKey_t* k3 = &keys[(i + 2) % count];
+
+    *position = bench__catmull_rom(k0->position, k1->position, k2->position, k3->position, local);
+    *target   = bench__catmull_rom(k0->target,   k1->target,   k2->target,   k3->target,   local);
+}
+
+static int bench__compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*) a;
+    uint64_t y = *(const uint64_t*) b;
+    return (x > y) - (x < y);
+}
+
+BENCHAPI BenchFrameStats_t bench_frame_stats(const uint64_t* frame_ns, int count) {
+    BenchFrameStats_t stats = { .count = count };
+    if (count <= 0) return stats;
+
+    uint64_t* sorted = mem_alloc(MEM_TAG_GENERAL, (size_t) count * sizeof(uint64_t));
+    if (!sorted) return (BenchFrameStats_t) {0};
+
+    memcpy(sorted, frame_ns, (size_t) count * sizeof(uint64_t));
+    qsort(sorted, (size_t) count, sizeof(uint64_t), bench__compare_u64);
+
+    for (int i = 0; i < count; ++i) stats.total += sorted[i];
+
+    // nearest rank.
+    stats.min = sorted[0];
+    stats.max = sorted[count - 1];
+    stats.p50 = sorted[(count - 1) * 50 / 100];
+    stats.p95 = sorted[(count - 1) * 95 / 100];
+    stats.p99 = sorted[(count - 1) * 99 / 100];
+
+    mem_free(sorted);
+    return stats;
+}
+
+static void bench__write_string(FILE* fh, const char* s) {
+    fputc('"', fh);
+    for (; s && *s; ++s) {
+        if (*s == '"' || *s == '\\')          fprintf(fh, "\\%c", *s);
+        else if ((unsigned char) *s < 0x20) fprintf(fh, "\\u%04x", *s);
+        else                                fputc(*s, fh);
+    }
+    fputc('"', fh);
+}
+
+BENCHAPI bool bench_write_json(const char* path, const char* renderer, const BenchResult_t* results, int count) {
+    FILE* fh = fopen(path, "wb");
+    if (!fh) {
+        printf("bench_write_json() failed to open %s\n", path);
+        return false;
+    }
+
+    fprintf(fh, "{\n  \"renderer\": ");
+    bench__write_string(fh, renderer);
+    fprintf(fh, ",\n  \"width\": %d,\n  \"height\": %d,\n  \"scenarios\": [\n", CANVAS_WIDTH, CANVAS_HEIGHT);
+
+    for (int i = 0; i < count; ++i) {
+        const BenchResult_t*     r       = &results[i];
+        const BenchFrameStats_t* f       = &r->frames;
+        double                   seconds = f->total / 1e9;
+
+        fprintf(fh, "    {\n      \"name\": ");
+        bench__write_string(fh, r->scenario.name);
+        fprintf(fh, ",\n");
+        fprintf(fh, "      \"cubes\": %d,\n",   r->scenario.cubes);
+        fprintf(fh, "      \"spheres\": %d,\n", r->scenario.spheres);
+        fprintf(fh, "      \"lights\": %d,\n",  r->scenario.lights);
+        fprintf(fh, "      \"frames\": %d,\n",  f->count);
+        fprintf(fh, "      \"mean_ms\": %.4f,\n", f->count ? f->total / 1e6 / f->count : 0.0);
+        fprintf(fh, "      \"p50_ms\": %.4f,\n",  f->p50 / 1e6);
+        fprintf(fh, "      \"p95_ms\": %.4f,\n",  f->p95 / 1e6);
+        fprintf(fh, "      \"p99_ms\": %.4f,\n",  f->p99 / 1e6);
+        fprintf(fh, "      \"max_ms\": %.4f,\n",  f->max / 1e6);
+        fprintf(fh, "      \"draws_per_sec\": %.1f,\n",     seconds > 0.0 ? r->draws     / seconds : 0.0);
+        fprintf(fh, "      \"triangles_per_sec\": %.1f\n",  seconds > 0.0 ? r->triangles / seconds : 0.0);
+        fprintf(fh, "    }%s\n", i + 1 < count ? "," : "");
+    }
+
+    fprintf(fh, "  ]\n}\n");
+
+    bool ok = !ferror(fh);
+    ok = fclose(fh) == 0 && ok;
+    return ok;
+}
+
+#endif // BENCH_IMPLEMENTATION
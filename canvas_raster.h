@@ -0,0 +1,584 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#   include <immintrin.h>
+#endif
+#include "deps/olivec/olive.c"
+#include "allocator.h"
+#include "jobs.h"
+
+// Tiled software rasterizer for Olivec_Canvas.
+//
+// Draws the same pixels as olive.c's olivec_fill / olivec_rect / olivec_triangle / olivec_circle
+// / olivec_line, blending included, but not right away: between raster_begin() and raster_end()
+// primitives are only recorded. raster_end() bins them into RASTER_TILE_SIZE square tiles and
+// fills the tiles on the job pool. Within a tile primitives are drawn in the order they were
+// recorded, and olive.c's result for a pixel depends only on that pixel and the order, so the
+// canvas ends up exactly as if the olivec_* calls had run one after the other.
+//
+// Every fill is cut into rows of constant color before touching pixels:
+//   - rects are rows of the clipped rect.
+//   - triangles: olive.c tests each pixel's barycentric coordinates. Each one is linear along a
+//     row, so the pixels that pass form one interval, found with exact integer divisions.
+//   - circles: olive.c counts the 2x2 subsamples inside the circle. Each subsample column passes
+//     over an interval of a row (exact integer square roots), and between the ends of the four
+//     intervals the coverage, so the alpha, is constant.
+// Rows are then blended 4 pixels at a time on SSE2, 8 with AVX2 when built for it, with olive's
+// integer blend (destination alpha kept, exact division by 255). Lines stay per pixel, binned
+// to the tiles they actually cross.
+//
+// Binning and tile lists are kept between frames, a steady frame doesn't allocate.
+
+#define RASTERAPI static
+
+#define RASTER_TILE_SIZE     64
+#define RASTER_MIN_CAPACITY  256
+
+typedef enum raster_prim_enum {
+    RASTER_FILL,
+    RASTER_RECT,
+    RASTER_TRIANGLE,
+    RASTER_CIRCLE,
+    RASTER_LINE,
+} raster_prim_t;
+
+typedef struct RasterPrim_st RasterPrim_t;
+typedef struct Raster_st     Raster_t;
+
+struct RasterPrim_st {
+    uint8_t  type;          // raster_prim_t
+    uint32_t color;
+    int      x0, y0, x1, y1;    // clipped bounds, inclusive
+    int      v[6];          // triangle vertices, circle cx cy r, line ends in drawing order
+};
+
+struct Raster_st {
+    Olivec_Canvas  canvas;
+    int            tiles_x, tiles_y;
+
+    RasterPrim_t*  prims;
+    uint32_t       prim_count;
+    uint32_t       prim_capacity;
+
+    // prim indices grouped by tile, tile t's are tile_prims[tile_offsets[t] .. tile_offsets[t + 1]).
+    // The cursors for filling them in share the allocation, after the offsets.
+    uint32_t*      tile_offsets;
+    uint32_t*      tile_cursors;
+    uint32_t       tile_capacity;
+    uint32_t*      tile_prims;
+    uint32_t       tile_prim_capacity;
+
+    uint64_t       binned;  // tile entries of the last raster_end()
+};
+
+RASTERAPI void raster_release(Raster_t* raster);
+// starts recording for `canvas`, which must stay alive until raster_end().
+RASTERAPI void raster_begin(Raster_t* raster, Olivec_Canvas canvas);
+// draws everything recorded since raster_begin(). false when out of memory, nothing drawn.
+RASTERAPI bool raster_end(Raster_t* raster);
+
+// same arguments and pixels as their olivec_* counterparts.
+RASTERAPI void raster_fill(Raster_t* raster, uint32_t color);
+RASTERAPI void raster_rect(Raster_t* raster, int x, int y, int w, int h, uint32_t color);
+RASTERAPI void raster_triangle(Raster_t* raster, int x1, int y1, int x2, int y2, int x3, int y3, uint32_t color);
+RASTERAPI void raster_circle(Raster_t* raster, int cx, int cy, int r, uint32_t color);
+RASTERAPI void raster_line(Raster_t* raster, int x1, int y1, int x2, int y2, uint32_t color);
+
+#ifdef RASTER_IMPLEMENTATION
+
+RASTERAPI void raster_release(Raster_t* raster) {
+    mem_free(raster->prims);
+    mem_free(raster->tile_offsets);
+    mem_free(raster->tile_prims);
+    memset(raster, 0, sizeof(*raster));
+}
+
+RASTERAPI void raster_begin(Raster_t* raster, Olivec_Canvas canvas) {
+    raster->canvas     = canvas;
+    raster->tiles_x    = (int)((canvas.width  + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE);
+    raster->tiles_y    = (int)((canvas.height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE);
+    raster->prim_count = 0;
+}
+
+static RasterPrim_t* raster__push(Raster_t* raster, raster_prim_t type, uint32_t color, int x0, int y0, int x1, int y1) {
+    if (raster->prim_count == raster->prim_capacity) {
+        uint32_t      capacity = raster->prim_capacity ? raster->prim_capacity * 2 : RASTER_MIN_CAPACITY;
+        RasterPrim_t* prims    = mem_realloc(MEM_TAG_RENDER, raster->prims, (size_t) capacity * sizeof(RasterPrim_t));
+        if (!prims) return NULL;
+
+        raster->prims         = prims;
+        raster->prim_capacity = capacity;
+    }
+
+    RasterPrim_t* prim = &raster->prims[raster->prim_count++];
+    *prim = (RasterPrim_t) { .type = (uint8_t) type, .color = color, .x0 = x0, .y0 = y0, .x1 = x1, .y1 = y1 };
+    return prim;
+}
+
+RASTERAPI void raster_fill(Raster_t* raster, uint32_t color) {
+    if (!raster->canvas.width || !raster->canvas.height) return;
+    raster__push(raster, RASTER_FILL, color, 0, 0, (int) raster->canvas.width - 1, (int) raster->canvas.height - 1);
+}
+
+RASTERAPI void raster_rect(Raster_t* raster, int x, int y, int w, int h, uint32_t color) {
+    Olivec_Normalized_Rect nr = {0};
+    if (!olivec_normalize_rect(x, y, w, h, raster->canvas.width, raster->canvas.height, &nr)) return;
+
+    raster__push(raster, RASTER_RECT, color, nr.x1, nr.y1, nr.x2, nr.y2);
+}
+
+RASTERAPI void raster_triangle(Raster_t* raster, int x1, int y1, int x2, int y2, int x3, int y3, uint32_t color) {
+    int lx = x1 < x2 ? (x1 < x3 ? x1 : x3) : (x2 < x3 ? x2 : x3);
+    int hx = x1 > x2 ? (x1 > x3 ? x1 : x3) : (x2 > x3 ? x2 : x3);
+    int ly = y1 < y2 ? (y1 < y3 ? y1 : y3) : (y2 < y3 ? y2 : y3);
+    int hy = y1 > y2 ? (y1 > y3 ? y1 : y3) : (y2 > y3 ? y2 : y3);
+
+    int width  = (int) raster->canvas.width;
+    int height = (int) raster->canvas.height;
+    if (hx < 0 || hy < 0 || lx >= width || ly >= height) return;
+
+    RasterPrim_t* prim = raster__push(raster, RASTER_TRIANGLE, color,
+        lx < 0 ? 0 : lx, ly < 0 ? 0 : ly, hx >= width ? width - 1 : hx, hy >= height ? height - 1 : hy);
+    if (!prim) return;
+
+    prim->v[0] = x1; prim->v[1] = y1;
+    prim->v[2] = x2; prim->v[3] = y2;
+    prim->v[4] = x3; prim->v[5] = y3;
+}
+
+RASTERAPI void raster_circle(Raster_t* raster, int cx, int cy, int r, uint32_t color) {
+    Olivec_Normalized_Rect nr = {0};
+    int r1 = r + (r > 0) - (r < 0);
+    if (!olivec_normalize_rect(cx - r1, cy - r1, 2 * r1, 2 * r1, raster->canvas.width, raster->canvas.height, &nr)) return;
+
+    RasterPrim_t* prim = raster__push(raster, RASTER_CIRCLE, color, nr.x1, nr.y1, nr.x2, nr.y2);
+    if (!prim) return;
+
+    prim->v[0] = cx;
+    prim->v[1] = cy;
+    prim->v[2] = r;
+}
+
+RASTERAPI void raster_line(Raster_t* raster, int x1, int y1, int x2, int y2, uint32_t color) {
+    int dx = x2 - x1;
+    int dy = y2 - y1;
+
+    // olive.c walks the longer axis from the smaller end.
+    if (abs(dx) > abs(dy) ? x1 > x2 : y1 > y2) {
+        int t;
+        t = x1; x1 = x2; x2 = t;
+        t = y1; y1 = y2; y2 = t;
+    }
+
+    int lx = x1 < x2 ? x1 : x2, hx = x1 < x2 ? x2 : x1;
+    int ly = y1 < y2 ? y1 : y2, hy = y1 < y2 ? y2 : y1;
+
+    int width  = (int) raster->canvas.width;
+    int height = (int) raster->canvas.height;
+    if (hx < 0 || hy < 0 || lx >= width || ly >= height) return;
+
+    RasterPrim_t* prim = raster__push(raster, RASTER_LINE, color,
+        lx < 0 ? 0 : lx, ly < 0 ? 0 : ly, hx >= width ? width - 1 : hx, hy >= height ? height - 1 : hy);
+    if (!prim) return;
+
+    prim->v[0] = x1; prim->v[1] = y1;
+    prim->v[2] = x2; prim->v[3] = y2;
+}
+
+// -- pixels --
+
+static inline void raster__blend(uint32_t* c1, uint32_t c2) {
+    uint32_t a2 = c2 >> 24;
+    uint32_t r  = ((*c1 & 0xFF)         * (255 - a2) + (c2 & 0xFF)         * a2) / 255;
+    uint32_t g  = ((*c1 >> 8  & 0xFF)   * (255 - a2) + (c2 >> 8  & 0xFF)   * a2) / 255;
+    uint32_t b  = ((*c1 >> 16 & 0xFF)   * (255 - a2) + (c2 >> 16 & 0xFF)   * a2) / 255;
+
+    *c1 = (*c1 & 0xFF000000) | b << 16 | g << 8 | r;
+}
+
+// c1 * (255 - a) + c2 * a over 8 16-bit channels, divided by 255 exactly: (x + 1 + (x >> 8)) >> 8
+// is x / 255 for every x up to 255 * 255.
+static inline __m128i raster__blend_channels(__m128i c1, __m128i inv_alpha, __m128i src_alpha) {
+    __m128i x = _mm_add_epi16(_mm_mullo_epi16(c1, inv_alpha), src_alpha);
+    return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), _mm_srli_epi16(x, 8)), 8);
+}
+
+// `count` pixels of `color` blended into `dst`.
+static void raster__span(uint32_t* dst, int count, uint32_t color) {
+    uint32_t alpha = color >> 24;
+    if (alpha == 0 || count <= 0) return;
+
+    int i = 0;
+
+    if (alpha == 255) {
+        uint32_t rgb = color & 0x00FFFFFF;
+#if defined(__AVX2__)
+        __m256i keep8 = _mm256_set1_epi32((int) 0xFF000000);
+        __m256i rgb8  = _mm256_set1_epi32((int) rgb);
+        for (; i + 8 <= count; i += 8) {
+            __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+            _mm256_storeu_si256((__m256i*)(dst + i), _mm256_or_si256(_mm256_and_si256(d, keep8), rgb8));
+        }
+#endif // defined(__AVX2__)
+        __m128i keep4 = _mm_set1_epi32((int) 0xFF000000);
+        __m128i rgb4  = _mm_set1_epi32((int) rgb);
+        for (; i + 4 <= count; i += 4) {
+            __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(_mm_and_si128(d, keep4), rgb4));
+        }
+        for (; i < count; ++i) dst[i] = (dst[i] & 0xFF000000) | rgb;
+        return;
+    }
+
+    short r = (short)((color & 0xFF) * alpha);
+    short g = (short)((color >> 8 & 0xFF) * alpha);
+    short b = (short)((color >> 16 & 0xFF) * alpha);
+
+    __m128i zero     = _mm_setzero_si128();
+    __m128i rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+    __m128i inv4     = _mm_set1_epi16((short)(255 - alpha));
+    __m128i src4     = _mm_set_epi16(0, b, g, r, 0, b, g, r);
+
+#if defined(__AVX2__)
+    __m256i zero8     = _mm256_setzero_si256();
+    __m256i rgb_mask8 = _mm256_set1_epi32(0x00FFFFFF);
+    __m256i inv8      = _mm256_set1_epi16((short)(255 - alpha));
+    __m256i src8      = _mm256_set_epi16(0, b, g, r, 0, b, g, r, 0, b, g, r, 0, b, g, r);
+    __m256i one8      = _mm256_set1_epi16(1);
+
+    for (; i + 8 <= count; i += 8) {
+        __m256i d  = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero8), inv8), src8);
+        __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero8), inv8), src8);
+
+        lo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(lo, one8), _mm256_srli_epi16(lo, 8)), 8);
+        hi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(hi, one8), _mm256_srli_epi16(hi, 8)), 8);
+
+        __m256i blended = _mm256_packus_epi16(lo, hi);
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_or_si256(_mm256_and_si256(blended, rgb_mask8), _mm256_andnot_si256(rgb_mask8, d)));
+    }
+#endif // defined(__AVX2__)
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i d  = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i lo = raster__blend_channels(_mm_unpacklo_epi8(d, zero), inv4, src4);
+        __m128i hi = raster__blend_channels(_mm_unpackhi_epi8(d, zero), inv4, src4);
+
+        __m128i blended = _mm_packus_epi16(lo, hi);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(_mm_and_si128(blended, rgb_mask), _mm_andnot_si128(rgb_mask, d)));
+    }
+
+    for (; i < count; ++i) raster__blend(&dst[i], color);
+}
+
+static void raster__store(uint32_t* dst, int count, uint32_t color) {
+    int     i     = 0;
+    __m128i color4 = _mm_set1_epi32((int) color);
+
+    for (; i + 4 <= count; i += 4) _mm_storeu_si128((__m128i*)(dst + i), color4);
+    for (; i < count; ++i) dst[i] = color;
+}
+
+// -- primitives, clipped to one tile --
+
+typedef struct {
+    int x0, y0, x1, y1;     // inclusive
+} RasterRect_t;
+
+static inline uint32_t* raster__row(const Raster_t* raster, int y) {
+    return raster->canvas.pixels + (size_t) y * raster->canvas.stride;
+}
+
+static inline int64_t raster__floor_div(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+static inline int64_t raster__ceil_div(int64_t a, int64_t b) {
+    return -raster__floor_div(-a, b);
+}
+
+// narrows [*lo, *hi] to the x where a * x + b >= 0.
+static inline void raster__clip_edge(int64_t a, int64_t b, int64_t* lo, int64_t* hi) {
+    if (a > 0) {
+        int64_t x = raster__ceil_div(-b, a);
+        if (x > *lo) *lo = x;
+    } else if (a < 0) {
+        int64_t x = raster__floor_div(b, -a);
+        if (x < *hi) *hi = x;
+    } else if (b < 0) {
+        *hi = *lo - 1;
+    }
+}
+
+static void raster__rect(const Raster_t* raster, const RasterPrim_t* prim, RasterRect_t clip, bool store) {
+    for (int y = clip.y0; y <= clip.y1; ++y) {
+        uint32_t* row = raster__row(raster, y) + clip.x0;
+        if (store) raster__store(row, clip.x1 - clip.x0 + 1, prim->color);
+        else       raster__span(row, clip.x1 - clip.x0 + 1, prim->color);
+    }
+}
+
+// olive.c: the pixel is in when u1, u2 and u3 = det - u1 - u2 each have det's sign or are 0.
+static void raster__triangle(const Raster_t* raster, const RasterPrim_t* prim, RasterRect_t clip) {
+    int64_t x1 = prim->v[0], y1 = prim->v[1];
+    int64_t x2 = prim->v[2], y2 = prim->v[3];
+    int64_t x3 = prim->v[4], y3 = prim->v[5];
+
+    int64_t det = (x1 - x3) * (y2 - y3) - (x2 - x3) * (y1 - y3);
+
+    // degenerate, only pixels where all three are 0. Not worth anything faster.
+    if (det == 0) {
+        for (int y = clip.y0; y <= clip.y1; ++y) {
+            for (int x = clip.x0; x <= clip.x1; ++x) {
+                int64_t u1 = (y2 - y3) * (x - x3) + (x3 - x2) * (y - y3);
+                int64_t u2 = (y3 - y1) * (x - x3) + (x1 - x3) * (y - y3);
+                if (u1 == 0 && u2 == 0) raster__blend(&raster__row(raster, y)[x], prim->color);
+            }
+        }
+        return;
+    }
+
+    // flipped so every test is u >= 0.
+    int64_t sign = det > 0 ? 1 : -1;
+
+    for (int y = clip.y0; y <= clip.y1; ++y) {
+        // u(x) = a * x + b along the row.
+        int64_t a1 = sign * (y2 - y3), b1 = sign * ((x3 - x2) * (y - y3) - (y2 - y3) * x3);
+        int64_t a2 = sign * (y3 - y1), b2 = sign * ((x1 - x3) * (y - y3) - (y3 - y1) * x3);
+        int64_t a3 = -a1 - a2,         b3 = sign * det - b1 - b2;
+
+        int64_t lo = clip.x0, hi = clip.x1;
+        raster__clip_edge(a1, b1, &lo, &hi);
+        raster__clip_edge(a2, b2, &lo, &hi);
+        raster__clip_edge(a3, b3, &lo, &hi);
+
+        if (lo <= hi) raster__span(raster__row(raster, y) + lo, (int)(hi - lo + 1), prim->color);
+    }
+}
+
+static inline int64_t raster__isqrt(int64_t v) {
+    int64_t s = (int64_t) sqrt((double) v);
+    while (s * s > v)             --s;
+    while ((s + 1) * (s + 1) <= v) ++s;
+    return s;
+}
+
+// olive.c with OLIVEC_AA_RES 2: subsample (sox, soy) of pixel (x, y) is in when
+// dx^2 + dy^2 <= 36 r^2, dx = 6 x + 2 sox - 6 cx - 1 and dy the same in y.
+static void raster__circle(const Raster_t* raster, const RasterPrim_t* prim, RasterRect_t clip) {
+    int64_t cx = prim->v[0], cy = prim->v[1], r = prim->v[2];
+    int64_t limit = 36 * r * r;
+    uint32_t alpha = prim->color >> 24;
+    uint32_t rgb   = prim->color & 0x00FFFFFF;
+
+    for (int y = clip.y0; y <= clip.y1; ++y) {
+        // pixel x sees a subsample column while lo <= x <= hi; coverage steps at each end.
+        int     edges[8];
+        int     steps[8];
+        int     edge_count = 0;
+
+        for (int soy = 0; soy < 2; ++soy) {
+            int64_t dy   = 6 * y + 2 * soy - 6 * cy - 1;
+            int64_t room = limit - dy * dy;
+            if (room < 0) continue;
+
+            int64_t s = raster__isqrt(room);
+            for (int sox = 0; sox < 2; ++sox) {
+                int64_t k  = 2 * sox - 6 * cx - 1;
+                int64_t lo = raster__ceil_div(-s - k, 6);
+                int64_t hi = raster__floor_div(s - k, 6);
+                if (lo > hi || hi < clip.x0 || lo > clip.x1) continue;
+
+                edges[edge_count] = (int)(lo < clip.x0 ? clip.x0 : lo);     steps[edge_count++] =  1;
+                edges[edge_count] = (int)(hi > clip.x1 ? clip.x1 + 1 : hi + 1); steps[edge_count++] = -1;
+            }
+        }
+
+        // a handful of edges, insertion sort.
+        for (int i = 1; i < edge_count; ++i) {
+            for (int j = i; j > 0 && edges[j - 1] > edges[j]; --j) {
+                int e = edges[j]; edges[j] = edges[j - 1]; edges[j - 1] = e;
+                int s = steps[j]; steps[j] = steps[j - 1]; steps[j - 1] = s;
+            }
+        }
+
+        uint32_t* row      = raster__row(raster, y);
+        int       coverage = 0;
+
+        for (int i = 0; i < edge_count; ++i) {
+            coverage += steps[i];
+
+            int begin = edges[i];
+            int end   = i + 1 < edge_count ? edges[i + 1] : clip.x1 + 1;
+            if (coverage <= 0 || begin >= end) continue;
+
+            raster__span(row + begin, end - begin, rgb | (alpha * coverage / 4) << 24);
+        }
+    }
+}
+
+// olive.c: one pixel per step along the longer axis, the other coordinate truncated toward 0.
+static void raster__line(const Raster_t* raster, const RasterPrim_t* prim, RasterRect_t clip) {
+    int x1 = prim->v[0], y1 = prim->v[1];
+    int x2 = prim->v[2], y2 = prim->v[3];
+    int dx = x2 - x1, dy = y2 - y1;
+
+    if (dx == 0 && dy == 0) {
+        if (x1 >= clip.x0 && x1 <= clip.x1 && y1 >= clip.y0 && y1 <= clip.y1) raster__blend(&raster__row(raster, y1)[x1], prim->color);
+        return;
+    }
+
+    if (abs(dx) > abs(dy)) {
+        int from = x1 > clip.x0 ? x1 : clip.x0;
+        int to   = x2 < clip.x1 ? x2 : clip.x1;
+
+        for (int x = from; x <= to; ++x) {
+            int y = dy * (x - x1) / dx + y1;
+            if (y >= clip.y0 && y <= clip.y1) raster__blend(&raster__row(raster, y)[x], prim->color);
+        }
+    } else {
+        int from = y1 > clip.y0 ? y1 : clip.y0;
+        int to   = y2 < clip.y1 ? y2 : clip.y1;
+
+        for (int y = from; y <= to; ++y) {
+            int x = dx * (y - y1) / dy + x1;
+            if (x >= clip.x0 && x <= clip.x1) raster__blend(&raster__row(raster, y)[x], prim->color);
+        }
+    }
+}
+
+// -- binning --
+
+// calls `fn` for every tile the primitive may touch. Lines only visit the tiles along them: the
+// minor coordinate is monotonic, so each column (row) of tiles spans the line's ends within it.
+static void raster__for_tiles(Raster_t* raster, uint32_t index, void (*fn)(Raster_t*, uint32_t, int)) {
+    const RasterPrim_t* prim = &raster->prims[index];
+
+    if (prim->type == RASTER_LINE && (prim->v[0] != prim->v[2] || prim->v[1] != prim->v[3])) {
+        int x1 = prim->v[0], y1 = prim->v[1];
+        int dx = prim->v[2] - x1, dy = prim->v[3] - y1;
+        bool major_x = abs(dx) > abs(dy);
+
+        int major_lo  = major_x ? prim->x0 : prim->y0, major_hi = major_x ? prim->x1 : prim->y1;
+        int minor_lo  = major_x ? prim->y0 : prim->x0, minor_hi = major_x ? prim->y1 : prim->x1;
+        int major_end = major_x ? raster->tiles_x : raster->tiles_y;
+
+        for (int t = major_lo / RASTER_TILE_SIZE; t < major_end && t * RASTER_TILE_SIZE <= major_hi; ++t) {
+            int from = t * RASTER_TILE_SIZE > major_lo ? t * RASTER_TILE_SIZE : major_lo;
+            int to   = t * RASTER_TILE_SIZE + RASTER_TILE_SIZE - 1 < major_hi ? t * RASTER_TILE_SIZE + RASTER_TILE_SIZE - 1 : major_hi;
+
+            int a = major_x ? dy * (from - x1) / dx + y1 : dx * (from - y1) / dy + x1;
+            int b = major_x ? dy * (to   - x1) / dx + y1 : dx * (to   - y1) / dy + x1;
+            int lo = a < b ? a : b, hi = a < b ? b : a;
+
+            if (lo < minor_lo) lo = minor_lo;
+            if (hi > minor_hi) hi = minor_hi;
+
+            for (int m = lo / RASTER_TILE_SIZE; lo <= hi && m <= hi / RASTER_TILE_SIZE; ++m) {
+                fn(raster, index, major_x ? m * raster->tiles_x + t : t * raster->tiles_x + m);
+            }
+        }
+        return;
+    }
+
+    for (int ty = prim->y0 / RASTER_TILE_SIZE; ty <= prim->y1 / RASTER_TILE_SIZE; ++ty) {
+        for (int tx = prim->x0 / RASTER_TILE_SIZE; tx <= prim->x1 / RASTER_TILE_SIZE; ++tx) {
+            fn(raster, index, ty * raster->tiles_x + tx);
+        }
+    }
+}
+
+static void raster__count(Raster_t* raster, uint32_t index, int tile) {
+    (void) index;
+    raster->tile_offsets[tile + 1]++;
+}
+
+static void raster__insert(Raster_t* raster, uint32_t index, int tile) {
+    raster->tile_prims[raster->tile_cursors[tile]++] = index;
+}
+
+static void raster__fill_tiles(int begin, int end, void* user) {
+    const Raster_t* raster = (const Raster_t*) user;
+
+    for (int tile = begin; tile < end; ++tile) {
+        int tx = tile % raster->tiles_x;
+        int ty = tile / raster->tiles_x;
+
+        RasterRect_t bounds = {
+            .x0 = tx * RASTER_TILE_SIZE,
+            .y0 = ty * RASTER_TILE_SIZE,
+            .x1 = tx * RASTER_TILE_SIZE + RASTER_TILE_SIZE - 1,
+            .y1 = ty * RASTER_TILE_SIZE + RASTER_TILE_SIZE - 1
+        };
+        if (bounds.x1 >= (int) raster->canvas.width)  bounds.x1 = (int) raster->canvas.width  - 1;
+        if (bounds.y1 >= (int) raster->canvas.height) bounds.y1 = (int) raster->canvas.height - 1;
+
+        for (uint32_t i = raster->tile_offsets[tile]; i < raster->tile_offsets[tile + 1]; ++i) {
+            const RasterPrim_t* prim = &raster->prims[raster->tile_prims[i]];
+
+            RasterRect_t clip = {
+                .x0 = prim->x0 > bounds.x0 ? prim->x0 : bounds.x0,
+                .y0 = prim->y0 > bounds.y0 ? prim->y0 : bounds.y0,
+                .x1 = prim->x1 < bounds.x1 ? prim->x1 : bounds.x1,
+                .y1 = prim->y1 < bounds.y1 ? prim->y1 : bounds.y1
+            };
+            if (clip.x0 > clip.x1 || clip.y0 > clip.y1) continue;
+
+            switch (prim->type) {
+                case RASTER_FILL:     raster__rect(raster, prim, clip, true);  break;
+                case RASTER_RECT:     raster__rect(raster, prim, clip, false); break;
+                case RASTER_TRIANGLE: raster__triangle(raster, prim, clip);    break;
+                case RASTER_CIRCLE:   raster__circle(raster, prim, clip);      break;
+                case RASTER_LINE:     raster__line(raster, prim, clip);        break;
+            }
+        }
+    }
+}
+
+static bool raster__reserve(uint32_t** array, uint32_t* capacity, uint32_t needed) {
+    if (needed <= *capacity) return true;
+
+    uint32_t grown = *capacity ? *capacity : RASTER_MIN_CAPACITY;
+    while (grown < needed) grown *= 2;
+
+    uint32_t* resized = mem_realloc(MEM_TAG_RENDER, *array, (size_t) grown * sizeof(uint32_t));
+    if (!resized) return false;
+
+    *array    = resized;
+    *capacity = grown;
+    return true;
+}
+
+RASTERAPI bool raster_end(Raster_t* raster) {
+    if (!raster->prim_count) return true;
+
+    uint32_t tiles = (uint32_t)(raster->tiles_x * raster->tiles_y);
+
+    if (!raster__reserve(&raster->tile_offsets, &raster->tile_capacity, 2 * (tiles + 1))) return false;
+    raster->tile_cursors = raster->tile_offsets + tiles + 1;
+
+    memset(raster->tile_offsets, 0, (size_t)(tiles + 1) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < raster->prim_count; ++i) raster__for_tiles(raster, i, raster__count);
+
+    for (uint32_t t = 0; t < tiles; ++t) raster->tile_offsets[t + 1] += raster->tile_offsets[t];
+    raster->binned = raster->tile_offsets[tiles];
+
+    if (!raster__reserve(&raster->tile_prims, &raster->tile_prim_capacity, (uint32_t) raster->binned)) return false;
+
+    memcpy(raster->tile_cursors, raster->tile_offsets, (size_t) tiles * sizeof(uint32_t));
+    for (uint32_t i = 0; i < raster->prim_count; ++i) raster__for_tiles(raster, i, raster__insert);
+
+    jobs_parallel_for((int) tiles, 1, raster__fill_tiles, raster);
+
+    raster->prim_count = 0;
+    return true;
+}
+
+#endif // RASTER_IMPLEMENTATION
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "file.h"
+#include "gl_gfx.h"
+
+// Cooked texture container (.ctex), written offline by tools/texcook.c.
+//
+// A fixed header indexes every mip level, each one already filtered and stored tightly packed
+// in the GL format it is uploaded with, so loading is a file mapping plus one glTexImage2D (or
+// glCompressedTexImage2D for block compressed files) per level: no image decode and no
+// glGenerateMipmap. Level data starts on a COOKED_TEXTURE_ALIGNMENT boundary.
+
+#define COOKEDTEXAPI static
+
+// the block compressed formats, as bc_encode.h writes them.
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#   define GL_COMPRESSED_RGB_S3TC_DXT1_EXT  0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#   define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RED_RGTC1
+#   define GL_COMPRESSED_RED_RGTC1          0x8DBB
+#endif
+#ifndef GL_COMPRESSED_RG_RGTC2
+#   define GL_COMPRESSED_RG_RGTC2           0x8DBD
+#endif
+
+#define COOKED_TEXTURE_MAGIC      0x58455443u  // "CTEX"
+#define COOKED_TEXTURE_VERSION    1
+#define COOKED_TEXTURE_MAX_LEVELS 16
+#define COOKED_TEXTURE_ALIGNMENT  16
+#define COOKED_TEXTURE_EXTENSION  ".ctex"
+
+// color channels were filtered in linear space and stored back as sRGB.
+#define COOKED_TEXTURE_FLAG_SRGB       (1u << 0)
+// xyz was renormalized after filtering.
+#define COOKED_TEXTURE_FLAG_NORMAL     (1u << 1)
+// levels hold compressed blocks of gl_internal_format, gl_format and gl_type are unused.
+#define COOKED_TEXTURE_FLAG_COMPRESSED (1u << 2)
+
+typedef struct CookedTextureLevel_st  CookedTextureLevel_t;
+typedef struct CookedTextureHeader_st CookedTextureHeader_t;
+typedef struct CookedTexture_st       CookedTexture_t;
+
+struct CookedTextureLevel_st {
+    uint32_t offset;    // from the start of the file
+    uint32_t size;      // in bytes
+    uint32_t width;
+    uint32_t height;
+};
+
+struct CookedTextureHeader_st {
+    uint32_t             magic;
+    uint32_t             version;
+    uint32_t             width;
+    uint32_t             height;
+    uint32_t             channels;
+    uint32_t             level_count;
+    uint32_t             gl_internal_format;
+    uint32_t             gl_format;
+    uint32_t             gl_type;
+    uint32_t             flags;
+    CookedTextureLevel_t levels[COOKED_TEXTURE_MAX_LEVELS];
+};
+
+struct CookedTexture_st {
+    const CookedTextureHeader_t* header;
+    const unsigned char*         data;  // whole file, header included
+    size_t                       size;
+    File_t                       file;  // the mapping behind data
+};
+
+// "dir/name.jpg" -> "dir/name.ctex". Returns false if it doesn't fit.
+COOKEDTEXAPI bool      cookedTexturePath(const char* source_path, char* out, size_t out_size);
+
+// maps the file read only and validates its index; any thread.
+COOKEDTEXAPI bool      cookedTextureOpen(const char* path, CookedTexture_t* out);
+COOKEDTEXAPI void      cookedTextureClose(CookedTexture_t* texture);
+
+// GL thread only.
+COOKEDTEXAPI void      uploadCookedTextureGL(GLuint texture_id, const CookedTexture_t* texture);
+COOKEDTEXAPI Texture_t createCookedTextureGL(const CookedTexture_t* texture);
+COOKEDTEXAPI Texture_t loadCookedTextureGL(const char* path);
+
+#ifdef COOKEDTEX_IMPLEMENTATION
+
+COOKEDTEXAPI bool cookedTexturePath(const char* source_path, char* out, size_t out_size) {
+    const char* dot    = strrchr(source_path, '.');
+    const char* slash  = strrchr(source_path, '/');
+    const char* bslash = strrchr(source_path, '\\');
+
+    if (bslash > slash) slash = bslash;
+    if (!dot || (slash && dot < slash)) dot = source_path + strlen(source_path);
+
+    size_t stem = (size_t)(dot - source_path);
+    if (stem + sizeof(COOKED_TEXTURE_EXTENSION) > out_size) return false;
+
+    memcpy(out, source_path, stem);
+    memcpy(out + stem, COOKED_TEXTURE_EXTENSION, sizeof(COOKED_TEXTURE_EXTENSION));
+
+    return true;
+}
+
+// bytes per 4x4 block of the formats texcook writes, 0 for anything else.
+static uint32_t cookedtex__block_bytes(uint32_t internal_format) {
+    switch (internal_format) {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:  return 8;
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: return 16;
+        case GL_COMPRESSED_RED_RGTC1:          return 8;
+        case GL_COMPRESSED_RG_RGTC2:           return 16;
+        default:                               return 0;
+    }
+}
+
+// the uncompressed format for `channels` 8 bit channels, as texcook writes it.
+static bool cookedtex__valid_format(const CookedTextureHeader_t* header) {
+    static const uint32_t internal_formats[] = { GL_R8,  GL_RG8, GL_RGB8, GL_RGBA8 };
+    static const uint32_t formats[]          = { GL_RED, GL_RG,  GL_RGB,  GL_RGBA  };
+
+    return header->gl_type            == GL_UNSIGNED_BYTE
+        && header->gl_internal_format == internal_formats[header->channels - 1]
+        && header->gl_format          == formats[header->channels - 1];
+}
+
+// the upload hands every level straight to GL, which reads what the dimensions and format say it
+// holds: each level has to be exactly that size, inside the file.
+static bool cookedtex__validate(const CookedTexture_t* texture) {
+    const CookedTextureHeader_t* header = texture->header;
+
+    if (texture->size < sizeof(CookedTextureHeader_t))       return false;
+    if (header->magic   != COOKED_TEXTURE_MAGIC)             return false;
+    if (header->version != COOKED_TEXTURE_VERSION)           return false;
+    if (header->level_count == 0 || header->level_count > COOKED_TEXTURE_MAX_LEVELS) return false;
+    if (header->channels == 0 || header->channels > 4)       return false;
+    if (header->width == 0 || header->height == 0)           return false;
+
+    bool     compressed  = (header->flags & COOKED_TEXTURE_FLAG_COMPRESSED) != 0;
+    uint32_t block_bytes = compressed ? cookedtex__block_bytes(header->gl_internal_format) : 0;
+
+    if (compressed ? block_bytes == 0 : !cookedtex__valid_format(header)) return false;
+
+    uint32_t width  = header->width;
+    uint32_t height = header->height;
+
+    for (uint32_t i = 0; i < header->level_count; ++i) {
+        const CookedTextureLevel_t* level = &header->levels[i];
+
+        if (level->width != width || level->height != height) return false;
+
+        uint64_t expected = compressed ? (uint64_t)((width + 3) / 4) * ((height + 3) / 4) * block_bytes
+                                       : (uint64_t) width * height * header->channels;
+
+        if (level->size != expected)                                return false;
+        if ((uint64_t) level->offset + level->size > texture->size) return false;
+
+        width  = width  > 1 ? width  / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+
+    return true;
+}
+
+COOKEDTEXAPI bool cookedTextureOpen(const char* path, CookedTexture_t* out) {
+    *out = (CookedTexture_t) {0};
+
+    // the upload reads every byte once, get the pages in before the GL thread touches them.
+    out->file = map_file(path, FILE_ACCESS_WILLNEED);
+    if (!out->file.data) return false;
+
+    out->data   = (const unsigned char*) out->file.data;
+    out->size   = out->file.size;
+    out->header = (const CookedTextureHeader_t*) out->data;
+
+    if (!cookedtex__validate(out)) {
+        fprintf(stderr, "%s is not a valid cooked texture.\n", path);
+        cookedTextureClose(out);
+        return false;
+    }
+
+    return true;
+}
+
+COOKEDTEXAPI void cookedTextureClose(CookedTexture_t* texture) {
+    unmap_file(&texture->file);
+    *texture = (CookedTexture_t) {0};
+}
+
+COOKEDTEXAPI void uploadCookedTextureGL(GLuint texture_id, const CookedTexture_t* texture) {
+    const CookedTextureHeader_t* header = texture->header;
+
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (uint32_t i = 0; i < header->level_count; ++i) {
+        const CookedTextureLevel_t* level = &header->levels[i];
+
+        if (header->flags & COOKED_TEXTURE_FLAG_COMPRESSED) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, (GLint) i, header->gl_internal_format,
+                                   (GLsizei) level->width, (GLsizei) level->height, 0,
+                                   (GLsizei) level->size, texture->data + level->offset);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, (GLint) i, (GLint) header->gl_internal_format,
+                         (GLsizei) level->width, (GLsizei) level->height, 0,
+                         header->gl_format, header->gl_type, texture->data + level->offset);
+        }
+
+        renderStatsUpload(level->size);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,  (GLint) header->level_count - 1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+COOKEDTEXAPI Texture_t createCookedTextureGL(const CookedTexture_t* texture) {
+    Texture_t result = {0};
+
+    glGenTextures(1, &result.texture_id);
+    uploadCookedTextureGL(result.texture_id, texture);
+
+    glBindTexture(GL_TEXTURE_2D, result.texture_id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return result;
+}
+
+COOKEDTEXAPI Texture_t loadCookedTextureGL(const char* path) {
+    CookedTexture_t cooked;
+    if (!cookedTextureOpen(path, &cooked)) return (Texture_t) {0};
+
+    Texture_t texture = createCookedTextureGL(&cooked);
+    cookedTextureClose(&cooked);
+
+    return texture;
+}
+
+#endif // COOKEDTEX_IMPLEMENTATION
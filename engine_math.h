@@ -42,6 +42,7 @@ float vec3_dot(vec3 a, vec3 b);
 vec3  vec3_scale(vec3 a, float s);
 vec3  vec3_norm(vec3 v);
 vec3  vec3_cross(vec3 side1, vec3 side2);
+vec3  vec3_lerp(vec3 a, vec3 b, float t);
 
 typedef struct Quaternion_st {
     float x, y, z, w;
@@ -335,6 +336,14 @@ vec3 vec3_scale(vec3 a, float s) {
     return (vec3) {.x = a.x * s, .y = a.y * s, .z = a.z * s};
 }
 
+vec3 vec3_lerp(vec3 a, vec3 b, float t) {
+    return (vec3) {
+        .x = a.x + (b.x - a.x) * t,
+        .y = a.y + (b.y - a.y) * t,
+        .z = a.z + (b.z - a.z) * t,
+    };
+}
+
 vec3 vec3_norm(vec3 v) {
     float len = v.x*v.x + v.y*v.y + v.z*v.z;
     if (fabsf(len) < EPS) return (vec3) {0.0f};
@@ -1,18 +1,91 @@
 #pragma once
 
+#if defined(_WIN32)
+#   include <windows.h>
+#else
+#   include <errno.h>
+#   include <string.h>
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif // defined(_WIN32)
+
+#include "allocator.h"
+
 typedef struct File_st      File_t;
 
+typedef enum file_access_enum {
+    FILE_ACCESS_NORMAL,      // no hint, the OS default read ahead
+    FILE_ACCESS_SEQUENTIAL,  // read once front to back, pages can go right after
+    FILE_ACCESS_WILLNEED     // every byte is needed soon, start reading it all in now
+} file_access_t;
 
 struct File_st {
     char*       data;
     size_t      size;
     const char* file_path;
+
+    // false: heap copy from mem_alloc() (MEM_TAG_IO), NUL terminated. read_file() counts the
+    //        terminator in `size`, map_file() (a compressed pack entry) doesn't.
+    // true:  read only view from map_file(), `size` is the file size and nothing follows it.
+    bool        mapped;
+    // view into memory owned by someone else (a mounted pack), releasing it only clears it.
+    bool        borrowed;
 };
 
+// consulted by read_file() / map_file() before the file system. Returns false to fall back to
+// loose files, or fills `out` with a borrowed read only view, or with a NUL terminated mem_alloc()
+// buffer (`mapped` false, the terminator not counted) the caller takes over.
+typedef bool (*file_resolver_fn)(const char* filepath, file_access_t access, File_t* out, void* user);
+
 File_t      read_file(const char* filepath);
+// zero copy: the pages come straight from the OS file cache. Any thread.
+File_t      map_file(const char* filepath, file_access_t access);
+void        unmap_file(File_t* file);
+// releases either kind, the File_t is zeroed.
+void        free_file(File_t* file);
+// applies an access hint to part of a mapping.
+void        advise_file_range(const void* data, size_t size, file_access_t access);
+// set once at startup, before any loading thread runs.
+void        set_file_resolver(file_resolver_fn resolver, void* user);
+bool        has_file_resolver(void);
 
 #ifdef FILE_IMPLEMENTATION
+static file_resolver_fn s_file_resolver;
+static void*            s_file_resolver_user;
+
+void set_file_resolver(file_resolver_fn resolver, void* user) {
+    s_file_resolver      = resolver;
+    s_file_resolver_user = user;
+}
+
+bool has_file_resolver(void) {
+    return s_file_resolver != NULL;
+}
+
 File_t read_file(const char* filepath) {
+    File_t view;
+    if (s_file_resolver && s_file_resolver(filepath, FILE_ACCESS_SEQUENTIAL, &view, s_file_resolver_user)) {
+        if (!view.borrowed) {
+            view.size += 1;
+            return view;
+        }
+
+        // callers own (and may keep) what read_file() returns, so borrowed views are still copied.
+        char* data = (char*) mem_alloc(MEM_TAG_IO, view.size + 1);
+        if (!data) return (File_t) { .file_path = filepath };
+
+        memcpy(data, view.data, view.size);
+        data[view.size] = '\0';
+
+        return (File_t) {
+            .data      = data,
+            .size      = view.size + 1,
+            .file_path = filepath
+        };
+    }
+
     char* err_msg = NULL;
     FILE* fh      = fopen(filepath, "rb");
 
@@ -24,7 +97,7 @@ File_t read_file(const char* filepath) {
     file_size = ftell(fh);
     if (fseek(fh, 0, SEEK_SET)) goto error;
      
-    char* data = (char*) malloc(file_size + 1);
+    char* data = (char*) mem_alloc(MEM_TAG_IO, file_size + 1);
     if (!data) {
         err_msg = "Couldn't allocate bytes to read file in RAM.";
         goto error;
@@ -51,4 +124,117 @@ error:
     if (fh) { fclose(fh); }
     return (File_t){ .data = NULL, .size = 0, .file_path = filepath };
 }
-#endif // FILE_IMPLEMENTATION
\ No newline at end of file
+
+#if defined(_WIN32)
+
+File_t map_file(const char* filepath, file_access_t access) {
+    File_t result = { .file_path = filepath };
+    if (s_file_resolver && s_file_resolver(filepath, access, &result, s_file_resolver_user)) return result;
+
+    DWORD  flags  = access == FILE_ACCESS_SEQUENTIAL ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL;
+
+    HANDLE fh = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, flags, NULL);
+    if (fh == INVALID_HANDLE_VALUE) return result;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(fh, &size) || size.QuadPart == 0) {
+        CloseHandle(fh);
+        return result;
+    }
+
+    // the view keeps the mapping and the file open, neither handle is needed after this.
+    HANDLE mapping = CreateFileMappingA(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(fh);
+    if (!mapping) return result;
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data) return result;
+
+    advise_file_range(data, (size_t) size.QuadPart, access);
+
+    result.data   = (char*) data;
+    result.size   = (size_t) size.QuadPart;
+    result.mapped = true;
+
+    return result;
+}
+
+void unmap_file(File_t* file) {
+    if (file->data && !file->borrowed) {
+        if (file->mapped) UnmapViewOfFile(file->data);
+        else              mem_free(file->data);
+    }
+    *file = (File_t) {0};
+}
+
+void advise_file_range(const void* data, size_t size, file_access_t access) {
+    if (access != FILE_ACCESS_WILLNEED || !size) return;
+
+    WIN32_MEMORY_RANGE_ENTRY range = { (void*) data, (SIZE_T) size };
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+#else
+
+File_t map_file(const char* filepath, file_access_t access) {
+    File_t result = { .file_path = filepath };
+    if (s_file_resolver && s_file_resolver(filepath, access, &result, s_file_resolver_user)) return result;
+
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0) return result;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return result;
+    }
+
+    void* data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) return result;
+
+    advise_file_range(data, (size_t) st.st_size, access);
+
+    result.data   = (char*) data;
+    result.size   = (size_t) st.st_size;
+    result.mapped = true;
+
+    return result;
+}
+
+void unmap_file(File_t* file) {
+    if (file->data && !file->borrowed) {
+        if (file->mapped) munmap(file->data, file->size);
+        else              mem_free(file->data);
+    }
+    *file = (File_t) {0};
+}
+
+void advise_file_range(const void* data, size_t size, file_access_t access) {
+    if (!size) return;
+
+    // madvise wants a page aligned start.
+    uintptr_t page  = (uintptr_t) sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t) data & ~(page - 1);
+
+    int advice = access == FILE_ACCESS_SEQUENTIAL ? MADV_SEQUENTIAL
+               : access == FILE_ACCESS_WILLNEED   ? MADV_WILLNEED
+               :                                    MADV_NORMAL;
+
+    madvise((void*) start, size + ((uintptr_t) data - start), advice);
+}
+
+#endif // defined(_WIN32)
+
+void free_file(File_t* file) {
+    if (file->mapped || file->borrowed) {
+        unmap_file(file);
+        return;
+    }
+
+    mem_free(file->data);
+    *file = (File_t) {0};
+}
+#endif // FILE_IMPLEMENTATION
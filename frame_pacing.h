@@ -0,0 +1,239 @@
+#pragma once
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#   include <windows.h>
+#   include <mmsystem.h>
+#else
+#   include <time.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#   include <immintrin.h>
+#   define FRAME_PACING_PAUSE() _mm_pause()
+#else
+#   define FRAME_PACING_PAUSE() ((void) 0)
+#endif
+
+// Frame pacing and the fixed simulation step.
+//
+// frame_pacer_wait() holds the frame until its deadline, one target interval after the last
+// one: it sleeps while the deadline is further than the sleep margin away, then spins on
+// get_time_ns() for the rest. The margin follows how late sleeps actually wake up (the worst
+// oversleep seen, decaying slowly, at most half a frame), so it is as short as the OS allows.
+// Deadlines advance by whole intervals so rounding never builds up; a frame that runs past its
+// deadline by more than an interval starts a new schedule instead of rushing the following ones.
+//
+// Simulation runs at its own fixed rate, decoupled from the frame rate: frame_pacer_begin()
+// adds the real time since the previous frame to an accumulator, frame_pacer_step() hands out
+// whole steps from it, and frame_pacer_alpha() is how far the leftover is into the next step,
+// for drawing state interpolated between the last two steps.
+//
+// Frame intervals (begin to begin, waits included) are kept for the jitter report.
+
+#define FRAMEPACINGAPI static
+
+#define FRAME_PACING_HISTORY          240            // frame intervals kept for the stats
+#define FRAME_PACING_MAX_DELTA_NS     250000000ull   // longer frames are simulated as this long
+#if defined(_WIN32)
+#   define FRAME_PACING_INITIAL_MARGIN_NS 2000000ull // 1 ms timer resolution, and some
+#else
+#   define FRAME_PACING_INITIAL_MARGIN_NS 500000ull
+#endif
+#define FRAME_PACING_MIN_MARGIN_NS    100000ull
+// a wake up later than this was the thread being preempted, not timer resolution.
+#define FRAME_PACING_MAX_MARGIN_NS    4000000ull
+
+typedef struct FramePacer_st      FramePacer_t;
+typedef struct FramePacingStats_st FramePacingStats_t;
+
+struct FramePacer_st {
+    uint64_t target_ns;      // frame interval, 0 doesn't wait
+    uint64_t step_ns;        // simulation step
+    double   step_seconds;
+
+    uint64_t frame_begin_ns;
+    uint64_t deadline_ns;
+    uint64_t accumulator_ns;
+    uint64_t sleep_margin_ns;
+
+    uint64_t frames;
+    uint64_t steps;
+    uint64_t late_frames;    // missed their deadline by a whole interval
+    uint64_t intervals[FRAME_PACING_HISTORY];
+};
+
+// nanoseconds, over the intervals in the history.
+struct FramePacingStats_st {
+    int      frames;
+    double   mean;
+    double   jitter;         // standard deviation
+    uint64_t min;
+    uint64_t max;
+    uint64_t late_frames;
+};
+
+// `target_hz` 0 runs frames back to back, `step_hz` must not be 0.
+FRAMEPACINGAPI void               frame_pacer_init(FramePacer_t* pacer, int target_hz, int step_hz);
+FRAMEPACINGAPI void               frame_pacer_shutdown(FramePacer_t* pacer);
+// at the top of the frame, before the simulation steps.
+FRAMEPACINGAPI void               frame_pacer_begin(FramePacer_t* pacer);
+// true while there is a whole step left in the accumulator, takes it.
+FRAMEPACINGAPI bool               frame_pacer_step(FramePacer_t* pacer);
+// [0, 1) into the step after the last one taken.
+FRAMEPACINGAPI float              frame_pacer_alpha(const FramePacer_t* pacer);
+// at the end of the frame, returns once the frame's deadline has passed.
+FRAMEPACINGAPI void               frame_pacer_wait(FramePacer_t* pacer);
+FRAMEPACINGAPI FramePacingStats_t frame_pacer_stats(const FramePacer_t* pacer);
+FRAMEPACINGAPI void               frame_pacer_print(const FramePacer_t* pacer);
+
+uint64_t get_time_ns();
+
+#ifdef FRAMEPACING_IMPLEMENTATION
+
+FRAMEPACINGAPI void frame_pacer_init(FramePacer_t* pacer, int target_hz, int step_hz) {
+    memset(pacer, 0, sizeof(*pacer));
+
+    pacer->target_ns       = target_hz > 0 ? 1000000000ull / (uint64_t) target_hz : 0;
+    pacer->step_ns         = 1000000000ull / (uint64_t)(step_hz > 0 ? step_hz : 60);
+    pacer->step_seconds    = pacer->step_ns / 1e9;
+    pacer->sleep_margin_ns = FRAME_PACING_INITIAL_MARGIN_NS;
+
+#if defined(_WIN32)
+    // Sleep() rounds to the scheduler tick, 15.6 ms unless asked for finer.
+    timeBeginPeriod(1);
+#endif // defined(_WIN32)
+}
+
+FRAMEPACINGAPI void frame_pacer_shutdown(FramePacer_t* pacer) {
+    (void) pacer;
+#if defined(_WIN32)
+    timeEndPeriod(1);
+#endif // defined(_WIN32)
+}
+
+FRAMEPACINGAPI void frame_pacer_begin(FramePacer_t* pacer) {
+    uint64_t now = get_time_ns();
+
+    // the first frame simulates one step, there's no previous frame to measure from.
+    uint64_t delta = pacer->frames ? now - pacer->frame_begin_ns : pacer->step_ns;
+    if (pacer->frames) pacer->intervals[(pacer->frames - 1) % FRAME_PACING_HISTORY] = delta;
+
+    if (delta > FRAME_PACING_MAX_DELTA_NS) delta = FRAME_PACING_MAX_DELTA_NS;
+
+    pacer->accumulator_ns += delta;
+    pacer->frame_begin_ns  = now;
+    pacer->frames++;
+
+    if (!pacer->deadline_ns) pacer->deadline_ns = now;
+}
+
+FRAMEPACINGAPI bool frame_pacer_step(FramePacer_t* pacer) {
+    if (pacer->accumulator_ns < pacer->step_ns) return false;
+
+    pacer->accumulator_ns -= pacer->step_ns;
+    pacer->steps++;
+    return true;
+}
+
+FRAMEPACINGAPI float frame_pacer_alpha(const FramePacer_t* pacer) {
+    return (float)((double) pacer->accumulator_ns / (double) pacer->step_ns);
+}
+
+static void frame_pacer__sleep(uint64_t ns) {
+#if defined(_WIN32)
+    Sleep((DWORD)(ns / 1000000ull));
+#else
+    struct timespec ts = { (time_t)(ns / 1000000000ull), (long)(ns % 1000000000ull) };
+    nanosleep(&ts, NULL);
+#endif // defined(_WIN32)
+}
+
+FRAMEPACINGAPI void frame_pacer_wait(FramePacer_t* pacer) {
+    if (!pacer->target_ns) return;
+
+    pacer->deadline_ns += pacer->target_ns;
+
+    // the worst wake up seen, forgotten by 1/64 per frame.
+    uint64_t max_margin = pacer->target_ns / 2 < FRAME_PACING_MAX_MARGIN_NS ? pacer->target_ns / 2 : FRAME_PACING_MAX_MARGIN_NS;
+    pacer->sleep_margin_ns -= pacer->sleep_margin_ns / 64;
+    if (pacer->sleep_margin_ns < FRAME_PACING_MIN_MARGIN_NS) pacer->sleep_margin_ns = FRAME_PACING_MIN_MARGIN_NS;
+
+    uint64_t now = get_time_ns();
+    if (now > pacer->deadline_ns + pacer->target_ns) {
+        pacer->late_frames++;
+        pacer->deadline_ns = now;
+        return;
+    }
+
+    while (now + pacer->sleep_margin_ns < pacer->deadline_ns) {
+        uint64_t request = pacer->deadline_ns - now - pacer->sleep_margin_ns;
+#if defined(_WIN32)
+        if (request < 1000000ull) break;
+#endif // defined(_WIN32)
+
+        frame_pacer__sleep(request);
+
+        uint64_t woke      = get_time_ns();
+        uint64_t oversleep = woke - now > request ? woke - now - request : 0;
+
+        if (oversleep + FRAME_PACING_MIN_MARGIN_NS > pacer->sleep_margin_ns) pacer->sleep_margin_ns = oversleep + FRAME_PACING_MIN_MARGIN_NS;
+        if (pacer->sleep_margin_ns > max_margin) pacer->sleep_margin_ns = max_margin;
+
+        now = woke;
+    }
+
+    while (now < pacer->deadline_ns) {
+        FRAME_PACING_PAUSE();
+        now = get_time_ns();
+    }
+}
+
+FRAMEPACINGAPI FramePacingStats_t frame_pacer_stats(const FramePacer_t* pacer) {
+    FramePacingStats_t stats = { .late_frames = pacer->late_frames };
+
+    uint64_t measured = pacer->frames ? pacer->frames - 1 : 0;
+    int      count    = measured < FRAME_PACING_HISTORY ? (int) measured : FRAME_PACING_HISTORY;
+    if (count == 0) return stats;
+
+    double total = 0.0;
+    stats.min = UINT64_MAX;
+
+    for (int i = 0; i < count; ++i) {
+        uint64_t interval = pacer->intervals[i];
+
+        total += (double) interval;
+        if (interval < stats.min) stats.min = interval;
+        if (interval > stats.max) stats.max = interval;
+    }
+
+    double variance = 0.0;
+    stats.mean = total / count;
+
+    for (int i = 0; i < count; ++i) {
+        double d  = (double) pacer->intervals[i] - stats.mean;
+        variance += d * d;
+    }
+
+    stats.frames = count;
+    stats.jitter = sqrt(variance / count);
+    return stats;
+}
+
+FRAMEPACINGAPI void frame_pacer_print(const FramePacer_t* pacer) {
+    FramePacingStats_t stats = frame_pacer_stats(pacer);
+    if (!stats.frames) return;
+
+    printf("frame pacing over the last %d frames: target %.3f ms, mean %.3f ms, jitter %.3f ms, min %.3f ms, max %.3f ms\n",
+        stats.frames, pacer->target_ns / 1e6, stats.mean / 1e6, stats.jitter / 1e6, stats.min / 1e6, stats.max / 1e6);
+    printf("  %llu simulation steps of %.3f ms, %llu late frames, sleep margin %.3f ms\n",
+        (unsigned long long) pacer->steps, pacer->step_ns / 1e6,
+        (unsigned long long) stats.late_frames, pacer->sleep_margin_ns / 1e6);
+}
+
+#endif // FRAMEPACING_IMPLEMENTATION
@@ -4,6 +4,9 @@
 #include <stdio.h>
 #include "deps/olivec/olive.c"
 
+#define RASTER_IMPLEMENTATION
+#include "canvas_raster.h"
+
 float x = 10.0f;
 float y = 300.0f;
 
@@ -14,6 +17,8 @@ AudioBuffer audio;
 AudioBuffer bg_song;
 AudioMixer mixer;
 
+static Raster_t s_raster;
+
 void game_init(Olivec_Canvas canvas) {
     audio   = audio_buffer_create(SAMPLE_RATE / 2  * AUDIO_CHANNELS, NULL);
     bg_song = audio_buffer_create(SAMPLE_RATE * 10 * AUDIO_CHANNELS, NULL);
@@ -34,12 +39,14 @@ void game_init(Olivec_Canvas canvas) {
     // y = 0;
 }
 
-void game_update(Olivec_Canvas canvas) {
+void game_update(Olivec_Canvas canvas, float dt) {
 
-    olivec_rect(canvas, (int)x, (int)y, 40, 40, 0xFFFF0000);
+    raster_begin(&s_raster, canvas);
+    raster_rect(&s_raster, (int)x, (int)y, 40, 40, 0xFFFF0000);
+    raster_end(&s_raster);
 
-    x += (speedX * 1.0f/60.0f);
-    y += (speedY * 1.0f/60.0f);
+    x += speedX * dt;
+    y += speedY * dt;
 
     if (y <= 0 || y + 40 >= CANVAS_HEIGHT) speedY = -speedY;
     if (y <= 0) y = 0;
@@ -61,6 +68,7 @@ void game_update(Olivec_Canvas canvas) {
 
 void game_close() {
     audio_buffer_free(audio);
+    raster_release(&s_raster);
 }
 
 void game_key_up(int key) {
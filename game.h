@@ -15,9 +15,11 @@
 #define AUDIO_CHANNELS          2
 #define SAMPLE_RATE             44100
 #define FPS                     60
+#define SIMULATION_RATE         120   // fixed steps per second, whatever the frame rate
 
 void game_init(Olivec_Canvas canvas);
-void game_update(Olivec_Canvas canvas);
+// `dt` seconds of simulation.
+void game_update(Olivec_Canvas canvas, float dt);
 void game_close(void);
 void game_key_up(int key);
 void game_key_down(int key);
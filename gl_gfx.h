@@ -1,7 +1,13 @@
 #pragma once
 
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "allocator.h"
 #include "deps/glad/glad.h"
 #include "file.h"
+#include "render_stats.h"
 
 
 #define ATTRIB_POSITION_LOCATION    0
@@ -17,8 +23,21 @@
 #define UNIFORM_NOCOLOR_ATTRIB         "no_color_attrib"
 #define UNIFORM_HAS_TANGENT_ATTRIB_LOC "hasTangentAttrib"
 #define UNIFORM_COLOR_LOC              "color"
+#define UNIFORM_CAMERA_POS             "camera_pos"
+#define UNIFORM_TEXTURE_LAYERS         "texture_layers"
+#define UNIFORM_TEXTURE_UV_RECTS       "texture_uv_rects"
+#define UNIFORM_TEXTURE_MIN_LODS       "texture_min_lods"
 
-typedef struct GLProgram_st GLProgram_t;
+// GL_KHR_parallel_shader_compile, same value as the ARB version.
+#ifndef GL_COMPLETION_STATUS_KHR
+#   define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef struct GLProgram_st       GLProgram_t;
+typedef struct GLPendingProgram_st GLPendingProgram_t;
+typedef struct GLUniform_st       GLUniform_t;
+typedef struct GLUniformBlock_st  GLUniformBlock_t;
+typedef struct GLUniformTable_st  GLUniformTable_t;
 
 
 enum {
@@ -36,9 +55,41 @@ const char* UNIFORM_TEXTURE_NAMES[TEXTURE_COUNT] = {
     "specular_map_texture",
 };
 
+// reflected active uniform, array elements get one entry each ("lights[3].pos", "values[2]").
+struct GLUniform_st {
+    uint32_t hash;
+    uint32_t name_offset;   // into GLUniformTable_t::names
+    GLint    location;
+    GLenum   type;
+    GLint    size;
+};
+
+struct GLUniformBlock_st {
+    uint32_t hash;
+    uint32_t name_offset;
+    GLuint   index;
+    GLint    data_size;
+};
+
+// name -> location/type table built once per link, open addressing on FNV-1a hashes.
+struct GLUniformTable_st {
+    GLUniform_t*      slots;
+    uint32_t          capacity;    // power of two
+    uint32_t          count;
+
+    GLUniformBlock_t* blocks;
+    uint32_t          block_count;
+
+    char*             names;
+    uint32_t          names_size;
+};
+
 struct GLProgram_st {
     GLuint program;
 
+    // shared by every copy of this program, owned by destroyShaderProgramGL().
+    GLUniformTable_t* uniforms;
+
     // unifroms
     GLint world_mat_loc;
     GLint view_mat_loc;
@@ -48,8 +99,21 @@ struct GLProgram_st {
     GLint no_color_attrib_loc;
     GLint has_tangent_attrib_loc;
     GLint color_loc;
+    GLint camera_pos_loc;
 
     GLint uniform_texture_locs[TEXTURE_COUNT];
+
+    // per texture slot layer / uv rect / min lod inside the bound texture array (material.h)
+    GLint texture_layers_loc;
+    GLint texture_uv_rects_loc;
+    GLint texture_min_lods_loc;
+};
+
+// a program the driver is still compiling and linking, see beginShaderProgramGL().
+struct GLPendingProgram_st {
+    GLuint program;
+    GLuint vs;
+    GLuint fs;
 };
 
 struct Texture_st {
@@ -61,6 +125,36 @@ typedef struct Texture_st Texture_t;
 void        canvas_to_GLtexture(Olivec_Canvas src, GLint dest);
 GLuint      createShaderProgramGL_(File_t vs_file, File_t fs_file);
 GLProgram_t createShaderProgramGL(File_t vs_file, File_t fs_file);
+void        loadProgramUniformsGL(GLProgram_t* program);
+void        destroyShaderProgramGL(GLProgram_t* program);
+
+// uniform reflection, no driver round trip once the program is linked.
+bool               reflectProgramUniformsGL(GLProgram_t* program);
+const GLUniform_t* programFindUniform(const GLProgram_t* program, const char* name);
+GLint              programUniformLocation(const GLProgram_t* program, const char* name);
+// location of `array[index].member` (or `array[index]` when member is NULL) without formatting the name.
+GLint              programUniformElementLocation(const GLProgram_t* program, const char* array, int index, const char* member);
+GLint              programUniformBlockIndex(const GLProgram_t* program, const char* name);
+
+// same as createShaderProgramGL() but never pops up a dialog: on failure
+// returns false, leaves `out` untouched and writes the driver log into `log`.
+bool        tryCreateShaderProgramGL(File_t vs_file, File_t fs_file, GLProgram_t* out, char* log, size_t log_size);
+
+// the same in steps that don't stall the GL thread. beginShaderProgramGL() hands the sources to
+// the driver and returns without asking for any status. With GL_KHR_parallel_shader_compile the
+// driver compiles on its own threads and shaderProgramReadyGL() turns true once it is done;
+// without it there is nothing to poll, it is always true and finishing waits for the compile.
+// finishShaderProgramGL() checks the result like tryCreateShaderProgramGL() and releases
+// `pending` either way, cancelShaderProgramGL() drops it unchecked.
+bool        beginShaderProgramGL(File_t vs_file, File_t fs_file, GLPendingProgram_t* pending);
+bool        shaderProgramReadyGL(const GLPendingProgram_t* pending);
+bool        finishShaderProgramGL(GLPendingProgram_t* pending, GLProgram_t* out, char* log, size_t log_size);
+void        cancelShaderProgramGL(GLPendingProgram_t* pending);
+
+// (re)specifies level 0 of `texture_id` from tightly packed 8 bit pixels and rebuilds its mip chain.
+void        uploadTextureGL(GLuint texture_id, const unsigned char* pixels, int width, int height, int channels);
+// new mipmapped, repeating texture from decoded pixels.
+Texture_t   createTextureGL(const unsigned char* pixels, int width, int height, int channels);
 
 #ifdef GLGFX_IMPLEMENTATION
 
@@ -81,31 +175,500 @@ GLProgram_t createShaderProgramGL(File_t vs_file, File_t fs_file) {
     if (!programID) return program;
 
     program.program         = programID;
+    loadProgramUniformsGL(&program);
+
+    return program;
+}
+
+void loadProgramUniformsGL(GLProgram_t* program) {
+    GLuint programID = program->program;
+
+    reflectProgramUniformsGL(program);
 
     // load uniforms
-    program.world_mat_loc          = glGetUniformLocation(programID, UNIFORM_WORLD_MATRIX);
-    program.view_mat_loc           = glGetUniformLocation(programID, UNIFORM_VIEW_MATRIX);
-    program.proj_mat_loc           = glGetUniformLocation(programID, UNIFORM_PROJ_MATRIX);
-    program.light_count_loc        = glGetUniformLocation(programID, UNIFORM_LIGHT_COUNT);
-    program.no_color_attrib_loc    = glGetUniformLocation(programID, UNIFORM_NOCOLOR_ATTRIB);
-    program.color_loc              = glGetUniformLocation(programID, UNIFORM_COLOR_LOC);
-    program.has_tangent_attrib_loc = glGetUniformLocation(programID, UNIFORM_HAS_TANGENT_ATTRIB_LOC);
+    program->world_mat_loc          = programUniformLocation(program, UNIFORM_WORLD_MATRIX);
+    program->view_mat_loc           = programUniformLocation(program, UNIFORM_VIEW_MATRIX);
+    program->proj_mat_loc           = programUniformLocation(program, UNIFORM_PROJ_MATRIX);
+    program->light_count_loc        = programUniformLocation(program, UNIFORM_LIGHT_COUNT);
+    program->no_color_attrib_loc    = programUniformLocation(program, UNIFORM_NOCOLOR_ATTRIB);
+    program->color_loc              = programUniformLocation(program, UNIFORM_COLOR_LOC);
+    program->has_tangent_attrib_loc = programUniformLocation(program, UNIFORM_HAS_TANGENT_ATTRIB_LOC);
+    program->camera_pos_loc         = programUniformLocation(program, UNIFORM_CAMERA_POS);
+    program->texture_layers_loc     = programUniformLocation(program, UNIFORM_TEXTURE_LAYERS);
+    program->texture_uv_rects_loc   = programUniformLocation(program, UNIFORM_TEXTURE_UV_RECTS);
+    program->texture_min_lods_loc   = programUniformLocation(program, UNIFORM_TEXTURE_MIN_LODS);
     glUseProgram(programID);
     for (int i = 0; i < TEXTURE_COUNT; ++i) {
-        program.uniform_texture_locs[i] = glGetUniformLocation(program.program, UNIFORM_TEXTURE_NAMES[i]);
-        if (program.uniform_texture_locs[i] != -1) {
-            glUniform1i(program.uniform_texture_locs[i], i);
+        program->uniform_texture_locs[i] = programUniformLocation(program, UNIFORM_TEXTURE_NAMES[i]);
+        if (program->uniform_texture_locs[i] != -1) {
+            glUniform1i(program->uniform_texture_locs[i], i);
         }
     }
     glUseProgram(0);
+}
 
-    return program;
+void destroyShaderProgramGL(GLProgram_t* program) {
+    if (!program) return;
+
+    if (program->program) glDeleteProgram(program->program);
+
+    GLUniformTable_t* table = program->uniforms;
+    if (table) {
+        mem_free(table->slots);
+        mem_free(table->blocks);
+        mem_free(table->names);
+        mem_free(table);
+    }
+
+    *program = (GLProgram_t) {0};
+}
+
+// -- uniform reflection --
+
+#define GLGFX_FNV_OFFSET 2166136261u
+#define GLGFX_FNV_PRIME  16777619u
+
+static uint32_t glgfx__hash_str(uint32_t h, const char* str) {
+    while (*str) {
+        h ^= (uint8_t)*str++;
+        h *= GLGFX_FNV_PRIME;
+    }
+    return h;
+}
+
+static uint32_t glgfx__hash_chr(uint32_t h, char c) {
+    h ^= (uint8_t)c;
+    return h * GLGFX_FNV_PRIME;
+}
+
+// writes `index` in decimal into `digits`, returns the digit count.
+static int glgfx__itoa(int index, char digits[16]) {
+    char tmp[16];
+    int  len = 0;
+
+    do {
+        tmp[len++] = '0' + (index % 10);
+        index     /= 10;
+    } while (index > 0 && len < 15);
+
+    for (int i = 0; i < len; ++i) digits[i] = tmp[len - 1 - i];
+    digits[len] = '\0';
+
+    return len;
+}
+
+static uint32_t glgfx__append_name(GLUniformTable_t* table, const char* name, size_t len) {
+    uint32_t offset = table->names_size;
+    char*    names  = mem_realloc(MEM_TAG_RENDER, table->names, table->names_size + len + 1);
+    if (!names) return UINT32_MAX;
+
+    memcpy(names + offset, name, len);
+    names[offset + len] = '\0';
+
+    table->names       = names;
+    table->names_size += len + 1;
+
+    return offset;
+}
+
+// false when the name couldn't be stored or the table is full.
+static bool glgfx__insert_uniform(GLUniformTable_t* table, GLUniform_t uniform) {
+    if (uniform.name_offset == UINT32_MAX) return false;
+
+    uint32_t mask = table->capacity - 1;
+    uint32_t slot = uniform.hash & mask;
+
+    for (uint32_t step = 0; step < table->capacity; ++step, slot = (slot + 1) & mask) {
+        if (table->slots[slot].name_offset != UINT32_MAX) continue;
+
+        table->slots[slot] = uniform;
+        table->count++;
+        return true;
+    }
+
+    return false;
+}
+
+static void glgfx__clear_table(GLUniformTable_t* table) {
+    mem_free(table->slots);
+    mem_free(table->blocks);
+    mem_free(table->names);
+    *table = (GLUniformTable_t) {0};
+}
+
+bool reflectProgramUniformsGL(GLProgram_t* program) {
+    if (!program || !program->program) return false;
+
+    GLuint programID = program->program;
+    GLint  active    = 0;
+    GLint  max_len   = 0;
+    GLint  blocks    = 0;
+
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORMS,           &active);
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_len);
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORM_BLOCKS,     &blocks);
+
+    GLUniformTable_t* table = program->uniforms;
+    if (!table) {
+        table = mem_calloc(MEM_TAG_RENDER, 1, sizeof(*table));
+        if (!table) return false;
+        program->uniforms = table;
+    }
+
+    // first pass: count entries, arrays of basic types expand to one entry per element.
+    GLint* sizes = mem_alloc(MEM_TAG_RENDER, sizeof(GLint)  * (active > 0 ? active : 1));
+    GLenum* types = mem_alloc(MEM_TAG_RENDER, sizeof(GLenum) * (active > 0 ? active : 1));
+    char*  name  = mem_alloc(MEM_TAG_RENDER, max_len + 32);
+
+    if (!sizes || !types || !name) {
+        mem_free(sizes); mem_free(types); mem_free(name);
+        return false;
+    }
+
+    // arrays are one entry for the bare name plus one per element, a single element one included.
+    uint32_t entries = 0;
+    for (GLint i = 0; i < active; ++i) {
+        GLsizei len = 0;
+        glGetActiveUniform(programID, i, max_len, &len, &sizes[i], &types[i], name);
+
+        bool is_array = len > 3 && strcmp(name + len - 3, "[0]") == 0;
+        entries += is_array ? (uint32_t) sizes[i] + 1 : 1;
+    }
+
+    uint32_t capacity = 16;
+    while (capacity < entries * 2) capacity <<= 1;
+
+    glgfx__clear_table(table);
+
+    table->capacity = capacity;
+    table->slots    = mem_alloc(MEM_TAG_RENDER, sizeof(GLUniform_t) * capacity);
+    if (!table->slots) {
+        mem_free(sizes); mem_free(types); mem_free(name);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < capacity; ++i) table->slots[i].name_offset = UINT32_MAX;
+
+    bool ok = true;
+
+    for (GLint i = 0; ok && i < active; ++i) {
+        GLsizei len = 0;
+        glGetActiveUniform(programID, i, max_len, &len, &sizes[i], &types[i], name);
+
+        // uniforms living inside a block have no location of their own.
+        GLint location = glGetUniformLocation(programID, name);
+        if (location < 0) continue;
+
+        // drivers report arrays as "name[0]", register the bare name too like glGetUniformLocation does.
+        bool is_array = len > 3 && strcmp(name + len - 3, "[0]") == 0;
+        if (is_array) {
+            name[len - 3] = '\0';
+            len          -= 3;
+        }
+
+        GLUniform_t uniform = {
+            .hash        = glgfx__hash_str(GLGFX_FNV_OFFSET, name),
+            .name_offset = glgfx__append_name(table, name, len),
+            .location    = location,
+            .type        = types[i],
+            .size        = sizes[i]
+        };
+        ok = glgfx__insert_uniform(table, uniform);
+
+        if (!is_array) continue;
+
+        for (GLint e = 0; ok && e < sizes[i]; ++e) {
+            char digits[16];
+            int  dlen = glgfx__itoa(e, digits);
+
+            name[len]            = '[';
+            memcpy(name + len + 1, digits, dlen);
+            name[len + 1 + dlen] = ']';
+            name[len + 2 + dlen] = '\0';
+
+            GLUniform_t element = {
+                .hash        = glgfx__hash_str(GLGFX_FNV_OFFSET, name),
+                .name_offset = glgfx__append_name(table, name, len + 2 + dlen),
+                .location    = e == 0 ? location : glGetUniformLocation(programID, name),
+                .type        = types[i],
+                .size        = 1
+            };
+            ok = glgfx__insert_uniform(table, element);
+        }
+    }
+
+    if (ok && blocks > 0) {
+        table->blocks = mem_calloc(MEM_TAG_RENDER, blocks, sizeof(GLUniformBlock_t));
+        ok            = table->blocks != NULL;
+
+        for (GLint b = 0; ok && b < blocks; ++b) {
+            GLsizei len = 0;
+            GLint   data_size = 0;
+
+            glGetActiveUniformBlockName(programID, b, max_len + 32, &len, name);
+            glGetActiveUniformBlockiv(programID, b, GL_UNIFORM_BLOCK_DATA_SIZE, &data_size);
+
+            uint32_t offset = glgfx__append_name(table, name, len);
+            ok              = offset != UINT32_MAX;
+
+            table->blocks[table->block_count++] = (GLUniformBlock_t) {
+                .hash        = glgfx__hash_str(GLGFX_FNV_OFFSET, name),
+                .name_offset = offset,
+                .index       = b,
+                .data_size   = data_size
+            };
+        }
+    }
+
+    mem_free(sizes);
+    mem_free(types);
+    mem_free(name);
+
+    // out of memory: an empty table rather than one with holes, every lookup misses.
+    if (!ok) {
+        glgfx__clear_table(table);
+        printf("reflectProgramUniformsGL(): out of memory reflecting program %u\n", programID);
+    }
+
+    return ok;
+}
+
+static const GLUniform_t* glgfx__probe(const GLUniformTable_t* table, uint32_t hash,
+                                       const char* array, const char* digits, const char* member) {
+    if (!table || !table->slots) return NULL;
+
+    uint32_t mask = table->capacity - 1;
+    uint32_t slot = hash & mask;
+
+    // bounded even though the table always keeps free slots.
+    for (uint32_t step = 0; step < table->capacity; ++step, slot = (slot + 1) & mask) {
+        const GLUniform_t* uniform = &table->slots[slot];
+        if (uniform->name_offset == UINT32_MAX) return NULL;
+        if (uniform->hash != hash) continue;
+
+        // compare the stored name piecewise against array[digits].member
+        const char* stored = table->names + uniform->name_offset;
+        size_t      alen   = strlen(array);
+
+        if (strncmp(stored, array, alen) != 0) continue;
+        stored += alen;
+
+        if (digits) {
+            size_t dlen = strlen(digits);
+            if (stored[0] != '[' || strncmp(stored + 1, digits, dlen) != 0 || stored[1 + dlen] != ']') continue;
+            stored += dlen + 2;
+        }
+
+        if (member) {
+            if (stored[0] != '.' || strcmp(stored + 1, member) != 0) continue;
+        } else if (stored[0] != '\0') {
+            continue;
+        }
+
+        return uniform;
+    }
+
+    return NULL;
+}
+
+const GLUniform_t* programFindUniform(const GLProgram_t* program, const char* name) {
+    if (!program || !name) return NULL;
+    return glgfx__probe(program->uniforms, glgfx__hash_str(GLGFX_FNV_OFFSET, name), name, NULL, NULL);
+}
+
+GLint programUniformLocation(const GLProgram_t* program, const char* name) {
+    const GLUniform_t* uniform = programFindUniform(program, name);
+    return uniform ? uniform->location : -1;
+}
+
+GLint programUniformElementLocation(const GLProgram_t* program, const char* array, int index, const char* member) {
+    if (!program || !array || index < 0) return -1;
+
+    char digits[16];
+    glgfx__itoa(index, digits);
+
+    uint32_t h = glgfx__hash_str(GLGFX_FNV_OFFSET, array);
+    h = glgfx__hash_chr(h, '[');
+    h = glgfx__hash_str(h, digits);
+    h = glgfx__hash_chr(h, ']');
+
+    if (member) {
+        h = glgfx__hash_chr(h, '.');
+        h = glgfx__hash_str(h, member);
+    }
+
+    const GLUniform_t* uniform = glgfx__probe(program->uniforms, h, array, digits, member);
+    return uniform ? uniform->location : -1;
+}
+
+GLint programUniformBlockIndex(const GLProgram_t* program, const char* name) {
+    if (!program || !program->uniforms || !name) return -1;
+
+    const GLUniformTable_t* table = program->uniforms;
+    uint32_t hash                 = glgfx__hash_str(GLGFX_FNV_OFFSET, name);
+
+    for (uint32_t i = 0; i < table->block_count; ++i) {
+        const GLUniformBlock_t* block = &table->blocks[i];
+        if (block->hash == hash && strcmp(table->names + block->name_offset, name) == 0)
+            return block->index;
+    }
+
+    return -1;
+}
+
+bool tryCreateShaderProgramGL(File_t vs_file, File_t fs_file, GLProgram_t* out, char* log, size_t log_size) {
+    GLPendingProgram_t pending;
+    if (!out || !beginShaderProgramGL(vs_file, fs_file, &pending)) return false;
+
+    return finishShaderProgramGL(&pending, out, log, log_size);
+}
+
+// -1 until the first query on the GL thread.
+static int s_glgfxParallelCompile = -1;
+
+static bool glgfx__parallel_compile(void) {
+    if (s_glgfxParallelCompile >= 0) return s_glgfxParallelCompile;
+
+    // the driver picks how many threads it compiles on, we don't set
+    // GL_MAX_SHADER_COMPILER_THREADS_KHR.
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+
+    s_glgfxParallelCompile = 0;
+    for (GLint i = 0; i < count; ++i) {
+        const char* name = (const char*) glGetStringi(GL_EXTENSIONS, i);
+        if (name && (strcmp(name, "GL_KHR_parallel_shader_compile") == 0 || strcmp(name, "GL_ARB_parallel_shader_compile") == 0)) {
+            s_glgfxParallelCompile = 1;
+            break;
+        }
+    }
+
+    return s_glgfxParallelCompile;
+}
+
+bool beginShaderProgramGL(File_t vs_file, File_t fs_file, GLPendingProgram_t* pending) {
+    if (!pending || !vs_file.data || !fs_file.data) return false;
+
+    const char* vs_src = vs_file.data;
+    const char* fs_src = fs_file.data;
+
+    *pending = (GLPendingProgram_t) {
+        .program = glCreateProgram(),
+        .vs      = glCreateShader(GL_VERTEX_SHADER),
+        .fs      = glCreateShader(GL_FRAGMENT_SHADER)
+    };
+
+    if (!pending->program || !pending->vs || !pending->fs) {
+        cancelShaderProgramGL(pending);
+        return false;
+    }
+
+    glShaderSource(pending->vs, 1, &vs_src, NULL);
+    glShaderSource(pending->fs, 1, &fs_src, NULL);
+    glCompileShader(pending->vs);
+    glCompileShader(pending->fs);
+
+    // linking a program whose shaders failed just fails, finishing reports the compile log.
+    glAttachShader(pending->program, pending->vs);
+    glAttachShader(pending->program, pending->fs);
+    glLinkProgram(pending->program);
+
+    return true;
+}
+
+bool shaderProgramReadyGL(const GLPendingProgram_t* pending) {
+    if (!pending || !pending->program || !glgfx__parallel_compile()) return true;
+
+    GLint done = GL_FALSE;
+    glGetProgramiv(pending->program, GL_COMPLETION_STATUS_KHR, &done);
+    return done == GL_TRUE;
+}
+
+bool finishShaderProgramGL(GLPendingProgram_t* pending, GLProgram_t* out, char* log, size_t log_size) {
+    if (!pending || !pending->program) return false;
+
+    GLuint shaders[2] = { pending->vs, pending->fs };
+    int    success    = 0;
+
+    for (int i = 0; i < 2; ++i) {
+        glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &success);
+        if (success) continue;
+
+        if (log && log_size) glGetShaderInfoLog(shaders[i], log_size, NULL, log);
+        cancelShaderProgramGL(pending);
+        return false;
+    }
+
+    glGetProgramiv(pending->program, GL_LINK_STATUS, &success);
+    if (!success) {
+        if (log && log_size) glGetProgramInfoLog(pending->program, log_size, NULL, log);
+        cancelShaderProgramGL(pending);
+        return false;
+    }
+
+    // shaders are reference counted by the program from here on.
+    glDeleteShader(pending->vs);
+    glDeleteShader(pending->fs);
+
+    GLProgram_t program = {0};
+    program.program     = pending->program;
+    loadProgramUniformsGL(&program);
+
+    *pending = (GLPendingProgram_t) {0};
+    *out     = program;
+    return true;
+}
+
+void cancelShaderProgramGL(GLPendingProgram_t* pending) {
+    if (!pending) return;
+
+    if (pending->program) glDeleteProgram(pending->program);
+    if (pending->vs)      glDeleteShader(pending->vs);
+    if (pending->fs)      glDeleteShader(pending->fs);
+
+    *pending = (GLPendingProgram_t) {0};
+}
+
+void uploadTextureGL(GLuint texture_id, const unsigned char* pixels, int width, int height, int channels) {
+    GLenum format = GL_RGB;
+    if (channels == 1) format = GL_RED;
+    else if (channels == 3) format = GL_RGB;
+    else if (channels == 4) format = GL_RGBA;
+
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format,
+                 GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    renderStatsUpload((uint64_t) width * height * channels);
 }
 
 void canvas_to_GLtexture(Olivec_Canvas src, GLint dest) {
     glBindTexture(GL_TEXTURE_2D, dest);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, src.width, src.height, 0, GL_BGRA_EXT, GL_UNSIGNED_BYTE, src.pixels);
     glBindTexture(GL_TEXTURE_2D, dest);    
+
+    renderStatsUpload((uint64_t) src.width * src.height * 4);
+}
+
+Texture_t createTextureGL(const unsigned char* pixels, int width, int height, int channels) {
+    Texture_t texture = {0};
+
+    glGenTextures(1, &texture.texture_id);
+    uploadTextureGL(texture.texture_id, pixels, width, height, channels);
+
+    // Texture parameters
+    glBindTexture(GL_TEXTURE_2D, texture.texture_id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return texture;
 }
 
 #endif // GLGFX_IMPLEMENTATION
\ No newline at end of file
@@ -0,0 +1,263 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "gl_gfx.h"
+#include "profiler.h"
+
+// GPU pass timings.
+//
+// gpuProfilerPush() / gpuProfilerPop() (or the scoped GPU_PROFILE_ZONE) put a GL_TIMESTAMP
+// query before and after a stretch of GL commands. Timestamps rather than GL_TIME_ELAPSED
+// because elapsed queries can't nest, and a pass holds draw groups. The queries of a frame are
+// read back GPU_PROFILER_FRAMES - 1 frames later, when the GPU is long done with them, and
+// only once GL_QUERY_RESULT_AVAILABLE says so: reading results never waits on the GPU. A frame
+// whose results still aren't there when its slot comes round again is dropped.
+//
+// Results go to a "GPU" track of the CPU profiler, converted to get_time_ns() time with an
+// offset measured through glGetInteger64v(GL_TIMESTAMP) (and re-measured every
+// GPU_PROFILER_RECALIBRATE frames for drift), so passes line up under the CPU zones that
+// issued them. Averages per scope are kept for gpuProfilerPrint().
+
+#define GPUPROFAPI static
+
+#define GPU_PROFILER_FRAMES       4    // frames in flight, results are read this many frames - 1 late
+#define GPU_PROFILER_MAX_SCOPES   64   // per frame
+#define GPU_PROFILER_MAX_DEPTH    16
+#define GPU_PROFILER_MAX_NAMES    32   // distinct scope names with running averages
+#define GPU_PROFILER_RECALIBRATE  120
+
+typedef struct GPUProfilerScope_st GPUProfilerScope_t;
+typedef struct GPUProfilerFrame_st GPUProfilerFrame_t;
+
+struct GPUProfilerScope_st {
+    const char* name;       // static string
+    int         begin;      // query index in the frame
+    int         end;        // -1 until popped
+};
+
+struct GPUProfilerFrame_st {
+    GLuint             queries[GPU_PROFILER_MAX_SCOPES * 2];
+    GPUProfilerScope_t scopes[GPU_PROFILER_MAX_SCOPES];
+    int                scope_count;
+    int                query_count;
+    bool               pending;     // issued, results not read yet
+};
+
+GPUPROFAPI bool gpuProfilerInit(void);
+GPUPROFAPI void gpuProfilerShutdown(void);
+
+// around each frame's GL commands, on the GL thread.
+GPUPROFAPI void gpuProfilerBeginFrame(void);
+GPUPROFAPI void gpuProfilerEndFrame(void);
+
+// `name` must be a static string. Scopes past GPU_PROFILER_MAX_SCOPES in a frame are skipped.
+GPUPROFAPI void gpuProfilerPush(const char* name);
+GPUPROFAPI void gpuProfilerPop(void);
+
+GPUPROFAPI void gpuProfilerPrint(void);
+
+static inline const char* gpuProfiler__scope_begin(const char* name) {
+    gpuProfilerPush(name);
+    return name;
+}
+
+static inline void gpuProfiler__scope_end(const char** name) {
+    (void) name;
+    gpuProfilerPop();
+}
+
+#if PROFILER_ENABLED
+#   define GPU_PROFILE_ZONE(name) \
+        const char* PROFILER__CONCAT(gpu_profiler__zone_, __LINE__) __attribute__((cleanup(gpuProfiler__scope_end))) = gpuProfiler__scope_begin(name)
+#else
+#   define GPU_PROFILE_ZONE(name) ((void) 0)
+#endif // PROFILER_ENABLED
+
+#ifdef GPUPROF_IMPLEMENTATION
+
+static struct {
+    bool               initialized;
+    bool               in_frame;
+
+    GPUProfilerFrame_t frames[GPU_PROFILER_FRAMES];
+    uint64_t           frame;                   // frames begun
+    int                stack[GPU_PROFILER_MAX_DEPTH];
+    int                depth;                   // may exceed the stack, those scopes are skipped
+
+    ProfilerThread_t*  track;
+    int64_t            offset_ns;               // cpu = gpu + offset
+    uint64_t           dropped_frames;
+
+    struct {
+        const char* name;
+        uint64_t    total_ns;
+        uint64_t    count;
+    }                  names[GPU_PROFILER_MAX_NAMES];
+    int                name_count;
+    uint64_t           resolved_frames;
+} s_gpuprof;
+
+static void gpuProfiler__calibrate(void) {
+    GLint64 gpu_ns = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpu_ns);
+    s_gpuprof.offset_ns = (int64_t) get_time_ns() - (int64_t) gpu_ns;
+}
+
+GPUPROFAPI bool gpuProfilerInit(void) {
+    if (s_gpuprof.initialized) return true;
+
+    memset(&s_gpuprof, 0, sizeof(s_gpuprof));
+
+    for (int i = 0; i < GPU_PROFILER_FRAMES; ++i) {
+        glGenQueries(GPU_PROFILER_MAX_SCOPES * 2, s_gpuprof.frames[i].queries);
+    }
+
+    gpuProfiler__calibrate();
+    s_gpuprof.track       = profiler_create_track("GPU");
+    s_gpuprof.initialized = true;
+
+    return true;
+}
+
+GPUPROFAPI void gpuProfilerShutdown(void) {
+    if (!s_gpuprof.initialized) return;
+
+    for (int i = 0; i < GPU_PROFILER_FRAMES; ++i) {
+        glDeleteQueries(GPU_PROFILER_MAX_SCOPES * 2, s_gpuprof.frames[i].queries);
+    }
+
+    memset(&s_gpuprof, 0, sizeof(s_gpuprof));
+}
+
+static void gpuProfiler__accumulate(const char* name, uint64_t ns) {
+    int i = 0;
+    while (i < s_gpuprof.name_count && s_gpuprof.names[i].name != name) ++i;
+
+    if (i == s_gpuprof.name_count) {
+        if (i == GPU_PROFILER_MAX_NAMES) return;
+        s_gpuprof.names[i].name = name;
+        s_gpuprof.name_count++;
+    }
+
+    s_gpuprof.names[i].total_ns += ns;
+    s_gpuprof.names[i].count++;
+}
+
+// reads a finished frame back if the GPU got to it, never blocks.
+static bool gpuProfiler__resolve(GPUProfilerFrame_t* frame) {
+    if (!frame->pending) return true;
+
+    if (frame->query_count > 0) {
+        // timestamps complete in order, the last one being there means all of them are.
+        GLint available = 0;
+        glGetQueryObjectiv(frame->queries[frame->query_count - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return false;
+    }
+
+    for (int i = 0; i < frame->scope_count; ++i) {
+        GPUProfilerScope_t* scope = &frame->scopes[i];
+        if (scope->end < 0) continue;
+
+        GLuint64 begin_ns = 0, end_ns = 0;
+        glGetQueryObjectui64v(frame->queries[scope->begin], GL_QUERY_RESULT, &begin_ns);
+        glGetQueryObjectui64v(frame->queries[scope->end],   GL_QUERY_RESULT, &end_ns);
+        if (end_ns < begin_ns) continue;
+
+        gpuProfiler__accumulate(scope->name, end_ns - begin_ns);
+        profiler_track_record(s_gpuprof.track, scope->name,
+                              (uint64_t)((int64_t) begin_ns + s_gpuprof.offset_ns),
+                              (uint64_t)((int64_t) end_ns   + s_gpuprof.offset_ns));
+    }
+
+    frame->pending = false;
+    s_gpuprof.resolved_frames++;
+    return true;
+}
+
+GPUPROFAPI void gpuProfilerBeginFrame(void) {
+    if (!s_gpuprof.initialized) return;
+
+    // the slot about to be reused, and any older frame that's ready by now.
+    for (int i = 1; i <= GPU_PROFILER_FRAMES; ++i) {
+        if (s_gpuprof.frame < (uint64_t) i) break;
+
+        GPUProfilerFrame_t* frame = &s_gpuprof.frames[(s_gpuprof.frame - i) % GPU_PROFILER_FRAMES];
+        if (!gpuProfiler__resolve(frame) && i == GPU_PROFILER_FRAMES) {
+            frame->pending = false;
+            s_gpuprof.dropped_frames++;
+        }
+    }
+
+    if (s_gpuprof.frame % GPU_PROFILER_RECALIBRATE == 0) gpuProfiler__calibrate();
+
+    GPUProfilerFrame_t* frame = &s_gpuprof.frames[s_gpuprof.frame % GPU_PROFILER_FRAMES];
+    frame->scope_count = 0;
+    frame->query_count = 0;
+
+    s_gpuprof.depth    = 0;
+    s_gpuprof.in_frame = true;
+}
+
+GPUPROFAPI void gpuProfilerEndFrame(void) {
+    if (!s_gpuprof.initialized || !s_gpuprof.in_frame) return;
+
+    while (s_gpuprof.depth > 0) gpuProfilerPop();
+
+    GPUProfilerFrame_t* frame = &s_gpuprof.frames[s_gpuprof.frame % GPU_PROFILER_FRAMES];
+    frame->pending = frame->scope_count > 0;
+
+    s_gpuprof.in_frame = false;
+    s_gpuprof.frame++;
+}
+
+GPUPROFAPI void gpuProfilerPush(const char* name) {
+    if (!s_gpuprof.in_frame) return;
+
+    GPUProfilerFrame_t* frame = &s_gpuprof.frames[s_gpuprof.frame % GPU_PROFILER_FRAMES];
+    int                 depth = s_gpuprof.depth++;
+
+    // two queries per scope, so the scope limit also keeps the queries in bounds.
+    if (depth >= GPU_PROFILER_MAX_DEPTH || frame->scope_count == GPU_PROFILER_MAX_SCOPES) {
+        if (depth < GPU_PROFILER_MAX_DEPTH) s_gpuprof.stack[depth] = -1;
+        return;
+    }
+
+    int index = frame->scope_count++;
+    frame->scopes[index] = (GPUProfilerScope_t) { name, frame->query_count++, -1 };
+    s_gpuprof.stack[depth] = index;
+
+    glQueryCounter(frame->queries[frame->scopes[index].begin], GL_TIMESTAMP);
+}
+
+GPUPROFAPI void gpuProfilerPop(void) {
+    if (!s_gpuprof.in_frame || s_gpuprof.depth == 0) return;
+
+    int depth = --s_gpuprof.depth;
+    if (depth >= GPU_PROFILER_MAX_DEPTH || s_gpuprof.stack[depth] < 0) return;
+
+    GPUProfilerFrame_t* frame = &s_gpuprof.frames[s_gpuprof.frame % GPU_PROFILER_FRAMES];
+    GPUProfilerScope_t* scope = &frame->scopes[s_gpuprof.stack[depth]];
+
+    scope->end = frame->query_count++;
+    glQueryCounter(frame->queries[scope->end], GL_TIMESTAMP);
+}
+
+GPUPROFAPI void gpuProfilerPrint(void) {
+    if (!s_gpuprof.initialized) return;
+
+    printf("gpu timings: %llu frames read back, %llu dropped\n",
+        (unsigned long long) s_gpuprof.resolved_frames, (unsigned long long) s_gpuprof.dropped_frames);
+
+    for (int i = 0; i < s_gpuprof.name_count; ++i) {
+        uint64_t frames = s_gpuprof.resolved_frames ? s_gpuprof.resolved_frames : 1;
+
+        printf("  %-20s %8.3f ms per frame (%llu scopes)\n",
+            s_gpuprof.names[i].name, s_gpuprof.names[i].total_ns / 1e6 / frames,
+            (unsigned long long) s_gpuprof.names[i].count);
+    }
+}
+
+#endif // GPUPROF_IMPLEMENTATION
@@ -0,0 +1,272 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "allocator.h"
+#include "gl_gfx.h"
+
+// GPU memory accounting.
+//
+// Every buffer and texture allocation is recorded with its size and the last frame it was
+// used in. gpuResourcesEndFrame() checks the total against the budget; when it is over, the
+// coldest resources that registered an evict callback (and haven't been used for
+// GPU_RESOURCE_COLD_FRAMES) are asked to give memory back, oldest first. What "give back"
+// means is up to the owner: streamed textures drop their finest mip, meshes with a CPU copy
+// drop their buffers until they are drawn again.
+//
+// A view is a part of another resource's storage (a material texture in its page layer): it
+// carries the size and frame of use eviction picks on, but its bytes aren't added to the
+// totals. What an eviction gave back is the change of the totals, not of the evicted resource.
+
+#define GPURESAPI static
+
+#define GPU_RESOURCES_DEFAULT_BUDGET (512u * 1024 * 1024)
+#define GPU_RESOURCE_COLD_FRAMES     300
+
+typedef struct GPUResource_st GPUResource_t;
+
+typedef enum gpu_resource_kind_enum {
+    GPU_RESOURCE_BUFFER,
+    GPU_RESOURCE_TEXTURE,
+    GPU_RESOURCE_KIND_COUNT
+} gpu_resource_kind_t;
+
+// frees what it can and updates the resource (gpuResourceUpdate / gpuResourceUntrack).
+typedef void (*gpu_evict_fn)(void* user);
+
+struct GPUResource_st {
+    bool                used;
+    gpu_resource_kind_t kind;
+    GLuint              name;
+    size_t              bytes;
+    uint64_t            last_used_frame;
+    const char*         label;           // static string
+    bool                view;            // bytes counted by the resource it is part of
+
+    gpu_evict_fn        evict;
+    void*               evict_user;
+};
+
+GPURESAPI bool     gpuResourcesInit(size_t budget_bytes);
+GPURESAPI void     gpuResourcesShutdown(void);
+
+// returns the resource id, 0 if tracking isn't initialized.
+GPURESAPI int      gpuResourceTrack(gpu_resource_kind_t kind, GLuint name, size_t bytes, const char* label);
+GPURESAPI int      gpuResourceTrackView(gpu_resource_kind_t kind, GLuint name, size_t bytes, const char* label);
+GPURESAPI void     gpuResourceUpdate(int id, GLuint name, size_t bytes);
+GPURESAPI void     gpuResourceUntrack(int id);
+GPURESAPI void     gpuResourceTouch(int id);
+GPURESAPI void     gpuResourceSetEvict(int id, gpu_evict_fn evict, void* user);
+
+// once per frame, after the last draw.
+GPURESAPI void     gpuResourcesEndFrame(void);
+GPURESAPI uint64_t gpuResourcesFrame(void);
+GPURESAPI size_t   gpuResourcesUsedBytes(void);
+GPURESAPI void     gpuResourcesSetBudget(size_t budget_bytes);
+GPURESAPI void     gpuResourcesPrint(void);
+
+#ifdef GPURES_IMPLEMENTATION
+
+static struct {
+    GPUResource_t* resources;    // id - 1
+    int            count, capacity;
+    int*           free_ids;
+    int            free_count;
+
+    size_t         used_bytes[GPU_RESOURCE_KIND_COUNT];
+    size_t         budget;
+    uint64_t       frame;
+
+    uint32_t       evictions;
+    size_t         evicted_bytes;
+    bool           initialized;
+} s_gpures;
+
+static GPUResource_t* gpures__get(int id) {
+    if (id <= 0 || id > s_gpures.count) return NULL;
+
+    GPUResource_t* resource = &s_gpures.resources[id - 1];
+    return resource->used ? resource : NULL;
+}
+
+static size_t gpures__total(void) {
+    size_t total = 0;
+    for (int k = 0; k < GPU_RESOURCE_KIND_COUNT; ++k) total += s_gpures.used_bytes[k];
+    return total;
+}
+
+GPURESAPI bool gpuResourcesInit(size_t budget_bytes) {
+    if (s_gpures.initialized) return true;
+
+    memset(&s_gpures, 0, sizeof(s_gpures));
+    s_gpures.budget      = budget_bytes ? budget_bytes : GPU_RESOURCES_DEFAULT_BUDGET;
+    s_gpures.initialized = true;
+
+    return true;
+}
+
+GPURESAPI void gpuResourcesShutdown(void) {
+    if (!s_gpures.initialized) return;
+
+    mem_free(s_gpures.resources);
+    mem_free(s_gpures.free_ids);
+    memset(&s_gpures, 0, sizeof(s_gpures));
+}
+
+static int gpures__track(gpu_resource_kind_t kind, GLuint name, size_t bytes, const char* label, bool view) {
+    if (!s_gpures.initialized) return 0;
+
+    int id;
+
+    if (s_gpures.free_count > 0) {
+        id = s_gpures.free_ids[--s_gpures.free_count];
+    } else {
+        if (s_gpures.count == s_gpures.capacity) {
+            int capacity = s_gpures.capacity ? s_gpures.capacity * 2 : 256;
+
+            GPUResource_t* resources = mem_realloc(MEM_TAG_RENDER, s_gpures.resources, capacity * sizeof(GPUResource_t));
+            if (!resources) return 0;
+            s_gpures.resources = resources;
+
+            int* free_ids = mem_realloc(MEM_TAG_RENDER, s_gpures.free_ids, capacity * sizeof(int));
+            if (!free_ids) return 0;
+            s_gpures.free_ids = free_ids;
+
+            s_gpures.capacity = capacity;
+        }
+
+        id = ++s_gpures.count;
+    }
+
+    s_gpures.resources[id - 1] = (GPUResource_t) {
+        .used            = true,
+        .kind            = kind,
+        .name            = name,
+        .bytes           = bytes,
+        .last_used_frame = s_gpures.frame,
+        .label           = label,
+        .view            = view
+    };
+    if (!view) s_gpures.used_bytes[kind] += bytes;
+
+    return id;
+}
+
+GPURESAPI int gpuResourceTrack(gpu_resource_kind_t kind, GLuint name, size_t bytes, const char* label) {
+    return gpures__track(kind, name, bytes, label, false);
+}
+
+GPURESAPI int gpuResourceTrackView(gpu_resource_kind_t kind, GLuint name, size_t bytes, const char* label) {
+    return gpures__track(kind, name, bytes, label, true);
+}
+
+GPURESAPI void gpuResourceUpdate(int id, GLuint name, size_t bytes) {
+    GPUResource_t* resource = gpures__get(id);
+    if (!resource) return;
+
+    if (!resource->view) {
+        s_gpures.used_bytes[resource->kind] += bytes;
+        s_gpures.used_bytes[resource->kind] -= resource->bytes;
+    }
+
+    resource->name  = name;
+    resource->bytes = bytes;
+}
+
+GPURESAPI void gpuResourceUntrack(int id) {
+    GPUResource_t* resource = gpures__get(id);
+    if (!resource) return;
+
+    if (!resource->view) s_gpures.used_bytes[resource->kind] -= resource->bytes;
+    *resource = (GPUResource_t) {0};
+
+    s_gpures.free_ids[s_gpures.free_count++] = id;
+}
+
+GPURESAPI void gpuResourceTouch(int id) {
+    GPUResource_t* resource = gpures__get(id);
+    if (resource) resource->last_used_frame = s_gpures.frame;
+}
+
+GPURESAPI void gpuResourceSetEvict(int id, gpu_evict_fn evict, void* user) {
+    GPUResource_t* resource = gpures__get(id);
+    if (!resource) return;
+
+    resource->evict      = evict;
+    resource->evict_user = user;
+}
+
+GPURESAPI void gpuResourcesEndFrame(void) {
+    if (!s_gpures.initialized) return;
+
+    s_gpures.frame++;
+
+    // evict the coldest candidate until the total fits or nothing cold is left.
+    while (gpures__total() > s_gpures.budget) {
+        int      coldest = 0;
+        uint64_t oldest  = UINT64_MAX;
+
+        for (int id = 1; id <= s_gpures.count; ++id) {
+            GPUResource_t* resource = &s_gpures.resources[id - 1];
+
+            if (!resource->used || !resource->evict || resource->bytes == 0) continue;
+            if (s_gpures.frame - resource->last_used_frame < GPU_RESOURCE_COLD_FRAMES) continue;
+
+            if (resource->last_used_frame < oldest) {
+                oldest  = resource->last_used_frame;
+                coldest = id;
+            }
+        }
+
+        if (!coldest) break;
+
+        GPUResource_t* resource = &s_gpures.resources[coldest - 1];
+        size_t         before   = gpures__total();
+
+        resource->evict(resource->evict_user);
+
+        // a view shrinking only gives memory back once its owner's storage shrinks with it.
+        size_t after = gpures__total();
+        resource     = gpures__get(coldest);
+
+        if (after >= before) {
+            // nothing to give back, it stops being a candidate until it goes cold again.
+            if (resource) resource->last_used_frame = s_gpures.frame;
+            continue;
+        }
+
+        s_gpures.evictions++;
+        s_gpures.evicted_bytes += before - after;
+    }
+}
+
+GPURESAPI uint64_t gpuResourcesFrame(void) {
+    return s_gpures.frame;
+}
+
+GPURESAPI size_t gpuResourcesUsedBytes(void) {
+    return gpures__total();
+}
+
+GPURESAPI void gpuResourcesSetBudget(size_t budget_bytes) {
+    s_gpures.budget = budget_bytes;
+}
+
+GPURESAPI void gpuResourcesPrint(void) {
+    int counts[GPU_RESOURCE_KIND_COUNT] = {0};
+
+    for (int id = 1; id <= s_gpures.count; ++id) {
+        if (s_gpures.resources[id - 1].used && !s_gpures.resources[id - 1].view) counts[s_gpures.resources[id - 1].kind]++;
+    }
+
+    printf("gpu memory: %.2f / %.2f MB at frame %llu\n",
+        gpures__total() / (1024.0 * 1024.0), s_gpures.budget / (1024.0 * 1024.0), (unsigned long long) s_gpures.frame);
+    printf("  buffers  %4d  %8.2f MB\n", counts[GPU_RESOURCE_BUFFER],  s_gpures.used_bytes[GPU_RESOURCE_BUFFER]  / (1024.0 * 1024.0));
+    printf("  textures %4d  %8.2f MB\n", counts[GPU_RESOURCE_TEXTURE], s_gpures.used_bytes[GPU_RESOURCE_TEXTURE] / (1024.0 * 1024.0));
+    printf("  evictions %u, %.2f MB given back\n", s_gpures.evictions, s_gpures.evicted_bytes / (1024.0 * 1024.0));
+}
+
+#endif // GPURES_IMPLEMENTATION
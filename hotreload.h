@@ -0,0 +1,482 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "file.h"
+#include "gl_gfx.h"
+#include "material.h"
+#include "thread.h"
+
+// Live reload of shaders and textures.
+//
+// A watcher thread listens for file changes (inotify on Linux, mtime polling elsewhere),
+// re-reads / re-decodes only the affected asset off the main thread and parks the result.
+// hotreload_update() must be called on the GL thread at a frame boundary: it re-uploads the
+// texture in place, or hands the new program to the driver and swaps it in on a later frame once
+// it is compiled and linked (keeping the old one if that fails). The compile only runs off the GL
+// thread where the driver has GL_KHR_parallel_shader_compile, elsewhere it blocks that frame.
+
+#define HOTRELOADAPI static
+
+#ifndef HOTRELOAD_MAX_ASSETS
+#   define HOTRELOAD_MAX_ASSETS 64
+#endif
+
+#define HOTRELOAD_MAX_DIRS      16
+#define HOTRELOAD_PATH_MAX      256
+#define HOTRELOAD_DEBOUNCE_MS   50
+#define HOTRELOAD_POLL_MS       250
+
+typedef void (*hotreload_program_fn)(GLProgram_t* program, void* user);
+
+HOTRELOADAPI bool hotreload_init(void);
+HOTRELOADAPI void hotreload_shutdown(void);
+
+// `program` must outlive the watcher; it is overwritten with the new program on a successful reload
+// and `on_reload` (optional) is then invoked so the caller can propagate it to its copies.
+HOTRELOADAPI bool hotreload_watch_program(GLProgram_t* program, const char* vs_path, const char* fs_path,
+                                          hotreload_program_fn on_reload, void* user);
+// textures are re-specified in place, every copy of `texture` stays valid.
+HOTRELOADAPI bool hotreload_watch_texture(MaterialTexture_t texture, const char* path);
+
+// applies pending reloads, call once per frame on the thread owning the GL context.
+HOTRELOADAPI void hotreload_update(void);
+
+#ifdef HOTRELOAD_IMPLEMENTATION
+
+#include <sys/stat.h>
+
+#if defined(__linux__)
+#   include <sys/inotify.h>
+#   include <poll.h>
+#   include <unistd.h>
+#   define HOTRELOAD_INOTIFY
+#endif // defined(__linux__)
+
+typedef enum hotreload_kind_enum {
+    HOTRELOAD_PROGRAM,
+    HOTRELOAD_TEXTURE
+} hotreload_kind_t;
+
+typedef struct HotReloadAsset_st HotReloadAsset_t;
+typedef struct HotReloadDir_st   HotReloadDir_t;
+
+struct HotReloadDir_st {
+    char path[HOTRELOAD_PATH_MAX];
+    int  wd;
+};
+
+struct HotReloadAsset_st {
+    hotreload_kind_t     kind;
+    int                  path_count;
+    char                 paths[2][HOTRELOAD_PATH_MAX];
+    const char*          names[2];   // file name part of paths[i]
+    int                  dirs[2];    // index in s_hotreload.dirs
+    time_t               mtimes[2];
+
+    // watcher thread
+    bool                 dirty;
+
+    // results handed over to the GL thread
+    bool                 ready;
+    File_t               files[2];
+    unsigned char*       pixels;
+    int                  width, height, channels;
+
+    // GL thread, a program reload the driver is still building
+    GLPendingProgram_t   compile;
+    bool                 compiling;
+
+    // targets
+    GLProgram_t*         program;
+    hotreload_program_fn on_reload;
+    void*                user;
+    MaterialTexture_t    texture;
+};
+
+static struct {
+    Mutex_t          lock;
+    Thread_t         thread;
+    atomic_bool      running;
+    int              fd;
+
+    HotReloadDir_t   dirs[HOTRELOAD_MAX_DIRS];
+    int              dir_count;
+
+    HotReloadAsset_t assets[HOTRELOAD_MAX_ASSETS];
+    int              asset_count;
+} s_hotreload = { .fd = -1 };
+
+static time_t hotreload__mtime(const char* path) {
+    struct stat st;
+    if (stat(path, &st) != 0) return 0;
+    return st.st_mtime;
+}
+
+// must be called with s_hotreload.lock held.
+static int hotreload__watch_dir(const char* file_path, const char** name_out) {
+    const char* slash = strrchr(file_path, '/');
+    char dir[HOTRELOAD_PATH_MAX] = ".";
+
+    if (slash) {
+        size_t len = (size_t)(slash - file_path);
+        if (len >= sizeof(dir)) return -1;
+        memcpy(dir, file_path, len);
+        dir[len] = '\0';
+    }
+
+    *name_out = slash ? slash + 1 : file_path;
+
+    for (int i = 0; i < s_hotreload.dir_count; ++i) {
+        if (strcmp(s_hotreload.dirs[i].path, dir) == 0) return i;
+    }
+
+    if (s_hotreload.dir_count >= HOTRELOAD_MAX_DIRS) return -1;
+
+    HotReloadDir_t* d = &s_hotreload.dirs[s_hotreload.dir_count];
+    snprintf(d->path, sizeof(d->path), "%s", dir);
+    d->wd = -1;
+
+#if defined(HOTRELOAD_INOTIFY)
+    // editors often save through a temporary file + rename, so watch for both.
+    d->wd = inotify_add_watch(s_hotreload.fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (d->wd < 0) {
+        printf("hotreload: couldn't watch %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+#endif // defined(HOTRELOAD_INOTIFY)
+
+    return s_hotreload.dir_count++;
+}
+
+static HotReloadAsset_t* hotreload__add_asset(hotreload_kind_t kind, const char** paths, int path_count) {
+    if (!atomic_load(&s_hotreload.running)) return NULL;
+
+    mutex_lock(&s_hotreload.lock);
+
+    if (s_hotreload.asset_count >= HOTRELOAD_MAX_ASSETS) {
+        mutex_unlock(&s_hotreload.lock);
+        return NULL;
+    }
+
+    HotReloadAsset_t* asset = &s_hotreload.assets[s_hotreload.asset_count];
+    *asset                  = (HotReloadAsset_t) { .kind = kind, .path_count = path_count };
+
+    for (int i = 0; i < path_count; ++i) {
+        snprintf(asset->paths[i], HOTRELOAD_PATH_MAX, "%s", paths[i]);
+        asset->dirs[i]   = hotreload__watch_dir(asset->paths[i], &asset->names[i]);
+        asset->mtimes[i] = hotreload__mtime(asset->paths[i]);
+
+        if (asset->dirs[i] < 0) {
+            mutex_unlock(&s_hotreload.lock);
+            return NULL;
+        }
+    }
+
+    // published last: the watcher only looks at assets below asset_count.
+    s_hotreload.asset_count++;
+    mutex_unlock(&s_hotreload.lock);
+
+    return asset;
+}
+
+// must be called with s_hotreload.lock held.
+static void hotreload__mark_dirty(int dir, const char* name) {
+    for (int i = 0; i < s_hotreload.asset_count; ++i) {
+        HotReloadAsset_t* asset = &s_hotreload.assets[i];
+
+        for (int p = 0; p < asset->path_count; ++p) {
+            if (asset->dirs[p] == dir && strcmp(asset->names[p], name) == 0)
+                asset->dirty = true;
+        }
+    }
+}
+
+static void hotreload__free_results(HotReloadAsset_t* asset) {
+    for (int i = 0; i < 2; ++i) {
+        free_file(&asset->files[i]);
+    }
+
+    if (asset->pixels) stbi_image_free(asset->pixels);
+    asset->pixels = NULL;
+}
+
+// reads / decodes every dirty asset. Heavy work happens without holding the lock.
+// Returns true while some asset changed again before the GL thread took its previous reload,
+// the watcher has to come back for it: no new file event may ever arrive.
+static bool hotreload__load_dirty(void) {
+    bool waiting = false;
+
+    for (int i = 0; i < HOTRELOAD_MAX_ASSETS; ++i) {
+        mutex_lock(&s_hotreload.lock);
+        bool in_range = i < s_hotreload.asset_count;
+        HotReloadAsset_t* asset = &s_hotreload.assets[i];
+        bool pending  = in_range && asset->dirty && !asset->ready;
+        if (pending) asset->dirty = false;
+        waiting |= in_range && asset->dirty && asset->ready;
+        mutex_unlock(&s_hotreload.lock);
+
+        if (!in_range) break;
+        if (!pending)  continue;
+
+        File_t         files[2] = {0};
+        unsigned char* pixels   = NULL;
+        int            width = 0, height = 0, channels = 0;
+        bool           ok       = true;
+
+        // copied rather than mapped: an editor may still be rewriting the file.
+        for (int p = 0; p < asset->path_count; ++p) {
+            files[p] = read_file(asset->paths[p]);
+            ok      &= files[p].data != NULL;
+        }
+
+        if (ok && asset->kind == HOTRELOAD_TEXTURE) {
+            pixels = stbi_load_from_memory((const stbi_uc*) files[0].data, (int) files[0].size - 1, &width, &height, &channels, 0);
+            free_file(&files[0]);
+
+            if (!pixels) {
+                printf("hotreload: failed to decode %s: %s\n", asset->paths[0], stbi_failure_reason());
+                ok = false;
+            }
+        }
+
+        if (!ok) {
+            for (int p = 0; p < 2; ++p) free_file(&files[p]);
+            continue;
+        }
+
+        mutex_lock(&s_hotreload.lock);
+        asset->files[0] = files[0];
+        asset->files[1] = files[1];
+        asset->pixels   = pixels;
+        asset->width    = width;
+        asset->height   = height;
+        asset->channels = channels;
+        asset->ready    = true;
+        mutex_unlock(&s_hotreload.lock);
+    }
+
+    return waiting;
+}
+
+#if defined(HOTRELOAD_INOTIFY)
+
+static int hotreload__watcher(void* user) {
+    (void) user;
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool pending = false;
+
+    while (atomic_load(&s_hotreload.running)) {
+        struct pollfd pfd = { .fd = s_hotreload.fd, .events = POLLIN };
+
+        // keep draining events until the directory has been quiet for the debounce
+        // window, a single save commonly produces several notifications.
+        if (poll(&pfd, 1, HOTRELOAD_DEBOUNCE_MS) > 0 && (pfd.revents & POLLIN)) {
+            ssize_t len = read(s_hotreload.fd, buffer, sizeof(buffer));
+            if (len <= 0) continue;
+
+            mutex_lock(&s_hotreload.lock);
+            for (char* ptr = buffer; ptr < buffer + len;) {
+                struct inotify_event* ev = (struct inotify_event*) ptr;
+
+                for (int d = 0; d < s_hotreload.dir_count && ev->len; ++d) {
+                    if (s_hotreload.dirs[d].wd == ev->wd) hotreload__mark_dirty(d, ev->name);
+                }
+
+                ptr += sizeof(struct inotify_event) + ev->len;
+            }
+            mutex_unlock(&s_hotreload.lock);
+
+            pending = true;
+            continue;
+        }
+
+        // quiet for the debounce window, and every debounce window after that while an asset
+        // waits for the GL thread to take its previous reload.
+        if (pending) pending = hotreload__load_dirty();
+    }
+
+    return 0;
+}
+
+#else
+
+static int hotreload__watcher(void* user) {
+    (void) user;
+
+    bool waiting = false;
+
+    while (atomic_load(&s_hotreload.running)) {
+        thread_sleep_ms(HOTRELOAD_POLL_MS);
+
+        bool changed = false;
+
+        mutex_lock(&s_hotreload.lock);
+        for (int i = 0; i < s_hotreload.asset_count; ++i) {
+            HotReloadAsset_t* asset = &s_hotreload.assets[i];
+
+            for (int p = 0; p < asset->path_count; ++p) {
+                time_t mtime = hotreload__mtime(asset->paths[p]);
+                if (mtime && mtime != asset->mtimes[p]) {
+                    asset->mtimes[p] = mtime;
+                    hotreload__mark_dirty(asset->dirs[p], asset->names[p]);
+                    changed = true;
+                }
+            }
+        }
+        mutex_unlock(&s_hotreload.lock);
+
+        // the poll interval doubles as the debounce window.
+        if (changed) thread_sleep_ms(HOTRELOAD_DEBOUNCE_MS);
+        if (changed || waiting) waiting = hotreload__load_dirty();
+    }
+
+    return 0;
+}
+
+#endif // defined(HOTRELOAD_INOTIFY)
+
+HOTRELOADAPI bool hotreload_init(void) {
+    if (atomic_load(&s_hotreload.running)) return true;
+
+#if defined(HOTRELOAD_INOTIFY)
+    s_hotreload.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (s_hotreload.fd < 0) {
+        printf("hotreload: inotify_init1() failed: %s\n", strerror(errno));
+        return false;
+    }
+#endif // defined(HOTRELOAD_INOTIFY)
+
+    mutex_init(&s_hotreload.lock);
+    atomic_store(&s_hotreload.running, true);
+
+    if (!thread_create(&s_hotreload.thread, hotreload__watcher, NULL)) {
+        atomic_store(&s_hotreload.running, false);
+        printf("hotreload: couldn't start watcher thread.\n");
+        return false;
+    }
+
+    return true;
+}
+
+HOTRELOADAPI void hotreload_shutdown(void) {
+    if (!atomic_load(&s_hotreload.running)) return;
+
+    atomic_store(&s_hotreload.running, false);
+    thread_join(&s_hotreload.thread);
+
+    // called with the context current, like hotreload_update().
+    for (int i = 0; i < s_hotreload.asset_count; ++i) {
+        cancelShaderProgramGL(&s_hotreload.assets[i].compile);
+        hotreload__free_results(&s_hotreload.assets[i]);
+    }
+
+#if defined(HOTRELOAD_INOTIFY)
+    close(s_hotreload.fd);
+    s_hotreload.fd = -1;
+#endif // defined(HOTRELOAD_INOTIFY)
+
+    mutex_destroy(&s_hotreload.lock);
+    s_hotreload.asset_count = 0;
+    s_hotreload.dir_count   = 0;
+}
+
+HOTRELOADAPI bool hotreload_watch_program(GLProgram_t* program, const char* vs_path, const char* fs_path,
+                                          hotreload_program_fn on_reload, void* user) {
+    if (!program || !vs_path || !fs_path) return false;
+
+    const char* paths[2]    = { vs_path, fs_path };
+    HotReloadAsset_t* asset = hotreload__add_asset(HOTRELOAD_PROGRAM, paths, 2);
+    if (!asset) return false;
+
+    // targets are only read by the GL thread, no need to hold the lock.
+    asset->program   = program;
+    asset->on_reload = on_reload;
+    asset->user      = user;
+
+    return true;
+}
+
+HOTRELOADAPI bool hotreload_watch_texture(MaterialTexture_t texture, const char* path) {
+    if (!texture.id || !path) return false;
+
+    HotReloadAsset_t* asset = hotreload__add_asset(HOTRELOAD_TEXTURE, &path, 1);
+    if (!asset) return false;
+
+    asset->texture = texture;
+    return true;
+}
+
+// swaps the program in once the driver is done with it.
+static void hotreload__finish_program(HotReloadAsset_t* asset) {
+    if (!shaderProgramReadyGL(&asset->compile)) return;
+
+    GLProgram_t program;
+    char log[1024] = {0};
+
+    asset->compiling = false;
+
+    if (finishShaderProgramGL(&asset->compile, &program, log, sizeof(log))) {
+        destroyShaderProgramGL(asset->program);
+        *asset->program = program;
+        if (asset->on_reload) asset->on_reload(asset->program, asset->user);
+
+        printf("hotreload: reloaded %s + %s\n", asset->paths[0], asset->paths[1]);
+    } else {
+        printf("hotreload: %s + %s failed to build, keeping previous version:\n%s\n",
+               asset->paths[0], asset->paths[1], log);
+    }
+}
+
+HOTRELOADAPI void hotreload_update(void) {
+    if (!atomic_load(&s_hotreload.running)) return;
+
+    for (int i = 0; i < HOTRELOAD_MAX_ASSETS; ++i) {
+        mutex_lock(&s_hotreload.lock);
+        if (i >= s_hotreload.asset_count) {
+            mutex_unlock(&s_hotreload.lock);
+            break;
+        }
+
+        HotReloadAsset_t* asset  = &s_hotreload.assets[i];
+        HotReloadAsset_t  result = *asset;
+
+        // a newer version waits until the one being compiled is swapped in.
+        result.ready = asset->ready && !asset->compiling;
+
+        if (result.ready) {
+            // ownership of the loaded data moves to this thread.
+            asset->ready    = false;
+            asset->files[0] = asset->files[1] = (File_t) {0};
+            asset->pixels   = NULL;
+        }
+        mutex_unlock(&s_hotreload.lock);
+
+        if (asset->compiling) {
+            hotreload__finish_program(asset);
+            continue;
+        }
+
+        if (!result.ready) continue;
+
+        if (result.kind == HOTRELOAD_PROGRAM) {
+            // the driver keeps its own copy of the sources.
+            if (beginShaderProgramGL(result.files[0], result.files[1], &asset->compile)) {
+                asset->compiling = true;
+                hotreload__finish_program(asset);
+            } else {
+                printf("hotreload: couldn't create a program for %s + %s, keeping previous version\n",
+                       result.paths[0], result.paths[1]);
+            }
+        } else if (result.kind == HOTRELOAD_TEXTURE) {
+            materialTextureUpdatePixels(result.texture, result.pixels, result.width, result.height, result.channels);
+            printf("hotreload: reloaded %s (%dx%d)\n", result.paths[0], result.width, result.height);
+        }
+
+        hotreload__free_results(&result);
+    }
+}
+
+#endif // HOTRELOAD_IMPLEMENTATION
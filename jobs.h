@@ -0,0 +1,269 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "thread.h"
+
+// Small fixed-size worker pool.
+//
+// Jobs are plain function pointers pushed into one shared FIFO. A JobGroup_t counts the jobs
+// still in flight so the submitting thread can wait on a batch; jobs_wait() runs queued
+// jobs itself while it waits instead of sleeping. When the pool is not running jobs execute
+// inline on the calling thread, so every caller keeps working on single core setups.
+
+#ifndef JOBSAPI
+#   define JOBSAPI extern
+#endif
+
+#ifndef JOBS_QUEUE_CAPACITY
+#   define JOBS_QUEUE_CAPACITY 4096
+#endif
+
+#define JOBS_MAX_WORKERS 64
+
+typedef void (*job_fn)(void* user);
+typedef void (*job_range_fn)(int begin, int end, void* user);
+
+typedef struct JobGroup_st JobGroup_t;
+
+struct JobGroup_st {
+    atomic_int pending;
+};
+
+// worker_count <= 0 spawns one worker per core minus the calling thread.
+JOBSAPI bool jobs_init(int worker_count);
+JOBSAPI void jobs_shutdown(void);
+JOBSAPI int  jobs_worker_count(void);
+// index of the calling worker in [0, jobs_worker_count()), -1 for any other thread.
+JOBSAPI int  jobs_worker_index(void);
+
+JOBSAPI void jobs_submit(JobGroup_t* group, job_fn fn, void* user);
+JOBSAPI void jobs_wait(JobGroup_t* group);
+
+// splits [0, count) in batches of at least `min_batch` and blocks until all of them ran.
+JOBSAPI void jobs_parallel_for(int count, int min_batch, job_range_fn fn, void* user);
+
+#ifdef JOBS_IMPLEMENTATION
+
+typedef struct Job_st Job_t;
+
+struct Job_st {
+    job_fn      fn;
+    void*       user;
+    JobGroup_t* group;
+};
+
+static struct {
+    Mutex_t     lock;
+    CondVar_t   work_cv;    // signaled when a job is queued
+    CondVar_t   done_cv;    // broadcast when a group drains
+
+    Job_t       queue[JOBS_QUEUE_CAPACITY];
+    uint32_t    head;
+    uint32_t    count;
+
+    Thread_t    workers[JOBS_MAX_WORKERS];
+    int         worker_count;
+    atomic_bool running;
+} s_jobs;
+
+static _Thread_local int s_jobs_worker_index = -1;
+
+static void jobs__finish(Job_t job) {
+    if (!job.group) return;
+
+    if (atomic_fetch_sub(&job.group->pending, 1) == 1) {
+        // take the lock so a waiter can't miss the wake up between its check and its wait.
+        mutex_lock(&s_jobs.lock);
+        condvar_broadcast(&s_jobs.done_cv);
+        mutex_unlock(&s_jobs.lock);
+    }
+}
+
+// must be called with s_jobs.lock held.
+static bool jobs__pop(Job_t* out) {
+    if (s_jobs.count == 0) return false;
+
+    *out        = s_jobs.queue[s_jobs.head];
+    s_jobs.head = (s_jobs.head + 1) % JOBS_QUEUE_CAPACITY;
+    s_jobs.count--;
+
+    return true;
+}
+
+typedef struct { int index; } JobsWorkerArg_t;
+static JobsWorkerArg_t s_jobs_worker_args[JOBS_MAX_WORKERS];
+
+static int jobs__worker(void* user) {
+    s_jobs_worker_index = ((JobsWorkerArg_t*) user)->index;
+
+    for (;;) {
+        Job_t job;
+
+        mutex_lock(&s_jobs.lock);
+        while (s_jobs.count == 0 && atomic_load(&s_jobs.running)) {
+            condvar_wait(&s_jobs.work_cv, &s_jobs.lock);
+        }
+
+        bool has_job = jobs__pop(&job);
+        mutex_unlock(&s_jobs.lock);
+
+        if (!has_job) break; // shutting down and the queue is drained
+
+        job.fn(job.user);
+        jobs__finish(job);
+    }
+
+    return 0;
+}
+
+JOBSAPI bool jobs_init(int worker_count) {
+    if (atomic_load(&s_jobs.running)) return true;
+
+    if (worker_count <= 0) worker_count = thread_cpu_count() - 1;
+    if (worker_count < 1)  worker_count = 1;
+    if (worker_count > JOBS_MAX_WORKERS) worker_count = JOBS_MAX_WORKERS;
+
+    mutex_init(&s_jobs.lock);
+    condvar_init(&s_jobs.work_cv);
+    condvar_init(&s_jobs.done_cv);
+
+    s_jobs.head         = 0;
+    s_jobs.count        = 0;
+    s_jobs.worker_count = 0;
+    atomic_store(&s_jobs.running, true);
+
+    for (int i = 0; i < worker_count; ++i) {
+        s_jobs_worker_args[i].index = i;
+        if (!thread_create(&s_jobs.workers[i], jobs__worker, &s_jobs_worker_args[i])) break;
+        s_jobs.worker_count++;
+    }
+
+    if (s_jobs.worker_count == 0) {
+        atomic_store(&s_jobs.running, false);
+        return false;
+    }
+
+    return true;
+}
+
+JOBSAPI void jobs_shutdown(void) {
+    if (!atomic_load(&s_jobs.running)) return;
+
+    mutex_lock(&s_jobs.lock);
+    atomic_store(&s_jobs.running, false);
+    condvar_broadcast(&s_jobs.work_cv);
+    mutex_unlock(&s_jobs.lock);
+
+    for (int i = 0; i < s_jobs.worker_count; ++i) {
+        thread_join(&s_jobs.workers[i]);
+    }
+
+    s_jobs.worker_count = 0;
+    condvar_destroy(&s_jobs.work_cv);
+    condvar_destroy(&s_jobs.done_cv);
+    mutex_destroy(&s_jobs.lock);
+}
+
+JOBSAPI int jobs_worker_count(void) {
+    return atomic_load(&s_jobs.running) ? s_jobs.worker_count : 0;
+}
+
+JOBSAPI int jobs_worker_index(void) {
+    return s_jobs_worker_index;
+}
+
+JOBSAPI void jobs_submit(JobGroup_t* group, job_fn fn, void* user) {
+    if (!fn) return;
+
+    Job_t job = { .fn = fn, .user = user, .group = group };
+    if (group) atomic_fetch_add(&group->pending, 1);
+
+    if (atomic_load(&s_jobs.running)) {
+        mutex_lock(&s_jobs.lock);
+        if (s_jobs.count < JOBS_QUEUE_CAPACITY) {
+            s_jobs.queue[(s_jobs.head + s_jobs.count) % JOBS_QUEUE_CAPACITY] = job;
+            s_jobs.count++;
+            condvar_signal(&s_jobs.work_cv);
+            mutex_unlock(&s_jobs.lock);
+            return;
+        }
+        mutex_unlock(&s_jobs.lock);
+    }
+
+    // no pool or queue full: run it right here.
+    fn(user);
+    jobs__finish(job);
+}
+
+JOBSAPI void jobs_wait(JobGroup_t* group) {
+    if (!group) return;
+
+    while (atomic_load(&group->pending) > 0) {
+        if (!atomic_load(&s_jobs.running)) {
+            thread_yield();
+            continue;
+        }
+
+        Job_t job;
+
+        mutex_lock(&s_jobs.lock);
+        bool has_job = jobs__pop(&job);
+        if (!has_job && atomic_load(&group->pending) > 0) {
+            condvar_wait(&s_jobs.done_cv, &s_jobs.lock);
+        }
+        mutex_unlock(&s_jobs.lock);
+
+        if (has_job) {
+            job.fn(job.user);
+            jobs__finish(job);
+        }
+    }
+}
+
+typedef struct JobsRange_st {
+    job_range_fn fn;
+    void*        user;
+    int          begin;
+    int          end;
+} JobsRange_t;
+
+static void jobs__run_range(void* user) {
+    JobsRange_t* range = (JobsRange_t*) user;
+    range->fn(range->begin, range->end, range->user);
+}
+
+JOBSAPI void jobs_parallel_for(int count, int min_batch, job_range_fn fn, void* user) {
+    if (count <= 0 || !fn) return;
+    if (min_batch < 1) min_batch = 1;
+
+    // a few batches per thread keeps everyone busy when batches take uneven time.
+    enum { MAX_BATCHES = 256 };
+    int threads = jobs_worker_count() + 1;
+    int batches = threads * 4;
+
+    if (batches > MAX_BATCHES)        batches = MAX_BATCHES;
+    if (batches > count / min_batch)  batches = count / min_batch;
+    if (batches < 1)                  batches = 1;
+
+    if (batches == 1) {
+        fn(0, count, user);
+        return;
+    }
+
+    JobsRange_t ranges[MAX_BATCHES];
+    JobGroup_t  group = {0};
+    int         step  = (count + batches - 1) / batches;
+
+    int n = 0;
+    for (int begin = 0; begin < count; begin += step) {
+        int end   = begin + step < count ? begin + step : count;
+        ranges[n] = (JobsRange_t) { .fn = fn, .user = user, .begin = begin, .end = end };
+        jobs_submit(&group, jobs__run_range, &ranges[n]);
+        n++;
+    }
+
+    jobs_wait(&group);
+}
+
+#endif // JOBS_IMPLEMENTATION
@@ -1,11 +1,13 @@
 #pragma once
 #include <stdint.h>
-#include <stdio.h> // snprintf
 #include "engine_math.h"
 #include "gl_gfx.h"
+#include "pool.h"
+#include "profiler.h"
 
 
 typedef struct Light_st Light_t;
+typedef struct LightHandle_st LightHandle_t;
 typedef enum light_enum light_enum_t;
 
 struct Light_st {
@@ -25,75 +27,58 @@ struct Light_st {
     GLint  pos_loc;
 }; // struct Light_st
 
+// generation checked, 0 is no light.
+struct LightHandle_st {
+    uint32_t id;
+};
+
 enum light_enum {
     LIGHT_POINT,
     LIGHT_DIRECTIONAL,
     LIGHT_SPOT
 };
 
+// the size of the shader's lights[] array.
 #define MAX_LIGHTS 512
 #define LIGHTAPI static
 
-LIGHTAPI Light_t* createLight(vec3 position, Color color, light_enum_t type, GLProgram_t program);
-LIGHTAPI bool     updateLight(Light_t* light, GLProgram_t program);
+// Lights live in a pool, packed in the order the shader's lights[] array sees them: a light's
+// uniforms are those of its index in the pool, and destroying one moves the last light into its
+// place (and its uniforms with it). Light_t pointers from getLight() hold until the next create
+// or destroy.
+LIGHTAPI LightHandle_t createLight(vec3 position, Color color, light_enum_t type, GLProgram_t program);
+LIGHTAPI bool          destroyLight(LightHandle_t light, GLProgram_t program);
+// NULL once the light is destroyed.
+LIGHTAPI Light_t*      getLight(LightHandle_t light);
+// uploads the light's fields, false for a destroyed light.
+LIGHTAPI bool          updateLight(LightHandle_t light, GLProgram_t program);
+LIGHTAPI size_t        lightCount(void);
+// re-resolves every light's uniform locations against `program` and re-uploads them,
+// needed whenever the program is relinked (e.g. shader hot reload).
+LIGHTAPI void          rebindLights(GLProgram_t program);
+// destroys every light past the first `count`, the newest go first.
+LIGHTAPI void          truncateLights(size_t count, GLProgram_t program);
+// frees the pool, every handle becomes stale.
+LIGHTAPI void          shutdownLights(void);
 // LIGHTAPI void renderLight(Light_t* light, Camera_t* camera);
 
 
 #ifdef LIGHT_IMPLEMENTATION
 
-LIGHTAPI Light_t g_lightStack[MAX_LIGHTS];
-size_t  g_lightCount = 0;
-
-LIGHTAPI Light_t* createLight(vec3 position, Color color, light_enum_t type, GLProgram_t program) {
-    if (g_lightCount >= MAX_LIGHTS) {
-        return NULL;
-    }
-
-    Light_t light = {
-        .type      = type,
-        .color     = color,
-        .enabled   = true,
-        .pos       = position,
-        .intensity = 1.0f,
-        .dir       = {0.0f, 0.0f, -1.0f}
-    };
-
-    if (type == LIGHT_DIRECTIONAL) {
-        light.dir = vec3_norm(light.pos);
-        light.pos = vec3_init(0.0f, 0.0f, 0.0f);
-    }
-
-    int index = g_lightCount;
-    char uniformName[128];
-   
-    snprintf(uniformName, sizeof(uniformName), "lights[%d].enabled", index);
-    light.enabled_loc      = glGetUniformLocation(program.program, uniformName);
-    
-    snprintf(uniformName, sizeof(uniformName), "lights[%d].type", index);
-    light.type_loc      = glGetUniformLocation(program.program, uniformName);
-    
-    snprintf(uniformName, sizeof(uniformName), "lights[%d].color", index);
-    light.color_loc = glGetUniformLocation(program.program, uniformName);
-    
-    snprintf(uniformName, sizeof(uniformName), "lights[%d].intensity", index);
-    light.intensity_loc = glGetUniformLocation(program.program, uniformName);
-    
-    snprintf(uniformName, sizeof(uniformName), "lights[%d].dir", index);
-    light.dir_loc = glGetUniformLocation(program.program, uniformName);
-    
-    snprintf(uniformName, sizeof(uniformName), "lights[%d].pos", index);
-    light.pos_loc = glGetUniformLocation(program.program, uniformName);
-    
-    g_lightStack[g_lightCount++] = light;
-    Light_t* l_out = &(g_lightStack[g_lightCount - 1]);
-    
-    updateLight(l_out, program);
+static Pool_t s_lights;
 
-    return l_out;
+// locations come from the program's reflected uniform table, no name formatting or driver query.
+static void resolveLightUniforms(Light_t* light, int index, GLProgram_t program) {
+    light->enabled_loc   = programUniformElementLocation(&program, "lights", index, "enabled");
+    light->type_loc      = programUniformElementLocation(&program, "lights", index, "type");
+    light->color_loc     = programUniformElementLocation(&program, "lights", index, "color");
+    light->intensity_loc = programUniformElementLocation(&program, "lights", index, "intensity");
+    light->dir_loc       = programUniformElementLocation(&program, "lights", index, "dir");
+    light->pos_loc       = programUniformElementLocation(&program, "lights", index, "pos");
 }
 
-
-LIGHTAPI bool updateLight(Light_t* light, GLProgram_t program) {
+static bool uploadLight(const Light_t* light, GLProgram_t program) {
+    PROFILE_FUNCTION();
     if (!program.program) return false;
     
     // Update the light data in the GPU
@@ -113,9 +98,101 @@ LIGHTAPI bool updateLight(Light_t* light, GLProgram_t program) {
         glUniform3f(light->pos_loc, light->pos.x, light->pos.y, light->pos.z);
     
 
-    glUniform1i(program.light_count_loc, g_lightCount);
+    glUniform1i(program.light_count_loc, pool_count(&s_lights));
     glUseProgram(0);
 
+    renderStatsLightUpdate(pool_count(&s_lights));
+    return true;
+}
+
+static void uploadLightCount(GLProgram_t program) {
+    renderStatsLightCount(pool_count(&s_lights));
+
+    if (!program.program) return;
+
+    glUseProgram(program.program);
+    glUniform1i(program.light_count_loc, pool_count(&s_lights));
+    glUseProgram(0);
+}
+
+LIGHTAPI LightHandle_t createLight(vec3 position, Color color, light_enum_t type, GLProgram_t program) {
+    if (!s_lights.item_size) pool_init(&s_lights, "lights", sizeof(Light_t), MAX_LIGHTS, MEM_TAG_RENDER);
+
+    LightHandle_t handle = { pool_create(&s_lights) };
+    if (!handle.id) return handle;
+
+    Light_t* light = pool_get(&s_lights, handle.id);
+    *light = (Light_t) {
+        .type      = type,
+        .color     = color,
+        .enabled   = true,
+        .pos       = position,
+        .intensity = 1.0f,
+        .dir       = {0.0f, 0.0f, -1.0f}
+    };
+
+    if (type == LIGHT_DIRECTIONAL) {
+        light->dir = vec3_norm(light->pos);
+        light->pos = vec3_init(0.0f, 0.0f, 0.0f);
+    }
+
+    resolveLightUniforms(light, pool_index(&s_lights, handle.id), program);
+    uploadLight(light, program);
+
+    return handle;
+}
+
+LIGHTAPI bool destroyLight(LightHandle_t light, GLProgram_t program) {
+    uint32_t index = pool_index(&s_lights, light.id);
+    if (!pool_destroy(&s_lights, light.id)) return false;
+
+    // the last light took the hole, it now answers to the hole's uniforms.
+    Light_t* moved = pool_at(&s_lights, index);
+    if (moved) {
+        resolveLightUniforms(moved, index, program);
+        uploadLight(moved, program);
+    } else {
+        uploadLightCount(program);
+    }
+
     return true;
 }
-#endif // LIGHT_IMPLEMENTATION
\ No newline at end of file
+
+LIGHTAPI Light_t* getLight(LightHandle_t light) {
+    return pool_get(&s_lights, light.id);
+}
+
+LIGHTAPI bool updateLight(LightHandle_t light, GLProgram_t program) {
+    Light_t* l = pool_get(&s_lights, light.id);
+    return l && uploadLight(l, program);
+}
+
+LIGHTAPI size_t lightCount(void) {
+    return pool_count(&s_lights);
+}
+
+LIGHTAPI void rebindLights(GLProgram_t program) {
+    for (uint32_t i = 0; i < pool_count(&s_lights); ++i) {
+        Light_t* light = pool_at(&s_lights, i);
+
+        resolveLightUniforms(light, i, program);
+        uploadLight(light, program);
+    }
+}
+
+LIGHTAPI void truncateLights(size_t count, GLProgram_t program) {
+    if (count >= pool_count(&s_lights)) return;
+
+    // the last one each time, nothing moves.
+    while (pool_count(&s_lights) > count) {
+        pool_destroy(&s_lights, pool_handle_at(&s_lights, pool_count(&s_lights) - 1));
+    }
+
+    uploadLightCount(program);
+}
+
+LIGHTAPI void shutdownLights(void) {
+    pool_release(&s_lights);
+    renderStatsLightCount(0);
+}
+#endif // LIGHT_IMPLEMENTATION
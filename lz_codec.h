@@ -0,0 +1,188 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// Byte oriented LZ77 codec, LZ4 block format.
+//
+// A block is a run of sequences: a token (literal count in the high nibble, match length - 4 in
+// the low one, 15 meaning "more length bytes follow"), the literals, a 16 bit little endian
+// match offset and the extra match length bytes. The last sequence carries literals only.
+// Decoding is a couple of memcpys per sequence, which is why it's used for pack entries:
+// GB/s per core, far faster than the disk it saves reads from. The compressor is a
+// single probe hash table, fast rather than tight.
+
+// inline: the runtime only decodes, the builder only encodes, neither warns about the other half.
+#define LZCODECAPI static inline
+
+#define LZ_MIN_MATCH     4
+#define LZ_MAX_OFFSET    65535
+#define LZ_HASH_BITS     14
+// the format's end of block rules: the last 5 bytes are literals, no match starts in the last 12.
+#define LZ_LAST_LITERALS 5
+#define LZ_MATCH_LIMIT   12
+
+// worst case output size, for incompressible input.
+LZCODECAPI size_t lz_compress_bound(size_t size);
+// returns the compressed size, 0 if it doesn't fit in `dst_capacity`.
+LZCODECAPI size_t lz_compress(const void* src, size_t src_size, void* dst, size_t dst_capacity);
+// `dst_size` is the exact decompressed size. False on malformed or truncated input, never
+// reads or writes out of bounds.
+LZCODECAPI bool   lz_decompress(const void* src, size_t src_size, void* dst, size_t dst_size);
+
+#ifdef LZCODEC_IMPLEMENTATION
+
+LZCODECAPI size_t lz_compress_bound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+static uint32_t lz__read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t lz__hash(uint32_t v) {
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static uint8_t* lz__write_length(uint8_t* op, size_t length) {
+    for (; length >= 255; length -= 255) *op++ = 255;
+    *op++ = (uint8_t) length;
+    return op;
+}
+
+static uint8_t* lz__write_sequence(uint8_t* op, const uint8_t* oend, const uint8_t* literals, size_t literal_count,
+                                   size_t offset, size_t match_length) {
+    size_t match_code = match_length ? match_length - LZ_MIN_MATCH : 0;
+    size_t worst      = 1 + literal_count / 255 + 1 + literal_count + 2 + match_code / 255 + 1;
+    if ((size_t)(oend - op) < worst) return NULL;
+
+    uint8_t* token = op++;
+    *token = (uint8_t)((literal_count < 15 ? literal_count : 15) << 4);
+    if (literal_count >= 15) op = lz__write_length(op, literal_count - 15);
+
+    memcpy(op, literals, literal_count);
+    op += literal_count;
+
+    if (!match_length) return op;
+
+    *op++ = (uint8_t)(offset & 0xFF);
+    *op++ = (uint8_t)(offset >> 8);
+
+    *token |= (uint8_t)(match_code < 15 ? match_code : 15);
+    if (match_code >= 15) op = lz__write_length(op, match_code - 15);
+
+    return op;
+}
+
+LZCODECAPI size_t lz_compress(const void* src, size_t src_size, void* dst, size_t dst_capacity) {
+    const uint8_t* base   = (const uint8_t*) src;
+    const uint8_t* ip     = base;
+    const uint8_t* anchor = base;
+    const uint8_t* iend   = base + src_size;
+    uint8_t*       op     = (uint8_t*) dst;
+    const uint8_t* oend   = op + dst_capacity;
+
+    // positions relative to `base`; a stale or zero slot is caught by the byte compare.
+    uint32_t table[1 << LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    if (src_size > LZ_MATCH_LIMIT) {
+        const uint8_t* mflimit    = iend - LZ_MATCH_LIMIT;
+        const uint8_t* matchlimit = iend - LZ_LAST_LITERALS;
+
+        while (ip < mflimit) {
+            uint32_t       sequence  = lz__read32(ip);
+            uint32_t       h         = lz__hash(sequence);
+            const uint8_t* candidate = base + table[h];
+            table[h] = (uint32_t)(ip - base);
+
+            if (candidate >= ip || ip - candidate > LZ_MAX_OFFSET || lz__read32(candidate) != sequence) {
+                ip++;
+                continue;
+            }
+
+            // grow the match backwards over literals that repeat too.
+            while (ip > anchor && candidate > base && ip[-1] == candidate[-1]) { ip--; candidate--; }
+
+            const uint8_t* match_end = ip + LZ_MIN_MATCH;
+            const uint8_t* ref       = candidate + LZ_MIN_MATCH;
+            while (match_end < matchlimit && *match_end == *ref) { match_end++; ref++; }
+
+            op = lz__write_sequence(op, oend, anchor, (size_t)(ip - anchor), (size_t)(ip - candidate), (size_t)(match_end - ip));
+            if (!op) return 0;
+
+            ip     = match_end;
+            anchor = ip;
+
+            if (ip < mflimit) table[lz__hash(lz__read32(ip - 2))] = (uint32_t)(ip - 2 - base);
+        }
+    }
+
+    op = lz__write_sequence(op, oend, anchor, (size_t)(iend - anchor), 0, 0);
+    return op ? (size_t)(op - (uint8_t*) dst) : 0;
+}
+
+LZCODECAPI bool lz_decompress(const void* src, size_t src_size, void* dst, size_t dst_size) {
+    const uint8_t* ip     = (const uint8_t*) src;
+    const uint8_t* iend   = ip + src_size;
+    uint8_t*       op     = (uint8_t*) dst;
+    uint8_t*       ostart = op;
+    uint8_t*       oend   = op + dst_size;
+
+    while (ip < iend) {
+        uint8_t token   = *ip++;
+        size_t  literal = token >> 4;
+
+        if (literal == 15) {
+            uint8_t b;
+            do {
+                if (ip >= iend) return false;
+                b        = *ip++;
+                literal += b;
+            } while (b == 255);
+        }
+
+        if (literal > (size_t)(iend - ip) || literal > (size_t)(oend - op)) return false;
+        memcpy(op, ip, literal);
+        ip += literal;
+        op += literal;
+
+        // the last sequence stops after its literals.
+        if (ip == iend) break;
+
+        if (iend - ip < 2) return false;
+        size_t offset = (size_t) ip[0] | ((size_t) ip[1] << 8);
+        ip += 2;
+
+        if (offset == 0 || offset > (size_t)(op - ostart)) return false;
+
+        size_t length = token & 15;
+        if (length == 15) {
+            uint8_t b;
+            do {
+                if (ip >= iend) return false;
+                b       = *ip++;
+                length += b;
+            } while (b == 255);
+        }
+        length += LZ_MIN_MATCH;
+
+        if (length > (size_t)(oend - op)) return false;
+
+        const uint8_t* match = op - offset;
+        if (offset >= length) {
+            memcpy(op, match, length);
+            op += length;
+        } else {
+            // overlapping copy repeats the last `offset` bytes.
+            for (size_t i = 0; i < length; ++i) *op++ = match[i];
+        }
+    }
+
+    return op == oend;
+}
+
+#endif // LZCODEC_IMPLEMENTATION
@@ -1,6 +1,10 @@
-#include <windows.h>
-#include <mmsystem.h>
+#if defined(_WIN32)
+#   include <windows.h>
+#   include <mmsystem.h>
+#endif // defined(_WIN32)
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <stdint.h>
 #include <math.h>
 #include <stdbool.h>
@@ -11,6 +15,18 @@
 
 #include "game.h"
 
+#define ALLOCATOR_IMPLEMENTATION
+#include "allocator.h"
+
+#define ARENA_IMPLEMENTATION
+#include "arena.h"
+
+#define POOL_IMPLEMENTATION
+#include "pool.h"
+
+#define PROFILER_IMPLEMENTATION
+#include "profiler.h"
+
 #define AUDIO_IMPLEMENTATION
 #include "audio.h"
 
@@ -19,6 +35,13 @@
 #define DEFAULT_ROTMODE ROTMODE_QUATERNION
 #define VERTEX_STRIDE 11
 
+#define SHADER_ARROW_VS     "./shaders/arrow.vs"
+#define SHADER_ARROW_FS     "./shaders/arrow.fs"
+#define SHADER_QUAD_VS      "./shaders/quad.vs"
+#define SHADER_QUAD_FS      "./shaders/quad.fs"
+#define SHADER_DEFAULT_VS   "./shaders/default.vs"
+#define SHADER_DEFAULT_FS   "./shaders/default.fs"
+
 
 #if !defined(_WIN32)
     #include <time.h>
@@ -26,6 +49,9 @@
 
 #if defined(_WIN32)
 #   include <GL/wglext.h>
+#else
+#   include <EGL/egl.h>
+#   include <EGL/eglext.h>
 #endif // defined(_WIN32)
 
 uint64_t get_time_ns();
@@ -41,6 +67,28 @@ static HGLRC s_hglrc;
 static HDC   s_hdc;
 static HINSTANCE hInstance;
 
+#else
+
+// Headless: no window system. A surfaceless EGL context (Mesa's llvmpipe is enough, no GPU or
+// display needed) renders into an offscreen framebuffer standing in for the window's, and the
+// frame loop runs a fixed number of frames with no input.
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#   define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+#define HEADLESS_DEFAULT_FRAMES 600
+
+// the Win32 virtual keys the camera controls are mapped to.
+#define VK_SPACE  0x20
+#define VK_LSHIFT 0xA0
+
+static EGLDisplay s_eglDisplay = EGL_NO_DISPLAY;
+static EGLContext s_eglContext = EGL_NO_CONTEXT;
+static GLuint     s_backbuffer;
+static GLuint     s_backbufferColor;
+static GLuint     s_backbufferDepth;
+
 #endif // defined(_WIN32)
 
 // @deprecated
@@ -65,15 +113,41 @@ struct Window_st {
 static bool     init_platform();
 static Window   create_window(size_t width, size_t height, const char* title);
 static bool     create_opengl_context(Window window);
+static void     destroy_opengl_context(Window window);
+// binds the context to the calling thread, or releases it from it.
+static bool     make_context_current(Window window, bool current);
+// the framebuffer that ends up on screen, 0 unless it's offscreen.
+static GLuint   window_framebuffer(Window window);
+static void     swap_buffers(Window window);
+
+static void     print_frame_timings(const uint64_t* frame_ns, int count);
 
 GLuint          compile_shader(const char* src, GLenum type);
 
 #define FILE_IMPLEMENTATION
 #include "file.h"
 
+#define RENDERSTATS_IMPLEMENTATION
+#include "render_stats.h"
+
 #define GLGFX_IMPLEMENTATION
 #include "gl_gfx.h"
 
+#define COOKEDTEX_IMPLEMENTATION
+#include "cooked_texture.h"
+
+#define GPURES_IMPLEMENTATION
+#include "gpu_resources.h"
+
+#define GPUPROF_IMPLEMENTATION
+#include "gpu_profiler.h"
+
+#define MATERIAL_IMPLEMENTATION
+#include "material.h"
+
+#define RENDERCMD_IMPLEMENTATION
+#include "render_commands.h"
+
 typedef struct QuadMesh_st  QuadMesh;
 typedef struct Camera_st Camera_t;
 
@@ -97,7 +171,7 @@ struct Camera_st {
 
 
 struct QuadMesh_st {
-    GLuint program;
+    GLProgram_t program;
     GLint  texture_loc;
     GLuint texture;
     GLuint vbo;
@@ -105,6 +179,8 @@ struct QuadMesh_st {
 };
 
 typedef struct Mesh_st Mesh_t;
+typedef struct MeshHandle_st MeshHandle_t;
+typedef struct MeshDraw_st MeshDraw_t;
 typedef struct Transform_st Transform;
 
 struct Transform_st {
@@ -122,9 +198,12 @@ struct Mesh_st {
     GLProgram_t program;
     GLuint      vao;
     GLuint      vbo;
+    GLuint      normal_vbo;
+    GLuint      uv_vbo;
     GLuint      tangent_vbo;
+    int         gpu_resource;
 
-    // memory buffers
+    // memory buffers, also what evicted buffers are rebuilt from; NULL after meshDropCpuCopy()
     float*      vertices;
     float*      tangents;
 
@@ -132,28 +211,58 @@ struct Mesh_st {
     size_t      index_count;
     size_t      vertex_count;
     Transform   transform;
-    Mat4        localToWorld;
-    Texture_t   textures[TEXTURE_COUNT];
+    Material_t  material;
+    float       bounds_radius;  // local space, around the origin
     bool        noColorAttrib;
     bool        hasTangentAttrib; 
     bool        showTangentSpace;
+    bool        evictable;       // its buffers are rebuilt from the CPU copy
     Color       color;
 };
 
-void        setQuadMeshProgram(QuadMesh* mesh, GLuint program);
+// Meshes live in a pool and are passed around by handle, 0 is no mesh. Mesh_t pointers from
+// meshGet() hold until the next mesh is created or destroyed.
+struct MeshHandle_st {
+    uint32_t id;
+};
+
+// a mesh that passed culling, with what the simulation side worked out for it. Draw lists are
+// built by collectMeshDraws() and drawn by renderMeshDraws(), possibly on another thread: the
+// draw only reads the mesh's GL state and material, never its transform.
+struct MeshDraw_st {
+    Mesh_t* mesh;
+    Mat4    world;          // M = T * S * R
+    float   screen_size;    // rough on-screen diameter in pixels
+};
+
+void        setQuadMeshProgram(QuadMesh* mesh, GLProgram_t program);
 void        renderQuad(QuadMesh mesh);
 
 bool        meshSetupGLBuffers(Mesh_t * mesh, float* vbo_buffer, size_t buff_size);
 bool        meshSetupGLBuffers_Raylib(Mesh_t* mesh, float* vertices, float* normals, float* texcoords, float vertex_count);
 void        meshInit(Mesh_t* mesh);
-QuadMesh    createQuadMesh(size_t texture_width, size_t texture_height, GLuint program);
-Mesh_t      createTriangleMesh(vec3 v1, vec3 v2, vec3 v3, Color color, GLProgram_t program);
-Mesh_t      createSphereMesh(float radius, int rings, int slices, Color color, GLProgram_t program);
-Mesh_t      createCubeMesh(float width, float height, float depth, Color color, GLProgram_t program);
-void        renderMesh(Mesh_t m, Camera_t* camera);
+void        meshEnableEviction(MeshHandle_t mesh);
+// frees the CPU copy once the buffers are uploaded, only the bounds stay. Refused for meshes that
+// still need it: evictable ones and ones drawing their tangent arrows.
+bool        meshDropCpuCopy(MeshHandle_t mesh);
+Mesh_t*     meshGet(MeshHandle_t mesh);
+void        meshDestroy(MeshHandle_t mesh);
+// destroys what's left and frees the pool.
+void        meshesShutdown(void);
+QuadMesh    createQuadMesh(size_t texture_width, size_t texture_height, GLProgram_t program);
+MeshHandle_t createTriangleMesh(vec3 v1, vec3 v2, vec3 v3, Color color, GLProgram_t program);
+MeshHandle_t createSphereMesh(float radius, int rings, int slices, Color color, GLProgram_t program);
+MeshHandle_t createCubeMesh(float width, float height, float depth, Color color, GLProgram_t program);
+void        recordMesh(RenderCommandList_t* list, const MeshDraw_t* draw, uint64_t key, uint32_t order, const Camera_t* camera);
+void        renderTangentArrows(const MeshDraw_t* draw, Camera_t* camera);
+// `camera` with its matrices computed. Returns the number of draws written; meshes outside the
+// view are added to `culled`, visible ones past `capacity` to `dropped`.
+size_t      collectMeshDraws(Mesh_t** meshes, size_t count, const Camera_t* camera, MeshDraw_t* draws, size_t capacity,
+                             size_t* culled, size_t* dropped);
+void        renderMeshDraws(const MeshDraw_t* draws, size_t count, Camera_t* camera);
 
 Camera_t    camera_init(vec3 position, vec3 target, float near_plane, float far_plane, float fov);
-void        update_camera(Camera_t* camera);
+void        update_camera(Camera_t* camera, float dt);
 void        camera_compute_matrices(Camera_t* camera);
 void        camera_compute_viewmatrix(Camera_t* camera);
 void        camera_compute_projmatrix(Camera_t* camera);
@@ -162,12 +271,48 @@ vec3        screen_to_camera(Camera_t* camera, long screenX, long screenY);
 #define LIGHT_IMPLEMENTATION
 #include "light.h"
 
+// decoded images are charged to the assets tag like the rest of the loaders' memory.
+#define STBI_MALLOC(size)       mem_alloc(MEM_TAG_ASSETS, (size))
+#define STBI_REALLOC(ptr, size) mem_realloc(MEM_TAG_ASSETS, (ptr), (size))
+#define STBI_FREE(ptr)          mem_free(ptr)
 #define STB_IMAGE_IMPLEMENTATION
 #include "deps/stb_image/stb_image.h"
 
-// io utils
+#define THREAD_IMPLEMENTATION
+#include "thread.h"
 
-Texture_t loadTextureFromFile(const char * filePath);
+#define JOBS_IMPLEMENTATION
+#include "jobs.h"
+
+#define LZCODEC_IMPLEMENTATION
+#include "lz_codec.h"
+
+#define PACK_IMPLEMENTATION
+#include "pack.h"
+
+#define ASYNCIO_IMPLEMENTATION
+#include "async_io.h"
+
+#define ASSETREGISTRY_IMPLEMENTATION
+#include "asset_registry.h"
+
+#define HOTRELOAD_IMPLEMENTATION
+#include "hotreload.h"
+
+#define ASSETLOADER_IMPLEMENTATION
+#include "asset_loader.h"
+
+#define TEXSTREAM_IMPLEMENTATION
+#include "texture_stream.h"
+
+#define BENCH_IMPLEMENTATION
+#include "bench.h"
+
+#define FRAMEPACING_IMPLEMENTATION
+#include "frame_pacing.h"
+
+#define RENDERTHREAD_IMPLEMENTATION
+#include "render_thread.h"
 
 
 // keyboard and mouse
@@ -189,6 +334,10 @@ typedef struct MouseState_st MouseState;
 
 void print_mouse_state();
 
+// hot reload callbacks
+void onDefaultProgramReload(GLProgram_t* program, void* user);
+void onQuadProgramReload(GLProgram_t* program, void* user);
+
 // -- engine constants & state. --
 GLuint      g_arrowVBO;
 GLuint      g_arrowVAO;
@@ -212,12 +361,129 @@ KeyState keyState[] = {
 MouseState mouseState;
 Window window;
 
-GLint  cameraPosLoc;
-Mesh_t cube;
-Mesh_t sphere;
-Mesh_t floorMesh;
+MeshHandle_t cube;
+MeshHandle_t sphere;
+MeshHandle_t floorMesh;
+
+static Pool_t s_meshes;
+// mesh draws are recorded into it on the job pool, then replayed by the GL thread.
+static RenderCommandQueue_t s_renderCommands;
+
+// draws recorded per job, smaller draw lists are recorded on the GL thread.
+#define MESH_RECORD_BATCH 64
+
+#define RENDER_STATS_CSV_PATH     "render_stats.csv"
+#define RENDER_STATS_CSV_INTERVAL 120
+
+#define ALLOC_CHECK_WARMUP_FRAMES 30
+
+// radians per second of simulation time.
+#define LIGHT_ORBIT_SPEED         (0.6f * M_PI)
+// world units per second.
+#define CAMERA_SPEED              3.0f
+
+#define PROFILER_TRACE_PATH "trace.json"
+// F9, the trace is written at the end of the frame.
+static bool     s_traceRequested;
+
+#define FRAME_PACKET_MAX_DRAWS   1024
+#define FRAME_PACKET_MAX_LIGHTS  16
+
+typedef struct LightUpdate_st   LightUpdate_t;
+typedef struct FramePacket_st   FramePacket_t;
+typedef struct FrameRenderer_st FrameRenderer_t;
+
+struct LightUpdate_st {
+    LightHandle_t light;
+    vec3          pos;
+};
+
+// what the render thread gets of a frame, copied out of the simulation so it can go on with the
+// next one. Meshes are pointed at, not copied: none are created or destroyed while the render
+// thread runs, and draws don't read what the simulation writes.
+struct FramePacket_st {
+    int           frame;
+    Camera_t      camera;           // matrices computed
+    size_t        draw_count;
+    size_t        culled_count;
+    size_t        dropped_count;
+    size_t        light_count;
+    LightUpdate_t lights[FRAME_PACKET_MAX_LIGHTS];
+    MeshDraw_t    draws[FRAME_PACKET_MAX_DRAWS];
+};
+
+// the GL side of main(), used from the render thread once it has started: lights, hot reload,
+// texture streaming and everything GL belong to it from then on.
+struct FrameRenderer_st {
+    GLProgram_t* program;           // lights are uploaded into it, hot reload replaces it
+    QuadMesh*    quad;
+    GLuint       hdrFramebuffer;
+    uint64_t*    frameTimes;
+    int          frameLimit;
+#if defined(_WIN32)
+    // the stats overlay. The title is set by the window's thread, SetWindowText() from another
+    // one waits for it.
+    Mutex_t      titleLock;
+    char         title[256];
+    bool         titleChanged;
+#endif // defined(_WIN32)
+};
+
+static void renderFramePacket(void* packet, void* user);
+static bool renderContextCurrent(bool current, void* user);
+
+static MeshHandle_t meshAdd(Mesh_t* mesh);
+static void renderFrame(MeshDraw_t* draws, size_t count, Camera_t* camera, GLuint hdrFramebuffer, QuadMesh quad);
+static bool runBenchmarks(const char* outputPath, int frameOverride, GLProgram_t program, Material_t cubeMaterial, GLuint hdrFramebuffer, QuadMesh quad);
+
+int main(int argc, char** argv) {
+    // --frames N: render N frames, print their timings and quit. Headless builds always stop.
+    // --bench [out.json]: run the flythrough scenarios in bench.h instead, --frames overrides
+    //                     their frame count.
+    // --trace [out.json]: write the profiler's Chrome trace on exit.
+    // --stats [out.csv]: append render stats percentiles every RENDER_STATS_CSV_INTERVAL frames.
+    // --check-allocs: fail if a frame past ALLOC_CHECK_WARMUP_FRAMES allocated from the heap.
+    // --fps N: frame rate to pace to, 0 draws frames back to back. FPS by default.
+    // --no-render-thread: draw each frame on the main thread as soon as it's simulated.
+#if defined(_WIN32)
+    int frameLimit = 0;
+#else
+    int frameLimit = HEADLESS_DEFAULT_FRAMES;
+#endif // defined(_WIN32)
+    int         frameOverride = 0;
+    const char* benchOutput   = NULL;
+    const char* traceOutput   = NULL;
+    const char* statsOutput   = NULL;
+    bool        checkAllocs   = false;
+    int         targetFps     = FPS;
+    bool        renderThreaded = true;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frameLimit    = atoi(argv[++i]);
+            frameOverride = frameLimit;
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            benchOutput = i + 1 < argc && argv[i + 1][0] != '-' ? argv[++i] : "bench.json";
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            traceOutput = i + 1 < argc && argv[i + 1][0] != '-' ? argv[++i] : PROFILER_TRACE_PATH;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            statsOutput = i + 1 < argc && argv[i + 1][0] != '-' ? argv[++i] : RENDER_STATS_CSV_PATH;
+        } else if (strcmp(argv[i], "--check-allocs") == 0) {
+            checkAllocs = true;
+        } else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            targetFps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--no-render-thread") == 0) {
+            renderThreaded = false;
+        }
+    }
+
+    profiler_init();
+    profiler_set_thread_name("main");
+
+    if (statsOutput) renderStatsOpenCsv(statsOutput, RENDER_STATS_CSV_INTERVAL);
+
+    frame_arena_init(ARENA_FRAME_BLOCK);
 
-int main() {
     AudioDevice* device = audio_init_device();
     init_platform();
 
@@ -232,6 +498,8 @@ int main() {
         return -1;
     }
 
+    gpuProfilerInit();
+
     glGenBuffers(1, &g_arrowVBO);
     glBindBuffer(GL_ARRAY_BUFFER, g_arrowVBO);
     glBufferData(GL_ARRAY_BUFFER, 2 * 3 * sizeof(float), NULL, GL_DYNAMIC_DRAW);
@@ -244,83 +512,106 @@ int main() {
     glBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    File_t arrow_vs_file = read_file("./shaders/arrow.vs");
-    File_t arrow_fs_file = read_file("./shaders/arrow.fs");
-    g_arrowProgram = createShaderProgramGL(arrow_vs_file, arrow_fs_file);
+    GLProgram_t quadProg    = {0};
+    GLProgram_t defaultProg = {0};
 
+    AssetHandle_t     diffuseMap, specularMap;
+    MaterialTexture_t brickDiffuseMap, brickNormalMap;
 
-    File_t quad_vs_file    = read_file("./shaders/quad.vs");
-    File_t quad_fs_file    = read_file("./shaders/quad.fs");
-    File_t default_vs_file = read_file("./shaders/default.vs");
-    File_t default_fs_file = read_file("./shaders/default.fs");
+    // Reads and image decodes run on the job pool, programs get compiled and
+    // textures uploaded here as soon as their data is ready.
+    // shipped builds read everything from the archive (`make package`), without one assets
+    // are loose files.
+    pack_mount("./assets" PACK_EXTENSION);
 
-    if (!quad_vs_file.data || !quad_fs_file.data) {
-        if (!quad_vs_file.data) printf("%s was not found.\n", quad_vs_file.file_path);
-        if (!quad_fs_file.data) printf("%s was not found.\n", quad_fs_file.file_path);
-        return -1;
-    }
+    jobs_init(0);
+    async_io_init(ASYNC_IO_DEFAULT_DEPTH);
+    gpuResourcesInit(GPU_RESOURCES_DEFAULT_BUDGET);
+    materialTexturesInit();
+    asset_registry_init(ASSET_REGISTRY_DEFAULT_BUDGET);
 
-    if (!default_vs_file.data || !default_fs_file.data) {
-        if (!default_vs_file.data) printf("%s was not found.\n", default_vs_file.file_path);
-        if (!default_fs_file.data) printf("%s was not found.\n", default_fs_file.file_path);
-        return -1;
-    }
+    StartupLoader_t loader;
+    startup_loader_begin(&loader);
 
-    Mat4 world = mat4_identity();
+    startup_loader_add_program(&loader, &g_arrowProgram, SHADER_ARROW_VS,   SHADER_ARROW_FS);
+    startup_loader_add_program(&loader, &quadProg,       SHADER_QUAD_VS,    SHADER_QUAD_FS);
+    startup_loader_add_program(&loader, &defaultProg,    SHADER_DEFAULT_VS, SHADER_DEFAULT_FS);
+
+    startup_loader_add_texture(&loader, &diffuseMap,      "./resources/container.png");
+    startup_loader_add_texture(&loader, &specularMap,     "./resources/SpecularMap2.png");
+
+    // startup_loader_add_texture(&loader, &brickDiffuseMap,  "./resources/wall2/wall-4-granite-DIFFUSE.jpg");
+    // startup_loader_add_texture(&loader, &brickNormalMap,   "./resources/wall2/wall-4-granite-NORMAL.jpg");
+    // startup_loader_add_texture(&loader, &brickSpecularMap, "./resources/wall2/wall-4-granite-SPECULAR.jpg");
+
+    bool assetsLoaded = startup_loader_finish(&loader);
+    startup_loader_print_timeline(&loader);
+    pack_print_stats();
+    async_io_print_stats();
 
-    GLuint quadProg         = createShaderProgramGL_(quad_vs_file, quad_fs_file);
-    QuadMesh quadMesh       = createQuadMesh(CANVAS_WIDTH, CANVAS_HEIGHT, quadProg);
+    if (!assetsLoaded) return -1;
 
-    GLProgram_t defaultProg = createShaderProgramGL(default_vs_file, default_fs_file);
+    // material textures stream in behind a placeholder, mips follow what is visible on screen.
+    textureStreamInit(TEXTURE_STREAM_DEFAULT_BUDGET);
+    brickDiffuseMap = textureStreamRequest("./resources/brick_diffuse_map.jpg");
+    brickNormalMap  = textureStreamRequest("./resources/brick_normal_map.jpg");
+
+    Mat4 world = mat4_identity();
 
     QuadMesh quad = createQuadMesh(CANVAS_WIDTH, CANVAS_HEIGHT, quadProg);
     sphere    = createSphereMesh(1.0f, 8, 8, (Color) {1.0f, 1.0f, 1.0f}, defaultProg);
     cube      = createCubeMesh(1.0f, 1.0f, 1.0f, (Color) {1.0f, 1.0f, 1.0f}, defaultProg);
-    cube.showTangentSpace = true;
-
     floorMesh = createCubeMesh(10.0f, 0.1f, 10.0f, (Color) {1.0f, 1.0f, 1.0f}, defaultProg);
-    floorMesh.noColorAttrib     = true;
-    floorMesh.color             = (Color) {1.0f, 1.0f, 1.0f};
 
-    sphere.transform.position.x = -2.0f;
+    if (!sphere.id || !cube.id || !floorMesh.id) {
+        printf("creating the scene meshes failed! Quitting.\n");
+        return -1;
+    }
 
-    Light_t* light1   = createLight((vec3) {1.0f, 1.0f, 1.0f}, (Color) {1.0f, 1.0f, 1.0f},   LIGHT_POINT,       defaultProg);
-    light1->intensity = 5.0f;
-    updateLight(light1, defaultProg);
+    meshGet(cube)->showTangentSpace = true;
 
-    Light_t* light2   = createLight((vec3) {-7.0f, 7.0f, -7.0f}, (Color) {1.0f, 1.0f, 1.0f}, LIGHT_POINT,       defaultProg);
-    Light_t* dirLight = createLight((vec3) {4.0f, -5.0f, 4.0f}, (Color) {
-        (float)0x87/255.0f, (float)0xCE/255.0f, (float)0xFA/255.0f
-    }, LIGHT_DIRECTIONAL, defaultProg);
+    meshGet(floorMesh)->noColorAttrib  = true;
+    meshGet(floorMesh)->color          = (Color) {1.0f, 1.0f, 1.0f};
+    meshGet(floorMesh)->transform.position.y = -.6f;
 
-    light2->intensity = 5.0f;
-    dirLight->intensity = .5f;
-    updateLight(light2, defaultProg);
-    updateLight(dirLight, defaultProg);
-
-    Texture_t diffuseMap                  = loadTextureFromFile("./resources/container.png");
-    Texture_t specularMap                 = loadTextureFromFile("./resources/SpecularMap2.png");
+    meshGet(sphere)->transform.position.x = -2.0f;
 
-    // Texture_t brickDiffuseMap             = loadTextureFromFile("./resources/wall2/wall-4-granite-DIFFUSE.jpg");
-    // Texture_t brickNormalMap              = loadTextureFromFile("./resources/wall2/wall-4-granite-NORMAL.jpg");
-    // Texture_t brickSpecularMap            = loadTextureFromFile("./resources/wall2/wall-4-granite-SPECULAR.jpg");
+    // both keep a CPU copy for the tangent arrows, their buffers can go while off screen.
+    meshEnableEviction(cube);
+    meshEnableEviction(floorMesh);
+    meshDropCpuCopy(sphere);
 
-    Texture_t brickDiffuseMap             = loadTextureFromFile("./resources/brick_diffuse_map.jpg");
-    Texture_t brickNormalMap              = loadTextureFromFile("./resources/brick_normal_map.jpg");
+    LightHandle_t light1   = createLight((vec3) {1.0f, 1.0f, 1.0f}, (Color) {1.0f, 1.0f, 1.0f},   LIGHT_POINT,       defaultProg);
+    LightHandle_t light2   = createLight((vec3) {-7.0f, 7.0f, -7.0f}, (Color) {1.0f, 1.0f, 1.0f}, LIGHT_POINT,       defaultProg);
+    LightHandle_t dirLight = createLight((vec3) {4.0f, -5.0f, 4.0f}, (Color) {
+        (float)0x87/255.0f, (float)0xCE/255.0f, (float)0xFA/255.0f
+    }, LIGHT_DIRECTIONAL, defaultProg);
 
-    cube.textures[TEXTURE_ALBEDO_MAP]     = brickDiffuseMap;
-    cube.textures[TEXTURE_NORMAL_MAP]     = brickNormalMap;
+    if (getLight(light1)) {
+        getLight(light1)->intensity = 5.0f;
+        getLight(light1)->pos.z     = -1.0f;
+        getLight(light1)->pos.y     = 1.0f;
+    }
+    if (getLight(light2))   getLight(light2)->intensity   = 5.0f;
+    if (getLight(dirLight)) getLight(dirLight)->intensity = .5f;
 
-    light1->pos.z = -1.0f;
-    light1->pos.y = 1.0f;
+    updateLight(light1,   defaultProg);
+    updateLight(light2,   defaultProg);
+    updateLight(dirLight, defaultProg);
 
-    cameraPosLoc  = glGetUniformLocation(defaultProg.program, "camera_pos");
+    meshGet(cube)->material.textures[TEXTURE_ALBEDO_MAP] = brickDiffuseMap;
+    meshGet(cube)->material.textures[TEXTURE_NORMAL_MAP] = brickNormalMap;
 
-    glUseProgram(defaultProg.program);
-    glUniform3f(cameraPosLoc, camera.position.x, camera.position.y, camera.position.z);    
-    glUseProgram(0);
+    if (hotreload_init()) {
+        hotreload_watch_program(&defaultProg,    SHADER_DEFAULT_VS, SHADER_DEFAULT_FS, onDefaultProgramReload, NULL);
+        hotreload_watch_program(&quadProg,       SHADER_QUAD_VS,    SHADER_QUAD_FS,    onQuadProgramReload,    &quad);
+        hotreload_watch_program(&g_arrowProgram, SHADER_ARROW_VS,   SHADER_ARROW_FS,   NULL,                   NULL);
 
-    floorMesh.transform.position.y     = -.6f;
+        hotreload_watch_texture(asset_registry_texture(diffuseMap),  "./resources/container.png");
+        hotreload_watch_texture(asset_registry_texture(specularMap), "./resources/SpecularMap2.png");
+        hotreload_watch_texture(brickDiffuseMap, "./resources/brick_diffuse_map.jpg");
+        hotreload_watch_texture(brickNormalMap,  "./resources/brick_normal_map.jpg");
+    }
 
     camera = camera_init(
         vec3_init(-2.0f, 1.0f, 3.0f), 
@@ -329,8 +620,9 @@ int main() {
         1000.0f,
         degtorad(60.0f)
     );
-
-    int sleepDelay = (int)((1.0f/(float)FPS)*1000.0f);
+    // packets compute their own copy, mouse look unprojects through this one. The canvas size is
+    // fixed, so it holds for the whole run.
+    camera_compute_projmatrix(&camera);
 
     glViewport(0, 0, CANVAS_WIDTH, CANVAS_HEIGHT);
 #if defined(_WIN32)
@@ -382,31 +674,80 @@ int main() {
     glBindRenderbuffer(GL_RENDERBUFFER, 0);
     glBindTexture(GL_TEXTURE_2D, 0);
 
+    gpuResourceTrack(GPU_RESOURCE_TEXTURE, hdrColorBuffer, (size_t) CANVAS_WIDTH * CANVAS_HEIGHT * 8, "hdr color");
+    gpuResourceTrack(GPU_RESOURCE_TEXTURE, hdrRbo,         (size_t) CANVAS_WIDTH * CANVAS_HEIGHT * 4, "hdr depth");
+
     quad.texture  = hdrColorBuffer;
     printf("texture loc: %d\n", quad.texture_loc);
-    float time = 0.0f;
-    while (true) {
-        uint64_t begin = get_time_ns();
+
+    bool benchOk = true;
+    if (benchOutput) {
+        benchOk    = runBenchmarks(benchOutput, frameOverride, defaultProg, meshGet(cube)->material, hdrFrameBuffer, quad);
+        frameLimit = -1;
+    }
+
+    uint64_t* frameTimes = frameLimit > 0 ? mem_calloc(MEM_TAG_GENERAL, (size_t) frameLimit, sizeof(uint64_t)) : NULL;
+
+    int allocatingFrames = 0;
+
+    FramePacer_t pacer;
+    frame_pacer_init(&pacer, targetFps, SIMULATION_RATE);
+
+    // simulation state after the last two steps, frames draw a blend of them.
+    float simTime            = 0.0f;
+    float prevSimTime        = 0.0f;
+    vec3  prevCameraPosition = camera.position;
+    vec3  prevCameraTarget   = camera.target;
+    vec3  orbitPosition      = getLight(light1) ? getLight(light1)->pos : vec3_init(0.0f);
+
+    FrameRenderer_t renderer = {
+        .program        = &defaultProg,
+        .quad           = &quad,
+        .hdrFramebuffer = hdrFrameBuffer,
+        .frameTimes     = frameTimes,
+        .frameLimit     = frameLimit
+    };
+#if defined(_WIN32)
+    mutex_init(&renderer.titleLock);
+#endif // defined(_WIN32)
+
+    RenderThread_t renderThread;
+    if (!renderThreadStart(&renderThread, sizeof(FramePacket_t), renderThreaded, renderFramePacket, renderContextCurrent, &renderer)) {
+        printf("renderThreadStart() failed! Quitting.\n");
+        return -1;
+    }
+
+    bool running = true;
+
+    for (int frame = 0; running && (frameLimit == 0 || frame < frameLimit); ++frame) {
+        PROFILE_ZONE("frame");
+        frame_pacer_begin(&pacer);
+
+        frame_arena_swap();
 
     #if defined(_WIN32)
         while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
-
-            switch(msg.message) {
-                case WM_QUIT: return 0;
+            if (msg.message == WM_QUIT) {
+                running = false;
+                break;
             }
             
             TranslateMessage(&msg);
             DispatchMessage(&msg);
         }
 
+        // the render thread still has frames queued, they get drawn before it stops.
+        if (!running) break;
+
         POINT pt;
         if (GetCursorPos(&pt)) {
             // ScreenToClient(window->_winHandle, &pt);
             
-            mouseState.deltaX = pt.x - mouseCenter.x;
-            mouseState.deltaY = pt.y - mouseCenter.y;
-            mouseState.x     += mouseState.deltaX;
-            mouseState.y     += mouseState.deltaY;
+            // summed until a simulation step consumes them, a frame may run none.
+            mouseState.deltaX += pt.x - mouseCenter.x;
+            mouseState.deltaY += pt.y - mouseCenter.y;
+            mouseState.x      += pt.x - mouseCenter.x;
+            mouseState.y      += pt.y - mouseCenter.y;
             
             SetCursorPos(mouseCenter.x, mouseCenter.y);
         }
@@ -418,63 +759,395 @@ int main() {
         }
 
     #endif // defined(_WIN32)
-        
-        time += .001f;
-        light1->pos.x = 4.0f * cosf(time * 2 * M_PI * 5.0f);
-        light1->pos.z = 4.0f * sinf(time * 2 * M_PI * 5.0f);
-        
-        updateLight(light1, defaultProg);
-        update_camera(&camera);
 
-        // First pass
-            
+        {
+            PROFILE_ZONE("simulate");
+
+            while (frame_pacer_step(&pacer)) {
+                prevSimTime        = simTime;
+                prevCameraPosition = camera.position;
+                prevCameraTarget   = camera.target;
+
+                simTime += (float) pacer.step_seconds;
+                update_camera(&camera, (float) pacer.step_seconds);
+
+                mouseState.deltaX = 0;
+                mouseState.deltaY = 0;
+            }
+        }
+
+        float alpha = frame_pacer_alpha(&pacer);
+
+        // waits while the render thread holds every packet.
+        FramePacket_t* packet = renderThreadBeginPacket(&renderThread);
+        {
+            PROFILE_ZONE("build packet");
+
+            packet->frame           = frame;
+            packet->camera          = camera;
+            packet->camera.position = vec3_lerp(prevCameraPosition, camera.position, alpha);
+            packet->camera.target   = vec3_lerp(prevCameraTarget,   camera.target,   alpha);
+            camera_compute_matrices(&packet->camera);
+
+            Mesh_t* sceneMeshes[] = { meshGet(cube), meshGet(sphere), meshGet(floorMesh) };
+
+            packet->culled_count  = 0;
+            packet->dropped_count = 0;
+            packet->draw_count    = collectMeshDraws(sceneMeshes, sizeof(sceneMeshes) / sizeof(sceneMeshes[0]), &packet->camera,
+                                                     packet->draws, FRAME_PACKET_MAX_DRAWS, &packet->culled_count, &packet->dropped_count);
+
+            float angle = (prevSimTime + (simTime - prevSimTime) * alpha) * LIGHT_ORBIT_SPEED;
+            orbitPosition.x = 4.0f * cosf(angle);
+            orbitPosition.z = 4.0f * sinf(angle);
+
+            packet->lights[0]   = (LightUpdate_t) { light1, orbitPosition };
+            packet->light_count = 1;
+        }
+        renderThreadSubmit(&renderThread);
+
+        // the render thread allocates into the same counters, with the check on its frame is
+        // drawn before they close so every frame is charged for what it drew.
+        if (checkAllocs) renderThreadFlush(&renderThread);
+
+        // streaming and caches have settled by the end of the warm up, from there on a frame
+        // gets by on the frame and scratch arenas.
+        uint64_t frameAllocs = mem_frame_allocs();
+        mem_end_frame();
+
+        if (checkAllocs && frame >= ALLOC_CHECK_WARMUP_FRAMES && frameAllocs) {
+            if (!allocatingFrames) printf("frame %d: %llu heap allocations\n", frame, (unsigned long long) frameAllocs);
+            allocatingFrames++;
+        }
+
+    #if defined(_WIN32)
+        char title[sizeof(renderer.title)];
+        bool titleChanged;
+
+        mutex_lock(&renderer.titleLock);
+        titleChanged = renderer.titleChanged;
+        if (titleChanged) memcpy(title, renderer.title, sizeof(title));
+        renderer.titleChanged = false;
+        mutex_unlock(&renderer.titleLock);
+
+        if (titleChanged) SetWindowTextA(window->_winHandle, title);
+    #endif // defined(_WIN32)
+
+        if (s_traceRequested) {
+            profiler_dump_chrome_trace(PROFILER_TRACE_PATH);
+            s_traceRequested = false;
+        }
+
+        {
+            PROFILE_ZONE("pace");
+            frame_pacer_wait(&pacer);
+        }
+    }
+
+    // draws what's still queued and takes the context back.
+    renderThreadStop(&renderThread);
+#if defined(_WIN32)
+    mutex_destroy(&renderer.titleLock);
+#endif // defined(_WIN32)
+
+    frame_pacer_shutdown(&pacer);
+
+    if (frameTimes) {
+        print_frame_timings(frameTimes, frameLimit);
+        mem_free(frameTimes);
+    }
+
+    if (checkAllocs) {
+        printf("allocation check: %d frames past the first %d allocated from the heap\n", allocatingFrames, ALLOC_CHECK_WARMUP_FRAMES);
+    }
+
+    renderStatsPrint();
+    frame_pacer_print(&pacer);
+    if (renderThread.producer_waits) {
+        printf("render thread: the simulation waited for a free packet %llu times\n", (unsigned long long) renderThread.producer_waits);
+    }
+    gpuProfilerPrint();
+    mem_print_stats();
+    if (traceOutput) profiler_dump_chrome_trace(traceOutput);
+
+    // destroy game
+    game_close();
+    hotreload_shutdown();
+    textureStreamShutdown();
+
+    asset_registry_release(diffuseMap);
+    asset_registry_release(specularMap);
+    asset_registry_print_stats();
+    asset_registry_shutdown();
+
+    meshDestroy(cube);
+    meshDestroy(sphere);
+    meshDestroy(floorMesh);
+    meshesShutdown();
+    shutdownLights();
+    renderCmdQueueRelease(&s_renderCommands);
+
+    destroyShaderProgramGL(&defaultProg);
+    destroyShaderProgramGL(&quadProg);
+    destroyShaderProgramGL(&g_arrowProgram);
+
+    materialTexturesShutdown();
+    async_io_shutdown();
+    jobs_shutdown();
+    profiler_shutdown();
+
+    gpuResourcesPrint();
+    gpuResourcesShutdown();
+    gpuProfilerShutdown();
+    renderStatsShutdown();
+    pack_unmount_all();
+    
+    destroy_opengl_context(window);
+    audio_close_device(device);
+
+#if defined(_WIN32)
+    DestroyWindow(window->_winHandle);
+#endif // defined(_WIN32)
+    mem_free(window);
+
+    frame_arena_shutdown();
+    scratch_shutdown();
+
+    mem_report_leaks();
+    return benchOk && allocatingFrames == 0 ? 0 : 1;
+}
+
+static void print_frame_timings(const uint64_t* frame_ns, int count) {
+    if (count <= 0) return;
+
+    for (int i = 0; i < count; ++i) {
+        printf("frame %5d %8.3f ms\n", i, frame_ns[i] / 1e6);
+    }
+
+    BenchFrameStats_t stats = bench_frame_stats(frame_ns, count);
+
+    printf("%d frames in %.2f ms, %.1f fps\n", count, stats.total / 1e6, count / (stats.total / 1e9));
+    printf("  avg %.3f | min %.3f | p50 %.3f | p95 %.3f | p99 %.3f | max %.3f ms\n",
+        stats.total / 1e6 / count, stats.min / 1e6, stats.p50 / 1e6, stats.p95 / 1e6, stats.p99 / 1e6, stats.max / 1e6);
+}
+
+// hdr scene pass, then the tonemapped quad into the window's framebuffer. `camera` has its
+// matrices computed.
+static void renderFrame(MeshDraw_t* draws, size_t count, Camera_t* camera, GLuint hdrFramebuffer, QuadMesh quad) {
+    PROFILE_FUNCTION();
+    gpuProfilerBeginFrame();
+
+    // First pass
+    {
+        GPU_PROFILE_ZONE("hdr scene");
+
         glEnable(GL_DEPTH_TEST);
-        glBindFramebuffer(GL_FRAMEBUFFER, hdrFrameBuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, hdrFramebuffer);
 
         glClearColor((float)0x87/255.0f, (float)0xCE/255.0f, (float)0xFA/255.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        
-        renderMesh(cube, &camera);
-        renderMesh(sphere, &camera);
-        renderMesh(floorMesh, &camera);
+        renderMeshDraws(draws, count, camera);
+    }
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, window_framebuffer(window));
+
+    // Second pass
+    {
+        GPU_PROFILE_ZONE("tonemap");
 
-        // Second pass
         glDisable(GL_DEPTH_TEST);
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // Render into quad
         renderQuad(quad);
+    }
 
-        
-        SwapBuffers(s_hdc);
-        
-        uint64_t end = get_time_ns();
+    gpuProfilerEndFrame();
+}
 
-        uint64_t ellapsed = (end - begin) / 1000000LL;
-        
-        if (ellapsed < 16) {
-        #if defined(_WIN32)
-            Sleep(sleepDelay - ellapsed);
-        #endif // defined(_WIN32)
-        }
+static bool renderContextCurrent(bool current, void* user) {
+    return make_context_current(window, current);
+}
+
+// a frame on the render thread: asset updates first, then the packet's light changes, then the
+// frame itself. Frame times are the render thread's, from here to the present.
+static void renderFramePacket(void* data, void* user) {
+    FramePacket_t*   packet   = (FramePacket_t*) data;
+    FrameRenderer_t* renderer = (FrameRenderer_t*) user;
+
+    PROFILE_ZONE("render frame");
+    uint64_t begin = get_time_ns();
+
+    // swap in any shader / texture edited since last frame.
+    hotreload_update();
+    textureStreamUpdate();
+
+    // a destroyed light's handle is stale, getLight() says so instead of handing out another light.
+    for (size_t i = 0; i < packet->light_count; ++i) {
+        Light_t* light = getLight(packet->lights[i].light);
+        if (!light) continue;
+
+        light->pos = packet->lights[i].pos;
+        updateLight(packet->lights[i].light, *renderer->program);
     }
 
-    // destroy game
-    game_close();
-    
-#if defined(_WIN32)
-    wglMakeCurrent(NULL, NULL);
-    wglDeleteContext(s_hglrc);
+    renderStatsMeshes(packet->draw_count, packet->culled_count, packet->dropped_count);
+    renderFrame(packet->draws, packet->draw_count, &packet->camera, renderer->hdrFramebuffer, *renderer->quad);
 
-    ReleaseDC((HWND) window, s_hdc);
-    waveOutClose((HWAVEOUT) device);
-    DestroyWindow(window->_winHandle);
+    swap_buffers(window);
+    gpuResourcesEndFrame();
+
+    uint64_t end = get_time_ns();
+    if (renderer->frameTimes && packet->frame < renderer->frameLimit) renderer->frameTimes[packet->frame] = end - begin;
+
+    renderStatsEndFrame(end - begin);
+
+#if defined(_WIN32)
+    // the window title doubles as the stats overlay.
+    if (packet->frame % RENDER_STATS_CSV_INTERVAL == 0) {
+        RenderStatsSummary_t frameNs = renderStatsSummarize(RENDER_STAT_FRAME_NS);
+        RenderStatsSummary_t draws   = renderStatsSummarize(RENDER_STAT_DRAWS);
+        RenderStatsSummary_t culled  = renderStatsSummarize(RENDER_STAT_MESHES_CULLED);
+
+        mutex_lock(&renderer->titleLock);
+        snprintf(renderer->title, sizeof(renderer->title), "%s | p50 %.2f ms p99 %.2f ms | %llu draws | %llu culled",
+            GAME_TITLE, frameNs.p50 / 1e6, frameNs.p99 / 1e6,
+            (unsigned long long) draws.p50, (unsigned long long) culled.p50);
+        renderer->titleChanged = true;
+        mutex_unlock(&renderer->titleLock);
+    }
 #endif // defined(_WIN32)
-    return 0;
+}
+
+// one scene per BENCH_SCENARIOS entry: cubes and spheres on a grid around the origin, point
+// lights spread over it, and the camera on BENCH_CAMERA_PATH scaled to the grid. The scene's
+// own lights are dropped for the duration.
+static bool runBenchmarks(const char* outputPath, int frameOverride, GLProgram_t program, Material_t cubeMaterial, GLuint hdrFramebuffer, QuadMesh quad) {
+    BenchResult_t results[BENCH_SCENARIO_COUNT] = {0};
+
+    for (size_t s = 0; s < BENCH_SCENARIO_COUNT; ++s) {
+        BenchScenario_t scenario = BENCH_SCENARIOS[s];
+        if (frameOverride > 0) scenario.frames = frameOverride;
+
+        int           meshCount = scenario.cubes + scenario.spheres;
+        MeshHandle_t* meshes    = mem_calloc(MEM_TAG_GENERAL, (size_t) meshCount, sizeof(MeshHandle_t));
+        Mesh_t**      meshList  = mem_calloc(MEM_TAG_GENERAL, (size_t) meshCount, sizeof(Mesh_t*));
+        MeshDraw_t*   drawList  = mem_calloc(MEM_TAG_GENERAL, (size_t) meshCount, sizeof(MeshDraw_t));
+        uint64_t*     frameNs   = mem_calloc(MEM_TAG_GENERAL, (size_t) scenario.frames, sizeof(uint64_t));
+
+        if (!meshes || !meshList || !drawList || !frameNs) {
+            mem_free(meshes);
+            mem_free(meshList);
+            mem_free(drawList);
+            mem_free(frameNs);
+            return false;
+        }
+
+        int   side   = (int) ceilf(sqrtf((float) meshCount));
+        float extent = side * BENCH_GRID_SPACING * 0.5f;
+
+        for (int i = 0; i < meshCount; ++i) {
+            Color color = { 0.4f + 0.6f * ((i * 37) % 11) / 10.0f, 0.4f + 0.6f * ((i * 17) % 7) / 6.0f, 0.8f };
+
+            meshes[i] = i < scenario.cubes ? createCubeMesh(1.0f, 1.0f, 1.0f, color, program)
+                                           : createSphereMesh(0.6f, 16, 16, color, program);
+
+            Mesh_t* mesh = meshGet(meshes[i]);
+            if (!mesh) continue;
+
+            if (i < scenario.cubes) mesh->material = cubeMaterial;
+            mesh->transform.position.x = (i % side) * BENCH_GRID_SPACING - extent;
+            mesh->transform.position.z = (i / side) * BENCH_GRID_SPACING - extent;
+
+            meshDropCpuCopy(meshes[i]);
+        }
+
+        // every mesh is in, the pool doesn't move them again until they're destroyed.
+        int listCount = 0;
+        for (int i = 0; i < meshCount; ++i) {
+            Mesh_t* mesh = meshGet(meshes[i]);
+            if (mesh) meshList[listCount++] = mesh;
+        }
+
+        truncateLights(0, program);
+        for (int i = 0; i < scenario.lights; ++i) {
+            float angle = i * 2.39996f;  // golden angle, an even spiral over the grid
+            float r     = extent * sqrtf((i + 0.5f) / scenario.lights);
+
+            LightHandle_t light = createLight((vec3) { r * cosf(angle), 1.5f, r * sinf(angle) }, (Color) {1.0f, 1.0f, 1.0f}, LIGHT_POINT, program);
+            if (!light.id) break;
+
+            getLight(light)->intensity = 3.0f;
+            updateLight(light, program);
+        }
+
+        Camera_t benchCamera = camera_init(vec3_init(0.0f), vec3_init(0.0f), 0.1f, 1000.0f, degtorad(60.0f));
+
+        int      total     = BENCH_WARMUP_FRAMES + scenario.frames;
+        uint64_t draws     = 0;
+        uint64_t triangles = 0;
+
+        for (int frame = 0; frame < total; ++frame) {
+            vec3 position, target;
+            bench_camera_path(BENCH_CAMERA_PATH, BENCH_CAMERA_KEY_COUNT, (float) frame / total, &position, &target);
+
+            benchCamera.position = vec3_scale(position, extent);
+            benchCamera.target   = vec3_scale(target,   extent);
+
+            PROFILE_ZONE("bench frame");
+            uint64_t begin = get_time_ns();
+
+            frame_arena_swap();
+
+            textureStreamUpdate();
+            camera_compute_matrices(&benchCamera);
+
+            size_t culled    = 0;
+            size_t dropped   = 0;
+            size_t drawCount = collectMeshDraws(meshList, (size_t) listCount, &benchCamera, drawList, (size_t) meshCount, &culled, &dropped);
+
+            renderStatsMeshes(drawCount, culled, dropped);
+            renderFrame(drawList, drawCount, &benchCamera, hdrFramebuffer, quad);
+            swap_buffers(window);
+            gpuResourcesEndFrame();
+
+            uint64_t           end   = get_time_ns();
+            RenderStatsFrame_t stats = renderStatsEndFrame(end - begin);
+            mem_end_frame();
+
+            if (frame < BENCH_WARMUP_FRAMES) continue;
+
+            frameNs[frame - BENCH_WARMUP_FRAMES] = end - begin;
+            draws     += stats.values[RENDER_STAT_DRAWS];
+            triangles += stats.values[RENDER_STAT_TRIANGLES];
+        }
+
+        results[s] = (BenchResult_t) {
+            .scenario  = scenario,
+            .frames    = bench_frame_stats(frameNs, scenario.frames),
+            .draws     = draws,
+            .triangles = triangles
+        };
+
+        const BenchFrameStats_t* f = &results[s].frames;
+        printf("bench %-8s %5d meshes %4d lights | mean %.3f | p50 %.3f | p95 %.3f | p99 %.3f ms\n",
+            scenario.name, meshCount, scenario.lights,
+            f->total / 1e6 / f->count, f->p50 / 1e6, f->p95 / 1e6, f->p99 / 1e6);
+
+        for (int i = 0; i < meshCount; ++i) meshDestroy(meshes[i]);
+        mem_free(meshes);
+        mem_free(meshList);
+        mem_free(drawList);
+        mem_free(frameNs);
+    }
+
+    truncateLights(0, program);
+
+    if (!bench_write_json(outputPath, (const char*) glGetString(GL_RENDERER), results, BENCH_SCENARIO_COUNT)) return false;
+
+    printf("bench results written to %s\n", outputPath);
+    return true;
 }
 
 #if defined(_WIN32)
@@ -532,7 +1205,7 @@ static Window create_window(size_t width, size_t height, const char* title) {
     s_Bmi.bmiHeader.biBitCount    = 32;
     s_Bmi.bmiHeader.biCompression = BI_RGB;
 
-    Window wdw      = malloc(sizeof(struct Window_st));
+    Window wdw      = mem_alloc(MEM_TAG_PLATFORM, sizeof(struct Window_st));
     if (!wdw) return NULL;
     
     wdw->_winHandle = hwnd;
@@ -566,7 +1239,8 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         {
             UINT dwSize = 0;
             GetRawInputData((HRAWINPUT)lParam, RID_INPUT, NULL, &dwSize, sizeof(RAWINPUTHEADER));
-            LPBYTE lpb = (LPBYTE)malloc(dwSize);
+            // gone with the frame, no free.
+            LPBYTE lpb = (LPBYTE)frame_alloc(dwSize);
 
             if (lpb && GetRawInputData((HRAWINPUT)lParam, RID_INPUT, lpb, &dwSize, sizeof(RAWINPUTHEADER)) == dwSize) {
                 RAWINPUT* raw = (RAWINPUT*)lpb;
@@ -576,7 +1250,6 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                     // mouseState.deltaY = raw->data.mouse.lLastY;
                 }
             }
-            free(lpb);
             break;
         }
 
@@ -584,6 +1257,8 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         {
             UINT vkCode = (UINT)wParam;
 
+            if (vkCode == VK_F9) s_traceRequested = true;
+
             if (vkCode == VK_SHIFT) {
                 UINT scancode = (lParam >> 16) & 0xFF;
                 vkCode = MapVirtualKey(scancode, MAPVK_VSC_TO_VK_EX);
@@ -670,9 +1345,136 @@ static bool create_opengl_context(Window window) {
 
     return true;
 }
+
+static void destroy_opengl_context(Window window) {
+    wglMakeCurrent(NULL, NULL);
+    wglDeleteContext(s_hglrc);
+
+    ReleaseDC((HWND) window->_winHandle, s_hdc);
+}
+
+static bool make_context_current(Window window, bool current) {
+    return wglMakeCurrent(current ? s_hdc : NULL, current ? s_hglrc : NULL);
+}
+
+static GLuint window_framebuffer(Window window) {
+    return 0;
+}
+
+static void swap_buffers(Window window) {
+    PROFILE_FUNCTION();
+    SwapBuffers(s_hdc);
+}
+
 #else
-#error "create_opengl_context()  not implemented in your current OS."
-#endif
+
+static bool init_platform() {
+    return true;
+}
+
+static Window create_window(size_t width, size_t height, const char* title) {
+    Window wdw = mem_calloc(MEM_TAG_PLATFORM, 1, sizeof(struct Window_st));
+    if (!wdw) return NULL;
+
+    wdw->title   = (char*)title;
+    wdw->width   = width;
+    wdw->height  = height;
+    wdw->focused = true;
+
+    return wdw;
+}
+
+static bool create_opengl_context(Window window) {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+    if (eglGetPlatformDisplayEXT) s_eglDisplay = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (s_eglDisplay == EGL_NO_DISPLAY) s_eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    if (s_eglDisplay == EGL_NO_DISPLAY || !eglInitialize(s_eglDisplay, NULL, NULL)) {
+        fprintf(stderr, "create_opengl_context(): no EGL display\n");
+        return false;
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        fprintf(stderr, "create_opengl_context(): EGL has no desktop OpenGL\n");
+        return false;
+    }
+
+    EGLint attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION,       OPENGL_MAJOR_VERSION,
+        EGL_CONTEXT_MINOR_VERSION,       OPENGL_MINOR_VERSION,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+
+    // EGL_KHR_no_config_context + EGL_KHR_surfaceless_context: nothing to present to, the frame
+    // goes into s_backbuffer instead.
+    s_eglContext = eglCreateContext(s_eglDisplay, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attribs);
+    if (s_eglContext == EGL_NO_CONTEXT || !eglMakeCurrent(s_eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, s_eglContext)) {
+        fprintf(stderr, "create_opengl_context(): eglCreateContext failed 0x%x\n", eglGetError());
+        return false;
+    }
+
+    if (!gladLoadGLLoader((GLADloadproc) eglGetProcAddress)) {
+        fprintf(stderr, "create_opengl_context(): failed to load OpenGL functions\n");
+        return false;
+    }
+
+    glGenTextures(1, &s_backbufferColor);
+    glBindTexture(GL_TEXTURE_2D, s_backbufferColor);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, window->width, window->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenRenderbuffers(1, &s_backbufferDepth);
+    glBindRenderbuffer(GL_RENDERBUFFER, s_backbufferDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, window->width, window->height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &s_backbuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, s_backbuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, s_backbufferColor, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, s_backbufferDepth);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "create_opengl_context(): backbuffer incomplete 0x%x\n", status);
+        return false;
+    }
+
+    printf("headless: %s, OpenGL %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+    return true;
+}
+
+static void destroy_opengl_context(Window window) {
+    glDeleteFramebuffers(1, &s_backbuffer);
+    glDeleteRenderbuffers(1, &s_backbufferDepth);
+    glDeleteTextures(1, &s_backbufferColor);
+
+    eglMakeCurrent(s_eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(s_eglDisplay, s_eglContext);
+    eglTerminate(s_eglDisplay);
+}
+
+static bool make_context_current(Window window, bool current) {
+    return eglMakeCurrent(s_eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, current ? s_eglContext : EGL_NO_CONTEXT);
+}
+
+static GLuint window_framebuffer(Window window) {
+    return s_backbuffer;
+}
+
+static void swap_buffers(Window window) {
+    PROFILE_FUNCTION();
+    // nothing is presented; wait for the GPU so the frame time covers its work too.
+    glFinish();
+}
+
+#endif // defined(_WIN32)
 
 // Returns current time in nanoseconds (monotonic, high-resolution)
 uint64_t get_time_ns() {
@@ -703,12 +1505,16 @@ GLuint compile_shader(const char* src, GLenum type) {
     if (!success) {
         char log[512];
         glGetShaderInfoLog(sh, 512, NULL, log);
+#if defined(_WIN32)
         MessageBox(NULL, log, "Shader compile error", MB_OK);
+#else
+        fprintf(stderr, "Shader compile error: %s\n", log);
+#endif // defined(_WIN32)
     }
     return sh;
 }
 
-QuadMesh createQuadMesh(size_t texture_width, size_t texture_height, GLuint program) {
+QuadMesh createQuadMesh(size_t texture_width, size_t texture_height, GLProgram_t program) {
     float quad_vertices[] = {
         -1.0f, -1.0f, 0.0f, 0.0f,
          1.0f, -1.0f, 1.0f, 0.0f,
@@ -739,16 +1545,18 @@ QuadMesh createQuadMesh(size_t texture_width, size_t texture_height, GLuint prog
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glBindTexture(GL_TEXTURE_2D, 0);
 
+    gpuResourceTrack(GPU_RESOURCE_TEXTURE, quadTexture, texture_width * texture_height * 4, "quad texture");
+
     QuadMesh result = (QuadMesh) {
         .program     = program,
-        .texture_loc = program > 0 ? glGetUniformLocation(program, "uTexture") : -1,
+        .texture_loc = programUniformLocation(&program, "uTexture"),
         .texture     = quadTexture,
         .vbo         = quad_vbo,
         .vao         = quad_vao
     };
 
-    if (program && result.texture_loc > -1) {
-        glUseProgram(program);
+    if (program.program && result.texture_loc > -1) {
+        glUseProgram(program.program);
         glUniform1i(result.texture_loc, 0);
         glUseProgram(0);
     }
@@ -756,25 +1564,34 @@ QuadMesh createQuadMesh(size_t texture_width, size_t texture_height, GLuint prog
     return result;
 }
 
-void setQuadMeshProgram(QuadMesh* mesh, GLuint program) {
+void setQuadMeshProgram(QuadMesh* mesh, GLProgram_t program) {
     if (!mesh) return;
-    mesh->program = program;
+    mesh->program     = program;
+    mesh->texture_loc = programUniformLocation(&program, "uTexture");
+
+    if (program.program && mesh->texture_loc > -1) {
+        glUseProgram(program.program);
+        glUniform1i(mesh->texture_loc, 0);
+        glUseProgram(0);
+    }
 }
 
 void renderQuad(QuadMesh mesh) {
-    if (mesh.program <= 0) return;
+    if (!mesh.program.program) return;
 
-    glUseProgram(mesh.program);    
+    // uTexture is bound to unit 0 once in createQuadMesh() / setQuadMeshProgram().
+    glUseProgram(mesh.program.program);    
     glBindVertexArray(mesh.vao);
 
-    if (mesh.texture_loc <= -1) {
-        mesh.texture_loc = glGetUniformLocation(mesh.program, "uTexture");
-        glUniform1i(mesh.texture_loc, 0);
-    }
-    
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, mesh.texture);
     glDrawArrays(GL_TRIANGLES, 0, 6);
+
+    renderStatsBind(RENDER_STATE_PROGRAM,      mesh.program.program);
+    renderStatsBind(RENDER_STATE_VERTEX_ARRAY, mesh.vao);
+    renderStatsBind(RENDER_STATE_TEXTURE0,     mesh.texture);
+    renderStatsDraw(2);
+
     glBindTexture(GL_TEXTURE_2D, 0);
     glUseProgram(0);
     glBindVertexArray(0);
@@ -807,6 +1624,8 @@ bool meshSetupGLBuffers_Raylib(Mesh_t* mesh, float* vertices, float* normals, fl
     glBindBuffer(GL_ARRAY_BUFFER, texcoord_obj);
     glBufferData(GL_ARRAY_BUFFER, texcoords_vbo_size, texcoords, GL_STATIC_DRAW);
 
+    renderStatsUpload(vertex_vbo_size + normals_vbo_size + texcoords_vbo_size);
+
     glBindVertexArray(vao);
     glBindBuffer(GL_ARRAY_BUFFER, vertex_obj);
     glVertexAttribPointer(ATTRIB_POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*) 0);
@@ -828,7 +1647,11 @@ bool meshSetupGLBuffers_Raylib(Mesh_t* mesh, float* vertices, float* normals, fl
     mesh->ebo          = 0;
     mesh->index_count  = 0;
     mesh->vao          = vao;
+    mesh->vbo          = vertex_obj;
+    mesh->normal_vbo   = normal_obj;
+    mesh->uv_vbo       = texcoord_obj;
     mesh->vertex_count = vertex_count;
+    mesh->gpu_resource = gpuResourceTrack(GPU_RESOURCE_BUFFER, vao, vertex_vbo_size + normals_vbo_size + texcoords_vbo_size, "mesh");
     return true;
 }
 
@@ -843,6 +1666,7 @@ bool meshSetupGLBuffers(Mesh_t * mesh, float* vbo_buffer, size_t buff_size) {
 
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, buff_size, vbo_buffer, GL_STATIC_DRAW);
+    renderStatsUpload(buff_size);
 
     glBindVertexArray(vao);
 
@@ -865,10 +1689,14 @@ bool meshSetupGLBuffers(Mesh_t * mesh, float* vbo_buffer, size_t buff_size) {
     mesh->vertex_count = (buff_size / sizeof(float)) / VERTEX_STRIDE;
     glBindVertexArray(0);
 
+    // buffers rebuilt after an eviction keep their resource.
+    if (mesh->gpu_resource) gpuResourceUpdate(mesh->gpu_resource, vao, buff_size);
+    else                    mesh->gpu_resource = gpuResourceTrack(GPU_RESOURCE_BUFFER, vao, buff_size, "mesh");
+
     return true;
 }
 
-Mesh_t createSphereMesh(float radius, int rings, int slices, Color color, GLProgram_t program)  {
+MeshHandle_t createSphereMesh(float radius, int rings, int slices, Color color, GLProgram_t program)  {
     Mesh_t mesh = { 0 };
 
     if ((rings >= 3) && (slices >= 3))
@@ -878,9 +1706,24 @@ Mesh_t createSphereMesh(float radius, int rings, int slices, Color color, GLProg
         par_shapes_scale(sphere, radius, radius, radius);
         // NOTE: Soft normals are computed internally
 
-        float* vertices   = (float *)malloc(sphere->ntriangles*3*3*sizeof(float));
-        float* normals    = (float *)malloc(sphere->ntriangles*3*3*sizeof(float));
-        float* texcoords  = (float *)malloc(sphere->ntriangles*3*2*sizeof(float));
+        // only needed until the upload.
+        Arena_t* scratch = scratch_arena();
+        if (!scratch) {
+            par_shapes_free_mesh(sphere);
+            return (MeshHandle_t) {0};
+        }
+
+        ArenaMarker_t marker = arena_save(scratch);
+
+        float* vertices   = (float *)arena_alloc(scratch, sphere->ntriangles*3*3*sizeof(float), sizeof(float));
+        float* normals    = (float *)arena_alloc(scratch, sphere->ntriangles*3*3*sizeof(float), sizeof(float));
+        float* texcoords  = (float *)arena_alloc(scratch, sphere->ntriangles*3*2*sizeof(float), sizeof(float));
+
+        if (!vertices || !normals || !texcoords) {
+            arena_restore(scratch, marker);
+            par_shapes_free_mesh(sphere);
+            return (MeshHandle_t) {0};
+        }
 
         int vertexCount   = sphere->ntriangles*3;
         int triangleCount = sphere->ntriangles;
@@ -915,25 +1758,127 @@ Mesh_t createSphereMesh(float radius, int rings, int slices, Color color, GLProg
             mesh.program = program;
         }
 
-        if (!meshSetupGLBuffers_Raylib(&mesh, vertices, normals, texcoords, sphere->ntriangles*3))
-            return (Mesh_t) {0};
+        bool uploaded = meshSetupGLBuffers_Raylib(&mesh, vertices, normals, texcoords, vertexCount);
+        arena_restore(scratch, marker);
+
+        if (!uploaded) return (MeshHandle_t) {0};
 
         mesh.noColorAttrib = true;
         meshInit(&mesh);
 
-        mesh.color = color;
-        
+        mesh.color         = color;
+        mesh.bounds_radius = radius;
+    }
+    else return (MeshHandle_t) {0};
 
-        free(vertices);
-        free(normals);
-        free(texcoords);
+    return meshAdd(&mesh);
+}
+
+static void meshUploadTangents(Mesh_t* mesh) {
+    size_t tangent_buff_size = 3 * mesh->vertex_count * sizeof(float);
+
+    glGenBuffers(1, &mesh->tangent_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->tangent_vbo);
+    glBufferData(GL_ARRAY_BUFFER, tangent_buff_size, mesh->tangents, GL_STATIC_DRAW);
+    renderStatsUpload(tangent_buff_size);
+    glBindVertexArray(mesh->vao);
+    glVertexAttribPointer(ATTRIB_TANGENT_LOCATION, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(ATTRIB_TANGENT_LOCATION);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    gpuResourceUpdate(mesh->gpu_resource, mesh->vao, (VERTEX_STRIDE + 3) * mesh->vertex_count * sizeof(float));
+}
+
+static void meshDeleteGLBuffers(Mesh_t* mesh) {
+    GLuint buffers[] = { mesh->vbo, mesh->normal_vbo, mesh->uv_vbo, mesh->tangent_vbo, mesh->ebo };
+
+    glDeleteBuffers(sizeof(buffers) / sizeof(buffers[0]), buffers);
+    glDeleteVertexArrays(1, &mesh->vao);
+
+    mesh->vao = mesh->vbo = mesh->normal_vbo = mesh->uv_vbo = mesh->tangent_vbo = mesh->ebo = 0;
+}
+
+static void meshEvictBuffers(void* user) {
+    Mesh_t* mesh = meshGet((MeshHandle_t) { (uint32_t)(uintptr_t) user });
+    if (!mesh) return;
+
+    meshDeleteGLBuffers(mesh);
+    gpuResourceUpdate(mesh->gpu_resource, 0, 0);
+}
+
+static bool meshRestoreBuffers(Mesh_t* mesh) {
+    if (!meshSetupGLBuffers(mesh, mesh->vertices, mesh->vertex_count * VERTEX_STRIDE * sizeof(float))) return false;
+    if (mesh->hasTangentAttrib) meshUploadTangents(mesh);
+    return true;
+}
+
+// only meshes built from an interleaved CPU copy (see createCubeMesh) can come back. The eviction
+// callback holds the handle, the pool moves meshes around.
+void meshEnableEviction(MeshHandle_t handle) {
+    Mesh_t* mesh = meshGet(handle);
+    if (!mesh || !mesh->vertices || (mesh->hasTangentAttrib && !mesh->tangents)) return;
+    gpuResourceSetEvict(mesh->gpu_resource, meshEvictBuffers, (void*)(uintptr_t) handle.id);
+    mesh->evictable = true;
+}
+
+bool meshDropCpuCopy(MeshHandle_t handle) {
+    Mesh_t* mesh = meshGet(handle);
+    if (!mesh || !mesh->vao || mesh->evictable || mesh->showTangentSpace) return false;
+
+    mem_free(mesh->vertices);
+    mem_free(mesh->tangents);
+
+    mesh->vertices = NULL;
+    mesh->tangents = NULL;
+    return true;
+}
+
+static void meshFreeResources(Mesh_t* mesh) {
+    meshDeleteGLBuffers(mesh);
+    gpuResourceUntrack(mesh->gpu_resource);
+
+    mem_free(mesh->vertices);
+    mem_free(mesh->tangents);
+
+    mesh->gpu_resource = 0;
+    mesh->vertices     = NULL;
+    mesh->tangents     = NULL;
+}
+
+// moves a built mesh into the pool, which owns its buffers from then on.
+static MeshHandle_t meshAdd(Mesh_t* mesh) {
+    if (!s_meshes.item_size) pool_init(&s_meshes, "meshes", sizeof(Mesh_t), 0, MEM_TAG_RENDER);
+
+    MeshHandle_t handle = { pool_create(&s_meshes) };
+    if (!handle.id) {
+        meshFreeResources(mesh);
+        return handle;
     }
-    else {};
 
-    return mesh;
+    *(Mesh_t*) pool_get(&s_meshes, handle.id) = *mesh;
+    return handle;
+}
+
+Mesh_t* meshGet(MeshHandle_t mesh) {
+    return pool_get(&s_meshes, mesh.id);
 }
 
-Mesh_t createCubeMesh(float width, float height, float depth, Color color, GLProgram_t prog) {
+void meshDestroy(MeshHandle_t handle) {
+    Mesh_t* mesh = meshGet(handle);
+    if (!mesh) return;
+
+    meshFreeResources(mesh);
+    pool_destroy(&s_meshes, handle.id);
+}
+
+void meshesShutdown(void) {
+    while (pool_count(&s_meshes) > 0) meshDestroy((MeshHandle_t) { pool_handle_at(&s_meshes, 0) });
+    pool_release(&s_meshes);
+}
+
+
+MeshHandle_t createCubeMesh(float width, float height, float depth, Color color, GLProgram_t prog) {
 
 #   define NORMAL_
 #   define UV_
@@ -1002,13 +1947,13 @@ Mesh_t createCubeMesh(float width, float height, float depth, Color color, GLPro
     Mat4 localScale       = mat_scale(width, height, depth);
     int vertCount         = (sizeof(vbo_buffer) / sizeof(float)) / VERTEX_STRIDE;
     int tangent_buff_size = 3 * vertCount * sizeof(float);
-    float* tangents       = malloc(tangent_buff_size);
+    float* tangents       = mem_alloc(MEM_TAG_RENDER, tangent_buff_size);
     int face_count        = 6;
     int vertex_per_face   = 6;
 
 
     mesh.tangents = tangents;
-    mesh.vertices = malloc(vertCount * VERTEX_STRIDE * sizeof(float));
+    mesh.vertices = mem_alloc(MEM_TAG_RENDER, vertCount * VERTEX_STRIDE * sizeof(float));
 
     
     // apply scale
@@ -1048,25 +1993,20 @@ Mesh_t createCubeMesh(float width, float height, float depth, Color color, GLPro
         mesh.program = prog;
     }
 
-    // TODO: Remove memory leak for tangents and other critical resources.
-    if (!meshSetupGLBuffers(&mesh, vbo_buffer, sizeof(vbo_buffer))) 
-        return (Mesh_t) {0};
-
-    // upload tangent vectors.
-    glGenBuffers(1, &mesh.tangent_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.tangent_vbo);
-    glBufferData(GL_ARRAY_BUFFER, tangent_buff_size, tangents, GL_STATIC_DRAW);
-    glBindVertexArray(mesh.vao);
-    glVertexAttribPointer(ATTRIB_TANGENT_LOCATION, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(ATTRIB_TANGENT_LOCATION);
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    if (!meshSetupGLBuffers(&mesh, vbo_buffer, sizeof(vbo_buffer))) {
+        mem_free(mesh.vertices);
+        mem_free(mesh.tangents);
+        return (MeshHandle_t) {0};
+    }
 
     mesh.hasTangentAttrib = true;
+    meshUploadTangents(&mesh);
+
+    mesh.bounds_radius    = 0.5f * sqrtf(width * width + height * height + depth * depth);
     
     meshInit(&mesh);
 
-    return mesh;
+    return meshAdd(&mesh);
 
 #   undef NORMAL_
 #   undef UV_
@@ -1084,8 +2024,8 @@ void meshInit(Mesh_t* mesh) {
     // }
 } 
 
-Mesh_t createTriangleMesh(vec3 v1, vec3 v2, vec3 v3, Color color, GLProgram_t prog) {
-    Mesh_t mesh;
+MeshHandle_t createTriangleMesh(vec3 v1, vec3 v2, vec3 v3, Color color, GLProgram_t prog) {
+    Mesh_t mesh = { 0 };
 
     mesh.transform = (Transform) {
         .rot_mode = DEFAULT_ROTMODE,
@@ -1114,12 +2054,13 @@ Mesh_t createTriangleMesh(vec3 v1, vec3 v2, vec3 v3, Color color, GLProgram_t pr
     };
 
     if (!meshSetupGLBuffers(&mesh, vbo_buffer, sizeof(vbo_buffer))) 
-        return (Mesh_t) {0};
+        return (MeshHandle_t) {0};
     
+    mesh.bounds_radius = sqrtf(fmaxf(vec3_dot(v1, v1), fmaxf(vec3_dot(v2, v2), vec3_dot(v3, v3))));
 
     meshInit(&mesh);
 
-    return mesh;
+    return meshAdd(&mesh);
 
 #   undef NORMAL_
 #   undef UV_
@@ -1143,95 +2084,215 @@ void drawArrow(vec3 position, vec3 dir, Color color) {
     glDisable(GL_DEPTH_TEST);
     glBindVertexArray(g_arrowVAO);
     glDrawArrays(GL_LINE_STRIP, 0, 2);
+
+    renderStatsBind(RENDER_STATE_PROGRAM,      g_arrowProgram.program);
+    renderStatsBind(RENDER_STATE_VERTEX_ARRAY, g_arrowVAO);
+    renderStatsUpload(sizeof(data));
+    renderStatsDraw(0);
     glBindVertexArray(0);
     glEnable(GL_DEPTH_TEST);
     
     glUseProgram(0);
 }
 
-void renderMesh(Mesh_t m, Camera_t* camera) {
-    if (!m.program.program || !camera) return;
+// reads texture page residency, GL thread only.
+static uint64_t meshDrawKey(const Mesh_t* m) {
+    return ((uint64_t) m->program.program << 32) | materialSortKey(&m->material);
+}
+
+// records the draw's commands under `key` (meshDrawKey(), worked out on the GL thread), `order`
+// breaks ties between equal keys. Reads the mesh and the camera only, any thread can record while
+// the GL thread waits for it.
+void recordMesh(RenderCommandList_t* list, const MeshDraw_t* draw, uint64_t key, uint32_t order, const Camera_t* camera) {
+    Mesh_t* m = draw ? draw->mesh : NULL;
+    if (!list || !m || !m->program.program || !m->vao || !camera) return;
 
+    renderCmdBegin(list, key, order);
+    renderCmdSetPipeline(list, m->program.program, m->vao);
+
+    renderCmdUniformMat4(list, m->program.view_mat_loc,  &camera->view_matrix);
+    renderCmdUniformMat4(list, m->program.proj_mat_loc,  &camera->proj_matrix);
+    renderCmdUniformMat4(list, m->program.world_mat_loc, &draw->world);
+    renderCmdUniformVec3(list, m->program.camera_pos_loc, camera->position);
+
+    // texture pages stay bound between draws, only units whose page changes get rebound.
+    renderCmdBindMaterial(list, &m->material, &m->program);
+
+    renderCmdUniformInt(list,  m->program.no_color_attrib_loc,    m->noColorAttrib);
+    renderCmdUniformVec3(list, m->program.color_loc,              vec3_init(m->color.r, m->color.g, m->color.b));
+    renderCmdUniformInt(list,  m->program.has_tangent_attrib_loc, m->hasTangentAttrib);
+
+    if (m->ebo) renderCmdDraw(list, GL_UNSIGNED_SHORT, (GLsizei) m->index_count);
+    else        renderCmdDraw(list, 0,                 (GLsizei) m->vertex_count);
+
+    renderCmdEnd(list);
+}
+
+// debug arrows, drawn straight away on the GL thread.
+void renderTangentArrows(const MeshDraw_t* draw, Camera_t* camera) {
+    Mesh_t* m = draw->mesh;
+    if (!m->vertices || !m->tangents) return;
+
+    GPU_PROFILE_ZONE("tangent arrows");
+
+    glUseProgram(g_arrowProgram.program);
+    glUniformMatrix4fv(g_arrowProgram.view_mat_loc,  1, GL_TRUE, (float*)(&camera->view_matrix));
+    glUniformMatrix4fv(g_arrowProgram.proj_mat_loc,  1, GL_TRUE, (float*)(&camera->proj_matrix));
+    glUniformMatrix4fv(g_arrowProgram.world_mat_loc, 1, GL_TRUE, (float*)(&draw->world));
+    glUseProgram(0);
+
+    for (int i = 0; i < m->vertex_count; ++i) {
+        float* vertex         = &(m->vertices[i * VERTEX_STRIDE]);
+        float* tangent_vertex = &(m->tangents[3 * i]);
+
+        vec3 position   = vec3_init(vertex[0], vertex[1], vertex[2]);
+        vec3 normal     = vec3_init(vertex[3 + 0], vertex[3 + 1], vertex[3 + 2]);
+        vec3 tangent    = vec3_init(tangent_vertex[0], tangent_vertex[1], tangent_vertex[2]);
+
+        // // re-orthogonalization
+        tangent = vec3_norm(vec3_sub(tangent, vec3_scale(normal, vec3_dot(tangent, normal))));
+        vec3 bitangent = vec3_cross(normal, tangent);
+        
+        drawArrow(position, tangent,   (Color) {1.0f, 0.0f, 0.0});
+        drawArrow(position, bitangent, (Color) {0.0f, 1.0f, 0.0});
+        drawArrow(position, normal,    (Color) {0.0f, 0.0f, 1.0});
+    }   
+}
+
+static Mat4 meshWorldMatrix(const Mesh_t* m) {
     Mat4 world_mat = mat4_identity();
     
-    if (m.transform.rot_mode == ROTMODE_QUATERNION) {
-        world_mat = quat_to_mat4(m.transform.rotation_q);
+    if (m->transform.rot_mode == ROTMODE_QUATERNION) {
+        world_mat = quat_to_mat4(m->transform.rotation_q);
     } else {
         // hope and pray for no Gimbal lock
-        world_mat = mat_rotate_x(m.transform.rotation.x);
-        world_mat = mat_mul(mat_rotate_y(m.transform.rotation.y), world_mat);
-        world_mat = mat_mul(mat_rotate_z(m.transform.rotation.z), world_mat);
+        world_mat = mat_rotate_x(m->transform.rotation.x);
+        world_mat = mat_mul(mat_rotate_y(m->transform.rotation.y), world_mat);
+        world_mat = mat_mul(mat_rotate_z(m->transform.rotation.z), world_mat);
     }
 
-    world_mat = mat_mul(mat_scale(m.transform.scale.x, m.transform.scale.y, m.transform.scale.z), world_mat);
-    world_mat = mat_mul(mat_translate(m.transform.position.x, m.transform.position.y, m.transform.position.z), world_mat);
+    world_mat = mat_mul(mat_scale(m->transform.scale.x, m->transform.scale.y, m->transform.scale.z), world_mat);
+    world_mat = mat_mul(mat_translate(m->transform.position.x, m->transform.position.y, m->transform.position.z), world_mat);
     // M = T * S * R 
-    m.localToWorld = world_mat; 
-        
-    camera_compute_matrices(camera);
+    return world_mat;
+}
 
-    glBindVertexArray(m.vao);
-    glUseProgram(m.program.program);
+// bounding sphere against the view frustum, in view space. Meshes without bounds are always drawn.
+static bool meshInFrustum(const Mesh_t* m, const Camera_t* camera) {
+    float meshScale = fmaxf(m->transform.scale.x, fmaxf(m->transform.scale.y, m->transform.scale.z));
+    float radius    = m->bounds_radius * meshScale;
+    if (radius <= 0.0f) return true;
 
-    glUniformMatrix4fv(m.program.view_mat_loc,  1, GL_TRUE, (float*)(&camera->view_matrix));
-    glUniformMatrix4fv(m.program.proj_mat_loc,  1, GL_TRUE, (float*)(&camera->proj_matrix));
-    glUniformMatrix4fv(m.program.world_mat_loc, 1, GL_TRUE, (float*)(&m.localToWorld));
-    glUniform3f(cameraPosLoc, camera->position.x, camera->position.y, camera->position.z);
+    // camera->matrix columns are the camera's right, up and back axes.
+    vec3  toMesh = vec3_sub(m->transform.position, camera->position);
+    float x      =  toMesh.x * camera->matrix.m00 + toMesh.y * camera->matrix.m10 + toMesh.z * camera->matrix.m20;
+    float y      =  toMesh.x * camera->matrix.m01 + toMesh.y * camera->matrix.m11 + toMesh.z * camera->matrix.m21;
+    float depth  = -(toMesh.x * camera->matrix.m02 + toMesh.y * camera->matrix.m12 + toMesh.z * camera->matrix.m22);
 
-    for (int i = 0; i < TEXTURE_COUNT; ++i) {
-        if (!m.textures[i].texture_id) continue;
+    if (depth + radius < camera->n || depth - radius > camera->f) return false;
 
-        GLuint tId = m.textures[i].texture_id;
+    // side planes through the eye, their normals (cos, -sin) in the x/depth and y/depth planes.
+    float tanY = tanf(camera->fov * 0.5f);
+    float tanX = tanY * (float) CANVAS_WIDTH / (float) CANVAS_HEIGHT;
+    float cosX = 1.0f / sqrtf(1.0f + tanX * tanX);
+    float cosY = 1.0f / sqrtf(1.0f + tanY * tanY);
 
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_2D, tId);
-    }
+    if (fabsf(x) * cosX - depth * tanX * cosX > radius) return false;
+    if (fabsf(y) * cosY - depth * tanY * cosY > radius) return false;
 
-    glUniform1i(m.program.no_color_attrib_loc, m.noColorAttrib);
-    glUniform3f(m.program.color_loc, m.color.r, m.color.g, m.color.b);
-    glUniform1i(m.program.has_tangent_attrib_loc, m.hasTangentAttrib);
-    
-    if (m.ebo) {
-        glDrawElements(GL_TRIANGLES, m.index_count, GL_UNSIGNED_SHORT, 0);
-    } else {
-        glDrawArrays(GL_TRIANGLES, 0, m.vertex_count);
-    }
+    return true;
+}
+
+size_t collectMeshDraws(Mesh_t** meshes, size_t count, const Camera_t* camera, MeshDraw_t* draws, size_t capacity,
+                        size_t* culled, size_t* dropped) {
+    PROFILE_FUNCTION();
+    size_t drawCount = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        Mesh_t* m = meshes[i];
 
+        if (!meshInFrustum(m, camera)) {
+            (*culled)++;
+            continue;
+        }
+
+        if (drawCount == capacity) {
+            (*dropped)++;
+            continue;
+        }
+
+        vec3  toMesh     = vec3_sub(m->transform.position, camera->position);
+        float distance   = sqrtf(vec3_dot(toMesh, toMesh));
+        float meshScale  = fmaxf(m->transform.scale.x, fmaxf(m->transform.scale.y, m->transform.scale.z));
+        float screenSize = CANVAS_HEIGHT;
 
-    // clean up
-    for (int i = 0; i < TEXTURE_COUNT; ++i) {
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        if (distance > m->bounds_radius * meshScale)
+            screenSize = (m->bounds_radius * meshScale) / (distance * tanf(camera->fov * 0.5f)) * CANVAS_HEIGHT;
+
+        draws[drawCount++] = (MeshDraw_t) {
+            .mesh        = m,
+            .world       = meshWorldMatrix(m),
+            .screen_size = screenSize
+        };
     }
 
-    if (m.showTangentSpace) {
+    return drawCount;
+}
+
+typedef struct {
+    const MeshDraw_t* draws;
+    const uint64_t*   keys;     // NULL: recording on the GL thread, keys are computed as it goes
+    const Camera_t*   camera;
+} MeshRecordJob_t;
 
-        glUseProgram(g_arrowProgram.program);
-        glUniformMatrix4fv(g_arrowProgram.view_mat_loc,  1, GL_TRUE, (float*)(&camera->view_matrix));
-        glUniformMatrix4fv(g_arrowProgram.proj_mat_loc,  1, GL_TRUE, (float*)(&camera->proj_matrix));
-        glUniformMatrix4fv(g_arrowProgram.world_mat_loc, 1, GL_TRUE, (float*)(&m.localToWorld));
-        glUseProgram(0);
+static void recordMeshRange(int begin, int end, void* user) {
+    PROFILE_ZONE("record draws");
+    const MeshRecordJob_t* job  = (const MeshRecordJob_t*) user;
+    RenderCommandList_t*   list = renderCmdList(&s_renderCommands);
 
-        for (int i = 0; i < m.vertex_count; ++i) {
-            float* vertex         = &(m.vertices[i * VERTEX_STRIDE]);
-            float* tangent_vertex = &(m.tangents[3 * i]);
+    for (int i = begin; i < end; ++i) {
+        uint64_t key = job->keys ? job->keys[i] : meshDrawKey(job->draws[i].mesh);
+        recordMesh(list, &job->draws[i], key, (uint32_t) i, job->camera);
+    }
+}
 
-            vec3 position   = vec3_init(vertex[0], vertex[1], vertex[2]);
-            vec3 normal     = vec3_init(vertex[3 + 0], vertex[3 + 1], vertex[3 + 2]);
-            vec3 tangent    = vec3_init(tangent_vertex[0], tangent_vertex[1], tangent_vertex[2]);
+// draws grouped by program, then by texture pages, so consecutive draws rebind as little as possible.
+// Commands are recorded on the job pool in batches of MESH_RECORD_BATCH and replayed here in
+// that order; `camera` has its matrices computed.
+void renderMeshDraws(const MeshDraw_t* draws, size_t count, Camera_t* camera) {
+    // the keys read texture page residency, which streaming moves on this thread: they are
+    // worked out here before the workers record.
+    Arena_t*      scratch = scratch_arena();
+    ArenaMarker_t marker  = scratch ? arena_save(scratch) : (ArenaMarker_t) {0};
+    uint64_t*     keys    = scratch ? arena_alloc(scratch, (count ? count : 1) * sizeof(uint64_t), sizeof(uint64_t)) : NULL;
+
+    for (size_t i = 0; i < count; ++i) {
+        Mesh_t* mesh = draws[i].mesh;
+
+        // evicted buffers come back on the first draw.
+        if (!mesh->vao && mesh->vertices) meshRestoreBuffers(mesh);
+        gpuResourceTouch(mesh->gpu_resource);
+
+        // tells the streamer which mips are worth having.
+        for (int t = 0; t < TEXTURE_COUNT; ++t) {
+            textureStreamNoteUsage(mesh->material.textures[t], draws[i].screen_size);
+        }
 
-            // // re-orthogonalization
-            tangent = vec3_norm(vec3_sub(tangent, vec3_scale(normal, vec3_dot(tangent, normal))));
-            vec3 bitangent = vec3_cross(normal, tangent);
-            
-            drawArrow(position, tangent,   (Color) {1.0f, 0.0f, 0.0});
-            drawArrow(position, bitangent, (Color) {0.0f, 1.0f, 0.0});
-            drawArrow(position, normal,    (Color) {0.0f, 0.0f, 1.0});
-        }   
+        if (keys) keys[i] = meshDrawKey(mesh);
     }
 
-    glBindVertexArray(0);
-    glUseProgram(0);
+    MeshRecordJob_t job = { draws, keys, camera };
+
+    renderCmdQueueReset(&s_renderCommands);
+    if (keys) jobs_parallel_for((int) count, MESH_RECORD_BATCH, recordMeshRange, &job);
+    else      recordMeshRange(0, (int) count, &job);
+    renderCmdSubmit(&s_renderCommands);
+
+    if (scratch) arena_restore(scratch, marker);
+
+    for (size_t i = 0; i < count; ++i) {
+        if (draws[i].mesh->showTangentSpace) renderTangentArrows(&draws[i], camera);
+    }
 }
 
 void camera_compute_matrices(Camera_t* camera) {
@@ -1255,10 +2316,11 @@ Camera_t camera_init(vec3 position, vec3 target, float near_plane, float far_pla
     };
 }
 
-void update_camera(Camera_t * camera) {
+void update_camera(Camera_t * camera, float dt) {
+    PROFILE_FUNCTION();
     if (!camera) return;
 
-    float cameraSpeed = .05f;
+    float cameraSpeed = CAMERA_SPEED * dt;
 
     vec3 forwardDelta = screen_to_camera(camera, mouseState.deltaX + CANVAS_WIDTH / 2, mouseState.deltaY + CANVAS_HEIGHT / 2);
     forwardDelta.x = forwardDelta.x * MOUSE_SENSITIVITY;
@@ -1406,36 +2468,15 @@ void print_mouse_state()
     printf("mouse X: %d, Y: %d, dX: %d, dY: %d\n", mouseState.x, mouseState.y, mouseState.deltaX, mouseState.deltaY);
 }
 
-Texture_t loadTextureFromFile(const char * filePath) {
-    Texture_t texture;
-    texture.texture_id = 0;
-
-    int width, height, channels;
-    unsigned char *data = stbi_load(filePath, &width, &height, &channels, 0);
-    if (!data) {
-        fprintf(stderr, "Failed to load texture: %s\n", filePath);
-        return texture;
+void onDefaultProgramReload(GLProgram_t* program, void* user) {
+    // meshes hold their own copy of the program, they all draw with this one.
+    for (uint32_t i = 0; i < pool_count(&s_meshes); ++i) {
+        ((Mesh_t*) pool_at(&s_meshes, i))->program = *program;
     }
 
-    glGenTextures(1, &texture.texture_id);
-    glBindTexture(GL_TEXTURE_2D, texture.texture_id);
-
-    GLenum format = GL_RGB;
-    if (channels == 1) format = GL_RED;
-    else if (channels == 3) format = GL_RGB;
-    else if (channels == 4) format = GL_RGBA;
-
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format,
-                 GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    // Texture parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    stbi_image_free(data);
+    rebindLights(*program);
+}
 
-    return texture;
-}
\ No newline at end of file
+void onQuadProgramReload(GLProgram_t* program, void* user) {
+    setQuadMeshProgram((QuadMesh*) user, *program);
+}
@@ -0,0 +1,870 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "allocator.h"
+#include "gl_gfx.h"
+#include "cooked_texture.h"
+#include "gpu_resources.h"
+
+// Material texture manager.
+//
+// Material textures don't get a GL texture each: same sized, same format textures share a
+// GL_TEXTURE_2D_ARRAY "page", one layer per texture, and small textures (up to
+// MATERIAL_ATLAS_MAX_ENTRY) are packed together into atlas pages with a wrapped border so
+// they still repeat and filter cleanly. A MaterialTexture_t is a handle into this manager;
+// shaders get a page per texture unit plus the layer and uv rect of every slot, so meshes
+// whose textures live in the same pages draw with no texture binds at all.
+//
+// Uncompressed textures are stored as RGBA8 (missing channels read as 0, alpha as 1, the same
+// as a GL_RED / GL_RG / GL_RGB texture), compressed ones keep their block format.
+//
+// Each texture is one GPU resource sized by the layer (or atlas block) it occupies. Array
+// storage can't drop levels of a single layer, so materialTextureResize() moves a texture to a
+// page of other dimensions instead, and materialTrimPages() gives the emptied layers back.
+
+#define MATERIALAPI static
+
+#ifndef MATERIAL_MAX_TEXTURES
+#   define MATERIAL_MAX_TEXTURES 512
+#endif
+
+#define MATERIAL_MAX_PAGES          32
+#define MATERIAL_PAGE_MIN_LAYERS    4
+#define MATERIAL_ATLAS_SIZE         1024
+#define MATERIAL_ATLAS_MAX_ENTRY    256
+#define MATERIAL_ATLAS_PADDING      8
+// a padding of 8 texels still covers one texel at mip 3, coarser mips would bleed.
+#define MATERIAL_ATLAS_LEVELS       4
+#define MATERIAL_ATLAS_ALIGN        (1 << (MATERIAL_ATLAS_LEVELS - 1))
+
+typedef struct MaterialTexture_st MaterialTexture_t;
+typedef struct Material_st        Material_t;
+typedef struct MaterialPage_st    MaterialPage_t;
+typedef struct MaterialEntry_st   MaterialEntry_t;
+
+// 0 is the empty slot. A released slot's generation moves on, so handles to what it held go stale.
+struct MaterialTexture_st {
+    uint16_t id;
+    uint16_t generation;
+};
+
+struct Material_st {
+    MaterialTexture_t textures[TEXTURE_COUNT];
+};
+
+struct MaterialPage_st {
+    GLuint  texture_id;      // GL_TEXTURE_2D_ARRAY
+    GLenum  internal_format;
+    bool    compressed;
+    bool    atlas;
+    int     width, height, levels;
+    int     layer_count;
+    int     layer_capacity;
+    size_t  layer_bytes;     // one layer, all levels
+    int     block_bytes;     // per 4x4 block when compressed
+    int     gpu_resource;    // the whole storage, textures in it are views
+
+    // released layers of a texture page, reused before growing
+    int*    free_layers;
+    int     free_count;
+
+    // atlas shelf packer, only the last layer takes new entries
+    int     shelf_x, shelf_y, shelf_height;
+};
+
+struct MaterialEntry_st {
+    bool     used;
+    bool     visible;        // at least one level holds data
+    uint16_t generation;     // of the handle to the slot, moves on when released
+    int16_t  page;           // -1 until storage is assigned
+    int16_t  layer;
+    int      width, height;
+    float    uv_rect[4];     // scale xy, offset zw inside the layer
+    float    min_lod;        // finest level holding data
+    int      gpu_resource;
+};
+
+MATERIALAPI bool              materialTexturesInit(void);
+MATERIALAPI void              materialTexturesShutdown(void);
+
+// tightly packed 8 bit pixels, mips are built on the CPU.
+MATERIALAPI MaterialTexture_t materialTextureFromPixels(const unsigned char* pixels, int width, int height, int channels);
+MATERIALAPI MaterialTexture_t materialTextureFromCooked(const CookedTexture_t* cooked);
+// new contents for an existing handle, every copy of it stays valid.
+MATERIALAPI bool              materialTextureUpdatePixels(MaterialTexture_t texture, const unsigned char* pixels, int width, int height, int channels);
+MATERIALAPI void              materialTextureRelease(MaterialTexture_t texture);
+
+// streaming: a handle without data (sampled as missing) whose levels get filled over time.
+MATERIALAPI MaterialTexture_t materialTextureReserve(void);
+MATERIALAPI bool              materialTextureAllocate(MaterialTexture_t texture, GLenum internal_format, int width, int height);
+// rows [y, y + height) of `level`; `data` is an offset when a pixel unpack buffer is bound.
+MATERIALAPI void              materialTextureUploadRows(MaterialTexture_t texture, int level, int y, int height, const void* data, size_t size);
+// levels finer than `lod` are never sampled, also marks the texture as holding data.
+MATERIALAPI void              materialTextureSetMinLod(MaterialTexture_t texture, float lod);
+MATERIALAPI bool              materialTextureHasStorage(MaterialTexture_t texture);
+// moves a texture to storage of another size, keeping the levels both share (counted from the
+// coarsest). Levels it gains hold nothing until uploaded, min lod is moved past them.
+MATERIALAPI bool              materialTextureResize(MaterialTexture_t texture, int width, int height);
+// GPU storage materialTextureResize() to width x height would allocate (a new or grown page), and
+// what materialTrimPages() would give back once the layer it leaves is free.
+MATERIALAPI bool              materialTextureResizeCost(MaterialTexture_t texture, int width, int height, size_t* allocated, size_t* released);
+MATERIALAPI int               materialTextureResource(MaterialTexture_t texture);
+// frees the free layers at the end of texture pages and the pages left empty.
+MATERIALAPI void              materialTrimPages(void);
+
+// binds the pages of `material` (skipping units already holding them) and sets the slot uniforms.
+MATERIALAPI void              materialBind(const Material_t* material, const GLProgram_t* program);
+// forget what is bound, for code that binds GL_TEXTURE_2D_ARRAY on units 0..TEXTURE_COUNT-1 itself.
+MATERIALAPI void              materialResetBindings(void);
+// draws sorted on this key share their texture binds. Reads page residency, GL thread only.
+MATERIALAPI uint32_t          materialSortKey(const Material_t* material);
+
+// helpers shared with the streamer
+MATERIALAPI unsigned char*    materialExpandRGBA8(const unsigned char* pixels, int width, int height, int channels);
+MATERIALAPI unsigned char*    materialDownsampleRGBA8(const unsigned char* pixels, int width, int height);
+MATERIALAPI int               materialLevelCount(int width, int height);
+
+#ifdef MATERIAL_IMPLEMENTATION
+
+static struct {
+    MaterialPage_t  pages[MATERIAL_MAX_PAGES];
+    int             page_count;
+
+    MaterialEntry_t entries[MATERIAL_MAX_TEXTURES];   // entries[0] is the empty slot
+    int             entry_count;                      // entries handed out so far, past [0]
+    uint16_t        free_ids[MATERIAL_MAX_TEXTURES];  // released, reused first
+    int             free_count;
+
+    GLuint          bound[TEXTURE_COUNT];
+    bool            initialized;
+} s_material;
+
+static int material__level_dim(int dim, int level) {
+    int d = dim >> level;
+    return d > 0 ? d : 1;
+}
+
+MATERIALAPI int materialLevelCount(int width, int height) {
+    int size   = width > height ? width : height;
+    int levels = 1;
+    while (size > 1) { size >>= 1; levels++; }
+    return levels;
+}
+
+MATERIALAPI unsigned char* materialExpandRGBA8(const unsigned char* pixels, int width, int height, int channels) {
+    size_t         count = (size_t) width * height;
+    unsigned char* out   = mem_alloc(MEM_TAG_ASSETS, count * 4);
+    if (!out) return NULL;
+
+    for (size_t i = 0; i < count; ++i) {
+        const unsigned char* src = pixels + i * channels;
+        unsigned char*       dst = out + i * 4;
+
+        dst[0] = src[0];
+        dst[1] = channels > 1 ? src[1] : 0;
+        dst[2] = channels > 2 ? src[2] : 0;
+        dst[3] = channels > 3 ? src[3] : 255;
+    }
+
+    return out;
+}
+
+// 2x2 box filter, clamping on odd edges.
+MATERIALAPI unsigned char* materialDownsampleRGBA8(const unsigned char* pixels, int width, int height) {
+    int dw = width  > 1 ? width  / 2 : 1;
+    int dh = height > 1 ? height / 2 : 1;
+
+    unsigned char* out = mem_alloc(MEM_TAG_ASSETS, (size_t) dw * dh * 4);
+    if (!out) return NULL;
+
+    for (int y = 0; y < dh; ++y) {
+        int y0 = y * 2 < height ? y * 2 : height - 1;
+        int y1 = y0 + 1 < height ? y0 + 1 : y0;
+
+        for (int x = 0; x < dw; ++x) {
+            int x0 = x * 2 < width ? x * 2 : width - 1;
+            int x1 = x0 + 1 < width ? x0 + 1 : x0;
+
+            for (int k = 0; k < 4; ++k) {
+                int sum = pixels[((size_t) y0 * width + x0) * 4 + k] + pixels[((size_t) y0 * width + x1) * 4 + k]
+                        + pixels[((size_t) y1 * width + x0) * 4 + k] + pixels[((size_t) y1 * width + x1) * 4 + k];
+                out[((size_t) y * dw + x) * 4 + k] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+
+    return out;
+}
+
+static MaterialEntry_t* material__entry(MaterialTexture_t texture) {
+    if (texture.id == 0 || texture.id >= MATERIAL_MAX_TEXTURES) return NULL;
+
+    MaterialEntry_t* entry = &s_material.entries[texture.id];
+    return entry->used && entry->generation == texture.generation ? entry : NULL;
+}
+
+static MaterialTexture_t material__handle(const MaterialEntry_t* entry) {
+    return (MaterialTexture_t) { (uint16_t)(entry - s_material.entries), entry->generation };
+}
+
+static MaterialTexture_t material__new_entry(void) {
+    int id;
+    if (s_material.free_count > 0) {
+        id = s_material.free_ids[--s_material.free_count];
+    } else if (s_material.entry_count < MATERIAL_MAX_TEXTURES - 1) {
+        id = 1 + s_material.entry_count++;
+    } else {
+        fprintf(stderr, "material: out of texture slots (%d)\n", MATERIAL_MAX_TEXTURES);
+        return (MaterialTexture_t) {0};
+    }
+
+    MaterialEntry_t* entry = &s_material.entries[id];
+    *entry = (MaterialEntry_t) {
+        .used       = true,
+        .generation = entry->generation,
+        .page       = -1,
+        .layer      = -1,
+        .uv_rect    = { 1.0f, 1.0f, 0.0f, 0.0f }
+    };
+    entry->gpu_resource = gpuResourceTrackView(GPU_RESOURCE_TEXTURE, 0, 0, "material texture");
+    return material__handle(entry);
+}
+
+// uploads happen on the unit after the material ones so cached bindings stay valid.
+static void material__bind_for_upload(const MaterialPage_t* page) {
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_COUNT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, page->texture_id);
+}
+
+static void material__end_upload(void) {
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// one layer of every level, `block_bytes` 0 for RGBA8.
+static size_t material__layer_size(int block_bytes, int width, int height, int levels) {
+    size_t bytes = 0;
+
+    for (int level = 0; level < levels; ++level) {
+        int lw = material__level_dim(width, level);
+        int lh = material__level_dim(height, level);
+
+        bytes += block_bytes ? (size_t)((lw + 3) / 4) * ((lh + 3) / 4) * block_bytes : (size_t) lw * lh * 4;
+    }
+
+    return bytes;
+}
+
+// (re)creates the page storage with room for `capacity` layers, keeping the current ones that fit.
+static bool material__grow_page(MaterialPage_t* page, int capacity) {
+    // before touching the storage, a failure leaves the page as it was.
+    int* free_layers = mem_realloc(MEM_TAG_ASSETS, page->free_layers, (size_t) capacity * sizeof(int));
+    if (!free_layers) return false;
+    page->free_layers = free_layers;
+
+    GLuint texture_id = 0;
+
+    glGenTextures(1, &texture_id);
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_COUNT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture_id);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, page->levels, page->internal_format, page->width, page->height, capacity);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, page->atlas ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, page->atlas ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    if (!page->layer_bytes) {
+        if (page->compressed) {
+            GLint size = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D_ARRAY, 0, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+            page->block_bytes = size / capacity / (((page->width + 3) / 4) * ((page->height + 3) / 4));
+        }
+        page->layer_bytes = material__layer_size(page->block_bytes, page->width, page->height, page->levels);
+    }
+
+    material__end_upload();
+
+    if (page->texture_id) {
+        int layers = page->layer_count < capacity ? page->layer_count : capacity;
+
+        for (int level = 0; level < page->levels && layers > 0; ++level) {
+            glCopyImageSubData(page->texture_id, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+                               texture_id,       GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+                               material__level_dim(page->width, level), material__level_dim(page->height, level),
+                               layers);
+        }
+
+        glDeleteTextures(1, &page->texture_id);
+        // the old name may come back for another page, the cache can't be trusted anymore.
+        materialResetBindings();
+    }
+
+    page->texture_id     = texture_id;
+    page->layer_capacity = capacity;
+
+    if (page->gpu_resource) gpuResourceUpdate(page->gpu_resource, texture_id, (size_t) capacity * page->layer_bytes);
+    else page->gpu_resource = gpuResourceTrack(GPU_RESOURCE_TEXTURE, texture_id, (size_t) capacity * page->layer_bytes, "material page");
+
+    return true;
+}
+
+static int material__existing_page(GLenum internal_format, int width, int height, bool atlas) {
+    for (int i = 0; i < s_material.page_count; ++i) {
+        MaterialPage_t* page = &s_material.pages[i];
+        if (page->atlas != atlas || page->internal_format != internal_format) continue;
+        if (atlas || (page->width == width && page->height == height)) return i;
+    }
+
+    return -1;
+}
+
+static int material__find_page(GLenum internal_format, int width, int height, bool atlas) {
+    int existing = material__existing_page(internal_format, width, height, atlas);
+    if (existing >= 0) return existing;
+
+    if (s_material.page_count >= MATERIAL_MAX_PAGES) {
+        fprintf(stderr, "material: out of texture pages (%d)\n", MATERIAL_MAX_PAGES);
+        return -1;
+    }
+
+    MaterialPage_t* page = &s_material.pages[s_material.page_count];
+    *page = (MaterialPage_t) {
+        .internal_format = internal_format,
+        .compressed      = internal_format != GL_RGBA8,
+        .atlas           = atlas,
+        .width           = atlas ? MATERIAL_ATLAS_SIZE : width,
+        .height          = atlas ? MATERIAL_ATLAS_SIZE : height,
+        .levels          = atlas ? MATERIAL_ATLAS_LEVELS : materialLevelCount(width, height)
+    };
+
+    if (!material__grow_page(page, MATERIAL_PAGE_MIN_LAYERS)) return -1;
+
+    return s_material.page_count++;
+}
+
+static int material__take_layer(MaterialPage_t* page) {
+    if (page->free_count > 0) return page->free_layers[--page->free_count];
+
+    if (page->layer_count == page->layer_capacity) {
+        int capacity = page->layer_capacity ? page->layer_capacity * 2 : MATERIAL_PAGE_MIN_LAYERS;
+        if (!material__grow_page(page, capacity)) return -1;
+    }
+
+    return page->layer_count++;
+}
+
+MATERIALAPI bool materialTexturesInit(void) {
+    if (s_material.initialized) return true;
+
+    memset(&s_material, 0, sizeof(s_material));
+    s_material.initialized = true;
+
+    return true;
+}
+
+MATERIALAPI void materialTexturesShutdown(void) {
+    if (!s_material.initialized) return;
+
+    for (int i = 0; i < s_material.page_count; ++i) {
+        glDeleteTextures(1, &s_material.pages[i].texture_id);
+        mem_free(s_material.pages[i].free_layers);
+        gpuResourceUntrack(s_material.pages[i].gpu_resource);
+    }
+
+    for (int i = 1; i < MATERIAL_MAX_TEXTURES; ++i) {
+        if (s_material.entries[i].used) gpuResourceUntrack(s_material.entries[i].gpu_resource);
+    }
+
+    memset(&s_material, 0, sizeof(s_material));
+}
+
+MATERIALAPI MaterialTexture_t materialTextureReserve(void) {
+    return material__new_entry();
+}
+
+// atlas space is not reclaimed, only whole layers of texture pages are. A same sized update
+// keeps its atlas block instead (materialTextureUpdatePixels).
+static void material__drop_storage(MaterialEntry_t* entry) {
+    if (entry->page >= 0 && !s_material.pages[entry->page].atlas) {
+        MaterialPage_t* page = &s_material.pages[entry->page];
+        page->free_layers[page->free_count++] = entry->layer;
+    }
+
+    entry->page    = -1;
+    entry->layer   = -1;
+    entry->visible = false;
+
+    gpuResourceUpdate(entry->gpu_resource, 0, 0);
+}
+
+MATERIALAPI bool materialTextureAllocate(MaterialTexture_t texture, GLenum internal_format, int width, int height) {
+    MaterialEntry_t* entry = material__entry(texture);
+    if (!entry) return false;
+
+    material__drop_storage(entry);
+
+    int page_index = material__find_page(internal_format, width, height, false);
+    if (page_index < 0) return false;
+
+    int layer = material__take_layer(&s_material.pages[page_index]);
+    if (layer < 0) return false;
+
+    entry->page       = (int16_t) page_index;
+    entry->layer      = (int16_t) layer;
+    entry->width      = width;
+    entry->height     = height;
+    entry->visible    = false;
+    entry->min_lod    = 0.0f;
+    entry->uv_rect[0] = 1.0f;
+    entry->uv_rect[1] = 1.0f;
+    entry->uv_rect[2] = 0.0f;
+    entry->uv_rect[3] = 0.0f;
+
+    gpuResourceUpdate(entry->gpu_resource, s_material.pages[page_index].texture_id, s_material.pages[page_index].layer_bytes);
+
+    return true;
+}
+
+MATERIALAPI bool materialTextureHasStorage(MaterialTexture_t texture) {
+    MaterialEntry_t* entry = material__entry(texture);
+    return entry && entry->page >= 0;
+}
+
+static void material__upload(const MaterialPage_t* page, int layer, int level, int x, int y, int width, int height,
+                             const void* data, size_t size) {
+    if (page->compressed) {
+        glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, x, y, layer, width, height, 1,
+                                  page->internal_format, (GLsizei) size, data);
+    } else {
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, x, y, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    }
+
+    renderStatsUpload(page->compressed ? size : (uint64_t) width * height * 4);
+}
+
+MATERIALAPI void materialTextureUploadRows(MaterialTexture_t texture, int level, int y, int height, const void* data, size_t size) {
+    MaterialEntry_t* entry = material__entry(texture);
+    if (!entry || entry->page < 0) return;
+
+    MaterialPage_t* page = &s_material.pages[entry->page];
+
+    material__bind_for_upload(page);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    material__upload(page, entry->layer, level, 0, y, material__level_dim(entry->width, level), height, data, size);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    material__end_upload();
+}
+
+MATERIALAPI void materialTextureSetMinLod(MaterialTexture_t texture, float lod) {
+    MaterialEntry_t* entry = material__entry(texture);
+    if (!entry) return;
+
+    entry->min_lod = lod;
+    entry->visible = true;
+}
+
+// whole mip chain of an RGBA8 image into its own layer.
+static bool material__store_layer(MaterialEntry_t* entry, const unsigned char* rgba, int width, int height) {
+    MaterialTexture_t handle = material__handle(entry);
+
+    if (!materialTextureAllocate(handle, GL_RGBA8, width, height)) return false;
+
+    MaterialPage_t*      page  = &s_material.pages[entry->page];
+    const unsigned char* level = rgba;
+    int                  lw    = width;
+    int                  lh    = height;
+
+    material__bind_for_upload(page);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (int l = 0; l < page->levels; ++l) {
+        material__upload(page, entry->layer, l, 0, 0, lw, lh, level, 0);
+        if (l + 1 == page->levels) break;
+
+        unsigned char* next = materialDownsampleRGBA8(level, lw, lh);
+        if (level != rgba) mem_free((void*) level);
+        if (!next) break;
+
+        level = next;
+        lw    = material__level_dim(width,  l + 1);
+        lh    = material__level_dim(height, l + 1);
+    }
+
+    if (level != rgba) mem_free((void*) level);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    material__end_upload();
+
+    entry->visible = true;
+    return true;
+}
+
+// padded block in an atlas page, the border repeats the opposite edge so UVs can wrap.
+static bool material__store_atlas(MaterialEntry_t* entry, const unsigned char* rgba, int width, int height) {
+    int pad      = MATERIAL_ATLAS_PADDING;
+    int block_w  = (width  + 2 * pad + MATERIAL_ATLAS_ALIGN - 1) & ~(MATERIAL_ATLAS_ALIGN - 1);
+    int block_h  = (height + 2 * pad + MATERIAL_ATLAS_ALIGN - 1) & ~(MATERIAL_ATLAS_ALIGN - 1);
+
+    int page_index, layer, x, y;
+
+    if (entry->page >= 0) {
+        // the block of the previous pixels, same size.
+        page_index = entry->page;
+        layer      = entry->layer;
+        x          = (int)(entry->uv_rect[2] * MATERIAL_ATLAS_SIZE) - pad;
+        y          = (int)(entry->uv_rect[3] * MATERIAL_ATLAS_SIZE) - pad;
+    } else {
+        page_index = material__find_page(GL_RGBA8, 0, 0, true);
+        if (page_index < 0) return false;
+
+        MaterialPage_t* page = &s_material.pages[page_index];
+
+        if (page->layer_count == 0 || page->shelf_x + block_w > page->width) {
+            page->shelf_x      = 0;
+            page->shelf_y     += page->shelf_height;
+            page->shelf_height = 0;
+        }
+
+        if (page->layer_count == 0 || page->shelf_y + block_h > page->height) {
+            if (material__take_layer(page) < 0) return false;
+            page->shelf_x = page->shelf_y = page->shelf_height = 0;
+        }
+
+        x     = page->shelf_x;
+        y     = page->shelf_y;
+        layer = page->layer_count - 1;
+
+        page->shelf_x += block_w;
+        if (block_h > page->shelf_height) page->shelf_height = block_h;
+    }
+
+    MaterialPage_t* page = &s_material.pages[page_index];
+
+    unsigned char* block = mem_alloc(MEM_TAG_ASSETS, (size_t) block_w * block_h * 4);
+    if (!block) return false;
+
+    for (int by = 0; by < block_h; ++by) {
+        int sy = ((by - pad) % height + height) % height;
+
+        for (int bx = 0; bx < block_w; ++bx) {
+            int sx = ((bx - pad) % width + width) % width;
+            memcpy(block + ((size_t) by * block_w + bx) * 4, rgba + ((size_t) sy * width + sx) * 4, 4);
+        }
+    }
+
+    material__bind_for_upload(page);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    unsigned char* level = block;
+    for (int l = 0; l < page->levels; ++l) {
+        material__upload(page, layer, l, x >> l, y >> l, block_w >> l, block_h >> l, level, 0);
+        if (l + 1 == page->levels) break;
+
+        unsigned char* next = materialDownsampleRGBA8(level, block_w >> l, block_h >> l);
+        mem_free(level);
+        level = next;
+        if (!level) break;
+    }
+    mem_free(level);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    material__end_upload();
+
+    float inv = 1.0f / (float) MATERIAL_ATLAS_SIZE;
+
+    entry->page       = (int16_t) page_index;
+    entry->layer      = (int16_t) layer;
+    entry->width      = width;
+    entry->height     = height;
+    entry->uv_rect[0] = width  * inv;
+    entry->uv_rect[1] = height * inv;
+    entry->uv_rect[2] = (x + pad) * inv;
+    entry->uv_rect[3] = (y + pad) * inv;
+    entry->min_lod    = 0.0f;
+    entry->visible    = true;
+
+    // a padded block and its 3 coarser levels.
+    gpuResourceUpdate(entry->gpu_resource, page->texture_id, (size_t) block_w * block_h * 4 * 4 / 3);
+
+    return true;
+}
+
+static bool material__store_pixels(MaterialEntry_t* entry, const unsigned char* pixels, int width, int height, int channels) {
+    unsigned char* rgba = channels == 4 ? (unsigned char*) pixels : materialExpandRGBA8(pixels, width, height, channels);
+    if (!rgba) return false;
+
+    bool ok = width <= MATERIAL_ATLAS_MAX_ENTRY && height <= MATERIAL_ATLAS_MAX_ENTRY
+            ? material__store_atlas(entry, rgba, width, height)
+            : material__store_layer(entry, rgba, width, height);
+
+    if (rgba != pixels) mem_free(rgba);
+    return ok;
+}
+
+MATERIALAPI MaterialTexture_t materialTextureFromPixels(const unsigned char* pixels, int width, int height, int channels) {
+    MaterialTexture_t texture = material__new_entry();
+    if (!texture.id) return texture;
+
+    if (!pixels || !material__store_pixels(material__entry(texture), pixels, width, height, channels)) {
+        materialTextureRelease(texture);
+        return (MaterialTexture_t) {0};
+    }
+
+    return texture;
+}
+
+MATERIALAPI MaterialTexture_t materialTextureFromCooked(const CookedTexture_t* cooked) {
+    const CookedTextureHeader_t* header = cooked->header;
+
+    // small or non RGBA textures are re-mipped from level 0, the padding has to be filtered with them.
+    if (!(header->flags & COOKED_TEXTURE_FLAG_COMPRESSED)
+        && (header->channels != 4 || (header->width <= MATERIAL_ATLAS_MAX_ENTRY && header->height <= MATERIAL_ATLAS_MAX_ENTRY))) {
+        return materialTextureFromPixels(cooked->data + header->levels[0].offset, (int) header->width, (int) header->height, (int) header->channels);
+    }
+
+    MaterialTexture_t texture = material__new_entry();
+    if (!texture.id) return texture;
+
+    GLenum format = (header->flags & COOKED_TEXTURE_FLAG_COMPRESSED) ? header->gl_internal_format : GL_RGBA8;
+    if (!materialTextureAllocate(texture, format, (int) header->width, (int) header->height)) {
+        materialTextureRelease(texture);
+        return (MaterialTexture_t) {0};
+    }
+
+    MaterialEntry_t* entry = material__entry(texture);
+    MaterialPage_t*  page  = &s_material.pages[entry->page];
+    uint32_t         count = header->level_count < (uint32_t) page->levels ? header->level_count : (uint32_t) page->levels;
+
+    material__bind_for_upload(page);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (uint32_t l = 0; l < count; ++l) {
+        const CookedTextureLevel_t* level = &header->levels[l];
+        material__upload(page, entry->layer, (int) l, 0, 0, (int) level->width, (int) level->height,
+                         cooked->data + level->offset, level->size);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    material__end_upload();
+
+    entry->visible = true;
+    return texture;
+}
+
+MATERIALAPI bool materialTextureUpdatePixels(MaterialTexture_t texture, const unsigned char* pixels, int width, int height, int channels) {
+    MaterialEntry_t* entry = material__entry(texture);
+    if (!entry || !pixels) return false;
+
+    // a same sized texture gets its old layer back from the free list, or keeps its atlas block.
+    bool same_block = entry->page >= 0 && s_material.pages[entry->page].atlas && entry->width == width && entry->height == height;
+    if (!same_block) material__drop_storage(entry);
+
+    return material__store_pixels(entry, pixels, width, height, channels);
+}
+
+MATERIALAPI void materialTextureRelease(MaterialTexture_t texture) {
+    MaterialEntry_t* entry = material__entry(texture);
+    if (!entry) return;
+
+    material__drop_storage(entry);
+    gpuResourceUntrack(entry->gpu_resource);
+    *entry = (MaterialEntry_t) { .generation = (uint16_t)(entry->generation + 1) };
+
+    s_material.free_ids[s_material.free_count++] = texture.id;
+}
+
+MATERIALAPI int materialTextureResource(MaterialTexture_t texture) {
+    MaterialEntry_t* entry = material__entry(texture);
+    return entry ? entry->gpu_resource : 0;
+}
+
+MATERIALAPI bool materialTextureResize(MaterialTexture_t texture, int width, int height) {
+    MaterialEntry_t* entry = material__entry(texture);
+    if (!entry || entry->page < 0 || s_material.pages[entry->page].atlas) return false;
+
+    MaterialPage_t* old = &s_material.pages[entry->page];
+    if (old->width == width && old->height == height) return true;
+
+    int page_index = material__find_page(old->internal_format, width, height, false);
+    if (page_index < 0) return false;
+
+    MaterialPage_t* page  = &s_material.pages[page_index];
+    int             layer = material__take_layer(page);
+    if (layer < 0) return false;
+
+    // level l of the old storage is level l + shift of the new one.
+    int shift = page->levels - old->levels;
+
+    for (int level = 0; level < old->levels; ++level) {
+        int target = level + shift;
+        if (target < 0 || target >= page->levels) continue;
+
+        glCopyImageSubData(old->texture_id,  GL_TEXTURE_2D_ARRAY, level,  0, 0, entry->layer,
+                           page->texture_id, GL_TEXTURE_2D_ARRAY, target, 0, 0, layer,
+                           material__level_dim(width, target), material__level_dim(height, target), 1);
+    }
+
+    old->free_layers[old->free_count++] = entry->layer;
+
+    float min_lod = entry->min_lod + (float) shift;
+
+    entry->page    = (int16_t) page_index;
+    entry->layer   = (int16_t) layer;
+    entry->width   = width;
+    entry->height  = height;
+    entry->min_lod = min_lod > 0.0f ? min_lod : 0.0f;
+
+    gpuResourceUpdate(entry->gpu_resource, page->texture_id, page->layer_bytes);
+
+    return true;
+}
+
+static bool material__layer_is_free(const MaterialPage_t* page, int layer, int* index) {
+    for (int i = 0; i < page->free_count; ++i) {
+        if (page->free_layers[i] == layer) {
+            *index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// what materialTrimPages() leaves of a page holding `layer_count` layers.
+static int material__trimmed_capacity(const MaterialPage_t* page, int layer_count) {
+    if (layer_count == 0) return 0;
+
+    int capacity = page->layer_capacity;
+    while (capacity / 2 >= layer_count && capacity / 2 >= MATERIAL_PAGE_MIN_LAYERS) capacity /= 2;
+    return capacity;
+}
+
+MATERIALAPI bool materialTextureResizeCost(MaterialTexture_t texture, int width, int height, size_t* allocated, size_t* released) {
+    MaterialEntry_t* entry = material__entry(texture);
+    if (!entry || entry->page < 0 || s_material.pages[entry->page].atlas) return false;
+
+    const MaterialPage_t* old = &s_material.pages[entry->page];
+    *allocated = *released = 0;
+
+    if (old->width == width && old->height == height) return true;
+
+    // same rules as material__take_layer(): a free layer, or the page doubles, or a new page.
+    int index = material__existing_page(old->internal_format, width, height, false);
+    if (index < 0) {
+        int levels = materialLevelCount(width, height);
+        *allocated = MATERIAL_PAGE_MIN_LAYERS * material__layer_size(old->block_bytes, width, height, levels);
+    } else {
+        const MaterialPage_t* page = &s_material.pages[index];
+        if (page->free_count == 0 && page->layer_count == page->layer_capacity) {
+            int grown  = page->layer_capacity ? page->layer_capacity * 2 : MATERIAL_PAGE_MIN_LAYERS;
+            *allocated = (size_t)(grown - page->layer_capacity) * page->layer_bytes;
+        }
+    }
+
+    // trimming only drops free layers at the end of the page.
+    int count = old->layer_count;
+    int free_index;
+    while (count > 0 && (count - 1 == entry->layer || material__layer_is_free(old, count - 1, &free_index))) count--;
+
+    *released = (size_t)(old->layer_capacity - material__trimmed_capacity(old, count)) * old->layer_bytes;
+    return true;
+}
+
+MATERIALAPI void materialTrimPages(void) {
+    for (int i = 0; i < s_material.page_count; ++i) {
+        MaterialPage_t* page = &s_material.pages[i];
+        if (page->atlas || !page->texture_id) continue;
+
+        int index;
+        while (page->layer_count > 0 && material__layer_is_free(page, page->layer_count - 1, &index)) {
+            page->free_layers[index] = page->free_layers[--page->free_count];
+            page->layer_count--;
+        }
+
+        if (page->layer_count == 0) {
+            glDeleteTextures(1, &page->texture_id);
+            materialResetBindings();
+
+            page->texture_id     = 0;
+            page->layer_capacity = 0;
+            page->free_count     = 0;
+
+            gpuResourceUpdate(page->gpu_resource, 0, 0);
+            continue;
+        }
+
+        int capacity = material__trimmed_capacity(page, page->layer_count);
+
+        if (capacity < page->layer_capacity && material__grow_page(page, capacity)) {
+            // layers moved to new storage.
+            for (int e = 1; e < MATERIAL_MAX_TEXTURES; ++e) {
+                MaterialEntry_t* entry = &s_material.entries[e];
+                if (entry->used && entry->page == i) gpuResourceUpdate(entry->gpu_resource, page->texture_id, page->layer_bytes);
+            }
+        }
+    }
+}
+
+MATERIALAPI void materialResetBindings(void) {
+    for (int i = 0; i < TEXTURE_COUNT; ++i) s_material.bound[i] = (GLuint) -1;
+}
+
+MATERIALAPI void materialBind(const Material_t* material, const GLProgram_t* program) {
+    GLint  layers[TEXTURE_COUNT];
+    float  rects[TEXTURE_COUNT * 4];
+    float  lods[TEXTURE_COUNT];
+    bool   switched = false;
+
+    for (int i = 0; i < TEXTURE_COUNT; ++i) {
+        const MaterialEntry_t* entry = material__entry(material->textures[i]);
+
+        layers[i]        = -1;
+        lods[i]          = 0.0f;
+        rects[i * 4 + 0] = 1.0f;
+        rects[i * 4 + 1] = 1.0f;
+        rects[i * 4 + 2] = 0.0f;
+        rects[i * 4 + 3] = 0.0f;
+
+        if (!entry) continue;
+
+        gpuResourceTouch(entry->gpu_resource);
+        if (entry->page < 0 || !entry->visible) continue;
+
+        GLuint texture_id = s_material.pages[entry->page].texture_id;
+        if (s_material.bound[i] != texture_id) {
+            glActiveTexture(GL_TEXTURE0 + i);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, texture_id);
+            s_material.bound[i] = texture_id;
+            switched            = true;
+
+            renderStatsBind(RENDER_STATE_TEXTURE0 + i, texture_id);
+        }
+
+        layers[i] = entry->layer;
+        lods[i]   = entry->min_lod;
+        memcpy(&rects[i * 4], entry->uv_rect, sizeof(entry->uv_rect));
+    }
+
+    if (switched) glActiveTexture(GL_TEXTURE0);
+
+    glUniform1iv(program->texture_layers_loc,   TEXTURE_COUNT, layers);
+    glUniform4fv(program->texture_uv_rects_loc, TEXTURE_COUNT, rects);
+    glUniform1fv(program->texture_min_lods_loc, TEXTURE_COUNT, lods);
+}
+
+MATERIALAPI uint32_t materialSortKey(const Material_t* material) {
+    uint32_t key = 0;
+
+    for (int i = 0; i < TEXTURE_COUNT; ++i) {
+        const MaterialEntry_t* entry = material__entry(material->textures[i]);
+        uint32_t page = entry && entry->page >= 0 ? (uint32_t) entry->page + 1 : 0;
+        key = (key << 8) | (page & 0xFF);
+    }
+
+    return key;
+}
+
+#endif // MATERIAL_IMPLEMENTATION
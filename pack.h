@@ -0,0 +1,425 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "file.h"
+#include "jobs.h"
+#include "lz_codec.h"
+
+// Asset pack archive (.pack), written offline by tools/pack.c.
+//
+// One file holding every asset back to back, each entry starting on a PACK_ALIGNMENT boundary
+// (cooked textures keep their own alignment inside it). The directory at the end is sorted by
+// the 64 bit hash of the normalized path, so a lookup is a binary search over a few cache lines
+// and never touches the file system. pack_mount() maps the archive and installs a read_file() /
+// map_file() resolver: paths found in a mounted pack are served from the mapping, anything else
+// still comes from loose files, so development builds simply don't mount one.
+//
+// Layout: PackHeader_t | entry data... | PackEntry_t[entry_count] | path names (NUL terminated)
+//
+// Entries built with `pack -z` may be compressed (lz_codec.h) in independent chunks of
+// header.chunk_size bytes: the entry data is a uint32_t table with the stored size of every
+// chunk (PACK_CHUNK_RAW set when the chunk didn't compress and is stored as is), then the
+// chunks back to back. Chunks decode in parallel on the job pool straight into the caller's
+// buffer, so a compressed entry costs one heap allocation and no staging copy. Those can't be
+// handed out as views: read_file() / map_file() get an owned, decompressed buffer instead.
+
+// inline: the builder shares the format half and never mounts, unused ones stay quiet.
+#define PACKAPI static inline
+
+#define PACK_MAGIC      0x4B434150u  // "PACK"
+#define PACK_VERSION    2
+#define PACK_ALIGNMENT  64
+#define PACK_MAX_MOUNTS 8
+#define PACK_EXTENSION  ".pack"
+
+#define PACK_DEFAULT_CHUNK_SIZE (128u * 1024)
+#define PACK_ENTRY_COMPRESSED   0x1u
+#define PACK_CHUNK_RAW          0x80000000u  // in a chunk table entry
+
+typedef struct PackHeader_st PackHeader_t;
+typedef struct PackEntry_st  PackEntry_t;
+typedef struct Pack_st       Pack_t;
+
+struct PackHeader_st {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t flags;
+    uint64_t directory_offset;  // PackEntry_t[entry_count]
+    uint64_t names_offset;
+    uint64_t names_size;
+    uint32_t chunk_size;        // uncompressed bytes per chunk of compressed entries
+    uint32_t reserved;
+};
+
+struct PackEntry_st {
+    uint64_t path_hash;         // pack_hash_path() of the normalized path, the sort key
+    uint64_t offset;            // from the start of the archive
+    uint64_t size;              // of the data, decompressed
+    uint64_t stored_size;       // bytes in the archive, chunk table included
+    uint32_t flags;             // PACK_ENTRY_*
+    uint32_t checksum;          // pack_checksum() of the decompressed data
+    uint32_t name_offset;       // in the names block, to tell colliding hashes apart
+    uint32_t reserved;
+};
+
+struct Pack_st {
+    File_t                file;
+    const PackHeader_t*   header;
+    const PackEntry_t*    entries;
+    const char*           names;
+};
+
+// maps the archive and puts it in front of the loose files. Later mounts win over earlier ones.
+PACKAPI Pack_t*            pack_mount(const char* path);
+PACKAPI void               pack_unmount(Pack_t* pack);
+PACKAPI void               pack_unmount_all(void);
+
+PACKAPI const PackEntry_t* pack_find(const Pack_t* pack, const char* path);
+PACKAPI const char*        pack_entry_name(const Pack_t* pack, const PackEntry_t* entry);
+PACKAPI const void*        pack_entry_data(const Pack_t* pack, const PackEntry_t* entry);
+// copies or decompresses the entry into `dst` (entry->size bytes). False on corrupt chunks.
+PACKAPI bool               pack_entry_read(const Pack_t* pack, const PackEntry_t* entry, void* dst);
+// checks every entry against its checksum, false on the first mismatch.
+PACKAPI bool               pack_verify(const Pack_t* pack);
+// compression ratio and decompression throughput of the loads served so far.
+PACKAPI void               pack_print_stats(void);
+
+// shared with the builder
+PACKAPI size_t             pack_normalize_path(const char* path, char* out, size_t out_size);
+PACKAPI uint64_t           pack_hash_path(const char* normalized);
+PACKAPI uint32_t           pack_checksum(const void* data, size_t size);
+
+#ifdef PACK_IMPLEMENTATION
+
+uint64_t get_time_ns();
+
+static struct {
+    Pack_t*              mounts[PACK_MAX_MOUNTS];
+    int                  mount_count;
+
+    // compressed loads, updated from any loading thread
+    atomic_uint_fast64_t decompressed_files;
+    atomic_uint_fast64_t stored_bytes;
+    atomic_uint_fast64_t decompressed_bytes;
+    atomic_uint_fast64_t decompress_ns;
+} s_pack;
+
+// "./a\\b//c.png" -> "a/b/c.png"
+PACKAPI size_t pack_normalize_path(const char* path, char* out, size_t out_size) {
+    size_t n = 0;
+
+    while (path[0] == '.' && (path[1] == '/' || path[1] == '\\')) path += 2;
+
+    for (const char* c = path; *c && n + 1 < out_size; ++c) {
+        char ch = *c == '\\' ? '/' : *c;
+        if (ch == '/' && (n == 0 || out[n - 1] == '/')) continue;
+        if (ch == '.' && (n == 0 || out[n - 1] == '/') && (c[1] == '/' || c[1] == '\\')) { ++c; continue; }
+        out[n++] = ch;
+    }
+
+    out[n] = '\0';
+    return n;
+}
+
+// FNV-1a
+PACKAPI uint64_t pack_hash_path(const char* normalized) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const unsigned char* c = (const unsigned char*) normalized; *c; ++c) {
+        hash ^= *c;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+PACKAPI uint32_t pack_checksum(const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*) data;
+    uint32_t             hash  = 0x811c9dc5u;
+
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x01000193u;
+    }
+    return hash;
+}
+
+// also points entries / names into the mapping.
+static bool pack__validate(Pack_t* pack) {
+    const PackHeader_t* header = pack->header;
+    uint64_t            size   = pack->file.size;
+
+    if (size < sizeof(PackHeader_t))                       return false;
+    if (header->magic != PACK_MAGIC)                       return false;
+    if (header->version != PACK_VERSION)                   return false;
+    if (header->directory_offset % sizeof(uint64_t) != 0)  return false;
+    if (header->directory_offset + (uint64_t) header->entry_count * sizeof(PackEntry_t) > size) return false;
+    if (header->names_offset + header->names_size > size)  return false;
+
+    pack->entries = (const PackEntry_t*)(pack->file.data + header->directory_offset);
+    pack->names   = pack->file.data + header->names_offset;
+
+    if (header->names_size == 0 || pack->names[header->names_size - 1] != '\0') return false;
+
+    for (uint32_t i = 0; i < header->entry_count; ++i) {
+        const PackEntry_t* entry = &pack->entries[i];
+        if (entry->offset + entry->stored_size > size)     return false;
+        if (entry->name_offset >= header->names_size)      return false;
+
+        if (entry->flags & PACK_ENTRY_COMPRESSED) {
+            if (header->chunk_size == 0 || header->chunk_size >= PACK_CHUNK_RAW) return false;
+
+            uint64_t chunk_count = (entry->size + header->chunk_size - 1) / header->chunk_size;
+            if (entry->stored_size < chunk_count * sizeof(uint32_t)) return false;
+        } else if (entry->stored_size != entry->size) {
+            return false;
+        }
+
+        if (i > 0 && pack->entries[i - 1].path_hash > entry->path_hash) return false;
+    }
+
+    return true;
+}
+
+PACKAPI const PackEntry_t* pack_find(const Pack_t* pack, const char* path) {
+    char normalized[512];
+    pack_normalize_path(path, normalized, sizeof(normalized));
+
+    uint64_t hash = pack_hash_path(normalized);
+    uint32_t lo   = 0;
+    uint32_t hi   = pack->header->entry_count;
+
+    // lower bound, then walk the (very rare) run of equal hashes.
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (pack->entries[mid].path_hash < hash) lo = mid + 1;
+        else                                     hi = mid;
+    }
+
+    for (uint32_t i = lo; i < pack->header->entry_count && pack->entries[i].path_hash == hash; ++i) {
+        if (strcmp(pack->names + pack->entries[i].name_offset, normalized) == 0) return &pack->entries[i];
+    }
+
+    return NULL;
+}
+
+PACKAPI const char* pack_entry_name(const Pack_t* pack, const PackEntry_t* entry) {
+    return pack->names + entry->name_offset;
+}
+
+PACKAPI const void* pack_entry_data(const Pack_t* pack, const PackEntry_t* entry) {
+    return pack->file.data + entry->offset;
+}
+
+typedef struct PackDecode_st {
+    const uint32_t*       stored;       // chunk table
+    const uint8_t*        chunks;
+    const uint64_t*       chunk_offsets;
+    uint8_t*              dst;
+    uint64_t              size;
+    uint32_t              chunk_size;
+    atomic_bool           failed;
+} PackDecode_t;
+
+static void pack__decode_chunks(int begin, int end, void* user) {
+    PackDecode_t* decode = (PackDecode_t*) user;
+
+    for (int i = begin; i < end && !atomic_load(&decode->failed); ++i) {
+        uint64_t       out_offset = (uint64_t) i * decode->chunk_size;
+        size_t         out_size   = (size_t)(decode->size - out_offset < decode->chunk_size ? decode->size - out_offset : decode->chunk_size);
+        const uint8_t* src        = decode->chunks + decode->chunk_offsets[i];
+        size_t         src_size   = decode->stored[i] & ~PACK_CHUNK_RAW;
+        bool           ok;
+
+        if (decode->stored[i] & PACK_CHUNK_RAW) {
+            ok = src_size == out_size;
+            if (ok) memcpy(decode->dst + out_offset, src, out_size);
+        } else {
+            ok = lz_decompress(src, src_size, decode->dst + out_offset, out_size);
+        }
+
+        if (!ok) atomic_store(&decode->failed, true);
+    }
+}
+
+PACKAPI bool pack_entry_read(const Pack_t* pack, const PackEntry_t* entry, void* dst) {
+    if (!(entry->flags & PACK_ENTRY_COMPRESSED)) {
+        memcpy(dst, pack_entry_data(pack, entry), (size_t) entry->size);
+        return true;
+    }
+
+    uint64_t begin       = get_time_ns();
+    uint32_t chunk_size  = pack->header->chunk_size;
+    int      chunk_count = (int)((entry->size + chunk_size - 1) / chunk_size);
+    uint64_t table_size  = (uint64_t) chunk_count * sizeof(uint32_t);
+
+    uint64_t* chunk_offsets = mem_alloc(MEM_TAG_IO, ((size_t) chunk_count + 1) * sizeof(uint64_t));
+    if (!chunk_offsets) return false;
+
+    PackDecode_t decode = {
+        .stored        = (const uint32_t*) pack_entry_data(pack, entry),
+        .chunks        = (const uint8_t*) pack_entry_data(pack, entry) + table_size,
+        .chunk_offsets = chunk_offsets,
+        .dst           = (uint8_t*) dst,
+        .size          = entry->size,
+        .chunk_size    = chunk_size
+    };
+
+    // every chunk has to lie inside the entry before any of them is touched.
+    chunk_offsets[0] = 0;
+    for (int i = 0; i < chunk_count; ++i) chunk_offsets[i + 1] = chunk_offsets[i] + (decode.stored[i] & ~PACK_CHUNK_RAW);
+
+    bool ok = chunk_offsets[chunk_count] <= entry->stored_size - table_size;
+    if (ok) {
+        jobs_parallel_for(chunk_count, 1, pack__decode_chunks, &decode);
+        ok = !atomic_load(&decode.failed);
+    }
+
+    mem_free(chunk_offsets);
+
+    if (ok) {
+        atomic_fetch_add(&s_pack.decompressed_files, 1);
+        atomic_fetch_add(&s_pack.stored_bytes, entry->stored_size);
+        atomic_fetch_add(&s_pack.decompressed_bytes, entry->size);
+        atomic_fetch_add(&s_pack.decompress_ns, get_time_ns() - begin);
+    }
+
+    return ok;
+}
+
+PACKAPI bool pack_verify(const Pack_t* pack) {
+    for (uint32_t i = 0; i < pack->header->entry_count; ++i) {
+        const PackEntry_t* entry = &pack->entries[i];
+        const void*        data  = pack_entry_data(pack, entry);
+        void*              copy  = NULL;
+
+        if (entry->flags & PACK_ENTRY_COMPRESSED) {
+            copy = mem_alloc(MEM_TAG_IO, (size_t) entry->size);
+            data = copy;
+        }
+
+        bool ok = data && (!copy || pack_entry_read(pack, entry, copy))
+               && pack_checksum(data, (size_t) entry->size) == entry->checksum;
+        mem_free(copy);
+
+        if (!ok) {
+            fprintf(stderr, "pack: %s is corrupt.\n", pack_entry_name(pack, entry));
+            return false;
+        }
+    }
+    return true;
+}
+
+PACKAPI void pack_print_stats(void) {
+    uint64_t files        = atomic_load(&s_pack.decompressed_files);
+    uint64_t stored       = atomic_load(&s_pack.stored_bytes);
+    uint64_t decompressed = atomic_load(&s_pack.decompressed_bytes);
+    uint64_t ns           = atomic_load(&s_pack.decompress_ns);
+
+    if (!files) return;
+
+    printf("pack: %llu compressed files, %.2f MB -> %.2f MB (%.2fx), decompressed at %.0f MB/s\n",
+        (unsigned long long) files, stored / (1024.0 * 1024.0), decompressed / (1024.0 * 1024.0),
+        (double) decompressed / (double) stored, ns ? decompressed / (1024.0 * 1024.0) / (ns / 1e9) : 0.0);
+}
+
+static bool pack__resolve(const char* filepath, file_access_t access, File_t* out, void* user) {
+    (void) user;
+
+    for (int i = s_pack.mount_count - 1; i >= 0; --i) {
+        const Pack_t*      pack  = s_pack.mounts[i];
+        const PackEntry_t* entry = pack_find(pack, filepath);
+        if (!entry) continue;
+
+        // the archive is mapped without a hint, each entry gets the one its reader asked for.
+        advise_file_range(pack_entry_data(pack, entry), (size_t) entry->stored_size, access);
+
+        if (entry->flags & PACK_ENTRY_COMPRESSED) {
+            char* data = mem_alloc(MEM_TAG_IO, (size_t) entry->size + 1);
+            if (!data) return false;
+
+            if (!pack_entry_read(pack, entry, data)) {
+                fprintf(stderr, "pack: %s is corrupt.\n", pack_entry_name(pack, entry));
+                mem_free(data);
+                return false;
+            }
+            data[entry->size] = '\0';
+
+            *out = (File_t) { .data = data, .size = (size_t) entry->size, .file_path = filepath };
+            return true;
+        }
+
+        *out = (File_t) {
+            .data      = (char*) pack_entry_data(pack, entry),
+            .size      = entry->size,
+            .file_path = filepath,
+            .mapped    = true,
+            .borrowed  = true
+        };
+        return true;
+    }
+
+    return false;
+}
+
+PACKAPI Pack_t* pack_mount(const char* path) {
+    if (s_pack.mount_count >= PACK_MAX_MOUNTS) {
+        fprintf(stderr, "pack: can't mount %s, %d packs already mounted.\n", path, PACK_MAX_MOUNTS);
+        return NULL;
+    }
+
+    Pack_t* pack = mem_calloc(MEM_TAG_IO, 1, sizeof(Pack_t));
+    if (!pack) return NULL;
+
+    pack->file = map_file(path, FILE_ACCESS_NORMAL);
+    if (!pack->file.data) {
+        mem_free(pack);
+        return NULL;
+    }
+
+    pack->header = (const PackHeader_t*) pack->file.data;
+
+    if (!pack__validate(pack)) {
+        fprintf(stderr, "%s is not a valid pack.\n", path);
+        unmap_file(&pack->file);
+        mem_free(pack);
+        return NULL;
+    }
+
+    // lookups read the directory and names on every load, keep them in.
+    advise_file_range(pack->entries, (size_t) pack->header->entry_count * sizeof(PackEntry_t), FILE_ACCESS_WILLNEED);
+    advise_file_range(pack->names, (size_t) pack->header->names_size, FILE_ACCESS_WILLNEED);
+
+    s_pack.mounts[s_pack.mount_count++] = pack;
+    set_file_resolver(pack__resolve, NULL);
+
+    printf("pack: mounted %s (%u files, %.2f MB)\n", path, pack->header->entry_count, pack->file.size / (1024.0 * 1024.0));
+    return pack;
+}
+
+// views handed out from the pack must be released before it is unmounted.
+PACKAPI void pack_unmount(Pack_t* pack) {
+    if (!pack) return;
+
+    for (int i = 0; i < s_pack.mount_count; ++i) {
+        if (s_pack.mounts[i] != pack) continue;
+
+        memmove(&s_pack.mounts[i], &s_pack.mounts[i + 1], (size_t)(s_pack.mount_count - i - 1) * sizeof(Pack_t*));
+        s_pack.mount_count--;
+        break;
+    }
+
+    set_file_resolver(s_pack.mount_count > 0 ? pack__resolve : NULL, NULL);
+
+    unmap_file(&pack->file);
+    mem_free(pack);
+}
+
+PACKAPI void pack_unmount_all(void) {
+    while (s_pack.mount_count > 0) pack_unmount(s_pack.mounts[s_pack.mount_count - 1]);
+}
+
+#endif // PACK_IMPLEMENTATION
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "allocator.h"
+
+// Generational object pools.
+//
+// A pool keeps its objects packed in one array, so going over every live object is a loop over
+// pool_count() items with no holes to skip. Objects are named by 32-bit handles: the low
+// POOL_INDEX_BITS pick a slot, the bits above are the slot's generation, bumped every time the
+// slot's object is destroyed. A slot points at its object's place in the dense array; destroying
+// an object moves the last one into the hole and puts the slot on a free list, so both create
+// and destroy are O(1), and a handle kept past its object no longer matches its slot: pool_get()
+// returns NULL for it (and counts it) instead of handing out whatever lives there now. With 12
+// generation bits a slot only repeats a handle after 4095 reuses.
+//
+// Pointers into a pool hold until the next create (the arrays may grow) or destroy (the last
+// object moves), keep handles and look them up again. 0 is never a valid handle.
+
+#ifndef POOLAPI
+#   define POOLAPI extern
+#endif
+
+#define POOL_INDEX_BITS        20
+#define POOL_MAX_ITEMS         (1u << POOL_INDEX_BITS)
+#define POOL_INDEX_MASK        (POOL_MAX_ITEMS - 1)
+#define POOL_GENERATION_MASK   ((1u << (32 - POOL_INDEX_BITS)) - 1)
+#define POOL_MIN_CAPACITY      16
+#define POOL_NONE              UINT32_MAX
+
+typedef struct Pool_st     Pool_t;
+typedef struct PoolSlot_st PoolSlot_t;
+
+struct PoolSlot_st {
+    uint32_t dense;          // the object's index while used, the next free slot otherwise
+    uint32_t generation;
+    bool     used;
+};
+
+struct Pool_st {
+    const char*    name;
+    size_t         item_size;
+    uint32_t       max_items;
+    mem_tag_t      tag;
+
+    unsigned char* items;
+    uint32_t*      handles;  // of each item, for fixing up the slot of a moved one
+    uint32_t       count;
+    uint32_t       capacity;
+
+    PoolSlot_t*    slots;
+    uint32_t       slot_count;
+    uint32_t       slot_capacity;
+    uint32_t       free_slot;     // POOL_NONE when the list is empty
+
+    uint64_t       stale_lookups;
+};
+
+// `max_items` 0 or above POOL_MAX_ITEMS means POOL_MAX_ITEMS. Nothing is allocated until the
+// first create.
+POOLAPI bool     pool_init(Pool_t* pool, const char* name, size_t item_size, uint32_t max_items, mem_tag_t tag);
+// reports stale lookups, if any.
+POOLAPI void     pool_release(Pool_t* pool);
+// a zeroed object, 0 when the pool is full or out of memory.
+POOLAPI uint32_t pool_create(Pool_t* pool);
+// false for a stale handle. The last object moves into the destroyed one's index.
+POOLAPI bool     pool_destroy(Pool_t* pool, uint32_t handle);
+// NULL for a stale handle.
+POOLAPI void*    pool_get(Pool_t* pool, uint32_t handle);
+// the object's index in the dense array, POOL_NONE for a stale handle.
+POOLAPI uint32_t pool_index(const Pool_t* pool, uint32_t handle);
+
+static inline uint32_t pool_count(const Pool_t* pool) {
+    return pool->count;
+}
+
+static inline void* pool_at(const Pool_t* pool, uint32_t index) {
+    return index < pool->count ? pool->items + (size_t) index * pool->item_size : NULL;
+}
+
+static inline uint32_t pool_handle_at(const Pool_t* pool, uint32_t index) {
+    return index < pool->count ? pool->handles[index] : 0;
+}
+
+#ifdef POOL_IMPLEMENTATION
+
+static inline uint32_t pool__handle(uint32_t slot, uint32_t generation) {
+    return (generation << POOL_INDEX_BITS) | slot;
+}
+
+POOLAPI bool pool_init(Pool_t* pool, const char* name, size_t item_size, uint32_t max_items, mem_tag_t tag) {
+    if (!pool || !item_size) return false;
+
+    *pool = (Pool_t) {
+        .name      = name ? name : "pool",
+        .item_size = item_size,
+        .max_items = max_items && max_items <= POOL_MAX_ITEMS ? max_items : POOL_MAX_ITEMS,
+        .tag       = tag,
+        .free_slot = POOL_NONE
+    };
+    return true;
+}
+
+POOLAPI void pool_release(Pool_t* pool) {
+    if (!pool) return;
+
+    if (pool->stale_lookups) {
+        fprintf(stderr, "pool %s: %llu lookups through stale handles\n", pool->name, (unsigned long long) pool->stale_lookups);
+    }
+
+    mem_free(pool->items);
+    mem_free(pool->handles);
+    mem_free(pool->slots);
+
+    *pool = (Pool_t) {
+        .name      = pool->name,
+        .item_size = pool->item_size,
+        .max_items = pool->max_items,
+        .tag       = pool->tag,
+        .free_slot = POOL_NONE
+    };
+}
+
+static bool pool__grow_items(Pool_t* pool) {
+    uint32_t capacity = pool->capacity ? pool->capacity * 2 : POOL_MIN_CAPACITY;
+    if (capacity > pool->max_items) capacity = pool->max_items;
+
+    unsigned char* items = mem_realloc(pool->tag, pool->items, (size_t) capacity * pool->item_size);
+    if (!items) return false;
+    pool->items = items;
+
+    uint32_t* handles = mem_realloc(pool->tag, pool->handles, (size_t) capacity * sizeof(uint32_t));
+    if (!handles) return false;
+    pool->handles = handles;
+
+    pool->capacity = capacity;
+    return true;
+}
+
+static uint32_t pool__take_slot(Pool_t* pool) {
+    if (pool->free_slot != POOL_NONE) {
+        uint32_t slot   = pool->free_slot;
+        pool->free_slot = pool->slots[slot].dense;
+        return slot;
+    }
+
+    if (pool->slot_count == pool->slot_capacity) {
+        uint32_t capacity = pool->slot_capacity ? pool->slot_capacity * 2 : POOL_MIN_CAPACITY;
+        if (capacity > pool->max_items) capacity = pool->max_items;
+
+        PoolSlot_t* slots = mem_realloc(pool->tag, pool->slots, (size_t) capacity * sizeof(PoolSlot_t));
+        if (!slots) return POOL_NONE;
+
+        pool->slots         = slots;
+        pool->slot_capacity = capacity;
+    }
+
+    pool->slots[pool->slot_count] = (PoolSlot_t) { .generation = 1 };
+    return pool->slot_count++;
+}
+
+POOLAPI uint32_t pool_create(Pool_t* pool) {
+    if (pool->count == pool->max_items) {
+        fprintf(stderr, "pool %s: full (%u)\n", pool->name, pool->max_items);
+        return 0;
+    }
+
+    if (pool->count == pool->capacity && !pool__grow_items(pool)) return 0;
+
+    uint32_t slot = pool__take_slot(pool);
+    if (slot == POOL_NONE) return 0;
+
+    uint32_t index  = pool->count++;
+    uint32_t handle = pool__handle(slot, pool->slots[slot].generation);
+
+    pool->slots[slot].dense = index;
+    pool->slots[slot].used  = true;
+    pool->handles[index]    = handle;
+    memset(pool->items + (size_t) index * pool->item_size, 0, pool->item_size);
+
+    return handle;
+}
+
+POOLAPI uint32_t pool_index(const Pool_t* pool, uint32_t handle) {
+    uint32_t slot = handle & POOL_INDEX_MASK;
+    if (!handle || slot >= pool->slot_count) return POOL_NONE;
+
+    const PoolSlot_t* s = &pool->slots[slot];
+    if (!s->used || s->generation != handle >> POOL_INDEX_BITS) return POOL_NONE;
+
+    return s->dense;
+}
+
+POOLAPI void* pool_get(Pool_t* pool, uint32_t handle) {
+    uint32_t index = pool_index(pool, handle);
+    if (index == POOL_NONE) {
+        if (handle) pool->stale_lookups++;
+        return NULL;
+    }
+
+    return pool->items + (size_t) index * pool->item_size;
+}
+
+POOLAPI bool pool_destroy(Pool_t* pool, uint32_t handle) {
+    uint32_t index = pool_index(pool, handle);
+    if (index == POOL_NONE) {
+        if (handle) pool->stale_lookups++;
+        return false;
+    }
+
+    uint32_t last = --pool->count;
+    if (index != last) {
+        memcpy(pool->items + (size_t) index * pool->item_size, pool->items + (size_t) last * pool->item_size, pool->item_size);
+        pool->handles[index] = pool->handles[last];
+        pool->slots[pool->handles[index] & POOL_INDEX_MASK].dense = index;
+    }
+
+    // generation 0 would make slot 0's handle 0.
+    PoolSlot_t* s = &pool->slots[handle & POOL_INDEX_MASK];
+    s->generation = (s->generation + 1) & POOL_GENERATION_MASK;
+    if (!s->generation) s->generation = 1;
+
+    s->used         = false;
+    s->dense        = pool->free_slot;
+    pool->free_slot = handle & POOL_INDEX_MASK;
+
+    return true;
+}
+
+#endif // POOL_IMPLEMENTATION
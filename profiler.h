@@ -0,0 +1,305 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "allocator.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#   include <x86intrin.h>
+#   define PROFILER_HAS_TSC 1
+#endif
+
+// CPU zone profiler.
+//
+// PROFILE_ZONE("name") / PROFILE_FUNCTION() time the rest of the enclosing scope: the start is
+// taken where the macro sits, the end when the scope exits (early returns included, it's a
+// cleanup attribute). Every thread records its finished zones into its own ring of
+// PROFILER_RING_EVENTS events, registered on its first zone; a zone end is two timestamp reads
+// and one store into memory no other writer touches, no lock and no atomic read-modify-write.
+// Once a ring wraps the oldest zones are overwritten, so a dump holds the last few seconds.
+//
+// Timestamps are raw TSC ticks (invariant on anything recent), converted to time at dump by
+// calibrating the tick rate against get_time_ns() over the whole run. Targets without a TSC
+// use get_time_ns() directly.
+//
+// Tracks (profiler_create_track()) are rings not tied to a thread, fed with get_time_ns()
+// timestamps by one owner, e.g. the GPU timings gpu_profiler.h reads back.
+//
+// profiler_dump_chrome_trace() writes every ring as Chrome trace event JSON (chrome://tracing,
+// ui.perfetto.dev). Zones are compiled out when PROFILER_ENABLED is 0, which is the default for
+// NDEBUG builds; names must outlive the profiler (string literals, __func__).
+
+#define PROFILERAPI static
+
+#ifndef PROFILER_ENABLED
+#   if defined(NDEBUG)
+#       define PROFILER_ENABLED 0
+#   else
+#       define PROFILER_ENABLED 1
+#   endif
+#endif
+
+#define PROFILER_RING_EVENTS  (1 << 16)  // per thread, power of two
+#define PROFILER_MAX_THREADS  64
+#define PROFILER_NAME_LENGTH  32
+
+typedef struct ProfilerEvent_st  ProfilerEvent_t;
+typedef struct ProfilerThread_st ProfilerThread_t;
+typedef struct ProfilerZone_st   ProfilerZone_t;
+
+struct ProfilerEvent_st {
+    const char* name;
+    uint64_t    start;
+    uint64_t    end;
+};
+
+struct ProfilerThread_st {
+    ProfilerEvent_t       events[PROFILER_RING_EVENTS];
+    // events ever written, only the owning thread stores it. Release, so a reader that sees
+    // the count sees the event.
+    atomic_uint_fast64_t  written;
+    int                   id;
+    bool                  clock_ns;  // a track, timestamps from get_time_ns()
+    char                  name[PROFILER_NAME_LENGTH];
+};
+
+struct ProfilerZone_st {
+    const char* name;
+    uint64_t    start;
+};
+
+uint64_t get_time_ns();
+
+PROFILERAPI bool  profiler_init(void);
+// frees every ring, call once no other thread records zones anymore.
+PROFILERAPI void  profiler_shutdown(void);
+// shown as the thread's track name in the trace.
+PROFILERAPI void  profiler_set_thread_name(const char* name);
+// any thread, zones keep recording while it runs.
+PROFILERAPI bool  profiler_dump_chrome_trace(const char* path);
+// NULL when the profiler isn't running or out of slots.
+PROFILERAPI ProfilerThread_t* profiler_create_track(const char* name);
+// owner of the track only.
+PROFILERAPI void  profiler_track_record(ProfilerThread_t* track, const char* name, uint64_t start_ns, uint64_t end_ns);
+
+PROFILERAPI ProfilerThread_t* profiler__register_thread(void);
+
+extern atomic_bool                    g_profiler_running;
+extern _Thread_local ProfilerThread_t* g_profiler_thread;
+
+static inline uint64_t profiler__ticks(void) {
+#if defined(PROFILER_HAS_TSC)
+    return __rdtsc();
+#else
+    return get_time_ns();
+#endif
+}
+
+static inline ProfilerZone_t profiler__zone_begin(const char* name) {
+    return (ProfilerZone_t) { name, profiler__ticks() };
+}
+
+static inline void profiler__push(ProfilerThread_t* thread, const char* name, uint64_t start, uint64_t end) {
+    uint64_t         index = atomic_load_explicit(&thread->written, memory_order_relaxed);
+    ProfilerEvent_t* event = &thread->events[index & (PROFILER_RING_EVENTS - 1)];
+
+    event->name  = name;
+    event->start = start;
+    event->end   = end;
+
+    atomic_store_explicit(&thread->written, index + 1, memory_order_release);
+}
+
+static inline void profiler__zone_end(ProfilerZone_t* zone) {
+    uint64_t end = profiler__ticks();
+    if (!atomic_load_explicit(&g_profiler_running, memory_order_relaxed)) return;
+
+    ProfilerThread_t* thread = g_profiler_thread;
+    if (!thread && !(thread = profiler__register_thread())) return;
+
+    profiler__push(thread, zone->name, zone->start, end);
+}
+
+#if PROFILER_ENABLED
+#   define PROFILER__CONCAT2(a, b) a##b
+#   define PROFILER__CONCAT(a, b)  PROFILER__CONCAT2(a, b)
+#   define PROFILE_ZONE(name) \
+        ProfilerZone_t PROFILER__CONCAT(profiler__zone_, __LINE__) __attribute__((cleanup(profiler__zone_end))) = profiler__zone_begin(name)
+#else
+#   define PROFILE_ZONE(name) ((void) 0)
+#endif // PROFILER_ENABLED
+
+#define PROFILE_FUNCTION() PROFILE_ZONE(__func__)
+
+#ifdef PROFILER_IMPLEMENTATION
+
+atomic_bool                    g_profiler_running;
+_Thread_local ProfilerThread_t* g_profiler_thread;
+
+static struct {
+    ProfilerThread_t* threads[PROFILER_MAX_THREADS];
+    atomic_int        thread_count;
+
+    // calibration start, ticks and nanoseconds read back to back.
+    uint64_t          start_ticks;
+    uint64_t          start_ns;
+} s_profiler;
+
+PROFILERAPI bool profiler_init(void) {
+    s_profiler.start_ticks = profiler__ticks();
+    s_profiler.start_ns    = get_time_ns();
+
+    atomic_store(&g_profiler_running, true);
+    return true;
+}
+
+PROFILERAPI void profiler_shutdown(void) {
+    atomic_store(&g_profiler_running, false);
+
+    int count = atomic_load(&s_profiler.thread_count);
+    if (count > PROFILER_MAX_THREADS) count = PROFILER_MAX_THREADS;
+
+    for (int i = 0; i < count; ++i) {
+        mem_free(s_profiler.threads[i]);
+        s_profiler.threads[i] = NULL;
+    }
+    atomic_store(&s_profiler.thread_count, 0);
+
+    g_profiler_thread = NULL;
+}
+
+static ProfilerThread_t* profiler__new_ring(void) {
+    int id = atomic_fetch_add(&s_profiler.thread_count, 1);
+    if (id >= PROFILER_MAX_THREADS) return NULL;
+
+    ProfilerThread_t* thread = mem_calloc(MEM_TAG_PLATFORM, 1, sizeof(ProfilerThread_t));
+    if (!thread) return NULL;
+
+    thread->id = id;
+    snprintf(thread->name, sizeof(thread->name), "thread %d", id);
+
+    s_profiler.threads[id] = thread;
+    return thread;
+}
+
+PROFILERAPI ProfilerThread_t* profiler__register_thread(void) {
+    ProfilerThread_t* thread = profiler__new_ring();
+    if (thread) g_profiler_thread = thread;
+    return thread;
+}
+
+PROFILERAPI ProfilerThread_t* profiler_create_track(const char* name) {
+    if (!atomic_load(&g_profiler_running)) return NULL;
+
+    ProfilerThread_t* track = profiler__new_ring();
+    if (!track) return NULL;
+
+    track->clock_ns = true;
+    snprintf(track->name, sizeof(track->name), "%s", name);
+    return track;
+}
+
+PROFILERAPI void profiler_track_record(ProfilerThread_t* track, const char* name, uint64_t start_ns, uint64_t end_ns) {
+    if (!track || !atomic_load_explicit(&g_profiler_running, memory_order_relaxed)) return;
+    profiler__push(track, name, start_ns, end_ns);
+}
+
+PROFILERAPI void profiler_set_thread_name(const char* name) {
+    if (!atomic_load(&g_profiler_running)) return;
+
+    ProfilerThread_t* thread = g_profiler_thread;
+    if (!thread && !(thread = profiler__register_thread())) return;
+
+    snprintf(thread->name, sizeof(thread->name), "%s", name);
+}
+
+// ticks per microsecond, measured from profiler_init() to now.
+static double profiler__ticks_per_us(void) {
+#if defined(PROFILER_HAS_TSC)
+    uint64_t ticks, ns;
+
+    // a short interval calibrates poorly, give it at least 10 ms.
+    do {
+        ticks = profiler__ticks();
+        ns    = get_time_ns();
+    } while (ns - s_profiler.start_ns < 10000000ull);
+
+    return (double)(ticks - s_profiler.start_ticks) / ((ns - s_profiler.start_ns) / 1000.0);
+#else
+    return 1000.0;
+#endif
+}
+
+PROFILERAPI bool profiler_dump_chrome_trace(const char* path) {
+    FILE* fh = fopen(path, "wb");
+    if (!fh) {
+        printf("profiler_dump_chrome_trace() failed to open %s\n", path);
+        return false;
+    }
+
+    double ticks_per_us = profiler__ticks_per_us();
+
+    ProfilerEvent_t* copy = mem_alloc(MEM_TAG_PLATFORM, sizeof(ProfilerEvent_t) * PROFILER_RING_EVENTS);
+    if (!copy) {
+        fclose(fh);
+        return false;
+    }
+
+    int count = atomic_load(&s_profiler.thread_count);
+    if (count > PROFILER_MAX_THREADS) count = PROFILER_MAX_THREADS;
+
+    size_t written = 0;
+    fprintf(fh, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(fh, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"engine\"}}");
+
+    for (int t = 0; t < count; ++t) {
+        ProfilerThread_t* thread = s_profiler.threads[t];
+        if (!thread) continue;  // still registering
+
+        fprintf(fh, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", thread->id, thread->name);
+
+        // copy what the ring holds, then drop whatever the owner overwrote meanwhile: event i
+        // is gone once `written` passed i + PROFILER_RING_EVENTS - 1 (the slot being written).
+        uint64_t end   = atomic_load_explicit(&thread->written, memory_order_acquire);
+        uint64_t begin = end > PROFILER_RING_EVENTS ? end - PROFILER_RING_EVENTS : 0;
+
+        for (uint64_t i = begin; i < end; ++i) {
+            copy[i - begin] = thread->events[i & (PROFILER_RING_EVENTS - 1)];
+        }
+
+        atomic_thread_fence(memory_order_acquire);
+        uint64_t now = atomic_load_explicit(&thread->written, memory_order_relaxed);
+
+        uint64_t valid = now >= PROFILER_RING_EVENTS ? now - PROFILER_RING_EVENTS + 1 : 0;
+        if (valid < begin) valid = begin;
+
+        uint64_t origin = thread->clock_ns ? s_profiler.start_ns : s_profiler.start_ticks;
+        double   per_us = thread->clock_ns ? 1000.0 : ticks_per_us;
+
+        for (uint64_t i = valid; i < end; ++i) {
+            const ProfilerEvent_t* e = &copy[i - begin];
+            if (e->start < origin || e->end < e->start) continue;
+
+            fprintf(fh, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                e->name, thread->id,
+                (e->start - origin) / per_us,
+                (e->end - e->start) / per_us);
+            written++;
+        }
+    }
+
+    fprintf(fh, "\n]}\n");
+    mem_free(copy);
+
+    bool ok = !ferror(fh);
+    ok = fclose(fh) == 0 && ok;
+
+    if (ok) printf("profiler: %zu zones from %d threads written to %s\n", written, count, path);
+    return ok;
+}
+
+#endif // PROFILER_IMPLEMENTATION
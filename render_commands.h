@@ -0,0 +1,450 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+#include "engine_math.h"
+#include "gl_gfx.h"
+#include "gpu_profiler.h"
+#include "material.h"
+#include "profiler.h"
+#include "render_stats.h"
+
+// Recorded render commands.
+//
+// Draws are prepared on any thread by recording them into a command list instead of calling GL,
+// and replayed by the GL thread. One draw is a run: renderCmdBegin() with its sort key, a few
+// commands (pipeline, material, uniforms, the draw call), renderCmdEnd(). Commands are packed
+// structs behind a 4-byte header; a run is staged in the list and copied into the list's arena
+// in one piece at renderCmdEnd(), so replay walks it as plain memory.
+//
+// A queue hands every recording thread a list of its own, the first time it records after
+// renderCmdQueueReset(); no locks while recording. renderCmdSubmit() gathers the runs of every
+// list, sorts them by key (then by the order given at renderCmdBegin(), so the result doesn't
+// depend on which thread recorded what) and replays them. Replay skips a pipeline that is
+// already bound and opens a "draw group" GPU scope per run of equal keys.
+//
+// Materials are recorded by pointer and bound at replay: which texture page holds a texture is
+// streaming state, only the GL thread may look at it. Sort keys built from it (materialSortKey())
+// are computed there too, before recording fans out to other threads. Whatever a command points at must live
+// until the submit. Lists keep their arena blocks across resets, a steady frame doesn't allocate.
+
+#define RENDERCMDAPI static
+
+#define RENDER_CMD_MAX_LISTS     64      // recording threads per queue
+#define RENDER_CMD_MAX_RUN_BYTES 1024    // commands of one draw
+#define RENDER_CMD_LIST_BLOCK    (64 * 1024)
+
+typedef enum render_cmd_enum {
+    RENDER_CMD_SET_PIPELINE,
+    RENDER_CMD_BIND_MATERIAL,
+    RENDER_CMD_UNIFORM_MAT4,
+    RENDER_CMD_UNIFORM_VEC3,
+    RENDER_CMD_UNIFORM_INT,
+    RENDER_CMD_DRAW,
+    RENDER_CMD_DRAW_INSTANCED,
+} render_cmd_t;
+
+typedef struct RenderCmdHeader_st    RenderCmdHeader_t;
+typedef struct RenderCmdRun_st       RenderCmdRun_t;
+typedef struct RenderCommandList_st  RenderCommandList_t;
+typedef struct RenderCommandQueue_st RenderCommandQueue_t;
+
+struct RenderCmdHeader_st {
+    uint16_t type;      // render_cmd_t
+    uint16_t size;      // of the whole command, a multiple of 8
+};
+
+typedef struct {
+    RenderCmdHeader_t header;
+    GLuint            program;
+    GLuint            vao;
+} RenderCmdSetPipeline_t;
+
+typedef struct {
+    RenderCmdHeader_t  header;
+    const Material_t*  material;
+    const GLProgram_t* program;
+} RenderCmdBindMaterial_t;
+
+typedef struct {
+    RenderCmdHeader_t header;
+    GLint             location;
+    Mat4              value;        // row major, uploaded transposed
+} RenderCmdUniformMat4_t;
+
+typedef struct {
+    RenderCmdHeader_t header;
+    GLint             location;
+    float             value[3];
+} RenderCmdUniformVec3_t;
+
+typedef struct {
+    RenderCmdHeader_t header;
+    GLint             location;
+    GLint             value;
+} RenderCmdUniformInt_t;
+
+typedef struct {
+    RenderCmdHeader_t header;
+    GLenum            index_type;   // 0 draws arrays
+    GLsizei           count;        // indices or vertices, triangles
+    GLsizei           instances;
+} RenderCmdDraw_t;
+
+// a recorded draw, its commands follow it in the arena.
+struct RenderCmdRun_st {
+    RenderCmdRun_t* next;
+    uint64_t        key;
+    uint32_t        order;
+    uint32_t        size;           // bytes of commands
+};
+
+struct RenderCommandList_st {
+    Arena_t         arena;
+    RenderCmdRun_t* first;
+    RenderCmdRun_t* last;
+    size_t          run_count;
+
+    // the run being recorded.
+    _Alignas(16) unsigned char staging[RENDER_CMD_MAX_RUN_BYTES];
+    size_t          staged;
+    uint64_t        key;
+    uint32_t        order;
+    bool            recording;
+    bool            overflowed;     // the run didn't fit in the staging buffer, dropped
+    uint64_t        dropped_runs;
+};
+
+struct RenderCommandQueue_st {
+    RenderCommandList_t* lists[RENDER_CMD_MAX_LISTS];
+    atomic_int           list_count;     // handed out since the last reset
+    uint64_t             frame;
+};
+
+RENDERCMDAPI void                 renderCmdQueueInit(RenderCommandQueue_t* queue);
+RENDERCMDAPI void                 renderCmdQueueRelease(RenderCommandQueue_t* queue);
+// GL thread, before recording starts: empties every list.
+RENDERCMDAPI void                 renderCmdQueueReset(RenderCommandQueue_t* queue);
+// the calling thread's list until the next reset, NULL when out of lists.
+RENDERCMDAPI RenderCommandList_t* renderCmdList(RenderCommandQueue_t* queue);
+// GL thread, once recording is done: replays every list's runs in key order.
+RENDERCMDAPI void                 renderCmdSubmit(RenderCommandQueue_t* queue);
+
+RENDERCMDAPI void renderCmdBegin(RenderCommandList_t* list, uint64_t key, uint32_t order);
+RENDERCMDAPI void renderCmdEnd(RenderCommandList_t* list);
+RENDERCMDAPI void renderCmdSetPipeline(RenderCommandList_t* list, GLuint program, GLuint vao);
+RENDERCMDAPI void renderCmdBindMaterial(RenderCommandList_t* list, const Material_t* material, const GLProgram_t* program);
+RENDERCMDAPI void renderCmdUniformMat4(RenderCommandList_t* list, GLint location, const Mat4* value);
+RENDERCMDAPI void renderCmdUniformVec3(RenderCommandList_t* list, GLint location, vec3 value);
+RENDERCMDAPI void renderCmdUniformInt(RenderCommandList_t* list, GLint location, GLint value);
+// `index_type` 0 draws `count` vertices, GL_TRIANGLES either way.
+RENDERCMDAPI void renderCmdDraw(RenderCommandList_t* list, GLenum index_type, GLsizei count);
+RENDERCMDAPI void renderCmdDrawInstanced(RenderCommandList_t* list, GLenum index_type, GLsizei count, GLsizei instances);
+
+#ifdef RENDERCMD_IMPLEMENTATION
+
+static _Thread_local struct {
+    const RenderCommandQueue_t* queue;
+    uint64_t                    frame;
+    RenderCommandList_t*        list;
+} t_renderCmd;
+
+// frames of every queue, so a thread's cached list never matches a queue released and set up again.
+static atomic_uint_fast64_t s_renderCmdFrames;
+
+RENDERCMDAPI void renderCmdQueueInit(RenderCommandQueue_t* queue) {
+    memset(queue, 0, sizeof(*queue));
+}
+
+RENDERCMDAPI void renderCmdQueueRelease(RenderCommandQueue_t* queue) {
+    uint64_t dropped = 0;
+
+    for (int i = 0; i < RENDER_CMD_MAX_LISTS; ++i) {
+        if (!queue->lists[i]) continue;
+
+        dropped += queue->lists[i]->dropped_runs;
+        arena_release(&queue->lists[i]->arena);
+        mem_free(queue->lists[i]);
+    }
+
+    if (dropped) fprintf(stderr, "render commands: %llu draws dropped, over %d bytes of commands\n", (unsigned long long) dropped, RENDER_CMD_MAX_RUN_BYTES);
+
+    memset(queue, 0, sizeof(*queue));
+}
+
+RENDERCMDAPI void renderCmdQueueReset(RenderCommandQueue_t* queue) {
+    for (int i = 0; i < RENDER_CMD_MAX_LISTS; ++i) {
+        RenderCommandList_t* list = queue->lists[i];
+        if (!list) continue;
+
+        arena_reset(&list->arena);
+        list->first     = list->last = NULL;
+        list->run_count = 0;
+        list->recording = false;
+    }
+
+    atomic_store(&queue->list_count, 0);
+    queue->frame = atomic_fetch_add(&s_renderCmdFrames, 1) + 1;
+}
+
+// a list is created by the first thread to get its slot, the others only look at the slot
+// after the submit.
+RENDERCMDAPI RenderCommandList_t* renderCmdList(RenderCommandQueue_t* queue) {
+    if (t_renderCmd.queue == queue && t_renderCmd.frame == queue->frame) return t_renderCmd.list;
+
+    int index = atomic_fetch_add(&queue->list_count, 1);
+    if (index >= RENDER_CMD_MAX_LISTS) {
+        fprintf(stderr, "render commands: out of lists (%d threads)\n", RENDER_CMD_MAX_LISTS);
+        return NULL;
+    }
+
+    RenderCommandList_t* list = queue->lists[index];
+    if (!list) {
+        list = mem_calloc(MEM_TAG_RENDER, 1, sizeof(RenderCommandList_t));
+        if (!list || !arena_init(&list->arena, MEM_TAG_RENDER, RENDER_CMD_LIST_BLOCK)) {
+            if (list) arena_release(&list->arena);
+            mem_free(list);
+            return NULL;
+        }
+
+        queue->lists[index] = list;
+    }
+
+    t_renderCmd.queue = queue;
+    t_renderCmd.frame = queue->frame;
+    t_renderCmd.list  = list;
+    return list;
+}
+
+RENDERCMDAPI void renderCmdBegin(RenderCommandList_t* list, uint64_t key, uint32_t order) {
+    list->staged     = 0;
+    list->key        = key;
+    list->order      = order;
+    list->recording  = true;
+    list->overflowed = false;
+}
+
+RENDERCMDAPI void renderCmdEnd(RenderCommandList_t* list) {
+    if (!list->recording) return;
+    list->recording = false;
+
+    if (list->overflowed) {
+        list->dropped_runs++;
+        return;
+    }
+
+    RenderCmdRun_t* run = arena_alloc(&list->arena, sizeof(RenderCmdRun_t) + list->staged, 16);
+    if (!run) {
+        list->dropped_runs++;
+        return;
+    }
+
+    *run = (RenderCmdRun_t) { .key = list->key, .order = list->order, .size = (uint32_t) list->staged };
+    memcpy(run + 1, list->staging, list->staged);
+
+    if (list->last) list->last->next = run;
+    else            list->first      = run;
+
+    list->last = run;
+    list->run_count++;
+}
+
+static void* renderCmd__push(RenderCommandList_t* list, render_cmd_t type, size_t size) {
+    size = (size + 7) & ~(size_t) 7;
+
+    if (!list->recording || list->staged + size > RENDER_CMD_MAX_RUN_BYTES) {
+        list->overflowed = true;
+        return NULL;
+    }
+
+    RenderCmdHeader_t* header = (RenderCmdHeader_t*)(list->staging + list->staged);
+    header->type  = (uint16_t) type;
+    header->size  = (uint16_t) size;
+    list->staged += size;
+
+    return header;
+}
+
+RENDERCMDAPI void renderCmdSetPipeline(RenderCommandList_t* list, GLuint program, GLuint vao) {
+    RenderCmdSetPipeline_t* cmd = renderCmd__push(list, RENDER_CMD_SET_PIPELINE, sizeof(*cmd));
+    if (!cmd) return;
+
+    cmd->program = program;
+    cmd->vao     = vao;
+}
+
+RENDERCMDAPI void renderCmdBindMaterial(RenderCommandList_t* list, const Material_t* material, const GLProgram_t* program) {
+    RenderCmdBindMaterial_t* cmd = renderCmd__push(list, RENDER_CMD_BIND_MATERIAL, sizeof(*cmd));
+    if (!cmd) return;
+
+    cmd->material = material;
+    cmd->program  = program;
+}
+
+RENDERCMDAPI void renderCmdUniformMat4(RenderCommandList_t* list, GLint location, const Mat4* value) {
+    RenderCmdUniformMat4_t* cmd = renderCmd__push(list, RENDER_CMD_UNIFORM_MAT4, sizeof(*cmd));
+    if (!cmd) return;
+
+    cmd->location = location;
+    cmd->value    = *value;
+}
+
+RENDERCMDAPI void renderCmdUniformVec3(RenderCommandList_t* list, GLint location, vec3 value) {
+    RenderCmdUniformVec3_t* cmd = renderCmd__push(list, RENDER_CMD_UNIFORM_VEC3, sizeof(*cmd));
+    if (!cmd) return;
+
+    cmd->location = location;
+    cmd->value[0] = value.x;
+    cmd->value[1] = value.y;
+    cmd->value[2] = value.z;
+}
+
+RENDERCMDAPI void renderCmdUniformInt(RenderCommandList_t* list, GLint location, GLint value) {
+    RenderCmdUniformInt_t* cmd = renderCmd__push(list, RENDER_CMD_UNIFORM_INT, sizeof(*cmd));
+    if (!cmd) return;
+
+    cmd->location = location;
+    cmd->value    = value;
+}
+
+RENDERCMDAPI void renderCmdDraw(RenderCommandList_t* list, GLenum index_type, GLsizei count) {
+    RenderCmdDraw_t* cmd = renderCmd__push(list, RENDER_CMD_DRAW, sizeof(*cmd));
+    if (!cmd) return;
+
+    cmd->index_type = index_type;
+    cmd->count      = count;
+    cmd->instances  = 1;
+}
+
+RENDERCMDAPI void renderCmdDrawInstanced(RenderCommandList_t* list, GLenum index_type, GLsizei count, GLsizei instances) {
+    RenderCmdDraw_t* cmd = renderCmd__push(list, RENDER_CMD_DRAW_INSTANCED, sizeof(*cmd));
+    if (!cmd) return;
+
+    cmd->index_type = index_type;
+    cmd->count      = count;
+    cmd->instances  = instances;
+}
+
+static int renderCmd__compare_runs(const void* a, const void* b) {
+    const RenderCmdRun_t* ra = *(const RenderCmdRun_t* const*) a;
+    const RenderCmdRun_t* rb = *(const RenderCmdRun_t* const*) b;
+
+    if (ra->key != rb->key) return ra->key < rb->key ? -1 : 1;
+    return (ra->order > rb->order) - (ra->order < rb->order);
+}
+
+static void renderCmd__replay(const RenderCmdRun_t* run, GLuint* program, GLuint* vao) {
+    const unsigned char* cmd = (const unsigned char*)(run + 1);
+    const unsigned char* end = cmd + run->size;
+
+    for (; cmd < end; cmd += ((const RenderCmdHeader_t*) cmd)->size) {
+        switch (((const RenderCmdHeader_t*) cmd)->type) {
+            case RENDER_CMD_SET_PIPELINE: {
+                const RenderCmdSetPipeline_t* c = (const RenderCmdSetPipeline_t*) cmd;
+
+                if (*vao != c->vao) {
+                    glBindVertexArray(c->vao);
+                    renderStatsBind(RENDER_STATE_VERTEX_ARRAY, c->vao);
+                    *vao = c->vao;
+                }
+                if (*program != c->program) {
+                    glUseProgram(c->program);
+                    renderStatsBind(RENDER_STATE_PROGRAM, c->program);
+                    *program = c->program;
+                }
+            } break;
+
+            case RENDER_CMD_BIND_MATERIAL: {
+                const RenderCmdBindMaterial_t* c = (const RenderCmdBindMaterial_t*) cmd;
+                materialBind(c->material, c->program);
+            } break;
+
+            case RENDER_CMD_UNIFORM_MAT4: {
+                const RenderCmdUniformMat4_t* c = (const RenderCmdUniformMat4_t*) cmd;
+                glUniformMatrix4fv(c->location, 1, GL_TRUE, (const float*) &c->value);
+            } break;
+
+            case RENDER_CMD_UNIFORM_VEC3: {
+                const RenderCmdUniformVec3_t* c = (const RenderCmdUniformVec3_t*) cmd;
+                glUniform3f(c->location, c->value[0], c->value[1], c->value[2]);
+            } break;
+
+            case RENDER_CMD_UNIFORM_INT: {
+                const RenderCmdUniformInt_t* c = (const RenderCmdUniformInt_t*) cmd;
+                glUniform1i(c->location, c->value);
+            } break;
+
+            case RENDER_CMD_DRAW:
+            case RENDER_CMD_DRAW_INSTANCED: {
+                const RenderCmdDraw_t* c = (const RenderCmdDraw_t*) cmd;
+
+                if (c->header.type == RENDER_CMD_DRAW_INSTANCED) {
+                    if (c->index_type) glDrawElementsInstanced(GL_TRIANGLES, c->count, c->index_type, 0, c->instances);
+                    else               glDrawArraysInstanced(GL_TRIANGLES, 0, c->count, c->instances);
+                } else {
+                    if (c->index_type) glDrawElements(GL_TRIANGLES, c->count, c->index_type, 0);
+                    else               glDrawArrays(GL_TRIANGLES, 0, c->count);
+                }
+
+                renderStatsDraw((uint64_t)(c->count / 3) * (uint64_t) c->instances);
+            } break;
+        }
+    }
+}
+
+RENDERCMDAPI void renderCmdSubmit(RenderCommandQueue_t* queue) {
+    PROFILE_FUNCTION();
+
+    int lists = atomic_load(&queue->list_count);
+    if (lists > RENDER_CMD_MAX_LISTS) lists = RENDER_CMD_MAX_LISTS;
+
+    size_t total = 0;
+    for (int i = 0; i < lists; ++i) {
+        if (queue->lists[i]) total += queue->lists[i]->run_count;
+    }
+    if (!total) return;
+
+    Arena_t*        scratch = scratch_arena();
+    ArenaMarker_t   marker  = scratch ? arena_save(scratch) : (ArenaMarker_t) {0};
+    RenderCmdRun_t** runs   = scratch ? arena_alloc(scratch, total * sizeof(RenderCmdRun_t*), ARENA_DEFAULT_ALIGNMENT) : NULL;
+
+    if (!runs) {
+        fprintf(stderr, "renderCmdSubmit(): no scratch memory for %zu draws\n", total);
+        return;
+    }
+
+    size_t count = 0;
+    for (int i = 0; i < lists; ++i) {
+        if (!queue->lists[i]) continue;
+        for (RenderCmdRun_t* run = queue->lists[i]->first; run; run = run->next) runs[count++] = run;
+    }
+
+    qsort(runs, count, sizeof(RenderCmdRun_t*), renderCmd__compare_runs);
+
+    GLuint program = 0;
+    GLuint vao     = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        // one GPU scope per run of draws sharing a program and texture pages.
+        if (i == 0 || runs[i]->key != runs[i - 1]->key) {
+            if (i) gpuProfilerPop();
+            gpuProfilerPush("draw group");
+        }
+
+        renderCmd__replay(runs[i], &program, &vao);
+    }
+    gpuProfilerPop();
+
+    glBindVertexArray(0);
+    glUseProgram(0);
+
+    arena_restore(scratch, marker);
+}
+
+#endif // RENDERCMD_IMPLEMENTATION
@@ -0,0 +1,263 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Per frame rendering counters.
+//
+// The GL choke points (renderMesh(), renderQuad(), materialBind(), updateLight(), the texture
+// and buffer uploads) bump the counters of the frame being built; renderStatsEndFrame() closes
+// it into a ring of the last RENDER_STATS_HISTORY frames, which percentiles are taken over.
+// A counter is an add into a global, cheap enough that they stay on in release builds, where
+// slow frames actually get reported from.
+//
+// State changes count binds of a different object than the last one of that kind, unbinds to 0
+// aren't counted. Everything here is GL thread only.
+//
+// renderStatsOpenCsv() appends a summary of the window to a CSV file every `interval` frames:
+// one row per counter with its mean, percentiles, max, and its value in the slowest frame of the
+// window, so a spike in frame time can be lined up with what was submitted in it.
+
+#define RENDERSTATSAPI static
+
+#define RENDER_STATS_HISTORY       240  // frames
+#define RENDER_STATS_TEXTURE_UNITS 16
+
+typedef enum render_stat_enum {
+    RENDER_STAT_FRAME_NS,
+    RENDER_STAT_DRAWS,
+    RENDER_STAT_TRIANGLES,
+    RENDER_STAT_PROGRAM_CHANGES,
+    RENDER_STAT_VERTEX_ARRAY_CHANGES,
+    RENDER_STAT_TEXTURE_CHANGES,
+    RENDER_STAT_UPLOAD_BYTES,
+    RENDER_STAT_LIGHTS_UPDATED,
+    RENDER_STAT_LIGHTS_ACTIVE,       // lights the shader loops over, kept between frames
+    RENDER_STAT_MESHES_VISIBLE,
+    RENDER_STAT_MESHES_CULLED,
+    RENDER_STAT_MESHES_DROPPED,      // visible, but past the draw list's capacity
+    RENDER_STAT_COUNT
+} render_stat_t;
+
+typedef enum render_state_enum {
+    RENDER_STATE_PROGRAM,
+    RENDER_STATE_VERTEX_ARRAY,
+    RENDER_STATE_TEXTURE0,           // + unit
+    RENDER_STATE_COUNT = RENDER_STATE_TEXTURE0 + RENDER_STATS_TEXTURE_UNITS
+} render_state_t;
+
+typedef struct RenderStatsFrame_st   RenderStatsFrame_t;
+typedef struct RenderStatsSummary_st RenderStatsSummary_t;
+typedef struct RenderStatsCurrent_st RenderStatsCurrent_t;
+
+struct RenderStatsFrame_st {
+    uint64_t values[RENDER_STAT_COUNT];
+};
+
+struct RenderStatsSummary_st {
+    int      frames;
+    double   mean;
+    uint64_t p50;
+    uint64_t p95;
+    uint64_t p99;
+    uint64_t max;
+};
+
+// the frame being built, and the objects last bound per state.
+struct RenderStatsCurrent_st {
+    RenderStatsFrame_t frame;
+    uint32_t           bound[RENDER_STATE_COUNT];
+    uint64_t           lights_active;
+};
+
+extern RenderStatsCurrent_t g_renderStats;
+
+// closes the CSV file.
+RENDERSTATSAPI void                 renderStatsShutdown(void);
+// `frame_ns` is the CPU time the frame took. Returns the closed frame's counters.
+RENDERSTATSAPI RenderStatsFrame_t   renderStatsEndFrame(uint64_t frame_ns);
+// over the frames in the history ring.
+RENDERSTATSAPI RenderStatsSummary_t renderStatsSummarize(render_stat_t stat);
+RENDERSTATSAPI const char*          renderStatsName(render_stat_t stat);
+RENDERSTATSAPI bool                 renderStatsOpenCsv(const char* path, int interval);
+RENDERSTATSAPI void                 renderStatsPrint(void);
+
+static inline void renderStatsDraw(uint64_t triangles) {
+    g_renderStats.frame.values[RENDER_STAT_DRAWS]++;
+    g_renderStats.frame.values[RENDER_STAT_TRIANGLES] += triangles;
+}
+
+static inline void renderStatsBind(render_state_t state, uint32_t id) {
+    if (!id || state >= RENDER_STATE_COUNT || g_renderStats.bound[state] == id) return;
+    g_renderStats.bound[state] = id;
+
+    render_stat_t stat = state == RENDER_STATE_PROGRAM      ? RENDER_STAT_PROGRAM_CHANGES
+                       : state == RENDER_STATE_VERTEX_ARRAY ? RENDER_STAT_VERTEX_ARRAY_CHANGES
+                       :                                      RENDER_STAT_TEXTURE_CHANGES;
+    g_renderStats.frame.values[stat]++;
+}
+
+static inline void renderStatsUpload(uint64_t bytes) {
+    g_renderStats.frame.values[RENDER_STAT_UPLOAD_BYTES] += bytes;
+}
+
+static inline void renderStatsLightUpdate(uint64_t active) {
+    g_renderStats.frame.values[RENDER_STAT_LIGHTS_UPDATED]++;
+    g_renderStats.lights_active = active;
+}
+
+static inline void renderStatsLightCount(uint64_t active) {
+    g_renderStats.lights_active = active;
+}
+
+// culling runs with the simulation, its counts arrive with the frame's draw list.
+static inline void renderStatsMeshes(uint64_t visible, uint64_t culled, uint64_t dropped) {
+    g_renderStats.frame.values[RENDER_STAT_MESHES_VISIBLE] += visible;
+    g_renderStats.frame.values[RENDER_STAT_MESHES_CULLED]  += culled;
+    g_renderStats.frame.values[RENDER_STAT_MESHES_DROPPED] += dropped;
+}
+
+#ifdef RENDERSTATS_IMPLEMENTATION
+
+RenderStatsCurrent_t g_renderStats;
+
+static const char* const RENDER_STAT_NAMES[RENDER_STAT_COUNT] = {
+    "frame_ns",
+    "draws",
+    "triangles",
+    "program_changes",
+    "vertex_array_changes",
+    "texture_changes",
+    "upload_bytes",
+    "lights_updated",
+    "lights_active",
+    "meshes_visible",
+    "meshes_culled",
+    "meshes_dropped",
+};
+
+static struct {
+    RenderStatsFrame_t history[RENDER_STATS_HISTORY];
+    uint64_t           frames;          // frames ended
+
+    FILE*              csv;
+    int                csv_interval;
+} s_renderStats;
+
+RENDERSTATSAPI const char* renderStatsName(render_stat_t stat) {
+    return stat < RENDER_STAT_COUNT ? RENDER_STAT_NAMES[stat] : "?";
+}
+
+static int renderStats__compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*) a;
+    uint64_t y = *(const uint64_t*) b;
+    return (x > y) - (x < y);
+}
+
+RENDERSTATSAPI RenderStatsSummary_t renderStatsSummarize(render_stat_t stat) {
+    RenderStatsSummary_t summary = {0};
+
+    int count = s_renderStats.frames < RENDER_STATS_HISTORY ? (int) s_renderStats.frames : RENDER_STATS_HISTORY;
+    if (count == 0 || stat >= RENDER_STAT_COUNT) return summary;
+
+    uint64_t sorted[RENDER_STATS_HISTORY];
+    uint64_t total = 0;
+
+    for (int i = 0; i < count; ++i) {
+        sorted[i] = s_renderStats.history[i].values[stat];
+        total    += sorted[i];
+    }
+    qsort(sorted, (size_t) count, sizeof(uint64_t), renderStats__compare_u64);
+
+    // nearest rank, as bench_frame_stats().
+    summary.frames = count;
+    summary.mean   = (double) total / count;
+    summary.p50    = sorted[(count - 1) * 50 / 100];
+    summary.p95    = sorted[(count - 1) * 95 / 100];
+    summary.p99    = sorted[(count - 1) * 99 / 100];
+    summary.max    = sorted[count - 1];
+
+    return summary;
+}
+
+static void renderStats__write_csv(void) {
+    int count = s_renderStats.frames < RENDER_STATS_HISTORY ? (int) s_renderStats.frames : RENDER_STATS_HISTORY;
+
+    const RenderStatsFrame_t* slowest = &s_renderStats.history[0];
+    for (int i = 1; i < count; ++i) {
+        if (s_renderStats.history[i].values[RENDER_STAT_FRAME_NS] > slowest->values[RENDER_STAT_FRAME_NS])
+            slowest = &s_renderStats.history[i];
+    }
+
+    for (int stat = 0; stat < RENDER_STAT_COUNT; ++stat) {
+        RenderStatsSummary_t s = renderStatsSummarize((render_stat_t) stat);
+
+        fprintf(s_renderStats.csv, "%llu,%d,%s,%.2f,%llu,%llu,%llu,%llu,%llu\n",
+            (unsigned long long) s_renderStats.frames, s.frames, RENDER_STAT_NAMES[stat], s.mean,
+            (unsigned long long) s.p50, (unsigned long long) s.p95, (unsigned long long) s.p99,
+            (unsigned long long) s.max, (unsigned long long) slowest->values[stat]);
+    }
+
+    fflush(s_renderStats.csv);
+}
+
+RENDERSTATSAPI RenderStatsFrame_t renderStatsEndFrame(uint64_t frame_ns) {
+    RenderStatsFrame_t frame = g_renderStats.frame;
+    frame.values[RENDER_STAT_FRAME_NS]      = frame_ns;
+    frame.values[RENDER_STAT_LIGHTS_ACTIVE] = g_renderStats.lights_active;
+
+    s_renderStats.history[s_renderStats.frames % RENDER_STATS_HISTORY] = frame;
+    s_renderStats.frames++;
+
+    // bindings carry over, a frame starting with the last frame's program didn't change it.
+    memset(&g_renderStats.frame, 0, sizeof(g_renderStats.frame));
+
+    if (s_renderStats.csv && s_renderStats.frames % s_renderStats.csv_interval == 0) renderStats__write_csv();
+
+    return frame;
+}
+
+RENDERSTATSAPI bool renderStatsOpenCsv(const char* path, int interval) {
+    if (s_renderStats.csv) fclose(s_renderStats.csv);
+
+    s_renderStats.csv = fopen(path, "wb");
+    if (!s_renderStats.csv) {
+        printf("renderStatsOpenCsv() failed to open %s\n", path);
+        return false;
+    }
+
+    s_renderStats.csv_interval = interval > 0 ? interval : RENDER_STATS_HISTORY;
+    fprintf(s_renderStats.csv, "frame,window,stat,mean,p50,p95,p99,max,slowest_frame\n");
+    return true;
+}
+
+RENDERSTATSAPI void renderStatsPrint(void) {
+    RenderStatsSummary_t frames = renderStatsSummarize(RENDER_STAT_FRAME_NS);
+    if (!frames.frames) return;
+
+    printf("render stats over the last %d frames:\n", frames.frames);
+    printf("  %-22s %12s %10s %10s %10s %10s\n", "", "mean", "p50", "p95", "p99", "max");
+
+    for (int stat = 0; stat < RENDER_STAT_COUNT; ++stat) {
+        RenderStatsSummary_t s = renderStatsSummarize((render_stat_t) stat);
+
+        printf("  %-22s %12.1f %10llu %10llu %10llu %10llu\n", RENDER_STAT_NAMES[stat], s.mean,
+            (unsigned long long) s.p50, (unsigned long long) s.p95, (unsigned long long) s.p99, (unsigned long long) s.max);
+    }
+}
+
+// a last row for the frames since the previous one.
+RENDERSTATSAPI void renderStatsShutdown(void) {
+    if (s_renderStats.csv) {
+        if (s_renderStats.frames % s_renderStats.csv_interval != 0) renderStats__write_csv();
+        fclose(s_renderStats.csv);
+    }
+
+    memset(&s_renderStats, 0, sizeof(s_renderStats));
+    memset(&g_renderStats, 0, sizeof(g_renderStats));
+}
+
+#endif // RENDERSTATS_IMPLEMENTATION
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "allocator.h"
+#include "profiler.h"
+#include "thread.h"
+
+// Render thread.
+//
+// The thread owns the GL context and draws frame packets: whatever the simulation thread
+// captured of a frame (camera, draw list, light changes), copied into one of
+// RENDER_THREAD_PACKETS packets so neither side ever reads what the other is writing. The
+// simulation thread fills a packet while the render thread is still drawing the previous ones,
+// with up to two frames queued between them.
+//
+// The handoff is two counters, packets submitted and packets drawn, each stored by one side
+// only: packet n lives in slot n % RENDER_THREAD_PACKETS, free to fill once drawn + PACKETS > n.
+// A side with nothing to do spins a little and then sleeps on a condition variable, which the
+// other side only touches while someone sleeps.
+//
+// Packets are drawn in order and none is skipped, so they can carry changes (a light moved)
+// rather than the full state. Started without a thread, renderThreadSubmit() draws the packet
+// right away on the calling thread, which keeps the context.
+
+#define RENDERTHREADAPI static
+
+#define RENDER_THREAD_PACKETS  3
+#define RENDER_THREAD_SPINS    1000
+
+typedef struct RenderThread_st RenderThread_t;
+
+// draws one packet, on the thread holding the context.
+typedef void (*render_packet_fn)(void* packet, void* user);
+// makes the GL context current on the calling thread, or releases it.
+typedef bool (*render_context_fn)(bool current, void* user);
+
+struct RenderThread_st {
+    Thread_t             thread;
+    bool                 threaded;
+
+    unsigned char*       packets;
+    size_t               packet_size;
+
+    render_packet_fn     render;
+    render_context_fn    context;
+    void*                user;
+
+    atomic_uint_fast64_t submitted;
+    atomic_uint_fast64_t drawn;
+    atomic_int           state;      // RENDER_THREAD__*
+    atomic_int           sleepers;
+
+    Mutex_t              lock;       // only for sleeping
+    CondVar_t            wake;
+
+    uint64_t             producer_waits;   // packets the simulation thread had to wait for
+};
+
+// `threaded` false draws packets on the caller. Falls back to that if the thread can't take
+// the context.
+RENDERTHREADAPI bool  renderThreadStart(RenderThread_t* rt, size_t packet_size, bool threaded,
+                                        render_packet_fn render, render_context_fn context, void* user);
+// draws what's queued, stops the thread and hands the context back to the caller.
+RENDERTHREADAPI void  renderThreadStop(RenderThread_t* rt);
+// the packet to fill next, waits while every packet is queued or being drawn.
+RENDERTHREADAPI void* renderThreadBeginPacket(RenderThread_t* rt);
+RENDERTHREADAPI void  renderThreadSubmit(RenderThread_t* rt);
+// returns once every submitted packet is drawn.
+RENDERTHREADAPI void  renderThreadFlush(RenderThread_t* rt);
+
+#ifdef RENDERTHREAD_IMPLEMENTATION
+
+enum {
+    RENDER_THREAD__STARTING,
+    RENDER_THREAD__RUNNING,
+    RENDER_THREAD__FAILED,
+    RENDER_THREAD__QUIT
+};
+
+static void renderThread__wake(RenderThread_t* rt) {
+    if (atomic_load(&rt->sleepers) == 0) return;
+
+    mutex_lock(&rt->lock);
+    condvar_broadcast(&rt->wake);
+    mutex_unlock(&rt->lock);
+}
+
+// `ready` is re-checked under the lock, a wake between the check and the wait isn't lost: the
+// waker sees the sleeper and takes the lock first.
+static void renderThread__wait(RenderThread_t* rt, bool (*ready)(RenderThread_t*)) {
+    for (int i = 0; i < RENDER_THREAD_SPINS; ++i) {
+        if (ready(rt)) return;
+        thread_yield();
+    }
+
+    atomic_fetch_add(&rt->sleepers, 1);
+    mutex_lock(&rt->lock);
+    while (!ready(rt)) condvar_wait(&rt->wake, &rt->lock);
+    mutex_unlock(&rt->lock);
+    atomic_fetch_sub(&rt->sleepers, 1);
+}
+
+static bool renderThread__has_packet(RenderThread_t* rt) {
+    return atomic_load(&rt->submitted) > atomic_load(&rt->drawn) || atomic_load(&rt->state) == RENDER_THREAD__QUIT;
+}
+
+static bool renderThread__has_slot(RenderThread_t* rt) {
+    return atomic_load(&rt->submitted) - atomic_load(&rt->drawn) < RENDER_THREAD_PACKETS;
+}
+
+static bool renderThread__all_drawn(RenderThread_t* rt) {
+    return atomic_load(&rt->submitted) == atomic_load(&rt->drawn);
+}
+
+static bool renderThread__started(RenderThread_t* rt) {
+    return atomic_load(&rt->state) != RENDER_THREAD__STARTING;
+}
+
+static void* renderThread__slot(RenderThread_t* rt, uint64_t packet) {
+    return rt->packets + (packet % RENDER_THREAD_PACKETS) * rt->packet_size;
+}
+
+static void renderThread__draw_next(RenderThread_t* rt) {
+    uint64_t packet = atomic_load(&rt->drawn);
+
+    rt->render(renderThread__slot(rt, packet), rt->user);
+
+    atomic_store(&rt->drawn, packet + 1);
+    renderThread__wake(rt);
+}
+
+static int renderThread__main(void* user) {
+    RenderThread_t* rt = (RenderThread_t*) user;
+    profiler_set_thread_name("render");
+
+    bool bound = rt->context(true, rt->user);
+    atomic_store(&rt->state, bound ? RENDER_THREAD__RUNNING : RENDER_THREAD__FAILED);
+    renderThread__wake(rt);
+
+    if (!bound) return 1;
+
+    for (;;) {
+        renderThread__wait(rt, renderThread__has_packet);
+
+        // quitting drains the queue first.
+        if (atomic_load(&rt->submitted) == atomic_load(&rt->drawn)) break;
+        renderThread__draw_next(rt);
+    }
+
+    rt->context(false, rt->user);
+    return 0;
+}
+
+RENDERTHREADAPI bool renderThreadStart(RenderThread_t* rt, size_t packet_size, bool threaded,
+                                       render_packet_fn render, render_context_fn context, void* user) {
+    memset(rt, 0, sizeof(*rt));
+
+    // packets start on a cache line, the two threads write neighbouring ones.
+    rt->packet_size = (packet_size + 63) & ~(size_t) 63;
+    rt->packets     = mem_alloc(MEM_TAG_RENDER, rt->packet_size * RENDER_THREAD_PACKETS);
+    rt->render      = render;
+    rt->context     = context;
+    rt->user        = user;
+
+    if (!rt->packets) return false;
+
+    mutex_init(&rt->lock);
+    condvar_init(&rt->wake);
+
+    if (!threaded) return true;
+
+    // a context is current on one thread at a time.
+    context(false, user);
+    atomic_store(&rt->state, RENDER_THREAD__STARTING);
+
+    if (!thread_create(&rt->thread, renderThread__main, rt)) {
+        context(true, user);
+        fprintf(stderr, "renderThreadStart(): no thread, drawing on the caller\n");
+        return true;
+    }
+
+    renderThread__wait(rt, renderThread__started);
+
+    if (atomic_load(&rt->state) == RENDER_THREAD__FAILED) {
+        thread_join(&rt->thread);
+        context(true, user);
+        fprintf(stderr, "renderThreadStart(): the render thread couldn't take the context, drawing on the caller\n");
+        return true;
+    }
+
+    rt->threaded = true;
+    return true;
+}
+
+RENDERTHREADAPI void renderThreadStop(RenderThread_t* rt) {
+    if (!rt->packets) return;
+
+    if (rt->threaded) {
+        atomic_store(&rt->state, RENDER_THREAD__QUIT);
+        renderThread__wake(rt);
+        thread_join(&rt->thread);
+
+        rt->context(true, rt->user);
+        rt->threaded = false;
+    }
+
+    condvar_destroy(&rt->wake);
+    mutex_destroy(&rt->lock);
+
+    mem_free(rt->packets);
+    rt->packets = NULL;
+}
+
+RENDERTHREADAPI void* renderThreadBeginPacket(RenderThread_t* rt) {
+    if (rt->threaded && !renderThread__has_slot(rt)) {
+        PROFILE_ZONE("wait for render thread");
+        rt->producer_waits++;
+        renderThread__wait(rt, renderThread__has_slot);
+    }
+
+    return renderThread__slot(rt, atomic_load(&rt->submitted));
+}
+
+RENDERTHREADAPI void renderThreadSubmit(RenderThread_t* rt) {
+    atomic_fetch_add(&rt->submitted, 1);
+
+    if (rt->threaded) renderThread__wake(rt);
+    else              renderThread__draw_next(rt);
+}
+
+RENDERTHREADAPI void renderThreadFlush(RenderThread_t* rt) {
+    if (rt->threaded) renderThread__wait(rt, renderThread__all_drawn);
+}
+
+#endif // RENDERTHREAD_IMPLEMENTATION
@@ -30,11 +30,20 @@ uniform Light lights[MAX_LIGHT];
 uniform int   light_count;
 uniform vec3  camera_pos;
 
-// mesh textures
-uniform sampler2D albedo_texture;
-uniform sampler2D normal_map_texture;
-uniform sampler2D roughness_texture;
-uniform sampler2D specular_map_texture;
+// mesh textures: one texture array page per slot, see material.h
+#define TEXTURE_ALBEDO_MAP   0
+#define TEXTURE_NORMAL_MAP   1
+#define TEXTURE_ROUGHNESS    2
+#define TEXTURE_SPECULAR_MAP 3
+
+uniform sampler2DArray albedo_texture;
+uniform sampler2DArray normal_map_texture;
+uniform sampler2DArray roughness_texture;
+uniform sampler2DArray specular_map_texture;
+
+uniform int   texture_layers[4];     // -1: no texture in this slot
+uniform vec4  texture_uv_rects[4];   // scale xy, offset zw inside the layer
+uniform float texture_min_lods[4];   // finest level holding data
 
 uniform int hasTangentAttrib;
 in mat3 TBN;
@@ -42,9 +51,17 @@ in mat3 TBN;
 in vec3 tangent_out;
 in vec3 bitangent_out;
 
-bool validTexture(sampler2D texture) {
-    ivec2 size  = textureSize(texture, 0);
-    return size.x != 1 && size.y != 1;
+bool validTexture(int slot) {
+    return texture_layers[slot] >= 0;
+}
+
+// uv wraps inside the slot's rect, the lod comes from the unwrapped uv so the wrap doesn't spike it.
+vec4 sampleTexture(sampler2DArray tex, int slot) {
+    vec4  rect = texture_uv_rects[slot];
+    float lod  = max(textureQueryLod(tex, frag_uv * rect.xy).y, texture_min_lods[slot]);
+    vec2  st   = fract(frag_uv) * rect.xy + rect.zw;
+
+    return textureLod(tex, vec3(st, float(texture_layers[slot])), lod);
 }
 
 vec3 computeRadiance(Light light, vec3 norm, float radiance, vec3 lightDir, vec3 viewDir, float specular, float roughness) {
@@ -85,22 +102,22 @@ vec3 computeColor() {
     // vec3 ao             = vec3(0);
     float ambientFactor = .4;
 
-    float specular  = texture(specular_map_texture, frag_uv).r;
+    float specular  = 0.5;
     float roughness = .2;
     vec3 normal     = frag_norm;
-    vec3 albedo     = vec3(texture(albedo_texture, frag_uv));
+    vec3 albedo     = no_color_attrib == 1 ? color : vec3(frag_color);
 
-    if (!validTexture(albedo_texture))
-        albedo = no_color_attrib == 1 ? color : vec3(frag_color);
+    if (validTexture(TEXTURE_ALBEDO_MAP))
+        albedo = vec3(sampleTexture(albedo_texture, TEXTURE_ALBEDO_MAP));
 
-    if (!validTexture(specular_map_texture)) {
-        specular = 0.5;
+    if (validTexture(TEXTURE_SPECULAR_MAP)) {
+        specular = sampleTexture(specular_map_texture, TEXTURE_SPECULAR_MAP).r;
     }
 
-    if (validTexture(normal_map_texture) && hasTangentAttrib == 1) {
-        normal = vec3(texture(normal_map_texture, frag_uv));
-        // tangent space normal
-        normal = TBN * normalize(normal * 2.0 - 1.0);
+    if (validTexture(TEXTURE_NORMAL_MAP) && hasTangentAttrib == 1) {
+        // tangent space normal, z is rebuilt so two channel (BC5) normal maps work too.
+        vec2 xy = sampleTexture(normal_map_texture, TEXTURE_NORMAL_MAP).rg * 2.0 - 1.0;
+        normal  = TBN * vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
     }
 
     // radiance out
@@ -0,0 +1,553 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "file.h"
+#include "gl_gfx.h"
+#include "jobs.h"
+#include "async_io.h"
+#include "cooked_texture.h"
+#include "material.h"
+#include "gpu_resources.h"
+#include "profiler.h"
+
+// Asynchronous texture streaming.
+//
+// textureStreamRequest() hands back a material texture right away, already sampleable: the
+// coarsest level of a cooked sibling, or a 1x1 mid grey stand-in (also a flat normal) when the
+// image has to be decoded first. The image is read through async_io.h, then decoded and
+// its mip chain built on the job pool; textureStreamUpdate() then gives it a texture array layer and uploads mips coarse to
+// fine through a pixel unpack buffer, never more than the per-frame byte budget, raising the
+// layer's min lod as levels land. Levels finer than what the texture covers on screen
+// (reported with textureStreamNoteUsage()) are held back until the texture gets bigger on
+// screen. A cooked sibling (see cooked_texture.h) is mapped instead of decoding the source
+// image, its levels are then streamed straight out of the mapping.
+//
+// Streamed textures register with the GPU memory manager (gpu_resources.h): when it runs over
+// budget a cold texture gives back its finest level, and is streamed again from the source
+// once it's drawn large enough to need it.
+
+#define TEXSTREAMAPI static
+
+#ifndef TEXTURE_STREAM_MAX_TEXTURES
+#   define TEXTURE_STREAM_MAX_TEXTURES 256
+#endif
+
+#define TEXTURE_STREAM_MAX_LEVELS      16
+#define TEXTURE_STREAM_DEFAULT_BUDGET  (4 * 1024 * 1024)
+#define TEXTURE_STREAM_PBO_COUNT       3
+// evictions stop once the largest side would drop below this.
+#define TEXTURE_STREAM_MIN_EVICT_SIZE  64
+
+typedef struct TextureStreamEntry_st TextureStreamEntry_t;
+
+typedef enum texture_stream_state_enum {
+    TEXSTREAM_DECODING,
+    TEXSTREAM_UPLOADING,
+    TEXSTREAM_RESIDENT,
+    TEXSTREAM_EVICTED,      // resident without its `dropped_levels` finest levels
+    TEXSTREAM_FAILED
+} texture_stream_state_t;
+
+struct TextureStreamEntry_st {
+    char                   path[256];
+    MaterialTexture_t      texture;
+    atomic_int             state;
+
+    // decoded on the job pool, level 0 is full resolution
+    unsigned char*         levels[TEXTURE_STREAM_MAX_LEVELS];
+    CookedTexture_t        cooked;           // levels point into this mapping when it is open
+    AsyncRead_t            read;             // the source image, until it is decoded
+    int                    level_count;
+    int                    width, height, channels;  // 4 channels unless compressed
+    GLenum                 internal_format;
+    int                    block_bytes;      // bytes per 4x4 block when block compressed, 0 otherwise
+
+    // upload progress, GL thread only
+    int                    resident_level;   // finest fully uploaded level, level_count when none
+    int                    upload_row;       // rows (block rows if compressed) of resident_level - 1 already uploaded
+    int                    wanted_level;     // finest level worth uploading for the current usage
+    float                  max_screen_size;  // largest on-screen size reported this frame, in pixels
+    int                    dropped_levels;   // finest levels given back to the memory manager
+    bool                   placeholder;      // the storage holds the 1x1 stand-in, not this texture
+};
+
+TEXSTREAMAPI bool              textureStreamInit(size_t upload_budget_bytes);
+TEXSTREAMAPI void              textureStreamShutdown(void);
+
+// GL thread. Returns immediately with a placeholder that is sampled until the data is streamed
+// in. Requesting a path again returns the same texture.
+TEXSTREAMAPI MaterialTexture_t textureStreamRequest(const char* path);
+// tells the streamer the texture covers about `screen_size_px` pixels across on screen this frame.
+TEXSTREAMAPI void              textureStreamNoteUsage(MaterialTexture_t texture, float screen_size_px);
+// GL thread, once per frame: uploads pending mips within the byte budget.
+TEXSTREAMAPI void              textureStreamUpdate(void);
+TEXSTREAMAPI bool              textureStreamIsResident(MaterialTexture_t texture);
+
+#ifdef TEXSTREAM_IMPLEMENTATION
+
+static struct {
+    TextureStreamEntry_t entries[TEXTURE_STREAM_MAX_TEXTURES];
+    int                  count;
+
+    GLuint               pbos[TEXTURE_STREAM_PBO_COUNT];
+    int                  pbo_index;
+    size_t               budget;
+
+    JobGroup_t           group;
+    bool                 initialized;
+} s_texstream;
+
+static int texstream__level_dim(int dim, int level) {
+    int d = dim >> level;
+    return d > 0 ? d : 1;
+}
+
+// uploads go by rows of texels, or rows of 4x4 blocks for compressed textures.
+static int texstream__level_rows(TextureStreamEntry_t* entry, int level) {
+    int lh = texstream__level_dim(entry->height, level);
+    return entry->block_bytes ? (lh + 3) / 4 : lh;
+}
+
+static size_t texstream__row_bytes(TextureStreamEntry_t* entry, int level) {
+    int lw = texstream__level_dim(entry->width, level);
+    return entry->block_bytes ? (size_t)((lw + 3) / 4) * entry->block_bytes : (size_t) lw * entry->channels;
+}
+
+static bool texstream__open_cooked(TextureStreamEntry_t* entry) {
+    char path[512];
+    if (!cookedTexturePath(entry->path, path, sizeof(path))) return false;
+    if (!cookedTextureOpen(path, &entry->cooked))           return false;
+
+    const CookedTextureHeader_t* header     = entry->cooked.header;
+    bool                         compressed = (header->flags & COOKED_TEXTURE_FLAG_COMPRESSED) != 0;
+
+    // layers are RGBA8 or block compressed and always hold the full chain, anything else goes through the decoder.
+    if ((!compressed && (header->gl_type != GL_UNSIGNED_BYTE || header->gl_format != GL_RGBA))
+        || (int) header->level_count != materialLevelCount((int) header->width, (int) header->height)) {
+        cookedTextureClose(&entry->cooked);
+        return false;
+    }
+
+    entry->level_count     = (int) header->level_count;
+    entry->width           = (int) header->width;
+    entry->height          = (int) header->height;
+    entry->channels        = (int) header->channels;
+    entry->internal_format = compressed ? header->gl_internal_format : GL_RGBA8;
+    entry->block_bytes     = 0;
+
+    if (compressed) {
+        const CookedTextureLevel_t* top = &header->levels[0];
+        entry->block_bytes = (int)(top->size / (((top->width + 3) / 4) * ((top->height + 3) / 4)));
+    }
+
+    for (int l = 0; l < entry->level_count; ++l) {
+        entry->levels[l] = (unsigned char*) entry->cooked.data + header->levels[l].offset;
+    }
+
+    return true;
+}
+
+static void texstream__decode_job(void* user) {
+    PROFILE_FUNCTION();
+    TextureStreamEntry_t* entry = (TextureStreamEntry_t*) user;
+    File_t*               file  = &entry->read.file;
+
+    // read_file() layout, the terminator isn't part of the image.
+    int w, h, c;
+    unsigned char* pixels = stbi_load_from_memory((const stbi_uc*) file->data, (int)(file->size - 1), &w, &h, &c, 4);
+    free_file(file);
+
+    if (!pixels) {
+        fprintf(stderr, "Failed to load texture: %s\n", entry->path);
+        atomic_store(&entry->state, TEXSTREAM_FAILED);
+        return;
+    }
+
+    entry->levels[0]       = pixels;
+    entry->level_count     = 1;
+    entry->width           = w;
+    entry->height          = h;
+    entry->channels        = 4;
+    entry->internal_format = GL_RGBA8;
+    entry->block_bytes     = 0;
+
+    while (entry->level_count < TEXTURE_STREAM_MAX_LEVELS) {
+        int l  = entry->level_count - 1;
+        int lw = texstream__level_dim(w, l);
+        int lh = texstream__level_dim(h, l);
+        if (lw == 1 && lh == 1) break;
+
+        unsigned char* next = materialDownsampleRGBA8(entry->levels[l], lw, lh);
+        if (!next) break;
+
+        entry->levels[entry->level_count++] = next;
+    }
+
+    entry->resident_level = entry->level_count;
+    entry->wanted_level   = entry->level_count - 1;
+    entry->upload_row     = 0;
+
+    // publishes the levels to the GL thread.
+    atomic_store(&entry->state, TEXSTREAM_UPLOADING);
+}
+
+// I/O thread.
+static void texstream__read_done(AsyncRead_t* read, void* user) {
+    TextureStreamEntry_t* entry = (TextureStreamEntry_t*) user;
+
+    if (!read->file.data) {
+        fprintf(stderr, "Failed to load texture: %s\n", entry->path);
+        atomic_store(&entry->state, TEXSTREAM_FAILED);
+        return;
+    }
+
+    jobs_submit(&s_texstream.group, texstream__decode_job, entry);
+}
+
+// a cooked sibling is mapped and streams as is, anything else is read, then decoded. The request
+// already looked for the sibling, only a texture streamed again after an eviction maps it here.
+static void texstream__load_job(void* user) {
+    PROFILE_FUNCTION();
+    TextureStreamEntry_t* entry = (TextureStreamEntry_t*) user;
+
+    if (entry->dropped_levels && texstream__open_cooked(entry)) {
+        entry->resident_level = entry->level_count;
+        entry->wanted_level   = entry->level_count - 1;
+        entry->upload_row     = 0;
+
+        atomic_store(&entry->state, TEXSTREAM_UPLOADING);
+        return;
+    }
+
+    async_io_read(&entry->read, entry->path, texstream__read_done, entry);
+}
+
+static void texstream__free_level(TextureStreamEntry_t* entry, int level) {
+    if (!entry->levels[level]) return;
+
+    if (entry->cooked.data) {
+        // level 0 goes last, nothing points into the mapping after it.
+        entry->levels[level] = NULL;
+        if (level == 0) cookedTextureClose(&entry->cooked);
+        return;
+    }
+
+    if (level == 0) stbi_image_free(entry->levels[0]);
+    else            mem_free(entry->levels[level]);
+
+    entry->levels[level] = NULL;
+}
+
+static TextureStreamEntry_t* texstream__find(MaterialTexture_t texture) {
+    if (!texture.id) return NULL;
+
+    for (int i = 0; i < s_texstream.count; ++i) {
+        MaterialTexture_t entry = s_texstream.entries[i].texture;
+        if (entry.id == texture.id && entry.generation == texture.generation) return &s_texstream.entries[i];
+    }
+    return NULL;
+}
+
+TEXSTREAMAPI bool textureStreamInit(size_t upload_budget_bytes) {
+    if (s_texstream.initialized) return true;
+
+    s_texstream.budget = upload_budget_bytes ? upload_budget_bytes : TEXTURE_STREAM_DEFAULT_BUDGET;
+
+    // uploads are split on row boundaries, a budget below one row of a large texture would never progress.
+    if (s_texstream.budget < 64 * 1024) s_texstream.budget = 64 * 1024;
+
+    glGenBuffers(TEXTURE_STREAM_PBO_COUNT, s_texstream.pbos);
+    for (int i = 0; i < TEXTURE_STREAM_PBO_COUNT; ++i) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, s_texstream.pbos[i]);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, s_texstream.budget, NULL, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    s_texstream.initialized = true;
+    return true;
+}
+
+TEXSTREAMAPI void textureStreamShutdown(void) {
+    if (!s_texstream.initialized) return;
+
+    // loads start reads, whose callbacks queue decodes.
+    jobs_wait(&s_texstream.group);
+    for (int i = 0; i < s_texstream.count; ++i) async_io_wait(&s_texstream.entries[i].read);
+    jobs_wait(&s_texstream.group);
+
+    for (int i = 0; i < s_texstream.count; ++i) {
+        TextureStreamEntry_t* entry = &s_texstream.entries[i];
+        for (int l = 0; l < entry->level_count; ++l) texstream__free_level(entry, l);
+    }
+
+    glDeleteBuffers(TEXTURE_STREAM_PBO_COUNT, s_texstream.pbos);
+    s_texstream.count       = 0;
+    s_texstream.initialized = false;
+}
+
+static void texstream__evict(void* user);
+
+// a cooked texture takes its layer at request time with the coarsest level (1x1, a few bytes)
+// uploaded straight from the mapping, the rest streams within the budget.
+static bool texstream__upload_coarsest(TextureStreamEntry_t* entry) {
+    if (!materialTextureAllocate(entry->texture, entry->internal_format, entry->width, entry->height)) {
+        for (int l = 0; l < entry->level_count; ++l) texstream__free_level(entry, l);
+        return false;
+    }
+
+    gpuResourceSetEvict(materialTextureResource(entry->texture), texstream__evict, entry);
+
+    int                         coarsest = entry->level_count - 1;
+    const CookedTextureLevel_t* level    = &entry->cooked.header->levels[coarsest];
+
+    materialTextureUploadRows(entry->texture, coarsest, 0, (int) level->height, entry->levels[coarsest], level->size);
+    materialTextureSetMinLod(entry->texture, (float) coarsest);
+
+    entry->resident_level = coarsest;
+    entry->wanted_level   = coarsest;
+    entry->upload_row     = 0;
+    texstream__free_level(entry, coarsest);
+
+    atomic_store(&entry->state, coarsest == 0 ? TEXSTREAM_RESIDENT : TEXSTREAM_UPLOADING);
+    return true;
+}
+
+TEXSTREAMAPI MaterialTexture_t textureStreamRequest(const char* path) {
+    MaterialTexture_t texture = {0};
+    if (!s_texstream.initialized || !path) return texture;
+
+    // a material used many times streams its textures once.
+    for (int i = 0; i < s_texstream.count; ++i) {
+        if (strcmp(s_texstream.entries[i].path, path) == 0) return s_texstream.entries[i].texture;
+    }
+
+    if (s_texstream.count >= TEXTURE_STREAM_MAX_TEXTURES) return texture;
+
+    texture = materialTextureReserve();
+    if (!texture.id) return texture;
+
+    TextureStreamEntry_t* entry = &s_texstream.entries[s_texstream.count++];
+    memset(entry, 0, sizeof(*entry));
+    snprintf(entry->path, sizeof(entry->path), "%s", path);
+    entry->texture = texture;
+
+    if (texstream__open_cooked(entry) && texstream__upload_coarsest(entry)) return texture;
+
+    // nothing cooked to show, the stand-in covers the read and the decode.
+    static const unsigned char grey[4] = { 128, 128, 128, 255 };
+
+    if (materialTextureAllocate(texture, GL_RGBA8, 1, 1)) {
+        materialTextureUploadRows(texture, 0, 0, 1, grey, sizeof(grey));
+        materialTextureSetMinLod(texture, 0.0f);
+        entry->placeholder = true;
+    }
+
+    atomic_store(&entry->state, TEXSTREAM_DECODING);
+    jobs_submit(&s_texstream.group, texstream__load_job, entry);
+
+    return texture;
+}
+
+TEXSTREAMAPI void textureStreamNoteUsage(MaterialTexture_t texture, float screen_size_px) {
+    TextureStreamEntry_t* entry = texstream__find(texture);
+    if (entry && screen_size_px > entry->max_screen_size) entry->max_screen_size = screen_size_px;
+}
+
+TEXSTREAMAPI bool textureStreamIsResident(MaterialTexture_t texture) {
+    TextureStreamEntry_t* entry = texstream__find(texture);
+    return entry && atomic_load(&entry->state) == TEXSTREAM_RESIDENT;
+}
+
+// finest mip whose texel density still maps to at least one pixel on screen.
+static int texstream__level_for_size(TextureStreamEntry_t* entry, float screen_size_px) {
+    int   size  = entry->width > entry->height ? entry->width : entry->height;
+    int   level = 0;
+    float texels = (float) size;
+
+    while (level < entry->level_count - 1 && texels * 0.5f >= screen_size_px) {
+        texels *= 0.5f;
+        level++;
+    }
+
+    return level;
+}
+
+static int texstream__wanted_level(TextureStreamEntry_t* entry) {
+    if (entry->max_screen_size <= 0.0f) return entry->wanted_level;
+
+    int level = texstream__level_for_size(entry, entry->max_screen_size);
+
+    // only ever refine, dropping resident levels is the memory manager's call.
+    return level < entry->wanted_level ? level : entry->wanted_level;
+}
+
+// memory manager callback: the finest level still on the GPU goes, the texture moves to a
+// layer half the size. Only when that doesn't cost more than it gives back: with no free layer
+// of the smaller size a page is created or doubled, while the layer left behind only comes back
+// once it (and the ones after it) can be trimmed off its page.
+static void texstream__evict(void* user) {
+    TextureStreamEntry_t* entry = (TextureStreamEntry_t*) user;
+    int                   state = atomic_load(&entry->state);
+
+    if (state != TEXSTREAM_RESIDENT && state != TEXSTREAM_EVICTED) return;
+
+    int dropped = entry->dropped_levels + 1;
+    int width   = texstream__level_dim(entry->width,  dropped);
+    int height  = texstream__level_dim(entry->height, dropped);
+
+    if ((width > height ? width : height) < TEXTURE_STREAM_MIN_EVICT_SIZE) return;
+
+    size_t allocated, released;
+    if (!materialTextureResizeCost(entry->texture, width, height, &allocated, &released) || allocated > released) return;
+    if (!materialTextureResize(entry->texture, width, height)) return;
+
+    entry->dropped_levels = dropped;
+    atomic_store(&entry->state, TEXSTREAM_EVICTED);
+
+    materialTrimPages();
+}
+
+typedef struct TextureStreamUpload_st {
+    TextureStreamEntry_t* entry;
+    int                   level;
+    int                   row;
+    int                   rows;
+    size_t                offset;     // in the frame's unpack buffer
+    bool                  completes;  // last rows of the level: make it sampleable
+} TextureStreamUpload_t;
+
+#define TEXTURE_STREAM_MAX_UPLOADS 64
+
+TEXSTREAMAPI void textureStreamUpdate(void) {
+    PROFILE_FUNCTION();
+    if (!s_texstream.initialized) return;
+
+    TextureStreamUpload_t uploads[TEXTURE_STREAM_MAX_UPLOADS];
+    int                   upload_count = 0;
+    size_t                budget       = s_texstream.budget;
+    size_t                used         = 0;
+    unsigned char*        mapped       = NULL;
+
+    // 1. pick the rows that fit the budget and copy them into this frame's unpack buffer.
+    for (int i = 0; i < s_texstream.count && used < budget && upload_count < TEXTURE_STREAM_MAX_UPLOADS; ++i) {
+        TextureStreamEntry_t* entry = &s_texstream.entries[i];
+
+        int state = atomic_load(&entry->state);
+
+        if (state == TEXSTREAM_EVICTED) {
+            // drawn big enough to need a dropped level again: decode it all, only those get uploaded.
+            if (entry->max_screen_size > 0.0f
+                && texstream__level_for_size(entry, entry->max_screen_size) < entry->dropped_levels) {
+                atomic_store(&entry->state, TEXSTREAM_DECODING);
+                jobs_submit(&s_texstream.group, texstream__load_job, entry);
+            }
+            entry->max_screen_size = 0.0f;
+            continue;
+        }
+
+        if (state != TEXSTREAM_UPLOADING) continue;
+
+        if (entry->dropped_levels) {
+            // back to full size, the coarse levels come along and don't need uploading.
+            if (!materialTextureResize(entry->texture, entry->width, entry->height)) {
+                for (int l = 0; l < entry->level_count; ++l) texstream__free_level(entry, l);
+                atomic_store(&entry->state, TEXSTREAM_EVICTED);
+                continue;
+            }
+
+            for (int l = entry->dropped_levels; l < entry->level_count; ++l) texstream__free_level(entry, l);
+            entry->resident_level = entry->dropped_levels;
+            entry->dropped_levels = 0;
+        }
+
+        // the layer is taken once the size and format are known, before anything is mapped. It
+        // replaces the stand-in, whose texel the coarsest level takes over within this frame.
+        if (entry->placeholder || !materialTextureHasStorage(entry->texture)) {
+            bool replaced      = entry->placeholder;
+            entry->placeholder = false;
+
+            if (!materialTextureAllocate(entry->texture, entry->internal_format, entry->width, entry->height)) {
+                fprintf(stderr, "Failed to allocate texture layer: %s\n", entry->path);
+                for (int l = 0; l < entry->level_count; ++l) texstream__free_level(entry, l);
+                atomic_store(&entry->state, TEXSTREAM_FAILED);
+                continue;
+            }
+
+            gpuResourceSetEvict(materialTextureResource(entry->texture), texstream__evict, entry);
+            if (replaced) materialTrimPages();
+        }
+
+        entry->wanted_level    = texstream__wanted_level(entry);
+        entry->max_screen_size = 0.0f;
+
+        while (entry->resident_level > entry->wanted_level && used < budget && upload_count < TEXTURE_STREAM_MAX_UPLOADS) {
+            int    level     = entry->resident_level - 1;
+            int    lh        = texstream__level_rows(entry, level);
+            size_t row_bytes = texstream__row_bytes(entry, level);
+            size_t rows      = (budget - used) / row_bytes;
+
+            if (rows == 0) break;
+            if (rows > (size_t)(lh - entry->upload_row)) rows = lh - entry->upload_row;
+
+            if (!mapped) {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, s_texstream.pbos[s_texstream.pbo_index]);
+                // invalidating the whole buffer lets the driver orphan it instead of waiting on the GPU.
+                mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, budget, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+                if (!mapped) break;
+            }
+
+            size_t bytes = rows * row_bytes;
+            memcpy(mapped + used, entry->levels[level] + (size_t) entry->upload_row * row_bytes, bytes);
+
+            uploads[upload_count++] = (TextureStreamUpload_t) {
+                .entry     = entry,
+                .level     = level,
+                .row       = entry->upload_row,
+                .rows      = (int) rows,
+                .offset    = used,
+                .completes = entry->upload_row + (int) rows == lh
+            };
+
+            used              += bytes;
+            entry->upload_row += rows;
+
+            if (entry->upload_row < lh) break;
+
+            // the rows live in the unpack buffer now, the CPU copy can go.
+            entry->resident_level = level;
+            entry->upload_row     = 0;
+            texstream__free_level(entry, level);
+        }
+    }
+
+    if (!mapped) return;
+
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    s_texstream.pbo_index = (s_texstream.pbo_index + 1) % TEXTURE_STREAM_PBO_COUNT;
+
+    // 2. source every upload from the buffer.
+    for (int i = 0; i < upload_count; ++i) {
+        TextureStreamUpload_t* up    = &uploads[i];
+        TextureStreamEntry_t*  entry = up->entry;
+        int    lh     = texstream__level_dim(entry->height, up->level);
+        size_t bytes  = (size_t) up->rows * texstream__row_bytes(entry, up->level);
+        int    y      = entry->block_bytes ? up->row * 4 : up->row;
+        int    height = entry->block_bytes ? (up->rows * 4 < lh - y ? up->rows * 4 : lh - y) : up->rows;
+
+        materialTextureUploadRows(entry->texture, up->level, y, height, (void*)(uintptr_t) up->offset, bytes);
+
+        if (up->completes) {
+            // levels are filled coarse to fine, so [level, last] is always a complete chain.
+            materialTextureSetMinLod(entry->texture, (float) up->level);
+
+            if (up->level == 0) atomic_store(&entry->state, TEXSTREAM_RESIDENT);
+        }
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+#endif // TEXSTREAM_IMPLEMENTATION
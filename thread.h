@@ -0,0 +1,172 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#if defined(_WIN32)
+#   include <windows.h>
+#else
+#   include <pthread.h>
+#   include <sched.h>
+#   include <unistd.h>
+#endif // defined(_WIN32)
+
+#ifndef THREADAPI
+#   define THREADAPI extern
+#endif
+
+typedef struct Thread_st  Thread_t;
+typedef struct Mutex_st   Mutex_t;
+typedef struct CondVar_st CondVar_t;
+
+typedef int (*thread_fn)(void* user);
+
+struct Thread_st {
+#if defined(_WIN32)
+    HANDLE    handle;
+#else
+    pthread_t handle;
+#endif
+    thread_fn fn;
+    void*     user;
+    bool      running;
+};
+
+struct Mutex_st {
+#if defined(_WIN32)
+    SRWLOCK         lock;
+#else
+    pthread_mutex_t lock;
+#endif
+};
+
+struct CondVar_st {
+#if defined(_WIN32)
+    CONDITION_VARIABLE cv;
+#else
+    pthread_cond_t     cv;
+#endif
+};
+
+// thread
+THREADAPI bool  thread_create(Thread_t* thread, thread_fn fn, void* user);
+THREADAPI int   thread_join(Thread_t* thread);
+THREADAPI int   thread_cpu_count(void);
+THREADAPI void  thread_sleep_ms(uint32_t ms);
+THREADAPI void  thread_yield(void);
+
+// mutex
+THREADAPI void  mutex_init(Mutex_t* mutex);
+THREADAPI void  mutex_destroy(Mutex_t* mutex);
+THREADAPI void  mutex_lock(Mutex_t* mutex);
+THREADAPI void  mutex_unlock(Mutex_t* mutex);
+
+// condition variable
+THREADAPI void  condvar_init(CondVar_t* cv);
+THREADAPI void  condvar_destroy(CondVar_t* cv);
+THREADAPI void  condvar_wait(CondVar_t* cv, Mutex_t* mutex);
+THREADAPI void  condvar_signal(CondVar_t* cv);
+THREADAPI void  condvar_broadcast(CondVar_t* cv);
+
+#ifdef THREAD_IMPLEMENTATION
+
+#if defined(_WIN32)
+
+static DWORD WINAPI thread__entry_win(LPVOID param) {
+    Thread_t* thread = (Thread_t*) param;
+    return (DWORD) thread->fn(thread->user);
+}
+
+THREADAPI bool thread_create(Thread_t* thread, thread_fn fn, void* user) {
+    if (!thread || !fn) return false;
+
+    thread->fn      = fn;
+    thread->user    = user;
+    thread->handle  = CreateThread(NULL, 0, thread__entry_win, thread, 0, NULL);
+    thread->running = thread->handle != NULL;
+
+    return thread->running;
+}
+
+THREADAPI int thread_join(Thread_t* thread) {
+    if (!thread || !thread->running) return -1;
+
+    DWORD code = 0;
+    WaitForSingleObject(thread->handle, INFINITE);
+    GetExitCodeThread(thread->handle, &code);
+    CloseHandle(thread->handle);
+    thread->running = false;
+
+    return (int) code;
+}
+
+THREADAPI int thread_cpu_count(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int) info.dwNumberOfProcessors : 1;
+}
+
+THREADAPI void thread_sleep_ms(uint32_t ms) { Sleep(ms); }
+THREADAPI void thread_yield(void)           { SwitchToThread(); }
+
+THREADAPI void mutex_init(Mutex_t* mutex)    { InitializeSRWLock(&mutex->lock); }
+THREADAPI void mutex_destroy(Mutex_t* mutex) { (void) mutex; }
+THREADAPI void mutex_lock(Mutex_t* mutex)    { AcquireSRWLockExclusive(&mutex->lock); }
+THREADAPI void mutex_unlock(Mutex_t* mutex)  { ReleaseSRWLockExclusive(&mutex->lock); }
+
+THREADAPI void condvar_init(CondVar_t* cv)                 { InitializeConditionVariable(&cv->cv); }
+THREADAPI void condvar_destroy(CondVar_t* cv)              { (void) cv; }
+THREADAPI void condvar_wait(CondVar_t* cv, Mutex_t* mutex) { SleepConditionVariableSRW(&cv->cv, &mutex->lock, INFINITE, 0); }
+THREADAPI void condvar_signal(CondVar_t* cv)               { WakeConditionVariable(&cv->cv); }
+THREADAPI void condvar_broadcast(CondVar_t* cv)            { WakeAllConditionVariable(&cv->cv); }
+
+#else
+
+static void* thread__entry_posix(void* param) {
+    Thread_t* thread = (Thread_t*) param;
+    return (void*)(intptr_t) thread->fn(thread->user);
+}
+
+THREADAPI bool thread_create(Thread_t* thread, thread_fn fn, void* user) {
+    if (!thread || !fn) return false;
+
+    thread->fn      = fn;
+    thread->user    = user;
+    thread->running = pthread_create(&thread->handle, NULL, thread__entry_posix, thread) == 0;
+
+    return thread->running;
+}
+
+THREADAPI int thread_join(Thread_t* thread) {
+    if (!thread || !thread->running) return -1;
+
+    void* code = NULL;
+    pthread_join(thread->handle, &code);
+    thread->running = false;
+
+    return (int)(intptr_t) code;
+}
+
+THREADAPI int thread_cpu_count(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int) count : 1;
+}
+
+THREADAPI void thread_sleep_ms(uint32_t ms) { usleep(ms * 1000); }
+THREADAPI void thread_yield(void)           { sched_yield(); }
+
+THREADAPI void mutex_init(Mutex_t* mutex)    { pthread_mutex_init(&mutex->lock, NULL); }
+THREADAPI void mutex_destroy(Mutex_t* mutex) { pthread_mutex_destroy(&mutex->lock); }
+THREADAPI void mutex_lock(Mutex_t* mutex)    { pthread_mutex_lock(&mutex->lock); }
+THREADAPI void mutex_unlock(Mutex_t* mutex)  { pthread_mutex_unlock(&mutex->lock); }
+
+THREADAPI void condvar_init(CondVar_t* cv)                 { pthread_cond_init(&cv->cv, NULL); }
+THREADAPI void condvar_destroy(CondVar_t* cv)              { pthread_cond_destroy(&cv->cv); }
+THREADAPI void condvar_wait(CondVar_t* cv, Mutex_t* mutex) { pthread_cond_wait(&cv->cv, &mutex->lock); }
+THREADAPI void condvar_signal(CondVar_t* cv)               { pthread_cond_signal(&cv->cv); }
+THREADAPI void condvar_broadcast(CondVar_t* cv)            { pthread_cond_broadcast(&cv->cv); }
+
+#endif // defined(_WIN32)
+
+#endif // THREAD_IMPLEMENTATION
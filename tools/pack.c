@@ -0,0 +1,384 @@
+// Asset packer.
+//
+//     pack [-z] <output.pack> <file | directory>...
+//
+// Collects every file under the given paths into one archive the runtime mounts instead of
+// opening loose files (see pack.h). Paths are stored as given, relative to where the packer
+// runs, so `pack assets.pack shaders resources` from the repository root serves the same
+// "./shaders/..." / "./resources/..." paths main.c asks for.
+//
+// Entries are written in path order, so files of one directory (usually loaded together) sit
+// next to each other in the archive. The directory is sorted by path hash for lookups.
+//
+// -z compresses entries in PACK_DEFAULT_CHUNK_SIZE chunks, on every core. A chunk that doesn't
+// shrink is stored raw, and a file that doesn't shrink by PACKER_MIN_SAVING percent overall
+// stays uncompressed so the runtime keeps serving it zero copy from the mapping.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#   include <windows.h>
+#else
+#   include <dirent.h>
+#   include <sys/stat.h>
+#   include <time.h>
+#endif // defined(_WIN32)
+
+#define ALLOCATOR_IMPLEMENTATION
+#include "allocator.h"
+
+#define FILE_IMPLEMENTATION
+#include "file.h"
+
+#define THREAD_IMPLEMENTATION
+#include "thread.h"
+
+#define JOBS_IMPLEMENTATION
+#include "jobs.h"
+
+#define LZCODEC_IMPLEMENTATION
+#include "lz_codec.h"
+
+#define PACK_IMPLEMENTATION
+#include "pack.h"
+
+#define PACKER_MIN_SAVING 10
+
+typedef struct PackSource_st   PackSource_t;
+typedef struct PackCompress_st PackCompress_t;
+
+struct PackSource_st {
+    char*       path;        // normalized, as stored
+    PackEntry_t entry;
+};
+
+struct PackCompress_st {
+    const uint8_t* src;
+    uint64_t       size;
+    uint8_t*       out;          // chunk i at i * PACK_DEFAULT_CHUNK_SIZE
+    uint32_t*      stored;       // the chunk table
+};
+
+static struct {
+    PackSource_t* sources;
+    int           count, capacity;
+} s_packer;
+
+// pack.h times decompression with it.
+uint64_t get_time_ns() {
+#if defined(_WIN32)
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((counter.QuadPart * 1000000000ULL) / frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+#endif
+}
+
+static bool packer__add_file(const char* path) {
+    char normalized[512];
+    if (pack_normalize_path(path, normalized, sizeof(normalized)) + 1 >= sizeof(normalized)) {
+        printf("pack: path too long, skipped: %s\n", path);
+        return true;
+    }
+
+    if (s_packer.count == s_packer.capacity) {
+        int           capacity = s_packer.capacity ? s_packer.capacity * 2 : 256;
+        PackSource_t* sources  = realloc(s_packer.sources, (size_t) capacity * sizeof(PackSource_t));
+        if (!sources) return false;
+
+        s_packer.sources  = sources;
+        s_packer.capacity = capacity;
+    }
+
+    PackSource_t* source = &s_packer.sources[s_packer.count++];
+    *source = (PackSource_t) { .path = strdup(normalized) };
+    source->entry.path_hash = pack_hash_path(source->path);
+
+    return source->path != NULL;
+}
+
+#if defined(_WIN32)
+
+static bool packer__add(const char* path) {
+    DWORD attributes = GetFileAttributesA(path);
+    if (attributes == INVALID_FILE_ATTRIBUTES) {
+        printf("pack: %s not found.\n", path);
+        return false;
+    }
+
+    if (!(attributes & FILE_ATTRIBUTE_DIRECTORY)) return packer__add_file(path);
+
+    char pattern[512];
+    snprintf(pattern, sizeof(pattern), "%s/*", path);
+
+    WIN32_FIND_DATAA found;
+    HANDLE           find = FindFirstFileA(pattern, &found);
+    if (find == INVALID_HANDLE_VALUE) return true;
+
+    bool ok = true;
+    do {
+        if (strcmp(found.cFileName, ".") == 0 || strcmp(found.cFileName, "..") == 0) continue;
+
+        char child[512];
+        snprintf(child, sizeof(child), "%s/%s", path, found.cFileName);
+        ok = packer__add(child);
+    } while (ok && FindNextFileA(find, &found));
+
+    FindClose(find);
+    return ok;
+}
+
+#else
+
+static bool packer__add(const char* path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        printf("pack: %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    if (!S_ISDIR(st.st_mode)) return packer__add_file(path);
+
+    DIR* dir = opendir(path);
+    if (!dir) return true;
+
+    bool           ok = true;
+    struct dirent* found;
+    while (ok && (found = readdir(dir))) {
+        if (strcmp(found->d_name, ".") == 0 || strcmp(found->d_name, "..") == 0) continue;
+
+        char child[512];
+        snprintf(child, sizeof(child), "%s/%s", path, found->d_name);
+        ok = packer__add(child);
+    }
+
+    closedir(dir);
+    return ok;
+}
+
+#endif // defined(_WIN32)
+
+static int packer__compare_paths(const void* a, const void* b) {
+    return strcmp(((const PackSource_t*) a)->path, ((const PackSource_t*) b)->path);
+}
+
+static int packer__compare_hashes(const void* a, const void* b) {
+    uint64_t ha = ((const PackEntry_t*) a)->path_hash;
+    uint64_t hb = ((const PackEntry_t*) b)->path_hash;
+    return (ha > hb) - (ha < hb);
+}
+
+static bool packer__pad(FILE* out, uint64_t* offset, uint64_t alignment) {
+    static const unsigned char zeros[PACK_ALIGNMENT] = {0};
+
+    uint64_t padding = (alignment - *offset % alignment) % alignment;
+    if (padding && fwrite(zeros, 1, (size_t) padding, out) != padding) return false;
+
+    *offset += padding;
+    return true;
+}
+
+static void packer__compress_chunks(int begin, int end, void* user) {
+    PackCompress_t* compress = (PackCompress_t*) user;
+
+    for (int i = begin; i < end; ++i) {
+        uint64_t offset = (uint64_t) i * PACK_DEFAULT_CHUNK_SIZE;
+        size_t   size   = (size_t)(compress->size - offset < PACK_DEFAULT_CHUNK_SIZE ? compress->size - offset : PACK_DEFAULT_CHUNK_SIZE);
+
+        // only worth it when it comes out smaller, otherwise the chunk is copied as is.
+        size_t stored = lz_compress(compress->src + offset, size, compress->out + offset, size - 1);
+        compress->stored[i] = stored ? (uint32_t) stored : (uint32_t) size | PACK_CHUNK_RAW;
+    }
+}
+
+// writes the entry data at the current position and fills in its size, flags and checksum.
+static bool packer__write_entry(FILE* out, const void* data, size_t size, bool compress, PackEntry_t* entry) {
+    entry->size        = size;
+    entry->stored_size = size;
+    entry->checksum    = pack_checksum(data, size);
+
+    if (!compress || size == 0) return size == 0 || fwrite(data, 1, size, out) == size;
+
+    int             chunk_count = (int)((size + PACK_DEFAULT_CHUNK_SIZE - 1) / PACK_DEFAULT_CHUNK_SIZE);
+    PackCompress_t  chunks      = {
+        .src    = (const uint8_t*) data,
+        .size   = size,
+        .out    = malloc(size),
+        .stored = malloc((size_t) chunk_count * sizeof(uint32_t))
+    };
+
+    bool ok = chunks.out && chunks.stored;
+
+    if (ok) {
+        jobs_parallel_for(chunk_count, 1, packer__compress_chunks, &chunks);
+
+        uint64_t stored_size = (uint64_t) chunk_count * sizeof(uint32_t);
+        for (int i = 0; i < chunk_count; ++i) stored_size += chunks.stored[i] & ~PACK_CHUNK_RAW;
+
+        if (stored_size * 100 > (uint64_t) size * (100 - PACKER_MIN_SAVING)) {
+            ok = fwrite(data, 1, size, out) == size;
+        } else {
+            entry->flags      |= PACK_ENTRY_COMPRESSED;
+            entry->stored_size = stored_size;
+
+            ok = fwrite(chunks.stored, sizeof(uint32_t), (size_t) chunk_count, out) == (size_t) chunk_count;
+
+            for (int i = 0; ok && i < chunk_count; ++i) {
+                uint64_t       offset = (uint64_t) i * PACK_DEFAULT_CHUNK_SIZE;
+                size_t         length = chunks.stored[i] & ~PACK_CHUNK_RAW;
+                const uint8_t* chunk  = (chunks.stored[i] & PACK_CHUNK_RAW) ? chunks.src + offset : chunks.out + offset;
+
+                ok = fwrite(chunk, 1, length, out) == length;
+            }
+        }
+    }
+
+    free(chunks.out);
+    free(chunks.stored);
+    return ok;
+}
+
+static void packer__usage(void) {
+    printf("usage: pack [-z] <output%s> <file | directory>...\n", PACK_EXTENSION);
+}
+
+int main(int argc, char** argv) {
+    int  first    = 1;
+    bool compress = false;
+
+    if (argc > 1 && strcmp(argv[1], "-z") == 0) {
+        compress = true;
+        first++;
+    }
+
+    if (argc - first < 2) {
+        packer__usage();
+        return 1;
+    }
+
+    const char* output = argv[first];
+
+    for (int i = first + 1; i < argc; ++i) {
+        if (!packer__add(argv[i])) return 1;
+    }
+
+    if (compress) jobs_init(0);
+
+    // the archive being written may sit in one of the inputs.
+    char normalized_output[512];
+    pack_normalize_path(output, normalized_output, sizeof(normalized_output));
+
+    qsort(s_packer.sources, (size_t) s_packer.count, sizeof(PackSource_t), packer__compare_paths);
+
+    FILE* out = fopen(output, "wb");
+    if (!out) {
+        printf("pack: can't write %s: %s\n", output, strerror(errno));
+        return 1;
+    }
+
+    PackHeader_t header     = { .magic = PACK_MAGIC, .version = PACK_VERSION, .chunk_size = PACK_DEFAULT_CHUNK_SIZE };
+    uint64_t     offset     = sizeof(header);
+    uint64_t     names      = 0;
+    uint64_t     raw_bytes  = 0;
+    int          compressed = 0;
+    bool         ok         = fwrite(&header, sizeof(header), 1, out) == 1;
+    int          kept       = 0;
+    int          next       = 0;
+
+    for (; ok && next < s_packer.count; ++next) {
+        PackSource_t* source = &s_packer.sources[next];
+
+        // the output itself and duplicates ("a/b" given twice, or a file and its directory).
+        if (strcmp(source->path, normalized_output) == 0
+            || (kept > 0 && strcmp(s_packer.sources[kept - 1].path, source->path) == 0)) {
+            free(source->path);
+            continue;
+        }
+
+        File_t file = map_file(source->path, FILE_ACCESS_SEQUENTIAL);
+        if (!file.data && !(file = read_file(source->path)).data) {
+            printf("pack: can't read %s.\n", source->path);
+            ok = false;
+            break;
+        }
+
+        // read_file() counts its terminator, empty files come back from it.
+        size_t size = file.mapped ? file.size : file.size - 1;
+
+        ok = packer__pad(out, &offset, PACK_ALIGNMENT)
+          && packer__write_entry(out, file.data, size, compress, &source->entry);
+
+        source->entry.offset      = offset;
+        source->entry.name_offset = (uint32_t) names;
+
+        offset    += source->entry.stored_size;
+        names     += strlen(source->path) + 1;
+        raw_bytes += size;
+        if (source->entry.flags & PACK_ENTRY_COMPRESSED) compressed++;
+
+        free_file(&file);
+        s_packer.sources[kept++] = *source;
+    }
+
+    PackEntry_t* entries = calloc((size_t) kept + 1, sizeof(PackEntry_t));
+    ok = ok && entries;
+
+    if (ok) {
+        for (int i = 0; i < kept; ++i) entries[i] = s_packer.sources[i].entry;
+        qsort(entries, (size_t) kept, sizeof(PackEntry_t), packer__compare_hashes);
+
+        for (int i = 1; i < kept; ++i) {
+            if (entries[i].path_hash == entries[i - 1].path_hash) printf("pack: hash collision, lookups compare names.\n");
+        }
+
+        ok = packer__pad(out, &offset, sizeof(uint64_t));
+
+        header.entry_count      = (uint32_t) kept;
+        header.directory_offset = offset;
+        header.names_offset     = offset + (uint64_t) kept * sizeof(PackEntry_t);
+        header.names_size       = names;
+    }
+
+    ok = ok && (kept == 0 || fwrite(entries, sizeof(PackEntry_t), (size_t) kept, out) == (size_t) kept);
+
+    for (int i = 0; ok && i < kept; ++i) {
+        ok = fwrite(s_packer.sources[i].path, strlen(s_packer.sources[i].path) + 1, 1, out) == 1;
+    }
+
+    // an empty names block still gets its terminator, the runtime checks for it.
+    if (ok && names == 0) {
+        header.names_size = 1;
+        ok = fputc('\0', out) != EOF;
+    }
+
+    ok = ok && fseek(out, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, out) == 1;
+    ok = fclose(out) == 0 && ok;
+
+    if (ok) {
+        printf("pack: %s, %d files (%d compressed), %.2f MB of data in %.2f MB\n", output, kept, compressed,
+            raw_bytes / (1024.0 * 1024.0), (header.names_offset + header.names_size) / (1024.0 * 1024.0));
+    } else {
+        printf("pack: failed to write %s.\n", output);
+        remove(output);
+    }
+
+    for (int i = 0;    i < kept;           ++i) free(s_packer.sources[i].path);
+    for (int i = next; i < s_packer.count; ++i) free(s_packer.sources[i].path);
+    free(s_packer.sources);
+    free(entries);
+    jobs_shutdown();
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,310 @@
+// Software canvas rasterizer check and benchmark.
+//
+//     rasterbench [-n primitives] [-r rounds]
+//
+// Draws the same generated scenes (rects, triangles, circles, lines, then all of them mixed)
+// into two copies of one canvas, once with olive.c's olivec_* calls and once through
+// canvas_raster.h, and compares them pixel for pixel. Scenes are deterministic, with negative
+// sizes, primitives half or fully off the canvas, and every alpha from 0 to 255 over a
+// background of varying alpha. Exits 1 at the first pixel that differs.
+//
+// Both paths are timed, best of `rounds`, and reported in primitives per second.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#   include <windows.h>
+#else
+#   include <time.h>
+#endif // defined(_WIN32)
+
+#define ALLOCATOR_IMPLEMENTATION
+#include "allocator.h"
+
+#define THREAD_IMPLEMENTATION
+#include "thread.h"
+
+#define JOBS_IMPLEMENTATION
+#include "jobs.h"
+
+#define OLIVEC_IMPLEMENTATION
+#include "deps/olivec/olive.c"
+
+#define RASTER_IMPLEMENTATION
+#include "canvas_raster.h"
+
+// the game's canvas, rows padded so stride and width differ.
+#define RASTERBENCH_WIDTH      (16 * 90)
+#define RASTERBENCH_HEIGHT     (9  * 90)
+#define RASTERBENCH_STRIDE     (RASTERBENCH_WIDTH + 16)
+#define RASTERBENCH_MARGIN     120     // primitives start this far off the canvas
+
+typedef enum rasterbench_scene_enum {
+    RASTERBENCH_RECTS,
+    RASTERBENCH_TRIANGLES,
+    RASTERBENCH_CIRCLES,
+    RASTERBENCH_LINES,
+    RASTERBENCH_MIXED,
+    RASTERBENCH_SCENE_COUNT
+} rasterbench_scene_t;
+
+static const char* s_sceneNames[RASTERBENCH_SCENE_COUNT] = { "rects", "triangles", "circles", "lines", "mixed" };
+
+typedef struct {
+    uint8_t  type;      // raster_prim_t
+    uint32_t color;
+    int      v[6];
+} BenchPrim_t;
+
+static uint64_t rasterbench__now_ns(void) {
+#if defined(_WIN32)
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((counter.QuadPart * 1000000000ULL) / frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+#endif
+}
+
+static uint32_t rasterbench__random(uint64_t* state) {
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (uint32_t)(*state >> 33);
+}
+
+static int rasterbench__range(uint64_t* state, int lo, int hi) {
+    return lo + (int)(rasterbench__random(state) % (uint32_t)(hi - lo + 1));
+}
+
+static uint32_t rasterbench__color(uint64_t* state) {
+    uint32_t color = rasterbench__random(state) & 0x00FFFFFF;
+    uint32_t pick  = rasterbench__random(state) % 8;
+
+    // transparent and opaque take their own paths, make sure both show up.
+    uint32_t alpha = pick == 0 ? 0 : pick < 3 ? 255 : rasterbench__random(state) & 0xFF;
+    return color | alpha << 24;
+}
+
+static void rasterbench__generate(BenchPrim_t* prims, int count, rasterbench_scene_t scene, uint64_t seed) {
+    uint64_t state = seed;
+
+    for (int i = 0; i < count; ++i) {
+        BenchPrim_t* prim = &prims[i];
+        int          type = scene == RASTERBENCH_MIXED ? RASTER_RECT + (int)(rasterbench__random(&state) % 4) : RASTER_RECT + (int) scene;
+
+        int x = rasterbench__range(&state, -RASTERBENCH_MARGIN, RASTERBENCH_WIDTH  + RASTERBENCH_MARGIN);
+        int y = rasterbench__range(&state, -RASTERBENCH_MARGIN, RASTERBENCH_HEIGHT + RASTERBENCH_MARGIN);
+
+        prim->type  = (uint8_t) type;
+        prim->color = rasterbench__color(&state);
+
+        switch (type) {
+            case RASTER_RECT:
+                prim->v[0] = x;
+                prim->v[1] = y;
+                prim->v[2] = rasterbench__range(&state, -100, 100);
+                prim->v[3] = rasterbench__range(&state, -100, 100);
+                break;
+            case RASTER_TRIANGLE:
+                // some flat and some single point ones among them.
+                for (int v = 0; v < 3; ++v) {
+                    prim->v[v * 2]     = x + rasterbench__range(&state, -90, 90);
+                    prim->v[v * 2 + 1] = y + rasterbench__range(&state, -90, 90);
+                }
+                if (rasterbench__random(&state) % 16 == 0) prim->v[3] = prim->v[1];
+                if (rasterbench__random(&state) % 32 == 0) {
+                    prim->v[2] = prim->v[4] = prim->v[0];
+                    prim->v[3] = prim->v[5] = prim->v[1];
+                }
+                break;
+            case RASTER_CIRCLE:
+                prim->v[0] = x;
+                prim->v[1] = y;
+                prim->v[2] = rasterbench__range(&state, -40, 80);
+                break;
+            case RASTER_LINE:
+                prim->v[0] = x;
+                prim->v[1] = y;
+                prim->v[2] = rasterbench__range(&state, -RASTERBENCH_MARGIN, RASTERBENCH_WIDTH  + RASTERBENCH_MARGIN);
+                prim->v[3] = rasterbench__range(&state, -RASTERBENCH_MARGIN, RASTERBENCH_HEIGHT + RASTERBENCH_MARGIN);
+                if (rasterbench__random(&state) % 32 == 0) prim->v[2] = x, prim->v[3] = y;
+                break;
+        }
+    }
+}
+
+static void rasterbench__background(uint32_t* pixels) {
+    uint64_t state = 0x5EED;
+    for (int i = 0; i < RASTERBENCH_STRIDE * RASTERBENCH_HEIGHT; ++i) pixels[i] = rasterbench__random(&state);
+}
+
+static void rasterbench__draw_olive(Olivec_Canvas canvas, const BenchPrim_t* prims, int count) {
+    for (int i = 0; i < count; ++i) {
+        const BenchPrim_t* p = &prims[i];
+
+        switch (p->type) {
+            case RASTER_RECT:     olivec_rect(canvas, p->v[0], p->v[1], p->v[2], p->v[3], p->color); break;
+            case RASTER_TRIANGLE: olivec_triangle(canvas, p->v[0], p->v[1], p->v[2], p->v[3], p->v[4], p->v[5], p->color); break;
+            case RASTER_CIRCLE:   olivec_circle(canvas, p->v[0], p->v[1], p->v[2], p->color); break;
+            case RASTER_LINE:     olivec_line(canvas, p->v[0], p->v[1], p->v[2], p->v[3], p->color); break;
+        }
+    }
+}
+
+static void rasterbench__record(Raster_t* raster, const BenchPrim_t* prims, int count) {
+    for (int i = 0; i < count; ++i) {
+        const BenchPrim_t* p = &prims[i];
+
+        switch (p->type) {
+            case RASTER_RECT:     raster_rect(raster, p->v[0], p->v[1], p->v[2], p->v[3], p->color); break;
+            case RASTER_TRIANGLE: raster_triangle(raster, p->v[0], p->v[1], p->v[2], p->v[3], p->v[4], p->v[5], p->color); break;
+            case RASTER_CIRCLE:   raster_circle(raster, p->v[0], p->v[1], p->v[2], p->color); break;
+            case RASTER_LINE:     raster_line(raster, p->v[0], p->v[1], p->v[2], p->v[3], p->color); break;
+        }
+    }
+}
+
+static bool rasterbench__draw_raster(Raster_t* raster, Olivec_Canvas canvas, const BenchPrim_t* prims, int count) {
+    raster_begin(raster, canvas);
+    rasterbench__record(raster, prims, count);
+    return raster_end(raster);
+}
+
+static bool rasterbench__compare(const char* name, const uint32_t* expected, const uint32_t* actual) {
+    for (int y = 0; y < RASTERBENCH_HEIGHT; ++y) {
+        for (int x = 0; x < RASTERBENCH_STRIDE; ++x) {
+            uint32_t e = expected[y * RASTERBENCH_STRIDE + x];
+            uint32_t a = actual[y * RASTERBENCH_STRIDE + x];
+            if (e == a) continue;
+
+            printf("rasterbench: %s: pixel (%d, %d) is 0x%08X, olive.c draws 0x%08X\n", name, x, y, a, e);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void rasterbench__usage(void) {
+    printf("usage: rasterbench [-n primitives] [-r rounds]\n");
+}
+
+int main(int argc, char** argv) {
+    int count  = 20000;
+    int rounds = 3;
+
+    for (int i = 1; i < argc; ++i) {
+        if      (strcmp(argv[i], "-n") == 0 && i + 1 < argc) count  = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) rounds = atoi(argv[++i]);
+        else {
+            rasterbench__usage();
+            return 1;
+        }
+    }
+
+    if (count <= 0 || rounds <= 0) {
+        rasterbench__usage();
+        return 1;
+    }
+
+    jobs_init(0);
+
+    size_t       canvas_size = (size_t) RASTERBENCH_STRIDE * RASTERBENCH_HEIGHT * sizeof(uint32_t);
+    uint32_t*    background  = mem_alloc(MEM_TAG_GENERAL, canvas_size);
+    uint32_t*    expected    = mem_alloc(MEM_TAG_GENERAL, canvas_size);
+    uint32_t*    actual      = mem_alloc(MEM_TAG_GENERAL, canvas_size);
+    BenchPrim_t* prims       = mem_alloc(MEM_TAG_GENERAL, (size_t) count * sizeof(BenchPrim_t));
+
+    if (!background || !expected || !actual || !prims) {
+        printf("rasterbench: out of memory.\n");
+        return 1;
+    }
+
+    rasterbench__background(background);
+
+    Olivec_Canvas olive_canvas  = olivec_canvas(expected, RASTERBENCH_WIDTH, RASTERBENCH_HEIGHT, RASTERBENCH_STRIDE);
+    Olivec_Canvas raster_canvas = olivec_canvas(actual,   RASTERBENCH_WIDTH, RASTERBENCH_HEIGHT, RASTERBENCH_STRIDE);
+    Raster_t      raster        = {0};
+
+#if defined(__AVX2__)
+    const char* simd = "AVX2";
+#else
+    const char* simd = "SSE2";
+#endif // defined(__AVX2__)
+
+    printf("rasterbench: %d primitives per scene on a %dx%d canvas, %d tiles of %d px, %d workers, %s spans\n",
+        count, RASTERBENCH_WIDTH, RASTERBENCH_HEIGHT,
+        ((RASTERBENCH_WIDTH + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE) * ((RASTERBENCH_HEIGHT + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE),
+        RASTER_TILE_SIZE, jobs_worker_count(), simd);
+
+    bool ok = true;
+
+    for (int scene = 0; scene < RASTERBENCH_SCENE_COUNT && ok; ++scene) {
+        rasterbench__generate(prims, count, (rasterbench_scene_t) scene, 0x1234 + (uint64_t) scene);
+
+        uint64_t olive_best  = UINT64_MAX;
+        uint64_t raster_best = UINT64_MAX;
+
+        for (int round = 0; round < rounds && ok; ++round) {
+            memcpy(expected, background, canvas_size);
+            uint64_t begin = rasterbench__now_ns();
+            rasterbench__draw_olive(olive_canvas, prims, count);
+            uint64_t elapsed = rasterbench__now_ns() - begin;
+            if (elapsed < olive_best) olive_best = elapsed;
+
+            memcpy(actual, background, canvas_size);
+            begin = rasterbench__now_ns();
+            if (!rasterbench__draw_raster(&raster, raster_canvas, prims, count)) {
+                printf("rasterbench: %s: out of memory.\n", s_sceneNames[scene]);
+                ok = false;
+                break;
+            }
+            elapsed = rasterbench__now_ns() - begin;
+            if (elapsed < raster_best) raster_best = elapsed;
+
+            ok = rasterbench__compare(s_sceneNames[scene], expected, actual);
+        }
+
+        if (!ok) break;
+
+        printf("  %-10s olive.c %9.2f ms %8.3f M prims/s | raster %8.2f ms %8.3f M prims/s, %7.1fx, %llu tile entries\n",
+            s_sceneNames[scene],
+            olive_best / 1e6,  count / (olive_best  / 1e9) / 1e6,
+            raster_best / 1e6, count / (raster_best / 1e9) / 1e6,
+            (double) olive_best / (double) raster_best, (unsigned long long) raster.binned);
+    }
+
+    // raster_fill() against olivec_fill(), then a scene on top of it.
+    if (ok) {
+        rasterbench__generate(prims, count, RASTERBENCH_MIXED, 0x4321);
+
+        memcpy(expected, background, canvas_size);
+        olivec_fill(olive_canvas, 0x80402010);
+        rasterbench__draw_olive(olive_canvas, prims, count);
+
+        memcpy(actual, background, canvas_size);
+        raster_begin(&raster, raster_canvas);
+        raster_fill(&raster, 0x80402010);
+        rasterbench__record(&raster, prims, count);
+        ok = raster_end(&raster) && rasterbench__compare("fill", expected, actual);
+    }
+
+    raster_release(&raster);
+    mem_free(prims);
+    mem_free(actual);
+    mem_free(expected);
+    mem_free(background);
+    jobs_shutdown();
+
+    printf(ok ? "rasterbench: every scene matches olive.c.\n" : "rasterbench: FAILED\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,396 @@
+// Offline texture cooker.
+//
+//     texcook [-linear | -normal] [-bc] <image> <output.ctex>
+//
+// Decodes the image once, builds its whole mip chain and writes it in the cooked container
+// the runtime maps and uploads as is (see cooked_texture.h).
+//
+// Color textures are decoded from sRGB, filtered in linear space and encoded back, so mips
+// don't darken. -linear keeps data textures (specular, masks...) as they are, -normal also
+// renormalizes tangent space normals after every filter step. Filtering runs on SSE2, one
+// RGBA texel per register, split in rows over the job pool.
+//
+// -bc block compresses every level (see bc_encode.h): BC1 for rgb color, BC3 for rgba, BC4
+// for data textures (the shaders only read their red channel) and BC5 for normal maps,
+// whose z the shader rebuilds from x and y.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <emmintrin.h>
+
+#include "deps/glad/glad.h"
+#include "deps/olivec/olive.c"
+
+#define ALLOCATOR_IMPLEMENTATION
+#include "allocator.h"
+
+#define FILE_IMPLEMENTATION
+#include "file.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "deps/stb_image/stb_image.h"
+
+#define THREAD_IMPLEMENTATION
+#include "thread.h"
+
+#define JOBS_IMPLEMENTATION
+#include "jobs.h"
+
+#define BCENCODE_IMPLEMENTATION
+#include "bc_encode.h"
+
+#include "cooked_texture.h"
+
+#define SRGB_ENCODE_STEPS 4096
+
+typedef struct CookImage_st CookImage_t;
+typedef struct CookPass_st  CookPass_t;
+
+// linear RGBA float texels, missing channels are 0 (alpha 1).
+struct CookImage_st {
+    float* texels;
+    int    width;
+    int    height;
+};
+
+struct CookPass_st {
+    const unsigned char* bytes;     // expand: decoded source
+    const CookImage_t*   src;       // downsample
+    CookImage_t*         dst;       // expand / downsample
+    unsigned char*       out;       // quantize: tightly packed level
+    int                  channels;
+    uint32_t             flags;
+};
+
+static float         s_srgb_decode[256];
+static unsigned char s_srgb_encode[SRGB_ENCODE_STEPS];
+
+static void texcook__init_tables(void) {
+    for (int i = 0; i < 256; ++i) {
+        float c = i / 255.0f;
+        s_srgb_decode[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    for (int i = 0; i < SRGB_ENCODE_STEPS; ++i) {
+        float l = i / (float)(SRGB_ENCODE_STEPS - 1);
+        float c = l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+        s_srgb_encode[i] = (unsigned char)(c * 255.0f + 0.5f);
+    }
+}
+
+static double texcook__now_ms(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// gray and gray+alpha images keep their gray value in channel 0.
+static bool texcook__is_color_channel(const CookPass_t* pass, int channel) {
+    if (!(pass->flags & COOKED_TEXTURE_FLAG_SRGB)) return false;
+    return pass->channels >= 3 ? channel < 3 : channel == 0;
+}
+
+static void texcook__expand_rows(int begin, int end, void* user) {
+    CookPass_t* pass = (CookPass_t*) user;
+    int         w    = pass->dst->width;
+    int         c    = pass->channels;
+
+    for (int y = begin; y < end; ++y) {
+        const unsigned char* src = pass->bytes + (size_t) y * w * c;
+        float*               dst = pass->dst->texels + (size_t) y * w * 4;
+
+        for (int x = 0; x < w; ++x, src += c, dst += 4) {
+            float texel[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+            for (int k = 0; k < c; ++k) {
+                texel[k] = texcook__is_color_channel(pass, k) ? s_srgb_decode[src[k]] : src[k] / 255.0f;
+            }
+
+            // gray+alpha keeps alpha in the alpha lane so both filter the same way.
+            if (c == 2) { texel[3] = texel[1]; texel[1] = 0.0f; }
+
+            _mm_storeu_ps(dst, _mm_loadu_ps(texel));
+        }
+    }
+}
+
+static __m128 texcook__renormalize(__m128 texel) {
+    const __m128 half = _mm_set1_ps(0.5f);
+    __m128       n    = _mm_sub_ps(_mm_add_ps(texel, texel), _mm_set1_ps(1.0f));
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, _mm_mul_ps(n, n));
+
+    float len2 = lanes[0] + lanes[1] + lanes[2];
+    if (len2 < 1e-12f) return texel;
+
+    __m128 packed = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(n, _mm_set1_ps(1.0f / sqrtf(len2))), half), half);
+
+    // alpha is not part of the normal, keep it filtered as is.
+    float out[4];
+    _mm_storeu_ps(out,   packed);
+    _mm_storeu_ps(lanes, texel);
+    out[3] = lanes[3];
+
+    return _mm_loadu_ps(out);
+}
+
+// 2x2 box filter, clamping on odd edges, in linear space.
+static void texcook__downsample_rows(int begin, int end, void* user) {
+    CookPass_t*        pass    = (CookPass_t*) user;
+    const CookImage_t* src     = pass->src;
+    CookImage_t*       dst     = pass->dst;
+    const __m128       quarter = _mm_set1_ps(0.25f);
+    bool               normal  = (pass->flags & COOKED_TEXTURE_FLAG_NORMAL) != 0;
+
+    for (int y = begin; y < end; ++y) {
+        int y0 = y * 2 < src->height ? y * 2 : src->height - 1;
+        int y1 = y0 + 1 < src->height ? y0 + 1 : y0;
+
+        const float* row0 = src->texels + (size_t) y0 * src->width * 4;
+        const float* row1 = src->texels + (size_t) y1 * src->width * 4;
+        float*       out  = dst->texels + (size_t) y * dst->width * 4;
+
+        for (int x = 0; x < dst->width; ++x, out += 4) {
+            int x0 = x * 2 < src->width ? x * 2 : src->width - 1;
+            int x1 = x0 + 1 < src->width ? x0 + 1 : x0;
+
+            __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0 + x0 * 4), _mm_loadu_ps(row0 + x1 * 4)),
+                                    _mm_add_ps(_mm_loadu_ps(row1 + x0 * 4), _mm_loadu_ps(row1 + x1 * 4)));
+            __m128 avg = _mm_mul_ps(sum, quarter);
+
+            if (normal) avg = texcook__renormalize(avg);
+
+            _mm_storeu_ps(out, avg);
+        }
+    }
+}
+
+static void texcook__quantize_rows(int begin, int end, void* user) {
+    CookPass_t*        pass = (CookPass_t*) user;
+    const CookImage_t* img  = pass->dst;
+    int                c    = pass->channels;
+
+    // color lanes index the sRGB encode table, the others go straight to 8 bits.
+    float scale[4];
+    bool  color[4];
+    for (int k = 0; k < 4; ++k) {
+        color[k] = k < 3 && texcook__is_color_channel(pass, k);
+        scale[k] = color[k] ? (float)(SRGB_ENCODE_STEPS - 1) : 255.0f;
+    }
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one  = _mm_set1_ps(1.0f);
+    const __m128 mul  = _mm_loadu_ps(scale);
+
+    for (int y = begin; y < end; ++y) {
+        const float*   src = img->texels + (size_t) y * img->width * 4;
+        unsigned char* dst = pass->out + (size_t) y * img->width * c;
+
+        for (int x = 0; x < img->width; ++x, src += 4, dst += c) {
+            __m128  v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src), zero), one);
+            __m128i q = _mm_cvtps_epi32(_mm_mul_ps(v, mul));
+
+            int32_t lanes[4];
+            _mm_storeu_si128((__m128i*) lanes, q);
+
+            for (int k = 0; k < 4; ++k) {
+                if (color[k]) lanes[k] = s_srgb_encode[lanes[k]];
+            }
+
+            if (c == 2) lanes[1] = lanes[3];
+            for (int k = 0; k < c; ++k) dst[k] = (unsigned char) lanes[k];
+        }
+    }
+}
+
+static bool texcook__write(const char* path, CookedTextureHeader_t* header, unsigned char** levels) {
+    FILE* fh = fopen(path, "wb");
+    if (!fh) {
+        printf("texcook: couldn't open %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    static const unsigned char padding[COOKED_TEXTURE_ALIGNMENT] = {0};
+    size_t written = 0;
+    bool   ok      = fwrite(header, sizeof(*header), 1, fh) == 1;
+    written       += sizeof(*header);
+
+    for (uint32_t i = 0; ok && i < header->level_count; ++i) {
+        size_t pad = header->levels[i].offset - written;
+        ok = ok && fwrite(padding, 1, pad, fh) == pad;
+        ok = ok && fwrite(levels[i], 1, header->levels[i].size, fh) == header->levels[i].size;
+        written += pad + header->levels[i].size;
+    }
+
+    if (fclose(fh) != 0) ok = false;
+    if (!ok) printf("texcook: failed writing %s\n", path);
+
+    return ok;
+}
+
+static bc_format_t texcook__bc_format(int channels, uint32_t flags) {
+    if (flags & COOKED_TEXTURE_FLAG_NORMAL)                   return BC_FORMAT_BC5;
+    if (channels == 2)                                        return BC_FORMAT_BC5;
+    if (channels == 1 || !(flags & COOKED_TEXTURE_FLAG_SRGB)) return BC_FORMAT_BC4;
+    return channels == 4 ? BC_FORMAT_BC3 : BC_FORMAT_BC1;
+}
+
+static void texcook__usage(void) {
+    printf("usage: texcook [-linear | -normal] [-bc] <image> <output%s>\n", COOKED_TEXTURE_EXTENSION);
+}
+
+int main(int argc, char** argv) {
+    uint32_t    flags  = COOKED_TEXTURE_FLAG_SRGB;
+    const char* input  = NULL;
+    const char* output = NULL;
+    bool        bc     = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if      (strcmp(argv[i], "-bc")     == 0) bc    = true;
+        else if (strcmp(argv[i], "-linear") == 0) flags = 0;
+        else if (strcmp(argv[i], "-normal") == 0) flags = COOKED_TEXTURE_FLAG_NORMAL;
+        else if (!input)                          input  = argv[i];
+        else if (!output)                         output = argv[i];
+        else { texcook__usage(); return 1; }
+    }
+
+    if (!input || !output) {
+        texcook__usage();
+        return 1;
+    }
+
+    double start = texcook__now_ms();
+
+    texcook__init_tables();
+    jobs_init(0);
+
+    int            width, height, channels;
+    unsigned char* pixels = stbi_load(input, &width, &height, &channels, 0);
+    if (!pixels) {
+        printf("texcook: failed to load %s: %s\n", input, stbi_failure_reason());
+        jobs_shutdown();
+        return 1;
+    }
+
+    double decoded = texcook__now_ms();
+
+    CookedTextureHeader_t header = {
+        .magic              = COOKED_TEXTURE_MAGIC,
+        .version            = COOKED_TEXTURE_VERSION,
+        .width              = (uint32_t) width,
+        .height             = (uint32_t) height,
+        .channels           = (uint32_t) channels,
+        .gl_type            = GL_UNSIGNED_BYTE,
+        .flags              = flags,
+    };
+
+    switch (channels) {
+        case 1:  header.gl_internal_format = GL_R8;    header.gl_format = GL_RED;  break;
+        case 2:  header.gl_internal_format = GL_RG8;   header.gl_format = GL_RG;   break;
+        case 3:  header.gl_internal_format = GL_RGB8;  header.gl_format = GL_RGB;  break;
+        default: header.gl_internal_format = GL_RGBA8; header.gl_format = GL_RGBA; break;
+    }
+
+    unsigned char* levels[COOKED_TEXTURE_MAX_LEVELS]  = {0};
+    unsigned char* encoded[COOKED_TEXTURE_MAX_LEVELS] = {0};
+    CookImage_t    current = { malloc((size_t) width * height * 4 * sizeof(float)), width, height };
+    CookImage_t    next    = {0};
+    bool           ok      = current.texels != NULL;
+
+    if (ok) {
+        CookPass_t expand = { .bytes = pixels, .dst = &current, .channels = channels, .flags = flags };
+        jobs_parallel_for(height, 16, texcook__expand_rows, &expand);
+    }
+
+    // same level size rule as the streamer and GL: halve, round down, never below 1.
+    while (ok && header.level_count < COOKED_TEXTURE_MAX_LEVELS) {
+        uint32_t              level = header.level_count;
+        uint32_t              size  = (uint32_t) current.width * current.height * channels;
+        CookedTextureLevel_t* entry = &header.levels[level];
+
+        *entry = (CookedTextureLevel_t) { 0, size, (uint32_t) current.width, (uint32_t) current.height };
+
+        // level 0 is the source itself, only mips go through the filter.
+        levels[level] = level == 0 ? pixels : malloc(size);
+        if (!levels[level]) { ok = false; break; }
+
+        if (level > 0) {
+            CookPass_t quantize = { .dst = &current, .out = levels[level], .channels = channels, .flags = flags };
+            jobs_parallel_for(current.height, 16, texcook__quantize_rows, &quantize);
+        }
+
+        header.level_count++;
+        if (current.width == 1 && current.height == 1) break;
+
+        next.width  = current.width  > 1 ? current.width  / 2 : 1;
+        next.height = current.height > 1 ? current.height / 2 : 1;
+        next.texels = malloc((size_t) next.width * next.height * 4 * sizeof(float));
+        if (!next.texels) { ok = false; break; }
+
+        CookPass_t downsample = { .src = &current, .dst = &next, .channels = channels, .flags = flags };
+        jobs_parallel_for(next.height, 16, texcook__downsample_rows, &downsample);
+
+        free(current.texels);
+        current = next;
+        next    = (CookImage_t) {0};
+    }
+
+    double      filtered = texcook__now_ms();
+    bc_format_t format   = texcook__bc_format(channels, flags);
+    double      psnr     = 0.0;
+
+    // every level is replaced by its blocks, the quality report is for the full resolution one.
+    if (ok && bc) {
+        header.gl_internal_format = bc_gl_internal_format(format);
+        header.gl_format          = 0;
+        header.gl_type            = 0;
+        header.flags             |= COOKED_TEXTURE_FLAG_COMPRESSED;
+
+        for (uint32_t i = 0; ok && i < header.level_count; ++i) {
+            CookedTextureLevel_t* entry = &header.levels[i];
+
+            entry->size = (uint32_t) bc_encoded_size(format, (int) entry->width, (int) entry->height);
+            encoded[i]  = malloc(entry->size);
+            if (!encoded[i]) { ok = false; break; }
+
+            bc_encode_image(format, levels[i], (int) entry->width, (int) entry->height, channels, encoded[i]);
+            if (i == 0) psnr = bc_psnr(format, levels[0], width, height, channels, encoded[0]);
+        }
+    }
+
+    double   compressed = texcook__now_ms();
+    uint32_t offset     = sizeof(CookedTextureHeader_t);
+
+    for (uint32_t i = 0; i < header.level_count; ++i) {
+        offset                  = (offset + COOKED_TEXTURE_ALIGNMENT - 1) & ~(uint32_t)(COOKED_TEXTURE_ALIGNMENT - 1);
+        header.levels[i].offset = offset;
+        offset                 += header.levels[i].size;
+    }
+
+    if (ok) ok = texcook__write(output, &header, bc ? encoded : levels);
+
+    if (ok) {
+        printf("texcook: %s -> %s  %dx%d x%d, %u levels, %.1f KB | decode %.1f ms, mips %.1f ms",
+            input, output, width, height, channels, header.level_count, offset / 1024.0,
+            decoded - start, filtered - decoded);
+
+        if (bc) printf(", %s %.1f ms (%.2f dB)", bc_format_name(format), compressed - filtered, psnr);
+
+        printf(", total %.1f ms\n", texcook__now_ms() - start);
+    }
+
+    for (uint32_t i = 0; i < COOKED_TEXTURE_MAX_LEVELS; ++i) free(encoded[i]);
+    for (uint32_t i = 1; i < COOKED_TEXTURE_MAX_LEVELS; ++i) free(levels[i]);
+    free(current.texels);
+    stbi_image_free(pixels);
+    jobs_shutdown();
+
+    return ok ? 0 : 1;
+}